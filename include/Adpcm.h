@@ -0,0 +1,26 @@
+/// \file Adpcm.h
+/// \brief IMA ADPCM, the 4 bit compression WAV files support, used to keep music small on disk and cheap to decode
+#pragma once
+#include <stdint.h>
+
+/// \brief WAV format tag for IMA ADPCM
+#define PNL_ADPCM_FORMAT ((int)0x11)
+
+/// \brief Bytes each channel gets in a block, what most encoders use at 44.1kHz
+#define PNL_ADPCM_CHANNEL_BYTES ((int)1024)
+
+/// \brief How many frames a block holds, the first of which is stored as-is in the block's header
+int pnlAdpcmBlockFrames(int blockAlign, int channels);
+
+/// \brief Encodes up to one block of interleaved mono or stereo samples
+///
+/// Frames past count are filled with the last one.
+/// \param indices Step index of each channel, carried over from the last block (start them at 0)
+/// \param out Where the block goes, blockAlign bytes
+void pnlAdpcmEncodeBlock(const int16_t *samples, int count, int channels, int blockAlign, int *indices, unsigned char *out);
+
+/// \brief Decodes a block into interleaved samples
+///
+/// A block cut short (the end of a file) is decoded as far as it goes.
+/// \return Number of frames written to out, 0 if the block is too short to have a header or isn't mono or stereo
+int pnlAdpcmDecodeBlock(const unsigned char *block, int size, int channels, int16_t *out);
@@ -0,0 +1,83 @@
+/// \file AssetArchive.h
+/// \brief One file holding every asset already decoded, mapped into memory instead of read
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// \brief Version written by the packer, archives with any other version are refused
+#define PNL_ARCHIVE_VERSION ((uint32_t)1)
+
+/// \brief Longest asset path an archive can hold, including the terminator
+#define PNL_ARCHIVE_PATH_LENGTH ((int)64)
+
+/// \brief Every payload starts on a multiple of this from the start of the archive
+#define PNL_ARCHIVE_ALIGNMENT ((int)64)
+
+/// \brief What a payload holds
+typedef enum {
+	ak_Raw = 0,     ///< The file as-is
+	ak_Pixels = 1,  ///< RGBA8 pixels, row by row
+	ak_Samples = 2, ///< Interleaved PCM samples from a WAV's data chunk
+	ak_MAX = 3,
+} PNLArchiveKind;
+
+/// \brief Start of an archive, followed by count entries sorted by path and then the payloads
+///
+/// Everything is little endian and laid out so it can be used straight out of the mapping.
+typedef struct PNLArchiveHeader {
+	char magic[4];     ///< "PNLA"
+	uint32_t version;  ///< PNL_ARCHIVE_VERSION
+	uint32_t count;    ///< Number of entries
+	uint32_t reserved;
+	uint64_t size;     ///< Size of the whole archive, anything shorter was cut off
+} PNLArchiveHeader;
+
+/// \brief Where an asset's payload is and how to read it
+typedef struct PNLArchiveEntry {
+	char path[PNL_ARCHIVE_PATH_LENGTH]; ///< Same path the ASSETS table uses
+	uint32_t kind;                      ///< A PNLArchiveKind
+	uint32_t width;                     ///< Pixels wide for ak_Pixels, channels for ak_Samples
+	uint32_t height;                    ///< Pixels tall for ak_Pixels, sample rate for ak_Samples
+	uint32_t bits;                      ///< Bits per sample for ak_Samples
+	uint64_t offset;                    ///< From the start of the archive
+	uint64_t size;                      ///< In bytes
+} PNLArchiveEntry;
+
+/// \brief How the packer should store an asset besides the default for its file type
+typedef enum {
+	ph_None = 0,
+	ph_Atlas = 1,  ///< PNG that goes on an atlas page instead of on its own (see Atlas.h)
+	ph_Stream = 2, ///< PCM WAV that's only ever streamed, stored as an IMA ADPCM WAV file (see Adpcm.h)
+	ph_MAX = 3,
+} PNLPackHint;
+
+/// \brief An archive mapped into memory, every payload is a pointer into the mapping
+typedef struct PNLAssetArchive {
+	const unsigned char *data;
+	size_t size;
+	const PNLArchiveHeader *header;
+	const PNLArchiveEntry *entries;
+	bool mapped;    ///< False if the platform couldn't map it and it was read into memory instead
+	void *handle;   ///< Platform mapping handle
+} *PNLAssetArchive;
+
+/// \brief Maps an archive, returns NULL if it doesn't exist or isn't a valid archive of this version
+PNLAssetArchive pnlAssetArchiveOpen(const char *filename);
+
+/// \brief Finds an asset by path, NULL if the archive doesn't have it
+const PNLArchiveEntry *pnlAssetArchiveFind(PNLAssetArchive archive, const char *path);
+
+/// \brief Gets a pointer to an entry's payload, valid until the archive is closed
+const void *pnlAssetArchiveData(PNLAssetArchive archive, const PNLArchiveEntry *entry);
+
+/// \brief Unmaps an archive
+void pnlAssetArchiveClose(PNLAssetArchive archive);
+
+/// \brief Decodes a list of asset files and writes them into an archive
+///
+/// PNGs are stored as pixels, WAVs as samples (or as compressed WAV files for ph_Stream) and anything
+/// else (fonts) as-is. Paths that can't be read or decoded are reported and left out.
+/// \param hints How to store each path, can be NULL
+/// \return False if the archive couldn't be written
+bool pnlAssetArchivePack(const char *filename, const char **paths, const PNLPackHint *hints, int count);
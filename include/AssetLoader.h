@@ -0,0 +1,117 @@
+/// \file AssetLoader.h
+/// \brief Decodes assets on worker threads while the main thread keeps drawing
+#pragma once
+#include <stdbool.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include <VK2D/VK2D.h>
+#include <JamUtil.h>
+#include "AssetArchive.h"
+#include "Atlas.h"
+#include "SoundPool.h"
+
+/// \brief What an asset turns into, decided the same way juLoaderCreate does
+typedef enum {
+	at_Texture = 0, ///< .png without a sprite size
+	at_Sprite = 1,  ///< .png with a sprite size
+	at_Font = 2,    ///< .jufnt
+	at_Sound = 3,   ///< .wav
+	at_MAX = 4,
+} PNLAssetType;
+
+/// \brief Where an asset is in loading, only ever moves forward
+typedef enum {
+	as_Queued = 0,   ///< Waiting for a worker
+	as_Decoded = 1,  ///< Worker is done with it, waiting for the main thread
+	as_Ready = 2,    ///< Usable
+	as_Failed = 3,   ///< Couldn't be loaded, getters return NULL for it
+} PNLAssetState;
+
+/// \brief One asset and everything loading it produces
+typedef struct PNLAsset {
+	const JULoadedAsset *spec; ///< Entry from the list the loader was made with
+	PNLAssetType type;
+	SDL_atomic_t state;        ///< A PNLAssetState
+
+	// Filled in by a worker
+	unsigned char *pixels;     ///< RGBA, images only
+	bool mapped;               ///< Pixels point into the archive instead of being decoded
+	const PNLAtlasRegion *region; ///< Where it is on an atlas page, it has no texture of its own if it's on one
+	int width, height;
+	PNLSound snd;              ///< Sounds are decoded all the way, nothing has to happen on the main thread
+	double decodeTime;         ///< Seconds a worker spent reading and decoding it
+
+	// Filled in by the main thread
+	double uploadTime;         ///< Seconds the main thread spent turning it into what the game uses
+	VK2DImage image;           ///< Backs tex, textures made from an image don't free it themselves
+	VK2DTexture tex;           ///< Images and the bitmap of sprites
+	JUSprite spr;
+	JUFont fnt;
+} PNLAsset;
+
+/// \brief A list of assets being decoded by a pool of threads
+///
+/// Anything that touches the renderer (uploading textures, building sprites and fonts) has to happen on the
+/// main thread, so workers only read and decode files and pnlAssetLoaderUpdate finishes
+/// them off a few at a time. Assets can be fetched once pnlAssetLoaderUpdate returns true.
+typedef struct PNLAssetLoader {
+	PNLAsset *assets;
+	int count;
+	PNLAssetArchive archive; ///< Images are taken from here instead of decoded if it has them
+	const PNLAtlasRegion *regions; ///< Atlas region table in the archive, NULL if it doesn't have one
+	int regionCount;
+	VK2DImage *pageImages;
+	VK2DTexture *pages;      ///< Atlas pages, uploaded before anything else is finished
+	int pageCount;
+	bool pagesReady;
+	SDL_atomic_t next;    ///< Next asset a worker will take
+	SDL_atomic_t decoded; ///< Assets workers have finished with
+	SDL_atomic_t workers; ///< Workers that have started, only the first few record to the profiler
+	int ready;            ///< Assets the main thread has finished with
+	SDL_Thread **threads;
+	int threadCount;
+	Uint64 start;         ///< When loading started
+	double loadTime;      ///< Seconds from creation until everything was ready
+} *PNLAssetLoader;
+
+/// \brief Starts decoding a list of assets in the same format juLoaderCreate takes on threadCount threads
+/// \param assets Must stay valid for as long as the loader is around
+/// \param threadCount Number of worker threads, anything below 1 decodes everything on the calling thread right now
+/// \param archive Packed archive to take images from, or NULL - it must stay open for as long as the loader
+///
+/// Images found in the archive are handed to the renderer straight out of the mapping, and images on its
+/// atlas pages become regions of those pages. Sounds in the archive are converted straight from
+/// its samples. Fonts are always loaded from their files since JamUtil can only load them by path.
+PNLAssetLoader pnlAssetLoaderCreate(JULoadedAsset *assets, int count, int threadCount, PNLAssetArchive archive);
+
+/// \brief Finishes decoded assets on the calling thread until budget seconds have passed
+/// \return True once every asset is ready or failed, the worker threads have been joined by then
+bool pnlAssetLoaderUpdate(PNLAssetLoader loader, double budget);
+
+/// \brief How far along loading is from 0 to 1, counting decoding and finishing equally
+double pnlAssetLoaderProgress(PNLAssetLoader loader);
+
+/// \brief Prints how long every asset took to decode and finish, slowest first
+void pnlAssetLoaderReport(PNLAssetLoader loader, FILE *out);
+
+/// \brief Gets a loaded texture by its path, NULL if it isn't one, failed or is on an atlas page
+VK2DTexture pnlAssetLoaderGetTexture(PNLAssetLoader loader, const char *path);
+
+/// \brief Gets a loaded texture by its path as either all of its own texture or its region of an atlas page
+///
+/// The image's texture is NULL if it isn't one or failed.
+PNLImage pnlAssetLoaderGetImage(PNLAssetLoader loader, const char *path);
+
+/// \brief Gets a loaded sprite by its path, NULL if it isn't one or failed
+///
+/// Sprites on an atlas page have their frames laid out along their region, the same as in their own file.
+JUSprite pnlAssetLoaderGetSprite(PNLAssetLoader loader, const char *path);
+
+/// \brief Gets a loaded font by its path, NULL if it isn't one or failed
+JUFont pnlAssetLoaderGetFont(PNLAssetLoader loader, const char *path);
+
+/// \brief Gets a loaded sound by its path, NULL if it isn't one or failed
+PNLSound pnlAssetLoaderGetSound(PNLAssetLoader loader, const char *path);
+
+/// \brief Waits for the workers and frees every asset along with the loader
+void pnlAssetLoaderFree(PNLAssetLoader loader);
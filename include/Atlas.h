@@ -0,0 +1,53 @@
+/// \file Atlas.h
+/// \brief Packs lots of small images onto a few big textures so drawing them doesn't switch textures
+#pragma once
+#include <stdint.h>
+#include <VK2D/VK2D.h>
+#include "AssetArchive.h"
+
+/// \brief Width and height of an atlas page
+#define PNL_ATLAS_PAGE_SIZE ((int)1024)
+
+/// \brief Archive entry holding the PNLAtlasRegion table, pages are stored as "atlas/page0", "atlas/page1"...
+#define PNL_ATLAS_REGIONS_PATH "atlas/regions"
+#define PNL_ATLAS_PAGE_PATH "atlas/page%i"
+
+/// \brief Empty pixels around every image, filled with copies of its edge so filtering never picks up a neighbour
+#define PNL_ATLAS_PADDING ((int)2)
+
+/// \brief A rectangle of a texture, either all of it or an image's spot on an atlas page
+typedef struct PNLImage {
+	VK2DTexture tex;
+	float x, y; ///< Top-left corner in the texture
+	float w, h;
+} PNLImage;
+
+/// \brief Where an image ended up, stored in the asset archive as-is so it's laid out for that
+typedef struct PNLAtlasRegion {
+	char path[PNL_ARCHIVE_PATH_LENGTH]; ///< Path of the image in the ASSETS table
+	uint32_t page;
+	uint32_t x, y; ///< Top-left corner on the page, not counting padding
+	uint32_t w, h;
+} PNLAtlasRegion;
+
+/// \brief Packed pages and the regions of every image that fit, regions are sorted by path
+typedef struct PNLAtlas {
+	unsigned char **pages; ///< RGBA pixels, PNL_ATLAS_PAGE_SIZE squared
+	int pageCount;
+	PNLAtlasRegion *regions;
+	int regionCount;
+	double fill;           ///< How much of the pages images cover from 0 to 1, padding not included
+} *PNLAtlas;
+
+/// \brief Packs images onto as few pages as it can, tallest first in rows
+///
+/// Images that couldn't fit on a page even by themselves (or have a path that's too long) are left out,
+/// so there can be fewer regions than images.
+/// \param pixels RGBA pixels for each image
+PNLAtlas pnlAtlasBuild(const char **paths, unsigned char **pixels, const int *widths, const int *heights, int count);
+
+/// \brief Finds an image's region in a list sorted by path, NULL if it isn't there
+const PNLAtlasRegion *pnlAtlasFindRegion(const PNLAtlasRegion *regions, int count, const char *path);
+
+/// \brief Frees an atlas
+void pnlAtlasFree(PNLAtlas atlas);
@@ -0,0 +1,53 @@
+/// \file ChunkGrid.h
+/// \brief Fixed grid of chunks over an area for things that rarely move
+#pragma once
+#include <stdbool.h>
+
+/// \brief A list of ids in one chunk
+typedef struct PNLChunk {
+	int *ids;
+	int count;
+	int capacity;
+} PNLChunk;
+
+/// \brief Ids binned into square chunks covering a fixed rectangle
+///
+/// Unlike PNLSpatialHash this is built once and kept up to date as things move, which is cheap
+/// when only a handful of ids move at a time. Positions outside the rectangle are clamped to the
+/// chunks along its edge so nothing is ever lost. The grid doesn't store positions, callers keep
+/// those and tell the grid where an id was when removing or moving it.
+typedef struct PNLChunkGrid {
+	double left, top;   ///< Top-left corner of the covered area
+	double chunkSize;   ///< Width/height of a chunk
+	int width, height;  ///< Chunks across/down
+	PNLChunk *chunks;   ///< width * height chunks, row by row
+	int count;          ///< Ids in the grid
+	int *results;       ///< Output of the last query
+	int resultCapacity; ///< Size of results
+} *PNLChunkGrid;
+
+/// \brief Creates an empty grid covering left/top to right/bottom
+PNLChunkGrid pnlChunkGridCreate(double left, double top, double right, double bottom, double chunkSize);
+
+/// \brief Removes every id, keeping the memory around for reuse
+void pnlChunkGridClear(PNLChunkGrid grid);
+
+/// \brief Adds an id at x/y, returns false if out of memory
+bool pnlChunkGridInsert(PNLChunkGrid grid, int id, double x, double y);
+
+/// \brief Removes an id that was last inserted/moved to x/y, returns false if it wasn't there
+bool pnlChunkGridRemove(PNLChunkGrid grid, int id, double x, double y);
+
+/// \brief Tells the grid an id moved, only does any work if it crossed into another chunk
+bool pnlChunkGridMove(PNLChunkGrid grid, int id, double oldX, double oldY, double newX, double newY);
+
+/// \brief Finds every id in a chunk overlapping the square of radius around x/y
+///
+/// This is a broad check - some ids will be farther than radius away so callers still need to
+/// check the distance themselves.
+/// \param results Set to the ids found - only valid until the next query
+/// \return Number of ids found or -1 if out of memory
+int pnlChunkGridQuery(PNLChunkGrid grid, double x, double y, double radius, const int **results);
+
+/// \brief Frees a chunk grid
+void pnlChunkGridFree(PNLChunkGrid grid);
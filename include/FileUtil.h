@@ -0,0 +1,26 @@
+/// \file FileUtil.h
+/// \brief Small file and path helpers shared by the asset and save code
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/// \brief Reads a whole file into memory
+/// \param size Set to the file's size, 0 if it couldn't be read
+/// \return A buffer to free, never NULL for a readable empty file, NULL if the file couldn't be read
+unsigned char *pnlReadFile(const char *path, size_t *size);
+
+/// \brief Gets everything written to a file onto the disk, not just into the OS
+bool pnlSyncFile(FILE *file);
+
+/// \brief Writes a whole file and syncs it before closing it
+bool pnlWriteFileSynced(const char *path, const unsigned char *data, size_t size);
+
+/// \brief Renames a file over another so the destination is always either the old file or the new one
+///
+/// The rename is synced too, so once this returns true the new file is what's there after a power loss
+/// as long as it was synced itself (pnlWriteFileSynced).
+bool pnlReplaceFile(const char *from, const char *to);
+
+/// \brief Whether string ends with end
+bool pnlEndsWith(const char *string, const char *end);
@@ -0,0 +1,52 @@
+/// \file FramePacer.h
+/// \brief Waits out the end of a frame by sleeping instead of spinning
+#pragma once
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+/// \brief Frame time statistics, all times are in seconds
+typedef struct PNLFrameStats {
+	int frames;       ///< Frames measured
+	double mean;      ///< Average frame time
+	double variance;  ///< Frame time variance (seconds squared)
+	double min;       ///< Shortest frame
+	double max;       ///< Longest frame
+	double jitter;    ///< Current estimate of how late the scheduler wakes us up
+} PNLFrameStats;
+
+/// \brief Paces frames to a target rate, sleeping for most of the slack and spinning only for the end
+///
+/// The pacer keeps a running estimate of how late SDL_Delay actually returns and stops sleeping
+/// that far before the deadline, so it spins for a fraction of a millisecond on a good scheduler
+/// and longer on one with coarse timers.
+typedef struct PNLFramePacer {
+	Uint64 period;        ///< Target frame time in performance counter ticks
+	Uint64 deadline;      ///< When the current frame should end
+	Uint64 lastFrame;     ///< When the last frame ended
+	double frequency;     ///< Performance counter ticks per second
+	double jitter;        ///< Estimated sleep overshoot in seconds
+	double spinThreshold; ///< Never sleep closer than this to the deadline (seconds)
+
+	// Running statistics (Welford's method)
+	int frames;
+	double mean;
+	double m2;
+	double min;
+	double max;
+} *PNLFramePacer;
+
+/// \brief Creates a pacer that aims for the given framerate
+PNLFramePacer pnlFramePacerCreate(double framerate);
+
+/// \brief Blocks until the next frame should start
+/// \return Length of the frame that just ended in seconds
+double pnlFramePacerWait(PNLFramePacer pacer);
+
+/// \brief Gets frame time statistics since the pacer was created or reset
+void pnlFramePacerGetStats(PNLFramePacer pacer, PNLFrameStats *stats);
+
+/// \brief Clears the frame time statistics
+void pnlFramePacerResetStats(PNLFramePacer pacer);
+
+/// \brief Frees a pacer
+void pnlFramePacerFree(PNLFramePacer pacer);
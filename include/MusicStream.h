@@ -0,0 +1,91 @@
+/// \file MusicStream.h
+/// \brief Plays music a block at a time from disk or the asset archive instead of keeping whole tracks in memory
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+#include "AssetArchive.h"
+
+/// \brief Rate everything is mixed and played at, tracks at other rates are resampled
+#define PNL_MUSIC_RATE ((int)44100)
+
+/// \brief Stereo frames between the decoder and the device, about 190ms at 44.1kHz (must be a power of 2)
+#define PNL_MUSIC_RING_FRAMES ((int)8192)
+
+/// \brief Frames mixed at a time
+#define PNL_MUSIC_CHUNK_FRAMES ((int)512)
+
+/// \brief Frames the device asks for at a time
+#define PNL_MUSIC_DEVICE_FRAMES ((int)1024)
+
+/// \brief What the game asked for last, picked up by the decoder the next time it mixes
+typedef struct PNLMusicRequest {
+	char path[PNL_ARCHIVE_PATH_LENGTH]; ///< Empty to stop
+	bool loop;
+	float fade;                         ///< Seconds to crossfade from what's playing now, 0 to cut
+	float left, right;
+} PNLMusicRequest;
+
+/// \brief A track being decoded, only the decoder touches these
+typedef struct PNLMusicVoice *PNLMusicVoice;
+
+/// \brief Music playing out of a ring buffer that a decoder thread keeps full
+///
+/// The decoder reads tracks a block at a time, so only a few blocks of any track are ever in memory.
+/// It mixes the track that's playing with the one it's crossfading from (if any) into the ring, and
+/// the audio device callback takes it from there. Both ends of the ring are lock-free.
+typedef struct PNLMusicStream {
+	PNLAssetArchive archive;  ///< Looked in before the files on disk, can be NULL
+	SDL_AudioDeviceID device; ///< 0 if there isn't one and the ring has to be read with pnlMusicStreamRead
+	SDL_Thread *thread;       ///< NULL without a device, reading decodes instead
+
+	// Ring buffer
+	int16_t *ring;            ///< Interleaved stereo
+	SDL_atomic_t written;     ///< Frames ever written, only the decoder moves it
+	SDL_atomic_t read;        ///< Frames ever read, only the reader moves it
+	SDL_sem *space;           ///< Posted every time the reader makes room
+
+	// Requests from the game
+	SDL_mutex *lock;
+	PNLMusicRequest request;
+	bool requested;
+	SDL_atomic_t quit;
+
+	// Decoder
+	PNLMusicVoice playing;
+	PNLMusicVoice fading;     ///< Whatever was playing before the last request, on its way out
+	float *mix;               ///< One chunk, stereo
+	float *scratch;           ///< One voice's share of a chunk
+
+	// Stats
+	SDL_atomic_t memory;      ///< Bytes the open voices are holding
+	SDL_atomic_t underruns;   ///< Times the reader wanted more than was decoded
+} *PNLMusicStream;
+
+/// \brief Creates a music stream, NULL if it can't
+/// \param device Whether to open an audio device to play it on, without one the ring is read with pnlMusicStreamRead
+PNLMusicStream pnlMusicStreamCreate(PNLAssetArchive archive, bool device);
+
+/// \brief Starts a track, crossfading from whatever is playing
+///
+/// The track is opened by the decoder, if it can't be found or read it's just silence.
+/// \param path Archive path or file, archive first
+/// \param fade Seconds the crossfade takes, 0 to cut straight to it
+void pnlMusicStreamPlay(PNLMusicStream stream, const char *path, bool loop, float fade, float left, float right);
+
+/// \brief Fades out whatever is playing
+void pnlMusicStreamStop(PNLMusicStream stream, float fade);
+
+/// \brief Takes stereo frames out of the ring, this is what the device callback does
+///
+/// Streams without a device decode here instead of on a thread, so this can be used to run the
+/// stream faster than real time.
+/// \return Frames that were actually there, the rest are silence
+int pnlMusicStreamRead(PNLMusicStream stream, int16_t *out, int frames);
+
+/// \brief Bytes of audio the stream is holding, ring and decoder buffers included
+size_t pnlMusicStreamMemory(PNLMusicStream stream);
+
+/// \brief Stops the device and decoder and frees the stream
+void pnlMusicStreamFree(PNLMusicStream stream);
@@ -0,0 +1,45 @@
+/// \file Pool.h
+/// \brief Slot allocator with a free list and a packed list of live slots
+#pragma once
+#include <stdbool.h>
+
+/// \brief Hands out integer slot ids in O(1), growing a chunk at a time when it runs out
+///
+/// The pool only tracks which slots are in use, the caller keeps the actual data in chunks of
+/// chunkSize entries so existing entries never move when the pool grows. Slot id / chunkSize is
+/// the chunk and slot id % chunkSize is the entry within it.
+typedef struct PNLPool {
+	int chunkSize;  ///< Slots added every time the pool grows
+	int capacity;   ///< Total slots across every chunk
+	int *next;      ///< Next free slot after each free slot, -1 ends the list
+	int freeHead;   ///< First free slot or -1 if there are none
+	int *live;      ///< Slots in use, packed
+	int *liveIndex; ///< Where each slot is in live, -1 if it's free
+	int liveCount;  ///< Number of slots in use
+	int highWater;  ///< Most slots that have been in use at once
+	int growths;    ///< Number of chunks added
+} *PNLPool;
+
+/// \brief Creates an empty pool, no slots exist until the first acquire
+PNLPool pnlPoolCreate(int chunkSize);
+
+/// \brief Takes a free slot, growing the pool by a chunk if none are free
+/// \return Slot id or -1 if growing failed
+/// \warning Check pnlPoolChunkCount afterwards, the slot may be in a chunk the caller doesn't have yet
+int pnlPoolAcquire(PNLPool pool);
+
+/// \brief Grows the pool until it has at least count slots, without touching the ones in use
+/// \return False if growing failed, the chunks that were added are kept
+bool pnlPoolReserve(PNLPool pool, int count);
+
+/// \brief Gives a slot back, moving the last live slot into its place in the live list
+void pnlPoolRelease(PNLPool pool, int id);
+
+/// \brief Releases every slot, keeping the capacity
+void pnlPoolClear(PNLPool pool);
+
+/// \brief Number of chunks the pool has grown to
+int pnlPoolChunkCount(PNLPool pool);
+
+/// \brief Frees a pool
+void pnlPoolFree(PNLPool pool);
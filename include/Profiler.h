@@ -0,0 +1,115 @@
+/// \file Profiler.h
+/// \brief Nested timing markers and counters recorded per thread, dumped as Chrome trace JSON
+#pragma once
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/// \brief Markers only compile to anything when PNL_PROFILER is defined, otherwise they cost nothing
+///
+/// Every PNL_PROFILE_BEGIN needs a PNL_PROFILE_END on the same thread before the function it's in
+/// returns, name has to stay valid until the last dump (string literals, asset paths and so on).
+/// Counters are plotted on the same timeline as the markers.
+#ifdef PNL_PROFILER
+#define PNL_PROFILE_BEGIN(name) pnlProfilerBegin(name)
+#define PNL_PROFILE_END() pnlProfilerEnd()
+#define PNL_PROFILE_COUNTER(name, value) pnlProfilerCounter(name, value)
+#define PNL_PROFILE_THREAD(name) pnlProfilerNameThread(name)
+#define PNL_PROFILE_IGNORE_THREAD() pnlProfilerIgnoreThread()
+#else
+#define PNL_PROFILE_BEGIN(name) ((void)0)
+#define PNL_PROFILE_END() ((void)0)
+#define PNL_PROFILE_COUNTER(name, value) ((void)0)
+#define PNL_PROFILE_THREAD(name) ((void)0)
+#define PNL_PROFILE_IGNORE_THREAD() ((void)0)
+#endif
+
+/// \brief Most events the thread that started the profiler keeps, older ones are overwritten (power of 2)
+///
+/// The main thread records around 5000 events a second at 240fps, so this holds PROFILE_SECONDS of it.
+#define PNL_PROFILER_MAIN_EVENTS ((int)65536)
+
+/// \brief Most events every other thread keeps (power of 2), audio callbacks record under 100 a second
+#define PNL_PROFILER_EVENTS ((int)4096)
+
+/// \brief Most threads that can record, any more than this started recording are ignored
+///
+/// Main, music, music device, sound device, save and the few asset loader workers that record.
+#define PNL_PROFILER_THREADS ((int)10)
+
+/// \brief Deepest markers can be nested, anything deeper isn't recorded
+#define PNL_PROFILER_DEPTH ((int)32)
+
+/// \brief What an event is
+typedef enum {
+	pe_Span = 0,    ///< A marker that began and ended
+	pe_Counter = 1, ///< A counter's value at some point
+} PNLProfileEventType;
+
+/// \brief One recorded event, times are in performance counter ticks
+typedef struct PNLProfileEvent {
+	const char *name;
+	Uint64 start;     ///< When the span began or the counter was set
+	union {
+		Uint64 duration;
+		double value;
+	};
+	PNLProfileEventType type;
+} PNLProfileEvent;
+
+/// \brief Events recorded by one thread
+///
+/// Every ring is allocated up front by pnlProfilerStart and a thread claims one the first time it
+/// records, so recording never locks or allocates (audio callbacks record too). Only the thread itself
+/// writes to its ring and publishes how many events it's written with written, so a dump can copy the
+/// ring while the thread keeps going and throw away whatever got overwritten during the copy.
+typedef struct PNLProfilerThread {
+	SDL_threadID id;
+	int index;                             ///< Order threads started recording in, their id in dumps
+	void *name;                            ///< const char*, NULL if the thread never named itself - atomic
+	PNLProfileEvent *events;
+	unsigned int capacity;                 ///< PNL_PROFILER_MAIN_EVENTS for the starting thread, PNL_PROFILER_EVENTS otherwise
+	unsigned int count;                    ///< Events ever recorded, owner only
+	SDL_atomic_t written;                  ///< count, published for dumps
+	SDL_atomic_t claimed;                  ///< Set once a thread owns this ring and id is filled in
+	const char *stackNames[PNL_PROFILER_DEPTH];
+	Uint64 stackStarts[PNL_PROFILER_DEPTH];
+	int depth;                             ///< Markers open right now, can be past PNL_PROFILER_DEPTH
+} PNLProfilerThread;
+
+/// \brief Allocates every thread's ring and starts recording on every thread, markers before this are ignored
+/// \param name What dumps call the process, has to stay valid until pnlProfilerQuit
+///
+/// The calling thread gets the big PNL_PROFILER_MAIN_EVENTS ring, call it from the main thread.
+void pnlProfilerStart(const char *name);
+
+/// \brief Whether pnlProfilerStart has been called
+bool pnlProfilerRunning();
+
+/// \brief Names the calling thread in dumps
+void pnlProfilerNameThread(const char *name);
+
+/// \brief Keeps the calling thread from ever taking a ring, for threads there can be any number of
+void pnlProfilerIgnoreThread();
+
+/// \brief Begins a marker on the calling thread
+void pnlProfilerBegin(const char *name);
+
+/// \brief Ends the calling thread's innermost marker
+void pnlProfilerEnd();
+
+/// \brief Records a counter's value on the calling thread
+void pnlProfilerCounter(const char *name, double value);
+
+/// \brief Writes everything from the last so many seconds as Chrome trace event JSON
+///
+/// The events are copied out under the profiler's lock and written after it's let go, recording threads
+/// never wait on either. Open the file in chrome://tracing or ui.perfetto.dev.
+/// \return Events written, -1 if the file couldn't be written
+int pnlProfilerDump(FILE *file, double seconds);
+
+/// \brief pnlProfilerDump to a file
+int pnlProfilerDumpFile(const char *filename, double seconds);
+
+/// \brief Stops recording and frees every thread's events, nothing can be recording anymore
+void pnlProfilerQuit();
@@ -0,0 +1,46 @@
+/// \file Random.h
+/// \brief Small, fast seedable random number generators
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/// \brief xoshiro256** state, every stream seeded from the same run seed is independent of the others
+///
+/// Unlike rand() the sequence is the same on every platform and each stream only advances when
+/// it is drawn from, so adding draws to one subsystem never changes what another one gets.
+typedef struct PNLRandom {
+	uint64_t s[4];
+} PNLRandom;
+
+/// \brief Seeds a generator, the same seed and stream always give the same sequence
+/// \param stream Identifies the stream, different streams from the same seed don't overlap in practice
+void pnlRandomSeed(PNLRandom *rng, uint64_t seed, uint64_t stream);
+
+/// \brief Next 64 random bits
+uint64_t pnlRandomNext(PNLRandom *rng);
+
+/// \brief Uniform double in [0, 1)
+double pnlRandomReal(PNLRandom *rng);
+
+/// \brief Uniform integer in [0, n), n must be positive
+int pnlRandomInt(PNLRandom *rng, int n);
+
+/// \brief Picks count different integers from [0, n) in random order, every subset and order equally likely
+///
+/// Uses Floyd's algorithm plus a shuffle of the result, so it costs O(count^2) no matter how close count is
+/// to n and never needs anything n sized. count must not be more than n.
+void pnlRandomSample(PNLRandom *rng, int n, int count, int *out);
+
+/// \brief Probability that scales[0] * u0 + scales[1] * u1 + ... <= x for independent uniform u in [0, 1)
+///
+/// Exact (inclusion-exclusion over the corners of the cube), costs 2^count so keep count small. Every
+/// scale must be positive, a count of 0 is the sum being 0.
+double pnlUniformSumCdf(const double *scales, int count, double x);
+
+/// \brief Samples count uniforms in [0, 1) conditioned on scales[0] * u0 + scales[1] * u1 + ... >= minimum
+///
+/// Gives exactly what rolling them all over again until the condition holds would, but each value is
+/// drawn from its conditional distribution once, so the cost is fixed no matter how unlikely the
+/// condition is. If the condition can't be met the uniforms are unconstrained. count follows the same
+/// limits as pnlUniformSumCdf.
+void pnlRandomConstrainedUniforms(PNLRandom *rng, const double *scales, int count, double minimum, double *out);
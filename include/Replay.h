@@ -0,0 +1,43 @@
+/// \file Replay.h
+/// \brief Records the input of every frame to a file and plays it back
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/// \brief Everything a frame reads from the outside world
+typedef struct PNLReplayFrame {
+	float delta;          ///< Frame time in seconds
+	float mouseX, mouseY; ///< Mouse in the game world
+	uint32_t buttons;     ///< One bit per button/key, the caller decides which is which
+} PNLReplayFrame;
+
+/// \brief A replay file being written or read
+///
+/// Files are a header with the run seed followed by one record per frame. Each record is a byte
+/// saying which fields differ from the previous frame followed by only those fields, so a frame
+/// where nothing but the frame time changed costs 5 bytes. Everything is little endian.
+typedef struct PNLReplay {
+	FILE *file;
+	bool recording;       ///< Writing or reading
+	uint64_t seed;        ///< Seed the recorded run was started with
+	PNLReplayFrame last;  ///< Previous frame, records are relative to it
+	int frames;           ///< Frames written/read so far
+	long bytes;           ///< Bytes written/read so far, including the header
+} *PNLReplay;
+
+/// \brief Starts recording to a file, returns NULL if it can't be opened
+PNLReplay pnlReplayRecord(const char *filename, uint64_t seed);
+
+/// \brief Opens a recording for playback, returns NULL if it can't be opened or isn't a replay
+PNLReplay pnlReplayOpen(const char *filename);
+
+/// \brief Appends a frame to a recording
+void pnlReplayWrite(PNLReplay replay, const PNLReplayFrame *frame);
+
+/// \brief Reads the next frame of a recording
+/// \return False once every frame has been read
+bool pnlReplayRead(PNLReplay replay, PNLReplayFrame *frame);
+
+/// \brief Flushes and closes a replay
+void pnlReplayClose(PNLReplay replay);
@@ -0,0 +1,111 @@
+/// \file SaveStore.h
+/// \brief Key/value save data that's read from memory and written to disk in the background as it changes
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+
+/// \brief Longest a key can be, terminator included
+#define PNL_SAVE_KEY_LENGTH ((int)64)
+
+/// \brief Size the journal can grow to before everything is rewritten into the snapshot
+#define PNL_SAVE_COMPACT_BYTES ((int)4096)
+
+/// \brief One saved value, a number or a string
+typedef struct PNLSaveValue {
+	char key[PNL_SAVE_KEY_LENGTH];
+	uint32_t hash;
+	bool isString;
+	double number;
+	char *string;                  ///< Owned by the store, NULL for numbers
+} PNLSaveValue;
+
+/// \brief Bytes waiting for the writer
+typedef struct PNLSaveBuffer {
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+} PNLSaveBuffer;
+
+/// \brief What the store has been up to, times are in seconds
+typedef struct PNLSaveStoreStats {
+	int records;         ///< Changes appended to the journal
+	int compactions;     ///< Times the snapshot was rewritten
+	int failures;        ///< Writes that didn't make it to disk, they're retried with the next compaction
+	double setTime;      ///< Main thread time spent setting values
+	double setTimeMax;
+	double writeTime;    ///< Writer time spent on disk, none of it on the main thread
+	double writeTimeMax;
+} PNLSaveStoreStats;
+
+/// \brief Save data kept in memory and mirrored to a snapshot file plus a journal of changes
+///
+/// Every set updates memory right away and queues a record for the writer thread, which appends it to
+/// "<filename>.journal" and syncs it, so nothing set before a crash is lost as long as the writer got to
+/// it. Once the journal passes PNL_SAVE_COMPACT_BYTES the whole store is written to "<filename>.tmp" and
+/// renamed over the snapshot, then the journal is started over. Opening reads the snapshot then replays
+/// the journal, stopping at the first record a crash cut short.
+///
+/// Both files are a "PNLS" header followed by records that are each a size and checksum then a type,
+/// key and value, little endian.
+typedef struct PNLSaveStore {
+	char *filename;
+	PNLSaveValue *values;          ///< Main thread only
+	int count;
+	int capacity;
+
+	// Work for the writer, guarded by lock
+	SDL_mutex *lock;
+	SDL_cond *work;                ///< Signalled when there's something to write or it's quitting
+	SDL_cond *done;                ///< Signalled every time the writer finishes a batch
+	SDL_Thread *thread;            ///< NULL if it couldn't be started, sets write on the spot instead
+	PNLSaveBuffer journal;         ///< Records to append
+	PNLSaveBuffer snapshot;        ///< Whole store to compact into, empty if there's no compaction waiting
+	uint64_t submitted;            ///< Batches ever queued
+	uint64_t completed;            ///< Batches ever written
+	bool quit;
+	bool dirty;                    ///< A write failed so the next set compacts to get everything back on disk
+
+	// Writer only
+	PNLSaveBuffer writing[2];      ///< Journal and snapshot swapped out of the queue
+	FILE *file;                    ///< Journal, open for appending
+	bool journalTorn;              ///< Writing the journal failed, only a compaction may touch it again
+
+	// Stats
+	size_t journalBytes;           ///< Main thread's idea of how big the journal is
+	int records;
+	int compactions;
+	int failures;
+	double setTime, setTimeMax;
+	double writeTime, writeTimeMax;
+} *PNLSaveStore;
+
+/// \brief Loads a store and starts its writer, NULL if it can't be made (a store that isn't on disk yet is empty)
+PNLSaveStore pnlSaveStoreOpen(const char *filename);
+
+/// \brief Whether a key has been set
+bool pnlSaveStoreKeyExists(PNLSaveStore store, const char *key);
+
+/// \brief Gets a number, 0 if it isn't set or is a string
+double pnlSaveStoreGetDouble(PNLSaveStore store, const char *key);
+
+/// \brief Gets a string, "" if it isn't set or is a number
+///
+/// The string belongs to the store and is valid until the key is set again.
+const char *pnlSaveStoreGetString(PNLSaveStore store, const char *key);
+
+/// \brief Sets a number, it's on its way to disk when this returns
+void pnlSaveStoreSetDouble(PNLSaveStore store, const char *key, double value);
+
+/// \brief Sets a string, it's on its way to disk when this returns
+void pnlSaveStoreSetString(PNLSaveStore store, const char *key, const char *value);
+
+/// \brief Waits until everything set so far is on disk
+void pnlSaveStoreFlush(PNLSaveStore store);
+
+/// \brief Gets the store's stats
+void pnlSaveStoreGetStats(PNLSaveStore store, PNLSaveStoreStats *stats);
+
+/// \brief Compacts, stops the writer and frees the store
+void pnlSaveStoreClose(PNLSaveStore store);
@@ -0,0 +1,42 @@
+/// \file SimKernels.h
+/// \brief Hot per-entity and per-sample loops with scalar and SIMD implementations
+#pragma once
+
+/// \brief Which implementation of the kernels to use
+typedef enum {
+	km_Auto = 0,   ///< Best one the CPU supports
+	km_Scalar = 1, ///< Plain C
+	km_SSE2 = 2,   ///< 2 entities at a time
+	km_AVX = 3,    ///< 4 entities at a time
+} PNLKernelMode;
+
+/// \brief A set of kernels, every implementation gives bit-identical results
+///
+/// All arrays are structure-of-arrays columns of length count, they don't need to be aligned.
+typedef struct PNLKernels {
+	const char *name;
+	PNLKernelMode mode;
+
+	/// \brief Moves bullets along their direction vectors and slows them down
+	///
+	/// x += dirX * velocity * dt, y += dirY * velocity * dt, velocity -= deceleration * dt and lifetime += dt
+	void (*integrateBullets)(double *x, double *y, const double *dirX, const double *dirY, double *velocity, double *lifetime, int count, double dt, double deceleration);
+
+	/// \brief Moves enemies towards a target at a set speed
+	///
+	/// Enemies farther than farDistance move at speed * farMultiplier instead. distance receives each
+	/// enemy's distance to the target from before it moved.
+	void (*homeEnemies)(double *x, double *y, double *distance, int count, double targetX, double targetY, double speed, double farDistance, double farMultiplier, double dt);
+
+	/// \brief Adds a sound's samples into a stereo mix
+	///
+	/// out[f * 2] += sample * left and out[(f * 2) + 1] += sample * right, a mono sample goes into both
+	/// sides and a stereo one's channels go into their own.
+	void (*mixSamples)(float *out, const float *in, int frames, int channels, float left, float right);
+} PNLKernels;
+
+/// \brief Gets a set of kernels, falling back to the next best thing if the CPU can't run the requested mode
+const PNLKernels *pnlKernelsGet(PNLKernelMode mode);
+
+/// \brief Parses "auto", "scalar", "sse2" or "avx", returns km_Auto for anything else
+PNLKernelMode pnlKernelModeFromString(const char *string);
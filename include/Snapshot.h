@@ -0,0 +1,81 @@
+/// \file Snapshot.h
+/// \brief Compact versioned binary container for saving and restoring state
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// \brief Makes a section tag out of 4 characters
+#define PNL_SNAPSHOT_TAG(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/// \brief Bytes before the first section
+#define PNL_SNAPSHOT_HEADER_SIZE ((size_t)16)
+
+/// \brief A snapshot being written or read
+///
+/// Files are a header ("PNLG", the caller's version, payload size and an FNV-1a checksum of the payload)
+/// followed by tagged sections that each start with their tag and size, so a reader can skip sections it
+/// doesn't know and tell when a section an older version didn't write is missing. Everything is little
+/// endian, arrays are copied straight in on little endian machines.
+///
+/// Reads past the end of a section return 0 and set failed instead of reading garbage, so callers can
+/// read everything and check failed once at the end.
+typedef struct PNLSnapshot {
+	unsigned char *data;
+	size_t size;         ///< Bytes written, or bytes there are to read
+	size_t capacity;
+	uint32_t version;    ///< Whatever the writer said it was
+	bool reading;
+	size_t section;      ///< Where the section being written started, or the end of the one being read
+	size_t offset;       ///< Read position
+	bool failed;         ///< Out of memory writing, or read something that wasn't there
+} *PNLSnapshot;
+
+/// \brief Starts an empty snapshot to write to, NULL if there's no memory
+PNLSnapshot pnlSnapshotCreate(uint32_t version);
+
+/// \brief Empties a snapshot for writing again, keeping its memory
+void pnlSnapshotClear(PNLSnapshot snapshot, uint32_t version);
+
+/// \brief Opens bytes for reading, NULL if they aren't a snapshot or the checksum is off
+/// \param data Copied, it can be freed right after
+PNLSnapshot pnlSnapshotOpen(const void *data, size_t size);
+
+/// \brief Opens a snapshot file for reading, NULL if it can't be read or isn't one
+PNLSnapshot pnlSnapshotLoad(const char *filename);
+
+/// \brief Finishes the header and gets the bytes of a snapshot being written, valid until it's written to again
+const void *pnlSnapshotBytes(PNLSnapshot snapshot, size_t *size);
+
+/// \brief Writes a snapshot to a file, through a temporary file so a crash never leaves half of one
+bool pnlSnapshotStore(PNLSnapshot snapshot, const char *filename);
+
+/// \brief Starts a section, everything put until pnlSnapshotEndSection is in it
+void pnlSnapshotBeginSection(PNLSnapshot snapshot, uint32_t tag);
+
+/// \brief Ends the section being written
+void pnlSnapshotEndSection(PNLSnapshot snapshot);
+
+/// \brief Moves reading to the start of a section, false if there isn't one with that tag
+bool pnlSnapshotFindSection(PNLSnapshot snapshot, uint32_t tag);
+
+/// \brief Puts a value in the section being written, arrays are just their values so the reader has to know the count
+void pnlSnapshotPutBool(PNLSnapshot snapshot, bool value);
+void pnlSnapshotPutU32(PNLSnapshot snapshot, uint32_t value);
+void pnlSnapshotPutU64(PNLSnapshot snapshot, uint64_t value);
+void pnlSnapshotPutDouble(PNLSnapshot snapshot, double value);
+void pnlSnapshotPutInts(PNLSnapshot snapshot, const int *values, int count);
+void pnlSnapshotPutFloats(PNLSnapshot snapshot, const float *values, int count);
+void pnlSnapshotPutDoubles(PNLSnapshot snapshot, const double *values, int count);
+
+/// \brief Gets the next value from the section being read, 0 if the section is out of them
+bool pnlSnapshotGetBool(PNLSnapshot snapshot);
+uint32_t pnlSnapshotGetU32(PNLSnapshot snapshot);
+uint64_t pnlSnapshotGetU64(PNLSnapshot snapshot);
+double pnlSnapshotGetDouble(PNLSnapshot snapshot);
+void pnlSnapshotGetInts(PNLSnapshot snapshot, int *values, int count);
+void pnlSnapshotGetFloats(PNLSnapshot snapshot, float *values, int count);
+void pnlSnapshotGetDoubles(PNLSnapshot snapshot, double *values, int count);
+
+/// \brief Frees a snapshot
+void pnlSnapshotFree(PNLSnapshot snapshot);
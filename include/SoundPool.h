@@ -0,0 +1,114 @@
+/// \file SoundPool.h
+/// \brief Sound effects mixed from a fixed number of voices so a big fight costs the same as a small one
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+#include "SimKernels.h"
+
+/// \brief Rate sounds are converted to when they're loaded and mixed at
+#define PNL_SOUND_RATE ((int)44100)
+
+/// \brief Frames the device asks for at a time, about 12ms
+#define PNL_SOUND_DEVICE_FRAMES ((int)512)
+
+/// \brief Plays that can be waiting for the mixer at once, must be a power of 2
+#define PNL_SOUND_QUEUE_SIZE ((int)64)
+
+/// \brief A sound effect decoded to float samples at PNL_SOUND_RATE, ready to be mixed
+typedef struct PNLSound {
+	float *samples;
+	int frames;
+	int channels; ///< 1 or 2
+} *PNLSound;
+
+/// \brief A voice and the sound it's partway through, sound is NULL if it's free
+typedef struct PNLSoundVoice {
+	PNLSound sound;
+	int position;     ///< Frames in
+	int priority;
+	float left, right;
+	uint32_t started; ///< When it started in plays, lower is older
+} PNLSoundVoice;
+
+/// \brief A request to start a sound, sound is NULL to stop everything
+typedef struct PNLSoundPlay {
+	PNLSound sound;
+	int priority;
+	int limit;
+	float left, right;
+} PNLSoundPlay;
+
+/// \brief What the mixer has been up to, times are in seconds
+typedef struct PNLSoundPoolStats {
+	int voices;        ///< Playing right now
+	int peak;          ///< Most ever playing at once
+	int started;
+	int stolen;        ///< Plays that cut off another voice to start
+	int dropped;       ///< Plays that had nothing they were allowed to steal
+	double mixTime;    ///< Spent mixing
+	double mixTimeMax; ///< Longest a single device callback took
+	double audioTime;  ///< Audio mixed, mixTime / audioTime is how much of a core mixing takes
+} PNLSoundPoolStats;
+
+/// \brief Fixed set of voices mixed by the audio device callback
+///
+/// The game queues plays and the mixer starts them at the top of its next callback, so nothing is
+/// locked on either side. A play over its sound's instance limit restarts the oldest voice of that
+/// sound, otherwise it takes a free voice or steals the lowest priority voice (oldest first) as long
+/// as that isn't higher priority than itself.
+typedef struct PNLSoundPool {
+	const PNLKernels *kernels;  ///< Whichever mixSamples the CPU runs best
+	SDL_AudioDeviceID device;   ///< 0 if there isn't one and the pool is mixed with pnlSoundPoolMix
+	PNLSoundVoice *voices;
+	int voiceCount;
+	uint32_t plays;             ///< Mixer only
+	float *mix;                 ///< PNL_SOUND_DEVICE_FRAMES stereo frames
+
+	// Plays from the game, only the game moves queued and only the mixer moves taken
+	PNLSoundPlay queue[PNL_SOUND_QUEUE_SIZE];
+	SDL_atomic_t queued;
+	SDL_atomic_t taken;
+
+	// Stats, written by the mixer
+	SDL_atomic_t active;
+	SDL_atomic_t peak;
+	SDL_atomic_t started;
+	SDL_atomic_t stolen;
+	SDL_atomic_t dropped;
+	Uint64 mixTicks;            ///< Timing is only ever read for stats, so it can be a callback behind
+	Uint64 mixTicksMax;
+	int64_t mixedFrames;
+} *PNLSoundPool;
+
+/// \brief Converts samples in any format SDL knows to a sound, NULL if it can't
+PNLSound pnlSoundCreate(const void *samples, size_t size, SDL_AudioFormat format, int channels, int rate);
+
+/// \brief Loads a WAV file as a sound, NULL if it can't
+PNLSound pnlSoundLoad(const char *filename);
+
+/// \brief Frees a sound, it must not be playing anywhere
+void pnlSoundFree(PNLSound sound);
+
+/// \brief Creates a pool, NULL if it can't
+/// \param device Whether to open an audio device to play it on, without one it's mixed with pnlSoundPoolMix
+PNLSoundPool pnlSoundPoolCreate(int voices, const PNLKernels *kernels, bool device);
+
+/// \brief Queues a sound to be started by the mixer
+/// \param priority Higher can steal voices from lower
+/// \param limit Most voices this sound can have at once, 0 for no limit
+/// \return False if the queue is full and it was dropped
+bool pnlSoundPoolPlay(PNLSoundPool pool, PNLSound sound, int priority, int limit, float left, float right);
+
+/// \brief Stops every voice once the mixer gets to it, plays queued after this still start
+void pnlSoundPoolStopAll(PNLSoundPool pool);
+
+/// \brief Mixes the next frames into interleaved stereo, this is what the device callback does
+void pnlSoundPoolMix(PNLSoundPool pool, int16_t *out, int frames);
+
+/// \brief Gets the mixer's stats
+void pnlSoundPoolGetStats(PNLSoundPool pool, PNLSoundPoolStats *stats);
+
+/// \brief Closes the device and frees the pool, sounds are left alone
+void pnlSoundPoolFree(PNLSoundPool pool);
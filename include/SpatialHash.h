@@ -0,0 +1,42 @@
+/// \file SpatialHash.h
+/// \brief Uniform grid for finding things near a point without checking everything
+#pragma once
+#include <stdbool.h>
+
+/// \brief Points binned into a hashed uniform grid, rebuilt from scratch whenever the points move
+///
+/// Usage is pnlSpatialHashClear, pnlSpatialHashInsert for every point, pnlSpatialHashBuild, then
+/// any number of pnlSpatialHashQuery calls. Building is a counting sort so it is linear in the
+/// number of points and never allocates.
+typedef struct PNLSpatialHash {
+	double cellSize;  ///< Width/height of a grid cell, queries are cheapest with a radius at or below this
+	int capacity;     ///< Max points that can be inserted
+	int count;        ///< Points inserted since the last clear
+	int bucketCount;  ///< Number of hash buckets, always a power of two
+	int *bucketStart; ///< Start of each bucket in sorted, bucketCount + 1 long
+	int *bucketOf;    ///< Bucket each inserted point landed in
+	int *ids;         ///< Inserted ids in insertion order
+	double *xs, *ys;  ///< Inserted positions in insertion order
+	int *sorted;      ///< Indices into ids/xs/ys sorted by bucket
+	int *results;     ///< Output of the last query
+} *PNLSpatialHash;
+
+/// \brief Creates a spatial hash that can hold up to capacity points
+PNLSpatialHash pnlSpatialHashCreate(double cellSize, int capacity);
+
+/// \brief Removes every point
+void pnlSpatialHashClear(PNLSpatialHash hash);
+
+/// \brief Adds a point, returns false if the hash is full
+bool pnlSpatialHashInsert(PNLSpatialHash hash, int id, double x, double y);
+
+/// \brief Sorts the inserted points into their cells, must be called before querying
+void pnlSpatialHashBuild(PNLSpatialHash hash);
+
+/// \brief Finds every point within radius of x/y
+/// \param results Set to the ids found, in ascending order - only valid until the next query
+/// \return Number of ids found
+int pnlSpatialHashQuery(PNLSpatialHash hash, double x, double y, double radius, const int **results);
+
+/// \brief Frees a spatial hash
+void pnlSpatialHashFree(PNLSpatialHash hash);
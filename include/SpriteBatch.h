@@ -0,0 +1,65 @@
+/// \file SpriteBatch.h
+/// \brief Collects sprite draws and submits them grouped by texture
+#pragma once
+#include <VK2D/VK2D.h>
+#include <JamUtil.h>
+
+/// \brief One queued draw, either a region of a texture or a whole (animated) JUSprite
+typedef struct PNLSpriteInstance {
+	VK2DTexture tex;  ///< Texture to draw from or NULL for sprites
+	JUSprite spr;     ///< Sprite to draw or NULL for textures
+	float x, y;
+	float xscale, yscale;
+	float rot;
+	float originX, originY;
+	float xInTex, yInTex; ///< Region of the texture to draw
+	float texWidth, texHeight;
+	vec4 colour;      ///< Colour mod for just this instance
+	int order;        ///< Submission order, keeps sorting stable
+	int group;        ///< Which texture this is in the order textures were first queued, set on flush
+} PNLSpriteInstance;
+
+/// \brief Running totals used to compare batching against drawing everything immediately
+typedef struct PNLSpriteBatchStats {
+	int frames;                    ///< Frames ended with pnlSpriteBatchEndFrame
+	long instances;                ///< Sprites drawn
+	long draws;                    ///< Draws actually submitted to the renderer, one per instance
+	long textureSwitches;          ///< Times consecutive draws changed texture
+	long immediateTextureSwitches; ///< Texture switches drawing in the order things were queued would have made
+	long stateChanges;             ///< Colour mod changes actually made
+	long immediateStateChanges;    ///< Colour mod changes drawing each instance with set/draw/reset would have made
+} PNLSpriteBatchStats;
+
+/// \brief Sprites queued since the last flush
+typedef struct PNLSpriteBatch {
+	PNLSpriteInstance *instances;
+	int count;
+	int capacity;
+	const void **keys; ///< Textures in the order they were first queued, only used while flushing
+	int keyCapacity;
+	PNLSpriteBatchStats stats;
+} *PNLSpriteBatch;
+
+/// \brief Creates an empty sprite batch
+PNLSpriteBatch pnlSpriteBatchCreate();
+
+/// \brief Queues part of a texture, parameters are the same as vk2dRendererDrawTexture plus a colour mod
+void pnlSpriteBatchTexture(PNLSpriteBatch batch, VK2DTexture tex, float x, float y, float xscale, float yscale, float rot, float originX, float originY, float xInTex, float yInTex, float texWidth, float texHeight, const vec4 colour);
+
+/// \brief Queues a sprite to be drawn with juSpriteDraw and a colour mod
+void pnlSpriteBatchSprite(PNLSpriteBatch batch, JUSprite spr, float x, float y, const vec4 colour);
+
+/// \brief Draws everything queued grouped by texture and empties the batch
+///
+/// Groups are drawn in the order their textures were first queued and instances sharing a
+/// texture stay in the order they were queued, but anything queued before a
+/// flush can end up drawn on top of anything else from the same flush, so flush between layers.
+/// The colour mod is only changed when it differs from the previous instance and is left at
+/// VK2D_DEFAULT_COLOUR_MOD afterwards.
+void pnlSpriteBatchFlush(PNLSpriteBatch batch);
+
+/// \brief Counts a frame towards the stats
+void pnlSpriteBatchEndFrame(PNLSpriteBatch batch);
+
+/// \brief Frees a sprite batch
+void pnlSpriteBatchFree(PNLSpriteBatch batch);
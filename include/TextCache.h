@@ -0,0 +1,55 @@
+/// \file TextCache.h
+/// \brief Remembers laid out text so strings that don't change aren't laid out every frame
+#pragma once
+#include <stdbool.h>
+#include <VK2D/VK2D.h>
+#include <JamUtil.h>
+
+/// \brief Longest string that can be drawn, longer ones are cut off
+#define TEXT_MAX_LENGTH ((int)512)
+
+/// \brief A glyph's place relative to the start of the string and where it is in the font's bitmap
+typedef struct PNLTextQuad {
+	float x, y;
+	float u, v, w, h;
+} PNLTextQuad;
+
+/// \brief A formatted string and the glyph quads it lays out to
+typedef struct PNLTextRun {
+	JUFont font;
+	unsigned long hash;  ///< Hash of the string and font, checked before comparing strings
+	char *text;
+	PNLTextQuad *quads;
+	int quadCount;
+	int lastUsed;        ///< Frame this was last drawn, the least recently used run is replaced first
+} PNLTextRun;
+
+/// \brief Counters for one frame or a total over many
+typedef struct PNLTextCacheStats {
+	long draws;        ///< Strings drawn
+	long hits;         ///< Strings that were already laid out
+	double formatTime; ///< Seconds spent formatting strings
+	double layoutTime; ///< Seconds spent laying out strings that missed
+} PNLTextCacheStats;
+
+/// \brief Fixed number of laid out strings
+typedef struct PNLTextCache {
+	PNLTextRun *runs;
+	int capacity;
+	int frame;
+	PNLTextCacheStats frameStats; ///< Since the last pnlTextCacheEndFrame
+	PNLTextCacheStats lastFrame;  ///< The frame before that
+	PNLTextCacheStats total;      ///< Every frame
+} *PNLTextCache;
+
+/// \brief Creates a cache that holds up to capacity strings
+PNLTextCache pnlTextCacheCreate(int capacity);
+
+/// \brief Draws a string the same way juFontDraw does, laying it out only if it isn't cached
+void pnlTextDraw(PNLTextCache cache, JUFont font, float x, float y, const char *fmt, ...);
+
+/// \brief Moves this frame's counters into lastFrame and the total
+void pnlTextCacheEndFrame(PNLTextCache cache);
+
+/// \brief Frees a text cache
+void pnlTextCacheFree(PNLTextCache cache);
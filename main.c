@@ -2,6 +2,21 @@
 #include <JamUtil.h>
 #include <SDL2/SDL.h>
 #include <time.h>
+#include "FramePacer.h"
+#include "SpatialHash.h"
+#include "SimKernels.h"
+#include "Pool.h"
+#include "ChunkGrid.h"
+#include "SpriteBatch.h"
+#include "TextCache.h"
+#include "Random.h"
+#include "Replay.h"
+#include "AssetLoader.h"
+#include "MusicStream.h"
+#include "SoundPool.h"
+#include "SaveStore.h"
+#include "Snapshot.h"
+#include "Profiler.h"
 
 /********************** Typedefs **********************/
 typedef double real;
@@ -26,8 +41,20 @@ typedef enum { // Various elements in the home map
 	hb_Memorial = 3,
 	hb_Weapons = 4,
 	hb_Help = 5,
+	hb_MAX = 6,
 } HomeBlocks;
 
+typedef enum { // Independent random number streams, drawing from one never changes what another gives
+	rs_Weapons = 0, // Weapon generation
+	rs_Enemies = 1, // Enemy spawns and stats
+	rs_Minerals = 2, // Mineral scattering and pickups
+	rs_Market = 3, // Stock prices
+	rs_Planets = 4, // Planets offered at mission select
+	rs_Combat = 5, // Shotgun spread and enemy damage
+	rs_Cosmetic = 6, // Music and voice lines, kept apart so audio never changes the simulation
+	rs_MAX = 7,
+} RandomStream;
+
 typedef enum {
 	tc_NoDraw = 1, // Don't draw the player
 	tc_Noop = 2, // Nothing, the usual
@@ -43,22 +70,55 @@ typedef enum {
 	wt_Any = 5,
 } WeaponType;
 
+typedef enum {
+	bt_Bullet = 0,
+	bt_Whoosh = 1, // Sword swipes
+} BulletType;
+
+typedef enum { // Sound effects the simulation can ask for, they get played after the frame is drawn
+	se_Pistol = 0,
+	se_Shotgun = 1,
+	se_AssaultRifle = 2,
+	se_Sniper = 3,
+	se_Sword = 4,
+	se_Hit = 5,
+	se_NewGun = 6,
+	se_HeavyDrum = 7,
+	se_Shop1 = 8, // Rinky's lines, se_Shop1 + n for the nth line
+	se_Shop2 = 9,
+	se_Shop3 = 10,
+	se_MAX = 11,
+} SoundEffect;
+
+typedef enum {
+	mt_None = 0, // Leave the music alone
+	mt_Goofy = 1,
+	mt_Somber = 2,
+	mt_Mess = 3,
+	mt_MAX = 4,
+} MusicTrack;
+
 /********************** Constants **********************/
 const int GAME_WIDTH = 600;
 const int GAME_HEIGHT = 400;
 const int WINDOW_SCALE = 2;
-const real TARGET_FRAMERATE = 60;
+const real MAX_FRAMERATE = 240; // Rendering is paced to the display's refresh rate or this if it's unknown
+const real LOADING_FRAME_BUDGET = 0.008; // Seconds each loading screen frame spends finishing decoded assets
+const real SIM_TICK_RATE = 120; // Simulation ticks per second
+const real MAX_FRAME_TIME = 0.25; // Longest frame the simulation will try to catch up on (in seconds)
+const real PROFILE_SECONDS = 10; // How far back F9 and --profile dump the profiler, --profile-seconds overrides it
 const char *VERSION_STRING = "v1.2";
 const char *GAME_TITLE = "Peace & Liberty";
-const char *SAVE_FILE = "save.bin";
+const char *SAVE_FILE = "save.pnls";
+const char *LEGACY_SAVE_FILE = "save.bin"; // Where JamUtil kept it, imported the first time the game runs without SAVE_FILE
 const char *SAVE_HIGHSCORE = "hs";
 const char *SAVE_DOSH = "dosh";
 const char *SAVE_KILLS = "kills";
 const char *SAVE_DEATH_PLANET = "planet";
 const char *SAVE_DIFFICULTY = "diff";
-const real PHYS_TERMINAL_VELOCITY = 7; // Physics variables - all in pixels/second
-const real PHYS_FRICTION = 30; // Only applies while the player is not giving a keyboard input
-const real PHYS_ACCELERATION = 18;
+const real PHYS_TERMINAL_VELOCITY = 420; // Physics variables - all in pixels/second
+const real PHYS_FRICTION = 1800; // Only applies while the player is not giving a keyboard input
+const real PHYS_ACCELERATION = 1080;
 const float PHYS_CAMERA_FRICTION = 8;
 const real WORLD_GRID_WIDTH = 50; // These are really only for the homeworld and honestly dont matter that much
 const real WORLD_GRID_HEIGHT = 70;
@@ -73,6 +133,7 @@ const real DOSH_PLANET_COST = 200; // Cost of departing to a planet
 const real DOSH_MULTIPLIER = 1.3; // Cost multiplier per difficulty level
 const real DOSH_PLANET_COST_VARIANCE = 50; // How much the cost can vary (also multiplied by cost multiplier)
 const real IN_RANGE_TERMINAL_DISTANCE = 40; // Distance away from a terminal considered to be "in-range"
+const real SHIP_BUTTON_SIZE = 75; // The ship sits at 0, 0 and is also the button to leave a planet
 #define GENERATED_PLANET_COUNT ((int)5) // Number of planets the player can choose from
 const int WEAPON_MIN_SPREAD = 3; // Minimum/maximum pellets per shotgun blast
 const int WEAPON_MAX_SPREAD = 12;
@@ -102,11 +163,11 @@ const real WEAPON_SHOTGUN_DAMAGE_MULTIPLIER = 0.9; // Shotguns have lots of pell
 const real WEAPON_ASSAULTRIFLE_DAMAGE_MULTIPLIER = 0.6; // Assault rifles are fast and long-range so low damage
 const real WEAPON_SNIPER_DAMAGE_MULTIPLIER = 3; // Sniper shoots slow but pierces so high damage
 const real WEAPON_PISTOL_DAMAGE_MULTIPLIER = 1; // Starting weapon
-const real WEAPON_SWORD_RECOIL = 0; // Velocity applied in the opposite direction when firing a given weapon
-const real WEAPON_SHOTGUN_RECOIL = 10;
-const real WEAPON_ASSAULTRIFLE_RECOIL = 2;
-const real WEAPON_SNIPER_RECOIL = 15;
-const real WEAPON_PISTOL_RECOIL = 5;
+const real WEAPON_SWORD_RECOIL = 0; // Velocity (pixels/second) applied in the opposite direction when firing a given weapon
+const real WEAPON_SHOTGUN_RECOIL = 600;
+const real WEAPON_ASSAULTRIFLE_RECOIL = 120;
+const real WEAPON_SNIPER_RECOIL = 900;
+const real WEAPON_PISTOL_RECOIL = 300;
 const int WEAPON_MAX_BPS = 10; // Max/minimum bullets fired per second for assault rifles
 const int WEAPON_MIN_BPS = 5;
 const real WEAPON_BASE_COST = 200; // How much a weapon costs base - can be more depending on how good the weapon is
@@ -125,6 +186,7 @@ const real WEAPON_BULLET_SPAWN_DISTANCE = 20;
 const real FADE_IN_DURATION = 1; // In seconds
 const real MAX_ROT = VK2D_PI * 6; // "Fading in/out" is just rotating/zooming
 const real MAX_ZOOM = 1;
+const real MIN_FADE_ZOOM = 0.05; // The fade stops zooming out here, it's a speck by then and backgrounds only have to cover this much
 const int MAX_ON_HAND_INVENTORY = 20; // Maximum you can hold of any 1 item
 const int MIN_ENEMY_SPAWN_DISTANCE = 400; // Nearest and farthest away from the player enemies can spawn
 const int MAX_ENEMY_SPAWN_DISTANCE = 600;
@@ -136,17 +198,26 @@ const real MINERAL_MOVE_SPEED = 150; // how fast they move towards the player
 const int MAX_MINERAL_PICKUP = 3; // max/min minerals you can pickup at once
 const int MIN_MINERAL_PICKUP = 1;
 const real MINERAL_DEPOSIT_RANGE = 100;
-#define MAX_BULLETS ((int)50) // Maximum number of bullets present at once (because I'm allergic to the hepa)
-#define MAX_MINERALS ((int)200) // Max minerals in a world
-#define MAX_ENEMIES ((int)30) // Max enemies in a world at once
+#define BULLET_CHUNK_SIZE ((int)64) // Bullets are allocated this many at a time
+#define MAX_MINERALS ((int)200) // Minerals scattered around a planet unless told otherwise
+const real MINERAL_CHUNK_SIZE = 256; // Width/height of the chunks minerals are binned into
+#define MAX_QUEUED_SOUNDS ((int)32) // Max sound effects the simulation can request in a single frame
+#define TEXT_CACHE_SIZE ((int)128) // Strings kept laid out, a bit more than the busiest screen draws
 const real NOTIFICATION_TIME = 2; // time in seconds notifications remain on screen (they fade out for half of this)
 const real PLAYER_HEALTHBAR_WIDTH = 40;
 const real PLAYER_HEALTHBAR_HEIGHT = 8;
 #define MAX_WEAPONS_AT_RINKYS ((int)3) // how many weapons rinky sells at once
+const WeaponType RANDOM_WEAPON_TYPES[] = {wt_AssaultRifle, wt_Shotgun, wt_Sniper, wt_Sword}; // what wt_Any can roll
+#define RANDOM_WEAPON_TYPE_COUNT ((int)4)
+#define SHOP_TYPE_COMBINATIONS ((int)64) // RANDOM_WEAPON_TYPE_COUNT to the power of MAX_WEAPONS_AT_RINKYS
 const float VOLUME_MUSIC_LEFT = 1;
 const float VOLUME_MUSIC_RIGHT = 1;
 const float VOLUME_EFFECT_LEFT = 0.5;
 const float VOLUME_EFFECT_RIGHT = 0.5;
+const float MUSIC_CROSSFADE = 1.5; // Seconds it takes one track to fade into the next
+#define SOUND_VOICES ((int)24) // Effects that can play at once, past this the least important get cut off
+const int SOUND_PRIORITIES[se_MAX] = {2, 2, 2, 2, 2, 1, 3, 3, 3, 3, 3}; // Hits are everywhere in a fight so they give way to everything else
+const int SOUND_LIMITS[se_MAX] = {3, 3, 4, 2, 3, 6, 1, 1, 1, 1, 1}; // Instances of each at once, a new one restarts the oldest
 #define MAX_SHOP_LINES ((int)3)
 const real FAME_TO_DOSH_FAME_RATE = 50;
 const real FAME_TO_DOSH_DOSH_RATE = 500;
@@ -179,6 +250,14 @@ const char *DIFFICULTY_NAMES[] = {
 		"The Seventh Circle",
 };
 
+// Max enemies in a world at once for each difficulty level
+const int ENEMY_CAPACITY[] = {
+		30,
+		60,
+		150,
+		4000,
+};
+
 const char *WEAPON_NAME_FIRST[] = {
 		"Freedom",
 		"Liberty",
@@ -278,8 +357,6 @@ JULoadedAsset ASSETS[] = {
 		{"assets/tutorial1.png"},
 		{"assets/tutorial2.png"},
 		{"assets/deathhighscore.png"},
-		{"assets/goofytrack.wav"},
-		{"assets/sombertrack.wav"},
 		{"assets/newgun.wav"},
 		{"assets/whatisawenrad.wav"},
 		{"assets/dontturnmypizzainsideout.wav"},
@@ -290,30 +367,89 @@ JULoadedAsset ASSETS[] = {
 		{"assets/assaultrifle.wav"},
 		{"assets/sniper.wav"},
 		{"assets/hit.wav"},
-		{"assets/mess.wav"},
 		{"assets/heavy.wav"},
 };
 const int ASSET_COUNT = sizeof(ASSETS) / sizeof(JULoadedAsset);
+
+// Textures small enough to go on an atlas page with the sprites, these have to be drawn as PNLImages
+const char *ATLAS_TEXTURES[] = {
+		"assets/helpterm.png",
+		"assets/memorialterm.png",
+		"assets/missionterm.png",
+		"assets/stockterm.png",
+		"assets/weaponterm.png",
+		"assets/cursor.png",
+		"assets/planet1.png",
+		"assets/planet2.png",
+		"assets/planet3.png",
+		"assets/planet4.png",
+		"assets/planet5.png",
+		"assets/stock1.png",
+		"assets/stock2.png",
+		"assets/stock3.png",
+		"assets/stock4.png",
+		"assets/stock5.png",
+		"assets/down.png",
+		"assets/up.png",
+		"assets/assaultrifle.png",
+		"assets/pistol.png",
+		"assets/shotgun.png",
+		"assets/sniper.png",
+		"assets/sword.png",
+		"assets/bullet.png",
+		"assets/whoosh.png",
+		"assets/compass.png",
+};
+const int ATLAS_TEXTURE_COUNT = sizeof(ATLAS_TEXTURES) / sizeof(const char *);
+
+// Music isn't loaded with everything else, it's streamed from these a bit at a time
+const char *MUSIC_TRACKS[mt_MAX] = {
+		NULL,
+		"assets/goofytrack.wav",
+		"assets/sombertrack.wav",
+		"assets/mess.wav",
+};
+const char *ASSET_ARCHIVE = "assets/assets.pak"; // Made by --pack-assets, without it everything is decoded from its own file
 #define PLANET_TEXTURE_COUNT ((int)5)
 
 /********************** Struct **********************/
 
+// Everything the simulation reads from the player in a tick
+typedef struct PNLInput {
+	float mouseX, mouseY; // Mouse x/y in the game world - not the window relative
+	float viewX, viewY; // Top left of the view the mouse was mapped through, terminals are laid out from it
+	bool mouseLPressed, mouseLReleased, mouseLHeld;
+	bool mouseRPressed, mouseRReleased, mouseRHeld;
+	bool mouseMPressed, mouseMReleased, mouseMHeld;
+	bool keyUp, keyDown, keyLeft, keyRight; // WASD
+	bool keyRespawn; // Space, only the frame it was pressed
+	bool keyDebugLeave; // Backspace
+} PNLInput;
+
 typedef struct PNLHomeBlock { // Things in the home world for the player to interact with
 	HomeBlocks type;
 	real x, y;
 } PNLHomeBlock;
 
-typedef struct PNLBullet {
-	bool active;
-	VK2DTexture tex;
-	physvec2 pos;
-	real direction;
-	real lifetime; // Time in seconds until this bullet despawns
-	real pierce; // how many enemies this has pierced
-	bool canPierce; // only sniper/sword shots "pierce"
-	real damage;
-	real velocity;
-} PNLBullet;
+// A chunk of bullet slots, the pool decides which ones are live and the rest hold stale data
+typedef struct PNLBulletChunk {
+	real x[BULLET_CHUNK_SIZE], y[BULLET_CHUNK_SIZE];
+	real dirX[BULLET_CHUNK_SIZE], dirY[BULLET_CHUNK_SIZE]; // Unit vector the bullet travels along
+	real velocity[BULLET_CHUNK_SIZE];
+	real lifetime[BULLET_CHUNK_SIZE]; // Time in seconds this bullet has been alive
+	real damage[BULLET_CHUNK_SIZE];
+	real direction[BULLET_CHUNK_SIZE]; // Only used to rotate the sprite
+	bool canPierce[BULLET_CHUNK_SIZE]; // only sniper/sword shots "pierce"
+	BulletType type[BULLET_CHUNK_SIZE];
+	real lastX[BULLET_CHUNK_SIZE], lastY[BULLET_CHUNK_SIZE]; // Position last tick, for interpolation
+} PNLBulletChunk;
+
+// Every bullet in flight, slot ids from the pool map to chunks[id / BULLET_CHUNK_SIZE]
+typedef struct PNLBullets {
+	PNLPool pool;
+	PNLBulletChunk **chunks; // Chunks never move once allocated, only this list of them does
+	int chunkCount;
+} PNLBullets;
 
 typedef struct PNLWeapon {
 	real weaponDamage;
@@ -337,6 +473,7 @@ typedef struct PNLPlayer {
 	real hp;
 	int kills;
 	real hitcooldown;
+	physvec2 lastPos; // Position last tick, for interpolation
 } PNLPlayer;
 
 const PNLPlayer PLAYER_DEFAULT_STATE = {
@@ -355,14 +492,18 @@ typedef struct PNLStockMarket {
 	int stockOwned[STOCK_TRADE_COUNT]; // What the player owns
 } PNLStockMarket;
 
-typedef struct PNLEnemy {
-	real x, y;
-	real dosh;
-	real fame;
-	real hp;
-	vec4 colour;
-	bool active;
-} PNLEnemy;
+// Every live enemy on the planet, packed so the first count of each column are the live ones
+typedef struct PNLEnemies {
+	int count;
+	int capacity; // Depends on the planet's difficulty, set by pnlReserveEnemies
+	real *x, *y;
+	real *distance; // Distance to the player before the last move
+	real *hp;
+	real *dosh;
+	real *fame;
+	vec4 *colour;
+	real *lastX, *lastY; // Position last tick, for interpolation
+} PNLEnemies;
 
 // Information of a planet the sprite might go to
 typedef struct PNLPlanetSpecs {
@@ -385,18 +526,22 @@ typedef struct PNLHome {
 	int size;
 } PNLHome;
 
-typedef struct PNLMineral {
-	physvec2 pos;
-	int stockIndex;
-	bool active;
-	real randomSeed;
-} PNLMineral;
+// Every mineral scattered on the planet, the grid only holds the ones that haven't been picked up
+typedef struct PNLMinerals {
+	int count;
+	int capacity;
+	real *x, *y;
+	int *stockIndex;
+	real *randomSeed;
+	real *lastX, *lastY; // Position last tick, for interpolation - only kept up to date near the player
+	PNLChunkGrid grid;
+} PNLMinerals;
 
 // Information of the planet the sprite is on
 typedef struct PNLPlanet {
 	PNLPlanetSpecs spec; // Spec this planet comes from
-	PNLMineral minerals[MAX_MINERALS];
-	PNLEnemy enemies[MAX_ENEMIES];
+	PNLMinerals minerals;
+	PNLEnemies enemies;
 	real enemySpawnDelay;
 	real enemySpawnDelayPrevious;
 	PNLInventory inventory;
@@ -405,16 +550,16 @@ typedef struct PNLPlanet {
 typedef struct PNLAssets {
 	VK2DTexture bgHome;
 	VK2DTexture bgTerminal;
-	VK2DTexture texHelpTerminal;
-	VK2DTexture texMemorialTerminal;
-	VK2DTexture texMissionTerminal;
-	VK2DTexture texStockTerminal;
-	VK2DTexture texWeaponTerminal;
-	VK2DTexture texCursor;
-	VK2DTexture texDown;
-	VK2DTexture texUp;
-	VK2DTexture texPlanets[PLANET_TEXTURE_COUNT];
-	VK2DTexture texStocks[STOCK_TRADE_COUNT];
+	PNLImage texHelpTerminal;
+	PNLImage texMemorialTerminal;
+	PNLImage texMissionTerminal;
+	PNLImage texStockTerminal;
+	PNLImage texWeaponTerminal;
+	PNLImage texCursor;
+	PNLImage texDown;
+	PNLImage texUp;
+	PNLImage texPlanets[PLANET_TEXTURE_COUNT];
+	PNLImage texStocks[STOCK_TRADE_COUNT];
 	JUSprite sprButtonLaunch;
 	JUSprite sprStars;
 	JUSprite sprButtonYes;
@@ -427,39 +572,43 @@ typedef struct PNLAssets {
 	JUSprite sprButtonRetire;
 	JUSprite sprButtonFameToDosh;
 	JUSprite sprButtonDoshToFame;
-	VK2DTexture texAssaultRifle;
+	PNLImage texAssaultRifle;
 	VK2DTexture bgOnsite;
-	VK2DTexture texPistol;
-	VK2DTexture texShotgun;
-	VK2DTexture texSniper;
-	VK2DTexture texSword;
-	VK2DTexture texBullet;
-	VK2DTexture texWhoosh;
-	VK2DTexture texCompass;
+	PNLImage texPistol;
+	PNLImage texShotgun;
+	PNLImage texSniper;
+	PNLImage texSword;
+	PNLImage texBullet;
+	PNLImage texWhoosh;
+	PNLImage texCompass;
 	VK2DTexture texDeathScreen;
 	VK2DTexture texHighscoreScreen;
 	VK2DTexture texTutorial1;
 	VK2DTexture texTutorial2;
 	JUSprite sprEnemy;
 	JUFont fntOverlay;
-	JUSound sndMusicSomber;
-	JUSound sndMusicGoofy;
-	JUSound sndNewGun;
-	JUSound sndPistol;
-	JUSound sndShotgun;
-	JUSound sndAssaultRifle;
-	JUSound sndSniper;
-	JUSound sndHit;
-	JUSound sndShop[MAX_SHOP_LINES]; // 3 shop sound effect
-	JUSound sndSword;
-	JUSound sndMusicMess;
-	JUSound sndHeavyDrum;
+	PNLSound sndNewGun;
+	PNLSound sndPistol;
+	PNLSound sndShotgun;
+	PNLSound sndAssaultRifle;
+	PNLSound sndSniper;
+	PNLSound sndHit;
+	PNLSound sndShop[MAX_SHOP_LINES]; // 3 shop sound effect
+	PNLSound sndSword;
+	PNLSound sndHeavyDrum;
 } PNLAssets;
 
+// A terminal as it was last drawn
+typedef struct PNLTerminalCache {
+	VK2DTexture texture;
+	unsigned long hash; // Hash of the state and hovered buttons it was drawn with
+	bool valid;
+} PNLTerminalCache;
+
 typedef struct PNLRuntime {
 	PNLPlayer player;
 	PNLStockMarket market;
-	JUSave save;
+	PNLSaveStore save; // NULL in headless runs
 	int tutorialPage;
 
 	// Current planet, only matters if out on an expedition
@@ -469,38 +618,76 @@ typedef struct PNLRuntime {
 	PNLHome home; // home area
 
 	// All assets
-	JULoader loader;
+	PNLAssetLoader loader;
+	PNLAssetArchive archive; ///< May be NULL
 	PNLAssets assets;
+	PNLMusicStream music; ///< NULL if there's no audio device
+	PNLSoundPool sounds;  ///< Same
 
 	// For fading in/out
 	bool fadeIn, fadeOut;
 	real fadeClock; // Counts up to FADE_IN_DURATION
 	bool deathCooldown;
 	bool highscore;
-	bool weaponLastFrame; // For playing sounds when walking into the shop
+	bool weaponLastFrame; // Whether the player was at the weapon shop last tick, for playing a line when they walk up
 	bool weaponThisFrame;
 
+	// Terminals are only redrawn when what's on them changes
+	PNLTerminalCache terminalCache[hb_MAX];
+	VK2DTexture backbuffer; // Where the game is drawn before being upscaled
+	bool uiHidden; // Buttons don't draw anything
+	bool uiInert; // Buttons can't be pressed, the whole draw pass is
+	const PNLInput *uiInput; // Input buttons are tested against, NULL for the frame's
+	real uiMouseOffsetX, uiMouseOffsetY; // Added to the mouse for hit testing buttons
+	unsigned long uiHover; // Hash of every button's frame since this was last reset
+	int terminalFrames, terminalRedraws;
+
 	// Weapon store
 	PNLWeapon shop[MAX_WEAPONS_AT_RINKYS];
 
+	// Randomness
+	uint64_t seed; // Run seed every stream was derived from
+	PNLRandom random[rs_MAX];
+
 	// For notifications
 	real notificationTime;
 	const char *notificationMessage;
 
 	// Bullets
-	PNLBullet bullets[MAX_BULLETS];
-	int bulletIndex;
+	PNLBullets bullets;
+	const PNLKernels *kernels; // Scalar or SIMD versions of the bullet/enemy movement loops
+	int mineralCount; // Minerals scattered on each planet
+	PNLSpriteBatch batch; // For drawing lots of the same few sprites
+	PNLTextCache text; // Laid out strings for the HUD and terminals
+	PNLSpatialHash enemyGrid; // Active enemies binned by position, rebuilt every tick for bullet collisions
+
+	// Audio the simulation has requested, played by pnlFlushAudio
+	SoundEffect soundQueue[MAX_QUEUED_SOUNDS];
+	int soundQueueSize;
+	MusicTrack musicRequest;
+	bool musicLoop;
 
 	// Window interface stuff
-	float mouseX, mouseY; // Mouse x/y in the game world - not the window relative
-	bool mouseLPressed, mouseLReleased, mouseLHeld;
-	bool mouseRPressed, mouseRReleased, mouseRHeld;
-	bool mouseMPressed, mouseMReleased, mouseMHeld;
+	PNLInput input; // Input for the current tick
+	real frameDelta; // Length of the last frame in seconds, everything outside of ticks uses this instead of juDelta so replays match
+	bool inTerminal; // Player is standing at a home terminal
+	bool headless; // No renderer or audio, only the simulation runs
 	real time; // time in seconds since the program started
+	real interpolation; // How far the frame being drawn is between the last tick and the next, 0 - 1
 	int ww, wh;
 } *PNLRuntime;
 
 /********************** Utility **********************/
+#define PNL_HASH_START 2166136261ul
+
+// FNV-1a, start from PNL_HASH_START and feed the previous result back in to hash several things
+unsigned long pnlHash(unsigned long hash, const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 16777619ul;
+	return hash;
+}
+
 physvec2 addPhysVec2(physvec2 v1, physvec2 v2) {
 	physvec2 v = {v1.x + v2.x, v1.y + v2.y};
 	return v;
@@ -527,16 +714,31 @@ real clamp(real a, real low, real high) {
 	return a;
 }
 
+real lerp(real a, real b, real t) {
+	return a + ((b - a) * t);
+}
+
 real roundTo(real a, real to) {
 	return floor(a / to) * to;
 }
 
-real randr() { // Returns a real from 0 - 1
-	return (real)rand() / (real)RAND_MAX;
+real randr(PNLRuntime game, RandomStream stream) { // Returns a real from 0 - 1 (exclusive)
+	return pnlRandomReal(&game->random[stream]);
+}
+
+int randi(PNLRuntime game, RandomStream stream, int n) { // Returns an int from 0 - n (exclusive)
+	return pnlRandomInt(&game->random[stream], n);
 }
 
-bool weightedChance(real percent) { // 70% is 0.7
-	return randr() < percent;
+bool weightedChance(PNLRuntime game, RandomStream stream, real percent) { // 70% is 0.7
+	return randr(game, stream) < percent;
+}
+
+// Every stream is derived from the one seed so a whole run can be reproduced from it
+void pnlSeedRandom(PNLRuntime game, uint64_t seed) {
+	game->seed = seed;
+	for (int i = 0; i < rs_MAX; i++)
+		pnlRandomSeed(&game->random[i], seed, i);
 }
 
 // Returns true if the player can afford a purchase, removing the money if so
@@ -550,30 +752,55 @@ bool pnlPlayerPurchase(PNLRuntime game, real dosh) {
 }
 void pnlSetNotification(PNLRuntime game, const char *string);
 
+// Queues a sound effect to be played once the frame is drawn
+void pnlPlaySound(PNLRuntime game, SoundEffect sound) {
+	if (game->soundQueueSize < MAX_QUEUED_SOUNDS)
+		game->soundQueue[game->soundQueueSize++] = sound;
+}
+
+// Stops all sounds and starts a new track once the frame is drawn
+void pnlPlayMusic(PNLRuntime game, MusicTrack track, bool loop) {
+	game->musicRequest = track;
+	game->musicLoop = loop;
+	game->soundQueueSize = 0; // These would be stopped right away anyway
+}
+
+// Draws an image whether it has its own texture or is a region of an atlas page, origin is relative to the image
+void pnlDrawImage(PNLImage img, float x, float y, float xscale, float yscale, float rot, float originX, float originY) {
+	vk2dRendererDrawTexture(img.tex, x, y, xscale, yscale, rot, originX, originY, img.x, img.y, img.w, img.h);
+}
+
 /********************** Drawing/Updating Terminal Menus **********************/
 
 // Sprite should have 3 frames - normal, mouse over, and pressed
 // Returns true if the button has been pressed
 bool pnlDrawButton(PNLRuntime game, JUSprite button, real x, real y) {
+	const PNLInput *input = game->uiInput != NULL ? game->uiInput : &game->input;
 	JURectangle r = {x, y, button->Internal.w, button->Internal.h};
-	bool mouseOver = juPointInRectangle(&r, game->mouseX, game->mouseY);
-	bool pressed = mouseOver && game->mouseLHeld;
-	button->rotation = 0;
-	juSpriteDrawFrame(button, mouseOver ? (pressed ? 2 : 1) : 0, x, y);
-	return mouseOver && game->mouseLReleased;
+	bool mouseOver = juPointInRectangle(&r, input->mouseX + game->uiMouseOffsetX, input->mouseY + game->uiMouseOffsetY);
+	bool pressed = mouseOver && input->mouseLHeld;
+	int frame = mouseOver ? (pressed ? 2 : 1) : 0;
+	game->uiHover = pnlHash(game->uiHover, &frame, sizeof(int));
+	if (!game->uiHidden) {
+		button->rotation = 0;
+		juSpriteDrawFrame(button, frame, x, y);
+	}
+	return mouseOver && input->mouseLReleased && !game->uiInert;
 }
 
 // Same as above but can only be clicked if a condition is met
 bool pnlDrawButtonExt(PNLRuntime game, JUSprite button, real x, real y, bool condition) {
+	const PNLInput *input = game->uiInput != NULL ? game->uiInput : &game->input;
 	JURectangle r = {x, y, button->Internal.w, button->Internal.h};
-	bool mouseOver = juPointInRectangle(&r, game->mouseX, game->mouseY);
-	bool pressed = mouseOver && game->mouseLHeld;
-	button->rotation = 0;
-	if (condition)
-		juSpriteDrawFrame(button, mouseOver ? (pressed ? 2 : 1) : 0, x, y);
-	else
-		juSpriteDrawFrame(button, 0, x, y);
-	return mouseOver && game->mouseLReleased && condition;
+	bool mouseOver = juPointInRectangle(&r, input->mouseX + game->uiMouseOffsetX, input->mouseY + game->uiMouseOffsetY);
+	bool pressed = mouseOver && input->mouseLHeld;
+	int frame = condition && mouseOver ? (pressed ? 2 : 1) : 0;
+	game->uiHover = pnlHash(game->uiHover, &frame, sizeof(int));
+	if (!game->uiHidden) {
+		button->rotation = 0;
+		juSpriteDrawFrame(button, frame, x, y);
+	}
+	return mouseOver && input->mouseLReleased && condition && !game->uiInert;
 }
 
 void pnlDrawHealthbar(PNLRuntime game, real percent, vec4 colour, float x, float y, float w, float h) {
@@ -585,62 +812,100 @@ void pnlDrawHealthbar(PNLRuntime game, real percent, vec4 colour, float x, float
 }
 
 void pnlDrawWeaponStats(PNLRuntime game, PNLWeapon weapon, float x, float y) {
-	juFontDraw(game->assets.fntOverlay, x + 3, y, "%s %s", WEAPON_NAME_FIRST[weapon.weaponNameFirstIndex], WEAPON_NAME_SECOND[weapon.weaponNameSecondIndex]);
-	juFontDraw(game->assets.fntOverlay, x + 5, y + 20, "$%.2f", weapon.weaponCost);
+	pnlTextDraw(game->text, game->assets.fntOverlay, x + 3, y, "%s %s", WEAPON_NAME_FIRST[weapon.weaponNameFirstIndex], WEAPON_NAME_SECOND[weapon.weaponNameSecondIndex]);
+	pnlTextDraw(game->text, game->assets.fntOverlay, x + 5, y + 20, "$%.2f", weapon.weaponCost);
 	y += 20;
 	x += 20;
 	vk2dRendererSetColourMod(weapon.weaponColourMod);
 	if (weapon.weaponType == wt_AssaultRifle) {
-		vk2dDrawTextureExt(game->assets.texAssaultRifle, x - 20, y + 30, 3, 3, 0, 0, 0);
+		pnlDrawImage(game->assets.texAssaultRifle, x - 20, y + 30, 3, 3, 0, 0, 0);
 		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 60, "Damage");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 60, "Damage");
 		pnlDrawHealthbar(game, ((weapon.weaponDamage / WEAPON_ASSAULTRIFLE_DAMAGE_MULTIPLIER) - WEAPON_MIN_DAMAGE) / (WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE), VK2D_RED, x + 10, y + 90, 80, 10);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 105, "RPM");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 105, "RPM");
 		pnlDrawHealthbar(game, (weapon.weaponBPS - WEAPON_MIN_BPS) / (WEAPON_MAX_BPS - WEAPON_MIN_BPS), VK2D_GREEN, x + 10, y + 135, 80, 10);
 	} else if (weapon.weaponType == wt_Sniper) {
-		vk2dDrawTextureExt(game->assets.texSniper, x - 20, y + 30, 3, 3, 0, 0, 0);
+		pnlDrawImage(game->assets.texSniper, x - 20, y + 30, 3, 3, 0, 0, 0);
 		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 60, "Damage");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 60, "Damage");
 		pnlDrawHealthbar(game, ((weapon.weaponDamage / WEAPON_SNIPER_DAMAGE_MULTIPLIER) - WEAPON_MIN_DAMAGE) / (WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE), VK2D_RED, x + 10, y + 90, 80, 10);
 	} else if (weapon.weaponType == wt_Shotgun) {
-		vk2dDrawTextureExt(game->assets.texShotgun, x - 20, y + 30, 3, 3, 0, 0, 0);
+		pnlDrawImage(game->assets.texShotgun, x - 20, y + 30, 3, 3, 0, 0, 0);
 		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 60, "Damage");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 60, "Damage");
 		pnlDrawHealthbar(game, ((weapon.weaponDamage / WEAPON_SHOTGUN_DAMAGE_MULTIPLIER) - WEAPON_MIN_DAMAGE) / (WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE), VK2D_RED, x + 10, y + 90, 80, 10);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 105, "Spread");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 105, "Spread");
 		pnlDrawHealthbar(game, (weapon.weaponPellets - WEAPON_MIN_SPREAD) / (WEAPON_MAX_SPREAD - WEAPON_MIN_SPREAD), VK2D_BLUE, x + 10, y + 135, 80, 10);
 	} else if (weapon.weaponType == wt_Sword) {
-		vk2dDrawTextureExt(game->assets.texSword, x - 20, y + 30, 3, 3, 0, 0, 0);
+		pnlDrawImage(game->assets.texSword, x - 20, y + 30, 3, 3, 0, 0, 0);
 		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 60, "Damage");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 60, "Damage");
 		pnlDrawHealthbar(game, ((weapon.weaponDamage / WEAPON_SWORD_DAMAGE_MULTIPLIER) - WEAPON_MIN_DAMAGE) / (WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE), VK2D_RED, x + 10, y + 90, 80, 10);
 	} else if (weapon.weaponType == wt_Pistol) {
-		vk2dDrawTextureExt(game->assets.texPistol, x - 20, y + 30, 3, 3, 0, 0, 0);
+		pnlDrawImage(game->assets.texPistol, x - 20, y + 30, 3, 3, 0, 0, 0);
 		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-		juFontDraw(game->assets.fntOverlay, x + 10, y + 60, "Damage");
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y + 60, "Damage");
 		pnlDrawHealthbar(game, ((weapon.weaponDamage / WEAPON_PISTOL_DAMAGE_MULTIPLIER) - WEAPON_MIN_DAMAGE) / (WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE), VK2D_RED, x + 10, y + 90, 80, 10);
 	}
 }
 
 PNLWeapon pnlGenerateWeapon(PNLRuntime, WeaponType);
-TerminalCode pnlUpdateMemorialTerminal(PNLRuntime game) {
-	VK2DCamera cam = vk2dRendererGetCamera();
-	// Coordinates to start drawing the background - the +3 is to account for the background's frame
-	float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 3;
-	float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 3;
-	vk2dDrawTexture(game->assets.bgTerminal, x - 3, y - 3);
-
-	if (juSaveKeyExists(game->save, SAVE_HIGHSCORE)) {
-		real hs = juSaveGetDouble(game->save, SAVE_HIGHSCORE);
-		real dosh = juSaveGetDouble(game->save, SAVE_DOSH);
-		real kills = juSaveGetDouble(game->save, SAVE_KILLS);
-		const char *planet = juSaveGetString(game->save, SAVE_DEATH_PLANET);
-		const char *difficulty = juSaveGetString(game->save, SAVE_DIFFICULTY);
-		juFontDraw(game->assets.fntOverlay, x + 10, y - 2, "\n\nHigh score: %.0f fame, $%.0f dosh\nFreedom delivered to: %i aliens\nDied on planet %s\nDistance: %s", hs, dosh, kills, planet, difficulty);
-	} else {
-		juFontDraw(game->assets.fntOverlay, x + 1, y - 2, "There is no recorded highscore.");
+
+// What the terminal buttons do, split out so bots can press them too - each returns false if it couldn't be done
+bool pnlConvertFameToDosh(PNLRuntime game) {
+	if (game->player.fame < FAME_TO_DOSH_FAME_RATE)
+		return false;
+	game->player.fame -= FAME_TO_DOSH_FAME_RATE;
+	game->player.dosh += FAME_TO_DOSH_DOSH_RATE;
+	pnlSetNotification(game, "Politicans swayed");
+	pnlPlaySound(game, se_HeavyDrum);
+	return true;
+}
+
+bool pnlBuyStocks(PNLRuntime game, int stock, int count) {
+	if (!pnlPlayerPurchase(game, game->market.stockCosts[stock] * count))
+		return false;
+	game->market.stockOwned[stock] += count;
+	pnlSetNotification(game, count == 1 ? "Stock sold!" : "10 stocks purchased!");
+	return true;
+}
+
+bool pnlSellStocks(PNLRuntime game, int stock, int count) {
+	if (game->market.stockOwned[stock] < count || count <= 0)
+		return false;
+	game->market.stockOwned[stock] -= count;
+	game->player.dosh += game->market.stockCosts[stock] * count;
+	pnlSetNotification(game, count == 1 ? "Stock sold!" : "10 stocks sold!");
+	return true;
+}
+
+bool pnlBuyShopWeapon(PNLRuntime game, int index) {
+	if (!pnlPlayerPurchase(game, game->shop[index].weaponCost))
+		return false;
+	game->player.weapon = game->shop[index];
+	game->shop[index] = pnlGenerateWeapon(game, wt_Any);
+	pnlPlaySound(game, se_NewGun);
+	return true;
+}
+
+TerminalCode pnlUpdateMemorialTerminal(PNLRuntime game, float left, float top) {
+	// Coordinates to start drawing from - the +3 is to account for the background's frame
+	float x = left + 3;
+	float y = top + 3;
+	if (!game->uiHidden) {
+		vk2dDrawTexture(game->assets.bgTerminal, x - 3, y - 3);
+		if (pnlSaveStoreKeyExists(game->save, SAVE_HIGHSCORE)) {
+			real hs = pnlSaveStoreGetDouble(game->save, SAVE_HIGHSCORE);
+			real dosh = pnlSaveStoreGetDouble(game->save, SAVE_DOSH);
+			real kills = pnlSaveStoreGetDouble(game->save, SAVE_KILLS);
+			const char *planet = pnlSaveStoreGetString(game->save, SAVE_DEATH_PLANET);
+			const char *difficulty = pnlSaveStoreGetString(game->save, SAVE_DIFFICULTY);
+			pnlTextDraw(game->text, game->assets.fntOverlay, x + 10, y - 2, "\n\nHigh score: %.0f fame, $%.0f dosh\nFreedom delivered to: %i aliens\nDied on planet %s\nDistance: %s", hs, dosh, kills, planet, difficulty);
+		} else {
+			pnlTextDraw(game->text, game->assets.fntOverlay, x + 1, y - 2, "There is no recorded highscore.");
+		}
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 3, y + 300 - 75, "Retire if you're out of money or convert %.0f fame to $%.2f dosh", FAME_TO_DOSH_FAME_RATE, FAME_TO_DOSH_DOSH_RATE);
 	}
-	juFontDraw(game->assets.fntOverlay, x + 3, y + 300 - 75, "Retire if you're out of money or convert %.0f fame to $%.2f dosh", FAME_TO_DOSH_FAME_RATE, FAME_TO_DOSH_DOSH_RATE);
 	if (pnlDrawButton(game, game->assets.sprButtonRetire, x + 250 - 127, y + 300 - 43)) {
 		pnlSetNotification(game, "Restarted game");
 		JUSprite spr = game->player.sprite;
@@ -650,67 +915,59 @@ TerminalCode pnlUpdateMemorialTerminal(PNLRuntime game) {
 		for (int i = 0; i < STOCK_TRADE_COUNT; i++)
 			game->market.stockOwned[i] = 0;
 	}
-	if (pnlDrawButton(game, game->assets.sprButtonFameToDosh, x + 250 - 127 + 85, y + 300 - 43) && game->player.fame >= FAME_TO_DOSH_FAME_RATE) {
-		game->player.fame -= FAME_TO_DOSH_FAME_RATE;
-		game->player.dosh += FAME_TO_DOSH_DOSH_RATE;
-		pnlSetNotification(game, "Politicans swayed");
-		juSoundPlay(game->assets.sndHeavyDrum, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
-	}
+	if (pnlDrawButton(game, game->assets.sprButtonFameToDosh, x + 250 - 127 + 85, y + 300 - 43))
+		pnlConvertFameToDosh(game);
 	if (pnlDrawButton(game, game->assets.sprButtonDoshToFame, x + 250 - 127 + 85 + 85, y + 300 - 43) && pnlPlayerPurchase(game, FAME_TO_DOSH_DOSH_RATE)) {
 		game->player.fame += FAME_TO_DOSH_FAME_RATE;
 		pnlSetNotification(game, "Politicans swayed");
-		juSoundPlay(game->assets.sndHeavyDrum, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+		pnlPlaySound(game, se_HeavyDrum);
 	}
 
 	return tc_NoDraw;
 }
 
-void pnlLoadPlanet(PNLRuntime game, int index);
-TerminalCode pnlUpdateMissionSelectTerminal(PNLRuntime game) {
-	VK2DCamera cam = vk2dRendererGetCamera();
+bool pnlLaunchPlanet(PNLRuntime game, int index);
+TerminalCode pnlUpdateMissionSelectTerminal(PNLRuntime game, float left, float top) {
 	TerminalCode code = tc_NoDraw;
 
-	// Coordinates to start drawing the background - the +3 is to account for the background's frame
-	float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 4;
-	float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 4;
-	vk2dDrawTexture(game->assets.bgTerminal, x - 4, y - 4);
+	// Coordinates to start drawing from - the +4 is to account for the background's frame
+	float x = left + 4;
+	float y = top + 4;
+	if (!game->uiHidden)
+		vk2dDrawTexture(game->assets.bgTerminal, x - 4, y - 4);
 
 	// Draw planets and their info
-	float w = game->assets.texPlanets[0]->img->width;
-	float h = game->assets.texPlanets[0]->img->height;
+	float w = game->assets.texPlanets[0].w;
+	float h = game->assets.texPlanets[0].h;
 	for (int i = 0; i < GENERATED_PLANET_COUNT; i++) {
-		vk2dDrawTexture(game->assets.texPlanets[game->potentialPlanets[i].planetTexIndex], x + 1, y);
-		juFontDraw(game->assets.fntOverlay, x + w + 10, y, PLANET_NAMES[game->potentialPlanets[i].planetNameIndex]);
-		juFontDraw(game->assets.fntOverlay, x + w + 10, y + 29, "Cost: $%.2f | Potential Fame: %.0f", (float)game->potentialPlanets[i].doshCost, (float)roundTo(game->potentialPlanets[i].fameBonus, 10));
-
-		for (int j = 0; j < 4; j++) {
-			if (game->potentialPlanets[i].planetDifficulty <= j)
-				vk2dRendererSetColourMod(VK2D_BLACK);
-			juSpriteDrawFrame(game->assets.sprStars, j, (x + game->assets.bgTerminal->img->width - w - w - 11) + ((j % 2) * 29), y + (j > 1 ? 29 : 0));
-			vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		if (!game->uiHidden) {
+			pnlDrawImage(game->assets.texPlanets[game->potentialPlanets[i].planetTexIndex], x + 1, y, 1, 1, 0, 0, 0);
+			pnlTextDraw(game->text, game->assets.fntOverlay, x + w + 10, y, "%s", PLANET_NAMES[game->potentialPlanets[i].planetNameIndex]);
+			pnlTextDraw(game->text, game->assets.fntOverlay, x + w + 10, y + 29, "Cost: $%.2f | Potential Fame: %.0f", (float)game->potentialPlanets[i].doshCost, (float)roundTo(game->potentialPlanets[i].fameBonus, 10));
+
+			for (int j = 0; j < 4; j++) {
+				if (game->potentialPlanets[i].planetDifficulty <= j)
+					vk2dRendererSetColourMod(VK2D_BLACK);
+				juSpriteDrawFrame(game->assets.sprStars, j, (x + game->assets.bgTerminal->img->width - w - w - 11) + ((j % 2) * 29), y + (j > 1 ? 29 : 0));
+				vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+			}
 		}
 
-		if (pnlDrawButton(game, game->assets.sprButtonLaunch, x + game->assets.bgTerminal->img->width - w - 9, y) && pnlPlayerPurchase(game, game->potentialPlanets[i].doshCost)) {
-			pnlLoadPlanet(game, i);
-			game->fadeOut = true;
-			game->fadeClock = 0;
-		}
+		if (pnlDrawButton(game, game->assets.sprButtonLaunch, x + game->assets.bgTerminal->img->width - w - 9, y))
+			pnlLaunchPlanet(game, i);
 		y += h;
 	}
 
 	return code;
 }
 
-TerminalCode pnlUpdateHelpTerminal(PNLRuntime game) {
-	VK2DCamera cam = vk2dRendererGetCamera();
-	// Coordinates to start drawing the background - the +3 is to account for the background's frame
-	float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 3;
-	float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 3;
+TerminalCode pnlUpdateHelpTerminal(PNLRuntime game, float left, float top) {
+	// Coordinates to start drawing from - the +3 is to account for the background's frame
+	float x = left + 3;
+	float y = top + 3;
 
-	if (game->tutorialPage % 2 == 0)
-		vk2dDrawTexture(game->assets.texTutorial1, x - 4, y - 4);
-	else
-		vk2dDrawTexture(game->assets.texTutorial2, x - 4, y - 4);
+	if (!game->uiHidden)
+		vk2dDrawTexture(game->tutorialPage % 2 == 0 ? game->assets.texTutorial1 : game->assets.texTutorial2, x - 4, y - 4);
 
 	if (pnlDrawButton(game, game->assets.sprButtonYes, x + 500 - 60, y + 300 - 60))
 		game->tutorialPage++;
@@ -718,50 +975,34 @@ TerminalCode pnlUpdateHelpTerminal(PNLRuntime game) {
 	return tc_NoDraw;
 }
 
-TerminalCode pnlUpdateStocksTerminal(PNLRuntime game) {
-	VK2DCamera cam = vk2dRendererGetCamera();
-	// Coordinates to start drawing the background - the +3 is to account for the background's frame
-	float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 3;
-	float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 3;
-	vk2dDrawTexture(game->assets.bgTerminal, x - 3, y - 3);
+TerminalCode pnlUpdateStocksTerminal(PNLRuntime game, float left, float top) {
+	// Coordinates to start drawing from - the +3 is to account for the background's frame
+	float x = left + 3;
+	float y = top + 3;
+	if (!game->uiHidden)
+		vk2dDrawTexture(game->assets.bgTerminal, x - 3, y - 3);
 
 	// Draw stocks and their info
-	float w = game->assets.texStocks[0]->img->width;
-	float h = game->assets.texStocks[0]->img->height;
+	float w = game->assets.texStocks[0].w;
+	float h = game->assets.texStocks[0].h;
 	for (int i = 0; i < STOCK_TRADE_COUNT; i++) {
-		float maxCost = (float)STOCK_BASE_PRICE * (1.0f + (float)STOCK_FLUCTUATION[i]);
-		float chanceOfGoingUp = (1 - ((float)game->market.stockCosts[i] / (float)maxCost)) * 100.0f;
-		vk2dDrawTexture(game->assets.texStocks[i], x + 1, y);
-		juFontDraw(game->assets.fntOverlay, x + w + 10, y, "%s | %.0f on hand", STOCK_NAMES[i], (float)game->market.stockOwned[i]);
-		juFontDraw(game->assets.fntOverlay, x + w + 10, y + 29, "Market: $%.2f | Chance of Increasing: %0.f%%", (float)game->market.stockCosts[i], chanceOfGoingUp);
-		vk2dDrawTexture((game->market.previousCosts[i] < game->market.stockCosts[i] ? game->assets.texUp : game->assets.texDown), x + game->assets.bgTerminal->img->width - w - 9 - 58 - 2 - 30, y);
-
-		if (pnlDrawButton(game, game->assets.sprButtonBuy, x + game->assets.bgTerminal->img->width - w - 9 - 58 - 2, y + 29)) {
-			if (pnlPlayerPurchase(game, game->market.stockCosts[i])) {
-				game->market.stockOwned[i] += 1;
-				pnlSetNotification(game, "Stock sold!");
-			}
-		}
-		if (pnlDrawButton(game, game->assets.sprButtonSell, x + game->assets.bgTerminal->img->width - w - 9, y + 29)) {
-			if (game->market.stockOwned[i] > 0) {
-				game->market.stockOwned[i] -= 1;
-				game->player.dosh += game->market.stockCosts[i];
-				pnlSetNotification(game, "Stock sold!");
-			}
-		}
-		if (pnlDrawButton(game, game->assets.sprButtonBuy10, x + game->assets.bgTerminal->img->width - w - 9 - 58 - 2, y)) {
-			if (pnlPlayerPurchase(game, game->market.stockCosts[i] * 10)) {
-				game->market.stockOwned[i] += 10;
-				pnlSetNotification(game, "10 stocks purchased!");
-			}
-		}
-		if (pnlDrawButton(game, game->assets.sprButtonSell10, x + game->assets.bgTerminal->img->width - w - 9, y)) {
-			if (game->market.stockOwned[i] >= 10) {
-				game->market.stockOwned[i] -= 10;
-				game->player.dosh += game->market.stockCosts[i] * 10;
-				pnlSetNotification(game, "10 stocks sold!");
-			}
+		if (!game->uiHidden) {
+			float maxCost = (float)STOCK_BASE_PRICE * (1.0f + (float)STOCK_FLUCTUATION[i]);
+			float chanceOfGoingUp = (1 - ((float)game->market.stockCosts[i] / (float)maxCost)) * 100.0f;
+			pnlDrawImage(game->assets.texStocks[i], x + 1, y, 1, 1, 0, 0, 0);
+			pnlTextDraw(game->text, game->assets.fntOverlay, x + w + 10, y, "%s | %.0f on hand", STOCK_NAMES[i], (float)game->market.stockOwned[i]);
+			pnlTextDraw(game->text, game->assets.fntOverlay, x + w + 10, y + 29, "Market: $%.2f | Chance of Increasing: %0.f%%", (float)game->market.stockCosts[i], chanceOfGoingUp);
+			pnlDrawImage((game->market.previousCosts[i] < game->market.stockCosts[i] ? game->assets.texUp : game->assets.texDown), x + game->assets.bgTerminal->img->width - w - 9 - 58 - 2 - 30, y, 1, 1, 0, 0, 0);
 		}
+
+		if (pnlDrawButton(game, game->assets.sprButtonBuy, x + game->assets.bgTerminal->img->width - w - 9 - 58 - 2, y + 29))
+			pnlBuyStocks(game, i, 1);
+		if (pnlDrawButton(game, game->assets.sprButtonSell, x + game->assets.bgTerminal->img->width - w - 9, y + 29))
+			pnlSellStocks(game, i, 1);
+		if (pnlDrawButton(game, game->assets.sprButtonBuy10, x + game->assets.bgTerminal->img->width - w - 9 - 58 - 2, y))
+			pnlBuyStocks(game, i, 10);
+		if (pnlDrawButton(game, game->assets.sprButtonSell10, x + game->assets.bgTerminal->img->width - w - 9, y))
+			pnlSellStocks(game, i, 10);
 		y += h;
 	}
 
@@ -769,21 +1010,18 @@ TerminalCode pnlUpdateStocksTerminal(PNLRuntime game) {
 }
 
 PNLWeapon pnlGenerateWeapon(PNLRuntime game, WeaponType weaponType);
-TerminalCode pnlUpdateWeaponsTerminal(PNLRuntime game) {
-	game->weaponThisFrame = true;
-	VK2DCamera cam = vk2dRendererGetCamera();
-	// Coordinates to start drawing the background - the +3 is to account for the background's frame
-	float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 3;
-	float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 3;
-	vk2dDrawTexture(game->assets.bgTerminal, x - 3, y - 3);
+TerminalCode pnlUpdateWeaponsTerminal(PNLRuntime game, float left, float top) {
+	// Coordinates to start drawing from - the +3 is to account for the background's frame
+	float x = left + 3;
+	float y = top + 3;
+	if (!game->uiHidden)
+		vk2dDrawTexture(game->assets.bgTerminal, x - 3, y - 3);
 
 	for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++) {
-		pnlDrawWeaponStats(game, game->shop[i], x + 1, y + 1);
-		if (pnlDrawButton(game, game->assets.sprButtonPurchase, x + 44, y + 250) && pnlPlayerPurchase(game, game->shop[i].weaponCost)) {
-			game->player.weapon = game->shop[i];
-			game->shop[i] = pnlGenerateWeapon(game, wt_Any);
-			juSoundPlay(game->assets.sndNewGun, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
-		}
+		if (!game->uiHidden)
+			pnlDrawWeaponStats(game, game->shop[i], x + 1, y + 1);
+		if (pnlDrawButton(game, game->assets.sprButtonPurchase, x + 44, y + 250))
+			pnlBuyShopWeapon(game, i);
 		x += 500 / MAX_WEAPONS_AT_RINKYS;
 	}
 
@@ -795,107 +1033,130 @@ TerminalCode pnlUpdateWeaponsTerminal(PNLRuntime game) {
 
 // Records the new highscore if this score beats the last one - returns true if new highscore
 bool pnlRecordHighscore(PNLRuntime game) {
-	if (!juSaveKeyExists(game->save, SAVE_HIGHSCORE) || juSaveGetDouble(game->save, SAVE_HIGHSCORE) < game->player.fame) {
-		juSaveSetDouble(game->save, SAVE_HIGHSCORE, game->player.fame);
-		juSaveSetDouble(game->save, SAVE_DOSH, game->player.dosh);
-		juSaveSetDouble(game->save, SAVE_KILLS, (real)game->player.kills);
-		juSaveSetString(game->save, SAVE_DEATH_PLANET, PLANET_NAMES[game->planet.spec.planetNameIndex]);
-		juSaveSetString(game->save, SAVE_DIFFICULTY, DIFFICULTY_NAMES[game->planet.spec.planetDifficulty - 1]);
+	if (game->save == NULL) // headless runs have no save
+		return false;
+	if (!pnlSaveStoreKeyExists(game->save, SAVE_HIGHSCORE) || pnlSaveStoreGetDouble(game->save, SAVE_HIGHSCORE) < game->player.fame) {
+		pnlSaveStoreSetDouble(game->save, SAVE_HIGHSCORE, game->player.fame);
+		pnlSaveStoreSetDouble(game->save, SAVE_DOSH, game->player.dosh);
+		pnlSaveStoreSetDouble(game->save, SAVE_KILLS, (real)game->player.kills);
+		pnlSaveStoreSetString(game->save, SAVE_DEATH_PLANET, PLANET_NAMES[game->planet.spec.planetNameIndex]);
+		pnlSaveStoreSetString(game->save, SAVE_DIFFICULTY, DIFFICULTY_NAMES[game->planet.spec.planetDifficulty - 1]);
 		return true;
 	}
 	return false;
 }
 
+// Copies the highscore out of the save JamUtil used to write on exit, if there is one and nothing's been saved since
+void pnlImportLegacySave(PNLRuntime game) {
+	FILE *file = fopen(LEGACY_SAVE_FILE, "rb");
+	if (file == NULL || pnlSaveStoreKeyExists(game->save, SAVE_HIGHSCORE)) {
+		if (file != NULL)
+			fclose(file);
+		return;
+	}
+	fclose(file);
+	JUSave legacy = juSaveLoad(LEGACY_SAVE_FILE);
+	if (legacy != NULL && juSaveKeyExists(legacy, SAVE_HIGHSCORE)) {
+		pnlSaveStoreSetDouble(game->save, SAVE_HIGHSCORE, juSaveGetDouble(legacy, SAVE_HIGHSCORE));
+		pnlSaveStoreSetDouble(game->save, SAVE_DOSH, juSaveGetDouble(legacy, SAVE_DOSH));
+		pnlSaveStoreSetDouble(game->save, SAVE_KILLS, juSaveGetDouble(legacy, SAVE_KILLS));
+		pnlSaveStoreSetString(game->save, SAVE_DEATH_PLANET, juSaveGetString(legacy, SAVE_DEATH_PLANET));
+		pnlSaveStoreSetString(game->save, SAVE_DIFFICULTY, juSaveGetString(legacy, SAVE_DIFFICULTY));
+	}
+	if (legacy != NULL)
+		juSaveFree(legacy);
+}
+
 // Forward declarations
 void pnlDrawWeapon(PNLRuntime game, PNLWeapon wep, float x, float y, float r, float xscale, float yscale);
 PNLWeapon pnlGenerateWeapon(PNLRuntime game, WeaponType weaponType);
-void pnlCreateBullet(PNLRuntime game, physvec2 pos, real speed, real direction, bool pierce, real damage, VK2DTexture tex);
+void pnlCreateBullet(PNLRuntime game, physvec2 pos, real speed, real direction, bool pierce, real damage, BulletType type);
 
-void _pnlPlayerUpdate(PNLRuntime game, bool drawPlayer) {
+void _pnlSimPlayer(PNLRuntime game, real dt, const PNLInput *input, bool canShoot) {
 	// Handle weapons
-	float lookingDir = juPointAngle(game->player.pos.x, game->player.pos.y, game->mouseX, game->mouseY) - (VK2D_PI / 2);
+	float lookingDir = juPointAngle(game->player.pos.x, game->player.pos.y, input->mouseX, input->mouseY) - (VK2D_PI / 2);
 
-	if (drawPlayer) {
+	if (canShoot) {
 		if (game->player.weapon.weaponType == wt_Shotgun) {
 			if (game->player.weapon.cooldown > 0) {
-				game->player.weapon.cooldown -= juDelta();
-			} else if (game->mouseLPressed) {
+				game->player.weapon.cooldown -= dt;
+			} else if (input->mouseLPressed) {
 				physvec2 pos = {game->player.pos.x + (cos(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE),
 								game->player.pos.y - (sin(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE)};
 				game->player.weapon.cooldown = WEAPON_SHOTGUN_DELAY;
 				// Shotguns are guaranteed to fire 1 pellet where they are aimed
 				pnlCreateBullet(game, pos, WEAPON_BULLET_SPEED, lookingDir, false, game->player.weapon.weaponDamage,
-								game->assets.texBullet);
+								bt_Bullet);
 				for (int i = 0; i < (int) game->player.weapon.weaponPellets - 1; i++)
 					pnlCreateBullet(game, pos, WEAPON_BULLET_SPEED,
-									lookingDir + sign(randr() - 0.5) * randr() * WEAPON_SHOTGUN_SPREAD_ANGLE, false,
-									game->player.weapon.weaponDamage, game->assets.texBullet);
+									lookingDir + sign(randr(game, rs_Combat) - 0.5) * randr(game, rs_Combat) * WEAPON_SHOTGUN_SPREAD_ANGLE, false,
+									game->player.weapon.weaponDamage, bt_Bullet);
 				game->player.velocity.x -= cos(lookingDir) * WEAPON_SHOTGUN_RECOIL;
 				game->player.velocity.y += sin(lookingDir) * WEAPON_SHOTGUN_RECOIL;
-				juSoundPlay(game->assets.sndShotgun, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+				pnlPlaySound(game, se_Shotgun);
 			}
 		} else if (game->player.weapon.weaponType == wt_Sniper) {
 			if (game->player.weapon.cooldown > 0) {
-				game->player.weapon.cooldown -= juDelta();
-			} else if (game->mouseLPressed) {
+				game->player.weapon.cooldown -= dt;
+			} else if (input->mouseLPressed) {
 				physvec2 pos = {game->player.pos.x + (cos(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE),
 								game->player.pos.y - (sin(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE)};
 				game->player.weapon.cooldown = WEAPON_SNIPER_DELAY;
 				pnlCreateBullet(game, pos, WEAPON_BULLET_SPEED, lookingDir, true, game->player.weapon.weaponDamage,
-								game->assets.texBullet);
+								bt_Bullet);
 				game->player.velocity.x -= cos(lookingDir) * WEAPON_SNIPER_RECOIL;
 				game->player.velocity.y += sin(lookingDir) * WEAPON_SNIPER_RECOIL;
-				juSoundPlay(game->assets.sndSniper, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+				pnlPlaySound(game, se_Sniper);
 			}
 		} else if (game->player.weapon.weaponType == wt_AssaultRifle) {
 			if (game->player.weapon.cooldown > 0) {
-				game->player.weapon.cooldown -= juDelta();
-			} else if (game->mouseLHeld) {
+				game->player.weapon.cooldown -= dt;
+			} else if (input->mouseLHeld) {
 				physvec2 pos = {game->player.pos.x + (cos(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE),
 								game->player.pos.y - (sin(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE)};
 				game->player.weapon.cooldown = 1 / game->player.weapon.weaponBPS;
 				pnlCreateBullet(game, pos, WEAPON_BULLET_SPEED, lookingDir, false, game->player.weapon.weaponDamage,
-								game->assets.texBullet);
+								bt_Bullet);
 				game->player.velocity.x -= cos(lookingDir) * WEAPON_ASSAULTRIFLE_RECOIL;
 				game->player.velocity.y += sin(lookingDir) * WEAPON_ASSAULTRIFLE_RECOIL;
-				juSoundPlay(game->assets.sndAssaultRifle, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+				pnlPlaySound(game, se_AssaultRifle);
 			}
 		} else if (game->player.weapon.weaponType == wt_Pistol) {
-			if (game->mouseLPressed) {
+			if (input->mouseLPressed) {
 				physvec2 pos = {game->player.pos.x + (cos(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE),
 								game->player.pos.y - (sin(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE)};
 				pnlCreateBullet(game, pos, WEAPON_BULLET_SPEED, lookingDir, false, game->player.weapon.weaponDamage,
-								game->assets.texBullet);
+								bt_Bullet);
 				game->player.velocity.x -= cos(lookingDir) * WEAPON_PISTOL_RECOIL;
 				game->player.velocity.y += sin(lookingDir) * WEAPON_PISTOL_RECOIL;
-				juSoundPlay(game->assets.sndPistol, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+				pnlPlaySound(game, se_Pistol);
 			}
 		} else if (game->player.weapon.weaponType == wt_Sword) {
-			if (game->mouseLPressed) {
+			if (input->mouseLPressed) {
 				physvec2 pos = {game->player.pos.x + (cos(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE),
 								game->player.pos.y - (sin(lookingDir) * WEAPON_BULLET_SPAWN_DISTANCE)};
 				pnlCreateBullet(game, pos, WEAPON_SWORD_BULLET_SPEED, lookingDir, false,
-								game->player.weapon.weaponDamage, game->assets.texWhoosh);
+								game->player.weapon.weaponDamage, bt_Whoosh);
 				game->player.velocity.x -= cos(lookingDir) * WEAPON_SWORD_RECOIL;
 				game->player.velocity.y += sin(lookingDir) * WEAPON_SWORD_RECOIL;
-				juSoundPlay(game->assets.sndSword, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+				pnlPlaySound(game, se_Sword);
 			}
 		}
 	}
 
 	// Hit cooldown
-	game->player.hitcooldown -= juDelta();
+	game->player.hitcooldown -= dt;
 
 	// Move
 	physvec2 oldVel = game->player.velocity;
-	game->player.velocity.x += (((real)juKeyboardGetKey(SDL_SCANCODE_D)) - ((real)juKeyboardGetKey(SDL_SCANCODE_A))) * PHYS_ACCELERATION * juDelta();
-	game->player.velocity.y += (((real)juKeyboardGetKey(SDL_SCANCODE_S)) - ((real)juKeyboardGetKey(SDL_SCANCODE_W))) * PHYS_ACCELERATION * juDelta();
+	game->player.velocity.x += (((real)input->keyRight) - ((real)input->keyLeft)) * PHYS_ACCELERATION * dt;
+	game->player.velocity.y += (((real)input->keyDown) - ((real)input->keyUp)) * PHYS_ACCELERATION * dt;
 	physvec2 diff = subPhysVec2(oldVel, game->player.velocity);
 	bool movedX = diff.x != 0;
 	bool movedY = diff.y != 0;
 
 	// Apply friction
-	real rfric = PHYS_FRICTION * juDelta();
+	real rfric = PHYS_FRICTION * dt;
 	if (absr(game->player.velocity.x) - rfric < 0 && !movedX) // x
 		game->player.velocity.x = 0;
 	else if (!movedX)
@@ -910,35 +1171,51 @@ void _pnlPlayerUpdate(PNLRuntime game, bool drawPlayer) {
 	if (absr(game->player.velocity.y) > PHYS_TERMINAL_VELOCITY) game->player.velocity.y = sign(game->player.velocity.y) * PHYS_TERMINAL_VELOCITY;
 
 	// Apply velocity
-	game->player.pos = addPhysVec2(game->player.pos, game->player.velocity);
+	game->player.pos.x += game->player.velocity.x * dt;
+	game->player.pos.y += game->player.velocity.y * dt;
 	game->player.pos.x = clamp(game->player.pos.x, -MAX_MINERAL_SPAWN_DISTANCE, MAX_MINERAL_SPAWN_DISTANCE);
 	game->player.pos.y = clamp(game->player.pos.y, -MAX_MINERAL_SPAWN_DISTANCE, MAX_MINERAL_SPAWN_DISTANCE);
 
-	// Draw player
-	if (drawPlayer && !(game->player.hitcooldown > 0 && sin((game->time / VK2D_PI) * 4) > 1)) {
-		lookingDir += VK2D_PI / 2;
-		juSpriteDraw(game->player.sprite, game->player.pos.x, game->player.pos.y);
-		pnlDrawWeapon(game, game->player.weapon, game->player.pos.x, game->player.pos.y - 6, sign(lookingDir) == 1 ? -lookingDir + (VK2D_PI / 2) : -lookingDir + (VK2D_PI / 2) - VK2D_PI, sign(lookingDir), 1);
-		if (game->onSite) {
-			vk2dRendererSetColourMod(VK2D_BLACK);
-			vk2dDrawRectangle(game->player.pos.x - (PLAYER_HEALTHBAR_WIDTH / 2), game->player.pos.y - 14 - PLAYER_HEALTHBAR_HEIGHT, PLAYER_HEALTHBAR_WIDTH, PLAYER_HEALTHBAR_HEIGHT);
-			vk2dRendererSetColourMod(VK2D_RED);
-			vk2dDrawRectangle(game->player.pos.x - (PLAYER_HEALTHBAR_WIDTH / 2) + 1, game->player.pos.y - 13 - PLAYER_HEALTHBAR_HEIGHT, (game->player.hp / PLAYER_MAX_HP) * (PLAYER_HEALTHBAR_WIDTH - 2), PLAYER_HEALTHBAR_HEIGHT - 2);
-			vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-		}
-	}
 }
 
 // Player update - movement and weapons
-void pnlPlayerUpdate(PNLRuntime game, bool drawPlayer) {
+void pnlSimPlayer(PNLRuntime game, real dt, const PNLInput *input, bool canShoot) {
+	PNL_PROFILE_BEGIN("pnlSimPlayer");
 	if (game->player.hp > 0)
-		_pnlPlayerUpdate(game, drawPlayer);
+		_pnlSimPlayer(game, dt, input, canShoot);
 	else if (game->deathCooldown) {
-		if (juKeyboardGetKeyPressed(SDL_SCANCODE_SPACE) && !game->fadeOut) {
+		if (input->keyRespawn && !game->fadeOut) {
 			game->fadeOut = true;
 			game->fadeClock = FADE_IN_DURATION;
 		}
 	}
+	PNL_PROFILE_END();
+}
+
+// Where the player should be drawn this frame, somewhere between the last two ticks
+physvec2 pnlPlayerDrawPos(PNLRuntime game) {
+	physvec2 pos = {lerp(game->player.lastPos.x, game->player.pos.x, game->interpolation),
+					lerp(game->player.lastPos.y, game->player.pos.y, game->interpolation)};
+	return pos;
+}
+
+void pnlDrawPlayer(PNLRuntime game) {
+	if (game->player.hp <= 0 || game->inTerminal)
+		return;
+	physvec2 pos = pnlPlayerDrawPos(game);
+	float lookingDir = juPointAngle(pos.x, pos.y, game->input.mouseX, game->input.mouseY) - (VK2D_PI / 2);
+	if (!(game->player.hitcooldown > 0 && sin((game->time / VK2D_PI) * 4) > 1)) {
+		lookingDir += VK2D_PI / 2;
+		juSpriteDraw(game->player.sprite, pos.x, pos.y);
+		pnlDrawWeapon(game, game->player.weapon, pos.x, pos.y - 6, sign(lookingDir) == 1 ? -lookingDir + (VK2D_PI / 2) : -lookingDir + (VK2D_PI / 2) - VK2D_PI, sign(lookingDir), 1);
+		if (game->onSite) {
+			vk2dRendererSetColourMod(VK2D_BLACK);
+			vk2dDrawRectangle(pos.x - (PLAYER_HEALTHBAR_WIDTH / 2), pos.y - 14 - PLAYER_HEALTHBAR_HEIGHT, PLAYER_HEALTHBAR_WIDTH, PLAYER_HEALTHBAR_HEIGHT);
+			vk2dRendererSetColourMod(VK2D_RED);
+			vk2dDrawRectangle(pos.x - (PLAYER_HEALTHBAR_WIDTH / 2) + 1, pos.y - 13 - PLAYER_HEALTHBAR_HEIGHT, (game->player.hp / PLAYER_MAX_HP) * (PLAYER_HEALTHBAR_WIDTH - 2), PLAYER_HEALTHBAR_HEIGHT - 2);
+			vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		}
+	}
 }
 
 void pnlSetNotification(PNLRuntime game, const char *string) {
@@ -946,48 +1223,65 @@ void pnlSetNotification(PNLRuntime game, const char *string) {
 	game->notificationMessage = string;
 }
 
+// Covers everything the camera can see with one quad, relying on the sampler repeating the texture
+// past its edges (Vulkan2D creates its one texture sampler with VK_SAMPLER_ADDRESS_MODE_REPEAT on
+// every axis). The quad is a square around the camera's diagonal so it still covers the view while
+// the camera is rotated, and is scaled up by the zoom for the fade in/out - pnlPreFrame never lets
+// the zoom drop below MIN_FADE_ZOOM, so the quad always covers the view.
 void pnlDrawTiledBackground(PNLRuntime game, VK2DTexture bg) {
-	// Draw background
 	VK2DCamera cam = vk2dRendererGetCamera();
-	int tx = (cam.w / bg->img->width) + 3;
-	int ty = (cam.h / bg->img->height) + 3;
-	float ssx = roundTo(cam.x, bg->img->width) - bg->img->width;
-	float sx = ssx;
-	float sy = roundTo(cam.y, bg->img->height) - bg->img->height;
-	for (int i = 0; i < ty; i++) {
-		for (int j = 0; j < tx; j++) {
-			vk2dDrawTexture(bg, sx, sy);
-			sx += bg->img->width;
-		}
-		sy += bg->img->height;
-		sx = ssx;
-	}
+	float half = (sqrt((cam.w * cam.w) + (cam.h * cam.h)) / 2) / cam.zoom;
+	float x = floor(cam.x + (cam.w / 2) - half);
+	float y = floor(cam.y + (cam.h / 2) - half);
+
+	// Offset the texture coordinates by the world position so the tiles stay put as the camera moves
+	float u = x - (floor(x / bg->img->width) * bg->img->width);
+	float v = y - (floor(y / bg->img->height) * bg->img->height);
+	vk2dRendererDrawTexture(bg, x, y, 1, 1, 0, 0, 0, u, v, ceil(half * 2), ceil(half * 2));
 }
 
 // Loads a selected planet spec into the current planet slot
 void pnlLoadPlanet(PNLRuntime game, int index) {
+	// Storage is reused, pnlInitPlanet resizes it if needed
+	PNLEnemies enemies = game->planet.enemies;
+	PNLMinerals minerals = game->planet.minerals;
 	memset(&game->planet, 0, sizeof(struct PNLPlanet));
 	game->planet.spec = game->potentialPlanets[index];
+	game->planet.enemies = enemies;
+	game->planet.enemies.count = 0;
+	game->planet.minerals = minerals;
+	game->planet.minerals.count = 0;
+	pnlChunkGridClear(game->planet.minerals.grid);
+}
+
+// Buys a trip to one of the potential planets and starts fading out towards it
+bool pnlLaunchPlanet(PNLRuntime game, int index) {
+	if (!pnlPlayerPurchase(game, game->potentialPlanets[index].doshCost))
+		return false;
+	pnlLoadPlanet(game, index);
+	game->fadeOut = true;
+	game->fadeClock = 0;
+	return true;
 }
 
-// Creates a planet's specs based on player's current fame
-PNLPlanetSpecs pnlCreatePlanetSpec(PNLRuntime game) {
+// Creates a planet's specs based on player's current fame, the name is picked by the caller so they can be kept unique
+PNLPlanetSpecs pnlCreatePlanetSpec(PNLRuntime game, int nameIndex) {
 	PNLPlanetSpecs specs = {};
 	PlanetDifficulty difficulty;
 
 	// Find cutoff
 	if (game->player.fame >= FAME_4_STAR_CUTOFF) {
-		if (weightedChance(FAME_LOWER_STAR_CHANCE))
+		if (weightedChance(game, rs_Planets, FAME_LOWER_STAR_CHANCE))
 			difficulty = pd_Hard;
 		else
 			difficulty = pd_SeventhCircle;
 	} else if (game->player.fame >= FAME_3_STAR_CUTOFF) {
-		if (weightedChance(FAME_LOWER_STAR_CHANCE))
+		if (weightedChance(game, rs_Planets, FAME_LOWER_STAR_CHANCE))
 			difficulty = pd_Medium;
 		else
 			difficulty = pd_Hard;
 	} else if (game->player.fame >= FAME_2_STAR_CUTOFF) {
-		if (weightedChance(FAME_LOWER_STAR_CHANCE))
+		if (weightedChance(game, rs_Planets, FAME_LOWER_STAR_CHANCE))
 			difficulty = pd_Easy;
 		else
 			difficulty = pd_Medium;
@@ -1000,95 +1294,211 @@ PNLPlanetSpecs pnlCreatePlanetSpec(PNLRuntime game) {
 	real fameMult = pow(FAME_MULTIPLIER, (real)difficulty);
 
 	// Contruct planet specs
-	specs.doshCost = (DOSH_PLANET_COST * doshMult) + (DOSH_PLANET_COST_VARIANCE * doshMult * randr());
-	specs.fameBonus = (FAME_PER_PLANET * fameMult) + (FAME_VARIANCE * fameMult * randr());
+	specs.doshCost = (DOSH_PLANET_COST * doshMult) + (DOSH_PLANET_COST_VARIANCE * doshMult * randr(game, rs_Planets));
+	specs.fameBonus = (FAME_PER_PLANET * fameMult) + (FAME_VARIANCE * fameMult * randr(game, rs_Planets));
 	specs.planetDifficulty = difficulty;
-	specs.planetTexIndex = (int)floor(randr() * (real)PLANET_TEXTURE_COUNT);
+	specs.planetTexIndex = randi(game, rs_Planets, PLANET_TEXTURE_COUNT);
+	specs.planetNameIndex = nameIndex;
+
+	return specs;
+}
+
+// Runs a terminal's buttons and drawing with its background's top-left at left/top
+TerminalCode pnlRunTerminal(PNLRuntime game, HomeBlocks type, float left, float top) {
+	if (type == hb_Memorial)
+		return pnlUpdateMemorialTerminal(game, left, top);
+	else if (type == hb_MissionSelect)
+		return pnlUpdateMissionSelectTerminal(game, left, top);
+	else if (type == hb_Help)
+		return pnlUpdateHelpTerminal(game, left, top);
+	else if (type == hb_Stocks)
+		return pnlUpdateStocksTerminal(game, left, top);
+	else if (type == hb_Weapons)
+		return pnlUpdateWeaponsTerminal(game, left, top);
+	return tc_Noop;
+}
 
-	// Make unique name
-	int chosenName;
-	bool nameTaken = true;
-	while (nameTaken) {
-		chosenName = (int)floor(randr() * (real)PLANET_NAMES_COUNT);
-		nameTaken = false;
-		for (int i = 0; i < GENERATED_PLANET_COUNT; i++)
-			if (chosenName == game->potentialPlanets[i].planetNameIndex)
-				nameTaken = true;
+// Hash of everything a terminal shows, if this hasn't changed neither has the terminal
+unsigned long pnlTerminalStateHash(PNLRuntime game, HomeBlocks type) {
+	unsigned long hash = pnlHash(PNL_HASH_START, &type, sizeof(HomeBlocks));
+	if (type == hb_Memorial) {
+		if (pnlSaveStoreKeyExists(game->save, SAVE_HIGHSCORE)) {
+			real scores[] = {pnlSaveStoreGetDouble(game->save, SAVE_HIGHSCORE), pnlSaveStoreGetDouble(game->save, SAVE_DOSH), pnlSaveStoreGetDouble(game->save, SAVE_KILLS)};
+			const char *planet = pnlSaveStoreGetString(game->save, SAVE_DEATH_PLANET);
+			const char *difficulty = pnlSaveStoreGetString(game->save, SAVE_DIFFICULTY);
+			hash = pnlHash(hash, scores, sizeof(scores));
+			hash = pnlHash(hash, planet, strlen(planet));
+			hash = pnlHash(hash, difficulty, strlen(difficulty));
+		}
+	} else if (type == hb_MissionSelect) {
+		hash = pnlHash(hash, game->potentialPlanets, sizeof(game->potentialPlanets));
+	} else if (type == hb_Help) {
+		int page = game->tutorialPage % 2;
+		hash = pnlHash(hash, &page, sizeof(int));
+	} else if (type == hb_Stocks) {
+		hash = pnlHash(hash, &game->market, sizeof(PNLStockMarket));
+	} else if (type == hb_Weapons) {
+		hash = pnlHash(hash, game->shop, sizeof(game->shop));
 	}
-	specs.planetNameIndex = chosenName;
+	return hash;
+}
 
-	return specs;
+// Where a terminal's background goes, centred in a view with its top left at viewX/viewY
+void pnlTerminalOrigin(PNLRuntime game, float viewX, float viewY, float *left, float *top) {
+	float w = game->assets.bgTerminal->img->width;
+	float h = game->assets.bgTerminal->img->height;
+	*left = viewX + (GAME_WIDTH / 2) - (w / 2);
+	*top = viewY + (GAME_HEIGHT / 2) - (h / 2);
+}
+
+// Presses a terminal's buttons with a tick's input without drawing anything, the terminal is laid
+// out around the view the input was read through so this never asks the renderer where it is
+void pnlSimTerminal(PNLRuntime game, HomeBlocks type, const PNLInput *input) {
+	float left, top;
+	pnlTerminalOrigin(game, input->viewX, input->viewY, &left, &top);
+	game->uiHidden = true;
+	game->uiInput = input;
+	pnlRunTerminal(game, type, left, top);
+	game->uiHidden = false;
+	game->uiInput = NULL;
+}
+
+// Terminals are drawn into a texture that is only redrawn when what they show or which button
+// the mouse is over changes, otherwise drawing one is a single blit - clicks were handled by
+// pnlSimTerminal, the draw pass is inert
+TerminalCode pnlDrawTerminal(PNLRuntime game, HomeBlocks type) {
+	PNL_PROFILE_BEGIN("pnlDrawTerminal");
+	VK2DCamera cam = vk2dRendererGetCamera();
+	float w = game->assets.bgTerminal->img->width;
+	float h = game->assets.bgTerminal->img->height;
+	float left, top;
+	pnlTerminalOrigin(game, cam.x, cam.y, &left, &top);
+
+	// Run the buttons without drawing anything to find out what's hovered
+	game->uiHidden = true;
+	game->uiHover = PNL_HASH_START;
+	TerminalCode code = pnlRunTerminal(game, type, left, top);
+	game->uiHidden = false;
+	unsigned long hash = pnlHash(pnlTerminalStateHash(game, type), &game->uiHover, sizeof(unsigned long));
+
+	PNLTerminalCache *cache = &game->terminalCache[type];
+	if (cache->texture == NULL)
+		cache->texture = vk2dTextureCreate(vk2dRendererGetDevice(), w, h);
+	if (cache->texture != NULL && (!cache->valid || cache->hash != hash)) {
+		// Redraw at the texture's origin with the mouse moved to match, clicks were already handled
+		VK2DCamera local = cam;
+		local.x = 0;
+		local.y = 0;
+		local.w = w;
+		local.h = h;
+		local.zoom = 1;
+		local.rot = 0;
+		vec4 transparent = {0, 0, 0, 0};
+		vk2dRendererSetTarget(cache->texture);
+		vk2dRendererSetCamera(local);
+		vk2dRendererSetViewport(0, 0, w, h);
+		vk2dRendererSetColourMod(transparent);
+		vk2dRendererClear();
+		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		game->uiMouseOffsetX = -left;
+		game->uiMouseOffsetY = -top;
+		pnlRunTerminal(game, type, 0, 0);
+		game->uiMouseOffsetX = 0;
+		game->uiMouseOffsetY = 0;
+		vk2dRendererSetTarget(game->backbuffer);
+		vk2dRendererSetCamera(cam);
+		vk2dRendererSetViewport(0, 0, GAME_WIDTH, GAME_HEIGHT);
+
+		cache->hash = hash;
+		cache->valid = true;
+		game->terminalRedraws++;
+	}
+	if (cache->texture != NULL)
+		vk2dDrawTexture(cache->texture, left, top);
+	else
+		pnlRunTerminal(game, type, left, top); // No texture, draw it directly
+	game->terminalFrames++;
+	PNL_PROFILE_END();
+	return code;
 }
 
-TerminalCode pnlUpdateBlock(PNLRuntime game, int index) { // returns true if the player should be rendered
+TerminalCode pnlDrawBlock(PNLRuntime game, int index) { // returns true if the player should be rendered
 	PNLHomeBlock *block = &game->home.blocks[index];
 	TerminalCode code = tc_Noop;
-	game->weaponLastFrame = game->weaponThisFrame;
 
 	if (block->type == hb_Memorial) {
 		if (juPointDistance(game->player.pos.x, game->player.pos.y, block->x, block->y) > IN_RANGE_TERMINAL_DISTANCE) {
-			vk2dDrawTexture(game->assets.texMemorialTerminal, block->x - (game->assets.texMemorialTerminal->img->width / 2), block->y - (game->assets.texMemorialTerminal->img->height / 2));
+			pnlDrawImage(game->assets.texMemorialTerminal, block->x - (game->assets.texMemorialTerminal.w / 2), block->y - (game->assets.texMemorialTerminal.h / 2), 1, 1, 0, 0, 0);
 		} else if (!game->fadeIn && !game->fadeOut) { // only do terminal things when not fading
-			code = pnlUpdateMemorialTerminal(game);
+			code = pnlDrawTerminal(game, hb_Memorial);
 		}
 	} else if (block->type == hb_MissionSelect) {
 		if (juPointDistance(game->player.pos.x, game->player.pos.y, block->x, block->y) > IN_RANGE_TERMINAL_DISTANCE) {
-			vk2dDrawTexture(game->assets.texMissionTerminal, block->x - (game->assets.texMissionTerminal->img->width / 2), block->y - (game->assets.texMissionTerminal->img->height / 2));
+			pnlDrawImage(game->assets.texMissionTerminal, block->x - (game->assets.texMissionTerminal.w / 2), block->y - (game->assets.texMissionTerminal.h / 2), 1, 1, 0, 0, 0);
 		} else if (!game->fadeIn && !game->fadeOut) { // only do terminal things when not fading
-			code = pnlUpdateMissionSelectTerminal(game);
+			code = pnlDrawTerminal(game, hb_MissionSelect);
 		}
 	} else if (block->type == hb_Help) {
 		if (juPointDistance(game->player.pos.x, game->player.pos.y, block->x, block->y) > IN_RANGE_TERMINAL_DISTANCE) {
-			vk2dDrawTexture(game->assets.texHelpTerminal, block->x - (game->assets.texHelpTerminal->img->width / 2), block->y - (game->assets.texHelpTerminal->img->height / 2));
+			pnlDrawImage(game->assets.texHelpTerminal, block->x - (game->assets.texHelpTerminal.w / 2), block->y - (game->assets.texHelpTerminal.h / 2), 1, 1, 0, 0, 0);
 		} else if (!game->fadeIn && !game->fadeOut) { // only do terminal things when not fading
-			code = pnlUpdateHelpTerminal(game);
+			code = pnlDrawTerminal(game, hb_Help);
 		}
 	} else if (block->type == hb_Stocks) {
 		if (juPointDistance(game->player.pos.x, game->player.pos.y, block->x, block->y) > IN_RANGE_TERMINAL_DISTANCE) {
-			vk2dDrawTexture(game->assets.texStockTerminal, block->x - (game->assets.texStockTerminal->img->width / 2), block->y - (game->assets.texStockTerminal->img->height / 2));
+			pnlDrawImage(game->assets.texStockTerminal, block->x - (game->assets.texStockTerminal.w / 2), block->y - (game->assets.texStockTerminal.h / 2), 1, 1, 0, 0, 0);
 		} else if (!game->fadeIn && !game->fadeOut) { // only do terminal things when not fading
-			code = pnlUpdateStocksTerminal(game);
+			code = pnlDrawTerminal(game, hb_Stocks);
 		}
 	} else if (block->type == hb_Weapons) {
 		if (juPointDistance(game->player.pos.x, game->player.pos.y, block->x, block->y) > IN_RANGE_TERMINAL_DISTANCE) {
-			vk2dDrawTexture(game->assets.texWeaponTerminal, block->x - (game->assets.texWeaponTerminal->img->width / 2), block->y - (game->assets.texWeaponTerminal->img->height / 2));
-			game->weaponThisFrame = false;
+			pnlDrawImage(game->assets.texWeaponTerminal, block->x - (game->assets.texWeaponTerminal.w / 2), block->y - (game->assets.texWeaponTerminal.h / 2), 1, 1, 0, 0, 0);
 		} else if (!game->fadeIn && !game->fadeOut) { // only do terminal things when not fading
-			code = pnlUpdateWeaponsTerminal(game);
+			code = pnlDrawTerminal(game, hb_Weapons);
 		}
-	} else {
-		game->weaponThisFrame = false;
 	}
 
-	if (!game->weaponLastFrame && game->weaponThisFrame)
-		juSoundPlay(game->assets.sndShop[(int)floor(randr() * MAX_SHOP_LINES)], false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
-
 	return code;
 }
 
 // Generates a random weapon, specify wt_Any for a random weapon or wt_whatever for a specific type of weapon
-PNLWeapon pnlGenerateWeapon(PNLRuntime game, WeaponType weaponType) {
+real pnlWeaponDamageMultiplier(WeaponType weaponType) {
+	if (weaponType == wt_Pistol)
+		return WEAPON_PISTOL_DAMAGE_MULTIPLIER;
+	else if (weaponType == wt_Sniper)
+		return WEAPON_SNIPER_DAMAGE_MULTIPLIER;
+	else if (weaponType == wt_Shotgun)
+		return WEAPON_SHOTGUN_DAMAGE_MULTIPLIER;
+	else if (weaponType == wt_Sword)
+		return WEAPON_SWORD_DAMAGE_MULTIPLIER;
+	else if (weaponType == wt_AssaultRifle)
+		return WEAPON_ASSAULTRIFLE_DAMAGE_MULTIPLIER;
+	return 1;
+}
+
+// Rolls a weapon from any generator, so weapons can be made without a runtime (the bulk generator does this) - a
+// damagePercent of 0-1 is used instead of rolling one, anything negative rolls it as normal
+PNLWeapon pnlRollWeaponDamage(PNLRandom *rng, WeaponType weaponType, real damagePercent) {
 	PNLWeapon wep = {};
 
 	// Choose random type
-	if (weaponType == wt_Any) {
-		WeaponType types[] = {wt_AssaultRifle, wt_Shotgun, wt_Sniper, wt_Sword};
-		weaponType = types[(int)floor(randr() * 4)];
-	}
+	if (weaponType == wt_Any)
+		weaponType = RANDOM_WEAPON_TYPES[pnlRandomInt(rng, RANDOM_WEAPON_TYPE_COUNT)];
 
 	// Universal attributes
-	wep.weaponColourMod[0] = (float)randr();
-	wep.weaponColourMod[1] = (float)randr();
-	wep.weaponColourMod[2] = (float)randr();
+	wep.weaponColourMod[0] = (float)pnlRandomReal(rng);
+	wep.weaponColourMod[1] = (float)pnlRandomReal(rng);
+	wep.weaponColourMod[2] = (float)pnlRandomReal(rng);
 	wep.weaponColourMod[3] = 1;
-	wep.weaponNameFirstIndex = (int)floor(randr() * WEAPON_NAME_FIRST_COUNT);
-	wep.weaponNameSecondIndex = (int)floor(randr() * WEAPON_NAME_SECOND_COUNT);
+	wep.weaponNameFirstIndex = pnlRandomInt(rng, WEAPON_NAME_FIRST_COUNT);
+	wep.weaponNameSecondIndex = pnlRandomInt(rng, WEAPON_NAME_SECOND_COUNT);
 	wep.weaponType = weaponType;
-	real bpsPercent = randr();
+	real bpsPercent = pnlRandomReal(rng);
 	wep.weaponBPS = WEAPON_MIN_BPS + ((WEAPON_MAX_BPS - WEAPON_MIN_BPS) * bpsPercent);
-	real damagePercent = randr();
+	if (damagePercent < 0)
+		damagePercent = pnlRandomReal(rng);
 	wep.weaponDamage = WEAPON_MIN_DAMAGE + ((WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE) * damagePercent);
-	real pelletsPercent = randr();
+	real pelletsPercent = pnlRandomReal(rng);
 	wep.weaponPellets = WEAPON_MIN_SPREAD + round((WEAPON_MAX_SPREAD - WEAPON_MIN_SPREAD) * pelletsPercent);
 
 	// Weapon cost is universal even though certain aspects of a weapon are specific to certain weapon types
@@ -1096,23 +1506,78 @@ PNLWeapon pnlGenerateWeapon(PNLRuntime game, WeaponType weaponType) {
 	wep.weaponCost = WEAPON_BASE_COST * multiplier;
 
 	// Stuff specific to weapons
-	if (weaponType == wt_Pistol) {
-		wep.weaponDamage *= WEAPON_PISTOL_DAMAGE_MULTIPLIER;
-	} else if (weaponType == wt_Sniper) {
-		wep.weaponDamage *= WEAPON_SNIPER_DAMAGE_MULTIPLIER;
-	} else if (weaponType == wt_Shotgun) {
-		wep.weaponDamage *= WEAPON_SHOTGUN_DAMAGE_MULTIPLIER;
-	} else if (weaponType == wt_Sword) {
-		wep.weaponDamage *= WEAPON_SWORD_DAMAGE_MULTIPLIER;
-	} else if (weaponType == wt_AssaultRifle) {
-		wep.weaponDamage *= WEAPON_ASSAULTRIFLE_DAMAGE_MULTIPLIER;
-	}
+	wep.weaponDamage *= pnlWeaponDamageMultiplier(weaponType);
 
 	return wep;
 }
 
+PNLWeapon pnlRollWeapon(PNLRandom *rng, WeaponType weaponType) {
+	return pnlRollWeaponDamage(rng, weaponType, -1);
+}
+
+PNLWeapon pnlGenerateWeapon(PNLRuntime game, WeaponType weaponType) {
+	return pnlRollWeapon(&game->random[rs_Weapons], weaponType);
+}
+
+// Decodes one of the ways to pick types for every shop slot into the types and how much each slot's damage roll
+// counts towards the shop's damage, returns how much the rolls need to add up to for MINIMUM_WEAPON_DAMAGE_PERCENT
+real pnlShopCombination(int combination, WeaponType *types, real *scales) {
+	real minimum = MINIMUM_WEAPON_DAMAGE_PERCENT;
+	for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++) {
+		types[i] = RANDOM_WEAPON_TYPES[combination % RANDOM_WEAPON_TYPE_COUNT];
+		combination /= RANDOM_WEAPON_TYPE_COUNT;
+
+		// A weapon counts for ((min + ((max - min) * roll)) * multiplier - min) / max
+		real multiplier = pnlWeaponDamageMultiplier(types[i]);
+		minimum -= ((WEAPON_MIN_DAMAGE * multiplier) - WEAPON_MIN_DAMAGE) / WEAPON_MAX_DAMAGE;
+		scales[i] = ((WEAPON_MAX_DAMAGE - WEAPON_MIN_DAMAGE) * multiplier) / WEAPON_MAX_DAMAGE;
+	}
+	return minimum;
+}
+
+// Stocks the shop with MAX_WEAPONS_AT_RINKYS weapons that have at least MINIMUM_WEAPON_DAMAGE_PERCENT damage between them
+//
+// Comes out the same as re-rolling the whole shop until it has enough damage but there is at most one re-roll, and
+// it can't miss. The types are picked weighted by how likely each combination is to make the cut and then the damage
+// rolls are drawn knowing they have to, the rest of a weapon has nothing to do with its damage so it's rolled as normal.
+void pnlStockShop(PNLRandom *rng, PNLWeapon *shop) {
+	WeaponType types[MAX_WEAPONS_AT_RINKYS];
+	real scales[MAX_WEAPONS_AT_RINKYS];
+	real damage[MAX_WEAPONS_AT_RINKYS];
+
+	// A plain roll usually has enough damage already and keeping it doesn't change the odds of anything
+	int chosen = pnlRandomInt(rng, SHOP_TYPE_COMBINATIONS);
+	real minimum = pnlShopCombination(chosen, types, scales);
+	real rolled = 0;
+	for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++) {
+		damage[i] = pnlRandomReal(rng);
+		rolled += scales[i] * damage[i];
+	}
+
+	if (rolled < minimum) {
+		// Every combination of types is equally likely before the damage is checked
+		real odds[SHOP_TYPE_COMBINATIONS];
+		real total = 0;
+		for (int c = 0; c < SHOP_TYPE_COMBINATIONS; c++) {
+			minimum = pnlShopCombination(c, types, scales);
+			odds[c] = 1 - pnlUniformSumCdf(scales, MAX_WEAPONS_AT_RINKYS, minimum);
+			total += odds[c];
+		}
+		if (total > 0) { // If no combination can ever make it the one already rolled will do
+			real target = pnlRandomReal(rng) * total;
+			for (chosen = 0; chosen < SHOP_TYPE_COMBINATIONS - 1 && target >= odds[chosen]; chosen++)
+				target -= odds[chosen];
+		}
+		minimum = pnlShopCombination(chosen, types, scales);
+		pnlRandomConstrainedUniforms(rng, scales, MAX_WEAPONS_AT_RINKYS, minimum, damage);
+	}
+
+	for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++)
+		shop[i] = pnlRollWeaponDamage(rng, types[i], damage[i]);
+}
+
 void pnlDrawWeapon(PNLRuntime game, PNLWeapon wep, float x, float y, float r, float xscale, float yscale) {
-	VK2DTexture tex;
+	PNLImage tex;
 	if (wep.weaponType == wt_Pistol)
 		tex = game->assets.texPistol;
 	else if (wep.weaponType == wt_AssaultRifle)
@@ -1124,51 +1589,111 @@ void pnlDrawWeapon(PNLRuntime game, PNLWeapon wep, float x, float y, float r, fl
 	else
 		tex = game->assets.texSniper;
 	vk2dRendererSetColourMod(wep.weaponColourMod);
-	vk2dRendererDrawTexture(tex, x, y, xscale, yscale, r, 0, tex->img->height / 2, 0, 0, tex->img->width, tex->img->height);
+	pnlDrawImage(tex, x, y, xscale, yscale, r, 0, tex.h / 2);
 	vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
 }
 
-void pnlCreateBullet(PNLRuntime game, physvec2 pos, real speed, real direction, bool pierce, real damage, VK2DTexture tex) {
-	PNLBullet *bullet = &game->bullets[game->bulletIndex++ % MAX_BULLETS];
-	bullet->active = true;
-	bullet->pos = pos;
-	bullet->tex = tex;
-	bullet->canPierce = pierce;
-	bullet->damage = damage;
-	bullet->direction = direction;
-	bullet->lifetime = 0;
-	bullet->velocity = speed;
-}
-
-void pnlUpdateBullets(PNLRuntime game) {
-	for (int i = 0; i < MAX_BULLETS; i++) {
-		if (game->bullets[i].active) {
-			PNLBullet *b = &game->bullets[i];
-			b->pos.x += cos(b->direction) * b->velocity * juDelta();
-			b->pos.y -= sin(b->direction) * b->velocity * juDelta();
-			b->velocity -= WEAPON_BULLET_DECELERATION * juDelta();
-			vec4 c = {1, 1, 1, 1 - (b->lifetime / WEAPON_BULLET_LIFETIME)};
-			vk2dRendererSetColourMod(c);
-			vk2dRendererDrawTexture(b->tex, b->pos.x - b->tex->img->width / 2, b->pos.y - b->tex->img->height / 2, 1, 1, (VK2D_PI / 2) - b->direction + (VK2D_PI / 2), b->tex->img->width / 2, b->tex->img->height / 2, 0, 0, b->tex->img->width, b->tex->img->height);
-			vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+// Adds a chunk of bullet slots to keep up with the pool
+bool pnlGrowBullets(PNLRuntime game) {
+	PNLBullets *bullets = &game->bullets;
+	PNLBulletChunk **chunks = realloc(bullets->chunks, sizeof(PNLBulletChunk*) * (bullets->chunkCount + 1));
+	if (chunks == NULL)
+		return false;
+	bullets->chunks = chunks;
+	PNLBulletChunk *chunk = calloc(1, sizeof(struct PNLBulletChunk));
+	if (chunk == NULL)
+		return false;
+	bullets->chunks[bullets->chunkCount++] = chunk;
+	return true;
+}
 
-			b->lifetime += juDelta();
-			if (b->lifetime >= WEAPON_BULLET_LIFETIME) {
-				b->active = false;
-			}
+void pnlCreateBullet(PNLRuntime game, physvec2 pos, real speed, real direction, bool pierce, real damage, BulletType type) {
+	PNLBullets *bullets = &game->bullets;
+	int id = pnlPoolAcquire(bullets->pool);
+	if (id == -1)
+		return;
+	if (pnlPoolChunkCount(bullets->pool) > bullets->chunkCount && !pnlGrowBullets(game)) {
+		pnlPoolRelease(bullets->pool, id);
+		return;
+	}
 
-			for (int j = 0; j < MAX_ENEMIES; j++) {
-				if (game->planet.enemies[j].active && juPointDistance(game->planet.enemies[j].x, game->planet.enemies[j].y, game->bullets[i].pos.x, game->bullets[i].pos.y) <= ENEMY_HIT_DISTANCE) {
-					game->planet.enemies[j].hp -= game->bullets[i].damage;
-					if (game->bullets[i].canPierce) {
-						game->bullets[i].damage *= 1 - WEAPON_DROPOFF;
-					} else {
-						game->bullets[i].active = false;
-					}
-				}
-			}
+	PNLBulletChunk *chunk = bullets->chunks[id / BULLET_CHUNK_SIZE];
+	int i = id % BULLET_CHUNK_SIZE;
+	chunk->x[i] = pos.x;
+	chunk->y[i] = pos.y;
+	chunk->lastX[i] = pos.x;
+	chunk->lastY[i] = pos.y;
+	chunk->dirX[i] = cos(direction);
+	chunk->dirY[i] = -sin(direction);
+	chunk->direction[i] = direction;
+	chunk->type[i] = type;
+	chunk->canPierce[i] = pierce;
+	chunk->damage[i] = damage;
+	chunk->lifetime[i] = 0;
+	chunk->velocity[i] = speed;
+}
+
+void pnlSimBullets(PNLRuntime game, real dt) {
+	PNL_PROFILE_BEGIN("pnlSimBullets");
+	// Whole chunks are integrated, moving the dead slots along too is cheaper than skipping them
+	PNLBullets *bullets = &game->bullets;
+	for (int c = 0; c < bullets->chunkCount; c++) {
+		PNLBulletChunk *chunk = bullets->chunks[c];
+		game->kernels->integrateBullets(chunk->x, chunk->y, chunk->dirX, chunk->dirY, chunk->velocity, chunk->lifetime, BULLET_CHUNK_SIZE, dt, WEAPON_BULLET_DECELERATION);
+	}
+
+	// Bin enemies so bullets only have to look at the ones around them
+	pnlSpatialHashClear(game->enemyGrid);
+	for (int j = 0; j < game->planet.enemies.count; j++)
+		pnlSpatialHashInsert(game->enemyGrid, j, game->planet.enemies.x[j], game->planet.enemies.y[j]);
+	pnlSpatialHashBuild(game->enemyGrid);
+
+	// Releasing a bullet moves the last live one into its spot, so only advance if it survived
+	for (int l = 0; l < bullets->pool->liveCount;) {
+		int id = bullets->pool->live[l];
+		PNLBulletChunk *chunk = bullets->chunks[id / BULLET_CHUNK_SIZE];
+		int i = id % BULLET_CHUNK_SIZE;
+		bool dead = chunk->lifetime[i] >= WEAPON_BULLET_LIFETIME;
+		const int *hits;
+		int hitCount = pnlSpatialHashQuery(game->enemyGrid, chunk->x[i], chunk->y[i], ENEMY_HIT_DISTANCE, &hits);
+		for (int j = 0; j < hitCount; j++) {
+			game->planet.enemies.hp[hits[j]] -= chunk->damage[i];
+			if (chunk->canPierce[i])
+				chunk->damage[i] *= 1 - WEAPON_DROPOFF;
+			else
+				dead = true;
 		}
+
+		if (dead)
+			pnlPoolRelease(bullets->pool, id);
+		else
+			l++;
+	}
+	PNL_PROFILE_END();
+}
+
+void pnlDrawBullets(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlDrawBullets");
+	PNLBullets *bullets = &game->bullets;
+	for (int l = 0; l < bullets->pool->liveCount; l++) {
+		int id = bullets->pool->live[l];
+		PNLBulletChunk *chunk = bullets->chunks[id / BULLET_CHUNK_SIZE];
+		int i = id % BULLET_CHUNK_SIZE;
+		PNLImage tex = chunk->type[i] == bt_Whoosh ? game->assets.texWhoosh : game->assets.texBullet;
+		float x = lerp(chunk->lastX[i], chunk->x[i], game->interpolation);
+		float y = lerp(chunk->lastY[i], chunk->y[i], game->interpolation);
+		vec4 c = {1, 1, 1, 1 - (chunk->lifetime[i] / WEAPON_BULLET_LIFETIME)};
+		pnlSpriteBatchTexture(game->batch, tex.tex, x - tex.w / 2, y - tex.h / 2, 1, 1, (VK2D_PI / 2) - chunk->direction[i] + (VK2D_PI / 2), tex.w / 2, tex.h / 2, tex.x, tex.y, tex.w, tex.h, c);
 	}
+	pnlSpriteBatchFlush(game->batch);
+	PNL_PROFILE_END();
+}
+
+void pnlFreeBullets(PNLRuntime game) {
+	for (int c = 0; c < game->bullets.chunkCount; c++)
+		free(game->bullets.chunks[c]);
+	free(game->bullets.chunks);
+	pnlPoolFree(game->bullets.pool);
 }
 
 void pnlDrawTitleBar(PNLRuntime game) {
@@ -1177,20 +1702,19 @@ void pnlDrawTitleBar(PNLRuntime game) {
 	vk2dDrawRectangle(cam.x, cam.y, cam.w, 20);
 	vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
 	if (game->onSite)
-		juFontDraw(game->assets.fntOverlay, cam.x, cam.y - 5, "%s | Dosh: $%.2f | Fame: %.0f | %s | [on-hand/on-ship]", PLANET_NAMES[game->planet.spec.planetNameIndex], (float)game->player.dosh, (float)game->player.fame, VERSION_STRING);
+		pnlTextDraw(game->text, game->assets.fntOverlay, cam.x, cam.y - 5, "%s | Dosh: $%.2f | Fame: %.0f | %s | [on-hand/on-ship]", PLANET_NAMES[game->planet.spec.planetNameIndex], (float)game->player.dosh, (float)game->player.fame, VERSION_STRING);
 	else
-		juFontDraw(game->assets.fntOverlay, cam.x, cam.y - 5, "Home | Dosh: $%.2f | Fame: %.0f | %s", (float)game->player.dosh, (float)game->player.fame, VERSION_STRING);
+		pnlTextDraw(game->text, game->assets.fntOverlay, cam.x, cam.y - 5, "Home | Dosh: $%.2f | Fame: %.0f | %s", (float)game->player.dosh, (float)game->player.fame, VERSION_STRING);
 
 	// Draw notification at top left (after compass)
 	if (game->notificationTime > 0) {
 		vec4 cyan = {0, 1, 1, 1};
-		game->notificationTime -= juDelta();
 		if (game->notificationTime < NOTIFICATION_TIME / 2) {
 			cyan[3] = (game->notificationTime) / (NOTIFICATION_TIME / 2);
 			cyan[3] = cyan[3] < 0 ? 0 : cyan[3];
 		}
 		vk2dRendererSetColourMod(cyan);
-		juFontDraw(game->assets.fntOverlay, cam.x + 38, cam.y + 18, "%s", game->notificationMessage);
+		pnlTextDraw(game->text, game->assets.fntOverlay, cam.x + 38, cam.y + 18, "%s", game->notificationMessage);
 		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
 	}
 }
@@ -1211,69 +1735,193 @@ void pnlDrawMineralOverlay(PNLRuntime game) {
 	vk2dDrawRectangle(x, y, cam.w, 29);
 	vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
 	for (int i = 0; i < STOCK_TRADE_COUNT; i++) {
-		vk2dDrawTextureExt(game->assets.texStocks[i], x, y, 0.5, 0.5, 0, 0, 0);
-		juFontDraw(game->assets.fntOverlay, x + 35, y, "%i/%i", game->planet.inventory.onHandInventory[i], game->planet.inventory.onShipInventory[i]);
+		pnlDrawImage(game->assets.texStocks[i], x, y, 0.5, 0.5, 0, 0, 0);
+		pnlTextDraw(game->text, game->assets.fntOverlay, x + 35, y, "%i/%i", game->planet.inventory.onHandInventory[i], game->planet.inventory.onShipInventory[i]);
 		x += 120;
 	}
 
-	vk2dDrawTexture(game->assets.texCompass, cam.x + 4, cam.y + 20 + 4);
+	pnlDrawImage(game->assets.texCompass, cam.x + 4, cam.y + 20 + 4, 1, 1, 0, 0, 0);
 	vk2dRendererSetColourMod(VK2D_RED);
 	float dir = juPointAngle(game->player.pos.x, game->player.pos.y, 0, 0) - (VK2D_PI / 2);
 	vk2dDrawLine(cam.x + 16 + 4, cam.y + 20 + 16 + 4, 4 + cam.x + 16 + (cos(dir) * 13), 4 + cam.y + 16 + 20 - (sin(dir) * 13));
 	vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
 }
 
-void pnlUpdateMinerals(PNLRuntime game) {
-	for (int i = 0; i < MAX_MINERALS; i++) {
+// Frees the mineral columns and grid
+void pnlFreeMinerals(PNLRuntime game) {
+	PNLMinerals *minerals = &game->planet.minerals;
+	free(minerals->x);
+	free(minerals->y);
+	free(minerals->lastX);
+	free(minerals->lastY);
+	free(minerals->stockIndex);
+	free(minerals->randomSeed);
+	pnlChunkGridFree(minerals->grid);
+	memset(minerals, 0, sizeof(PNLMinerals));
+}
 
-		if (game->planet.minerals[i].active) {
-			float dist = juPointDistance(game->planet.minerals[i].pos.x, game->planet.minerals[i].pos.y, game->player.pos.x, game->player.pos.y);
-			if (dist < GAME_WIDTH) {
-				vk2dDrawTextureExt(game->assets.texStocks[game->planet.minerals[i].stockIndex], game->planet.minerals[i].pos.x - 7, game->planet.minerals[i].pos.y - 15 - (sin(game->time + game->planet.minerals[i].randomSeed) * 3), 0.25, 0.25, 0, 0, 0);
+// Makes room for count minerals and empties the grid, any existing minerals are lost
+bool pnlReserveMinerals(PNLRuntime game, int count) {
+	PNLMinerals *minerals = &game->planet.minerals;
+	minerals->count = 0;
+	if (minerals->grid != NULL && minerals->capacity >= count) {
+		pnlChunkGridClear(minerals->grid);
+		return true;
+	}
 
-				if (dist <= MINERAL_MOVE_RANGE) {
-					real angle = juPointAngle(game->planet.minerals[i].pos.x, game->planet.minerals[i].pos.y, game->player.pos.x, game->player.pos.y) - (VK2D_PI / 2);
-					game->planet.minerals[i].pos.x += cos(angle) * MINERAL_MOVE_SPEED * juDelta();
-					game->planet.minerals[i].pos.y -= sin(angle) * MINERAL_MOVE_SPEED * juDelta();
-				}
+	pnlFreeMinerals(game);
+	minerals->x = malloc(sizeof(real) * count);
+	minerals->y = malloc(sizeof(real) * count);
+	minerals->lastX = malloc(sizeof(real) * count);
+	minerals->lastY = malloc(sizeof(real) * count);
+	minerals->stockIndex = malloc(sizeof(int) * count);
+	minerals->randomSeed = malloc(sizeof(real) * count);
+	minerals->grid = pnlChunkGridCreate(-MAX_MINERAL_SPAWN_DISTANCE, -MAX_MINERAL_SPAWN_DISTANCE, MAX_MINERAL_SPAWN_DISTANCE, MAX_MINERAL_SPAWN_DISTANCE, MINERAL_CHUNK_SIZE);
+	if (minerals->x == NULL || minerals->y == NULL || minerals->lastX == NULL || minerals->lastY == NULL ||
+		minerals->stockIndex == NULL || minerals->randomSeed == NULL || minerals->grid == NULL) {
+		pnlFreeMinerals(game);
+		return false;
+	}
+	minerals->capacity = count;
+	return true;
+}
 
-				if (dist <= MINERAL_PICKUP_RANGE && game->planet.inventory.onHandInventory[game->planet.minerals[i].stockIndex] < MAX_ON_HAND_INVENTORY) {
-					game->planet.minerals[i].active = false;
-					game->planet.inventory.onHandInventory[game->planet.minerals[i].stockIndex] += MIN_MINERAL_PICKUP + round((real)(MAX_MINERAL_PICKUP - MIN_MINERAL_PICKUP) * randr());
-					game->planet.inventory.onHandInventory[game->planet.minerals[i].stockIndex] = clamp(game->planet.inventory.onHandInventory[game->planet.minerals[i].stockIndex], 0, 20);
+void pnlSimMinerals(PNLRuntime game, real dt) {
+	PNL_PROFILE_BEGIN("pnlSimMinerals");
+	PNLMinerals *minerals = &game->planet.minerals;
+	int *onHand = game->planet.inventory.onHandInventory;
+	const int *nearby;
+	int nearbyCount = pnlChunkGridQuery(minerals->grid, game->player.pos.x, game->player.pos.y, GAME_WIDTH, &nearby);
+	for (int n = 0; n < nearbyCount; n++) {
+		int i = nearby[n];
+		float dist = juPointDistance(minerals->x[i], minerals->y[i], game->player.pos.x, game->player.pos.y);
+		if (dist < GAME_WIDTH) {
+			minerals->lastX[i] = minerals->x[i];
+			minerals->lastY[i] = minerals->y[i];
+			if (dist <= MINERAL_MOVE_RANGE) {
+				real angle = juPointAngle(minerals->x[i], minerals->y[i], game->player.pos.x, game->player.pos.y) - (VK2D_PI / 2);
+				minerals->x[i] += cos(angle) * MINERAL_MOVE_SPEED * dt;
+				minerals->y[i] -= sin(angle) * MINERAL_MOVE_SPEED * dt;
+				pnlChunkGridMove(minerals->grid, i, minerals->lastX[i], minerals->lastY[i], minerals->x[i], minerals->y[i]);
+			}
 
-					pnlSetNotification(game, "Grabbed minerals");
-				}
+			int stock = minerals->stockIndex[i];
+			if (dist <= MINERAL_PICKUP_RANGE && onHand[stock] < MAX_ON_HAND_INVENTORY) {
+				pnlChunkGridRemove(minerals->grid, i, minerals->x[i], minerals->y[i]);
+				onHand[stock] += MIN_MINERAL_PICKUP + round((real)(MAX_MINERAL_PICKUP - MIN_MINERAL_PICKUP) * randr(game, rs_Minerals));
+				onHand[stock] = clamp(onHand[stock], 0, 20);
+
+				pnlSetNotification(game, "Grabbed minerals");
 			}
 		}
 	}
+	PNL_PROFILE_END();
+}
+
+void pnlDrawMinerals(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlDrawMinerals");
+	PNLMinerals *minerals = &game->planet.minerals;
+	const int *nearby;
+	int nearbyCount = pnlChunkGridQuery(minerals->grid, game->player.pos.x, game->player.pos.y, GAME_WIDTH, &nearby);
+	for (int n = 0; n < nearbyCount; n++) {
+		int i = nearby[n];
+		if (juPointDistance(minerals->x[i], minerals->y[i], game->player.pos.x, game->player.pos.y) < GAME_WIDTH) {
+			float x = lerp(minerals->lastX[i], minerals->x[i], game->interpolation);
+			float y = lerp(minerals->lastY[i], minerals->y[i], game->interpolation);
+			PNLImage tex = game->assets.texStocks[minerals->stockIndex[i]];
+			pnlSpriteBatchTexture(game->batch, tex.tex, x - 7, y - 15 - (sin(game->time + minerals->randomSeed[i]) * 3), 0.25, 0.25, 0, 0, 0, tex.x, tex.y, tex.w, tex.h, VK2D_DEFAULT_COLOUR_MOD);
+		}
+	}
+	pnlSpriteBatchFlush(game->batch);
+	PNL_PROFILE_END();
 }
 
 void pnlCreateEnemy(PNLRuntime game) {
-	PNLEnemy *enemy = NULL;
-	for (int i = 0; i < MAX_ENEMIES; i++)
-		if (!game->planet.enemies[i].active)
-			enemy = &game->planet.enemies[i];
-
-	if (enemy != NULL) { // Creates an enemy with random attributes (check constants at top for ranges)
-		enemy->active = true;
-		enemy->colour[0] = randr();
-		enemy->colour[1] = randr();
-		enemy->colour[2] = randr();
-		enemy->colour[3] = 1;
-		enemy->dosh = (pow(ENEMY_DOSH_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_DOSH) + (((pow(ENEMY_DOSH_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MAX_DOSH) - (pow(ENEMY_DOSH_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_DOSH)) * randr());
-		enemy->fame = (pow(ENEMY_FAME_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_FAME) + (((pow(ENEMY_FAME_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MAX_FAME) - (pow(ENEMY_FAME_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_FAME)) * randr());
-		enemy->hp = (pow(ENEMY_HP_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_HP) + ((pow(ENEMY_HP_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_HP) * sign(randr() - 0.5) * ENEMY_HP_VARIANCE);
-		float angle = randr() * VK2D_PI * 2;
-		float distance = MIN_ENEMY_SPAWN_DISTANCE + ((MAX_ENEMY_SPAWN_DISTANCE - MIN_ENEMY_SPAWN_DISTANCE) * randr());
-		enemy->x = cos(angle) * distance;
-		enemy->y = -sin(angle) * distance;
-	}
-}
-
-void pnlUpdateEnemies(PNLRuntime game) {
+	PNLEnemies *enemies = &game->planet.enemies;
+	if (enemies->count < enemies->capacity) { // Creates an enemy with random attributes (check constants at top for ranges)
+		int i = enemies->count++;
+		enemies->colour[i][0] = randr(game, rs_Enemies);
+		enemies->colour[i][1] = randr(game, rs_Enemies);
+		enemies->colour[i][2] = randr(game, rs_Enemies);
+		enemies->colour[i][3] = 1;
+		enemies->dosh[i] = (pow(ENEMY_DOSH_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_DOSH) + (((pow(ENEMY_DOSH_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MAX_DOSH) - (pow(ENEMY_DOSH_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_DOSH)) * randr(game, rs_Enemies));
+		enemies->fame[i] = (pow(ENEMY_FAME_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_FAME) + (((pow(ENEMY_FAME_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MAX_FAME) - (pow(ENEMY_FAME_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_MIN_FAME)) * randr(game, rs_Enemies));
+		enemies->hp[i] = (pow(ENEMY_HP_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_HP) + ((pow(ENEMY_HP_MULTIPLIER, game->planet.spec.planetDifficulty) * ENEMY_HP) * sign(randr(game, rs_Enemies) - 0.5) * ENEMY_HP_VARIANCE);
+		float angle = randr(game, rs_Enemies) * VK2D_PI * 2;
+		float distance = MIN_ENEMY_SPAWN_DISTANCE + ((MAX_ENEMY_SPAWN_DISTANCE - MIN_ENEMY_SPAWN_DISTANCE) * randr(game, rs_Enemies));
+		enemies->x[i] = cos(angle) * distance;
+		enemies->y[i] = -sin(angle) * distance;
+		enemies->lastX[i] = enemies->x[i];
+		enemies->lastY[i] = enemies->y[i];
+		enemies->distance[i] = distance;
+	}
+}
+
+// Copies enemy src over enemy dst
+void pnlMoveEnemy(PNLRuntime game, int dst, int src) {
+	PNLEnemies *enemies = &game->planet.enemies;
+	enemies->x[dst] = enemies->x[src];
+	enemies->y[dst] = enemies->y[src];
+	enemies->lastX[dst] = enemies->lastX[src];
+	enemies->lastY[dst] = enemies->lastY[src];
+	enemies->distance[dst] = enemies->distance[src];
+	enemies->hp[dst] = enemies->hp[src];
+	enemies->dosh[dst] = enemies->dosh[src];
+	enemies->fame[dst] = enemies->fame[src];
+	memcpy(enemies->colour[dst], enemies->colour[src], sizeof(vec4));
+}
+
+// Frees the enemy columns
+void pnlFreeEnemies(PNLRuntime game) {
+	PNLEnemies *enemies = &game->planet.enemies;
+	free(enemies->x);
+	free(enemies->y);
+	free(enemies->lastX);
+	free(enemies->lastY);
+	free(enemies->distance);
+	free(enemies->hp);
+	free(enemies->dosh);
+	free(enemies->fame);
+	free(enemies->colour);
+	memset(enemies, 0, sizeof(PNLEnemies));
+}
+
+// Makes room for capacity enemies (and resizes the collision grid to match), any existing enemies are lost
+bool pnlReserveEnemies(PNLRuntime game, int capacity) {
+	PNLEnemies *enemies = &game->planet.enemies;
+	if (enemies->capacity == capacity && game->enemyGrid != NULL) {
+		enemies->count = 0;
+		return true;
+	}
+
+	pnlFreeEnemies(game);
+	pnlSpatialHashFree(game->enemyGrid);
+	enemies->x = malloc(sizeof(real) * capacity);
+	enemies->y = malloc(sizeof(real) * capacity);
+	enemies->lastX = malloc(sizeof(real) * capacity);
+	enemies->lastY = malloc(sizeof(real) * capacity);
+	enemies->distance = malloc(sizeof(real) * capacity);
+	enemies->hp = malloc(sizeof(real) * capacity);
+	enemies->dosh = malloc(sizeof(real) * capacity);
+	enemies->fame = malloc(sizeof(real) * capacity);
+	enemies->colour = malloc(sizeof(vec4) * capacity);
+	game->enemyGrid = pnlSpatialHashCreate(ENEMY_HIT_DISTANCE, capacity);
+	if (enemies->x == NULL || enemies->y == NULL || enemies->lastX == NULL || enemies->lastY == NULL || enemies->distance == NULL ||
+		enemies->hp == NULL || enemies->dosh == NULL || enemies->fame == NULL || enemies->colour == NULL || game->enemyGrid == NULL) {
+		pnlFreeEnemies(game);
+		pnlSpatialHashFree(game->enemyGrid);
+		game->enemyGrid = NULL;
+		return false;
+	}
+	enemies->capacity = capacity;
+	return true;
+}
+
+void pnlSimEnemies(PNLRuntime game, real dt) {
+	PNL_PROFILE_BEGIN("pnlSimEnemies");
+	PNLEnemies *enemies = &game->planet.enemies;
 	if (game->planet.enemySpawnDelay > 0) {
-		game->planet.enemySpawnDelay -= juDelta();
+		game->planet.enemySpawnDelay -= dt;
 		if (game->planet.enemySpawnDelay <= 0) {
 			game->planet.enemySpawnDelay = game->planet.enemySpawnDelayPrevious * (1 - ENEMY_SPAWN_DELAY_DECREASE);
 			game->planet.enemySpawnDelayPrevious = game->planet.enemySpawnDelay;
@@ -1281,115 +1929,130 @@ void pnlUpdateEnemies(PNLRuntime game) {
 		}
 	}
 
-	// Move enemies towards player and draw
-	for (int i = 0; i < MAX_ENEMIES; i++) {
-		if (game->planet.enemies[i].active) {
-			if (game->planet.enemies[i].hp <= 0) { // Kill enemies
-				game->planet.enemies[i].active = false;
-				game->player.dosh += game->planet.enemies[i].dosh;
-				game->player.fame += game->planet.enemies[i].fame;
-				game->player.kills += 1;
-			} else {
-				float angle = juPointAngle(game->planet.enemies[i].x, game->planet.enemies[i].y, game->player.pos.x, game->player.pos.y) - (VK2D_PI / 2);
-				float distance = juPointDistance(game->planet.enemies[i].x, game->planet.enemies[i].y, game->player.pos.x, game->player.pos.y);
-
-				if (distance > (float)GAME_WIDTH * 1.5) { // Move double speed when outside player view
-					game->planet.enemies[i].x +=
-							cos(angle) * ENEMY_SPEED * pow(ENEMY_SPEED_MULTIPLIER, game->planet.spec.planetDifficulty) *
-							juDelta() * 4;
-					game->planet.enemies[i].y -=
-							sin(angle) * ENEMY_SPEED * pow(ENEMY_SPEED_MULTIPLIER, game->planet.spec.planetDifficulty) *
-							juDelta() * 4;
-				} else {
-					game->planet.enemies[i].x +=
-							cos(angle) * ENEMY_SPEED * pow(ENEMY_SPEED_MULTIPLIER, game->planet.spec.planetDifficulty) *
-							juDelta();
-					game->planet.enemies[i].y -=
-							sin(angle) * ENEMY_SPEED * pow(ENEMY_SPEED_MULTIPLIER, game->planet.spec.planetDifficulty) *
-							juDelta();
-				}
-
-				if (distance < ENEMY_HIT_DISTANCE && game->player.hitcooldown <= 0 && !game->fadeOut) {
-					real mult = pow(ENEMY_DAMAGE_MULTIPLIER, (real)game->planet.spec.planetDifficulty);
-					game->player.hp -= (ENEMY_DAMAGE * mult) + (sign(randr() - 0.5) * ENEMY_DAMAGE_VARIANCE * ENEMY_DAMAGE * randr());
-					juSoundPlay(game->assets.sndHit, false, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
-					game->player.hitcooldown = ENEMY_HIT_DELAY;
-
-					if (game->player.hp <= 0) {
-						game->highscore = pnlRecordHighscore(game);
-						game->deathCooldown = true;
-					}
-				}
-
-				vk2dRendererSetColourMod(game->planet.enemies[i].colour);
-				juSpriteDraw(game->assets.sprEnemy, game->planet.enemies[i].x, game->planet.enemies[i].y);
-				vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+	// Kill enemies, sliding the survivors down over them so the live ones stay packed and in order
+	int alive = 0;
+	for (int i = 0; i < enemies->count; i++) {
+		if (enemies->hp[i] <= 0) {
+			game->player.dosh += enemies->dosh[i];
+			game->player.fame += enemies->fame[i];
+			game->player.kills += 1;
+		} else {
+			if (alive != i)
+				pnlMoveEnemy(game, alive, i);
+			alive++;
+		}
+	}
+	enemies->count = alive;
+
+	// Move enemies towards player, 4x speed when outside player view
+	real speed = ENEMY_SPEED * pow(ENEMY_SPEED_MULTIPLIER, game->planet.spec.planetDifficulty);
+	game->kernels->homeEnemies(enemies->x, enemies->y, enemies->distance, enemies->count, game->player.pos.x, game->player.pos.y, speed, (real)GAME_WIDTH * 1.5, 4, dt);
+
+	for (int i = 0; i < enemies->count; i++) {
+		if (enemies->distance[i] < ENEMY_HIT_DISTANCE && game->player.hitcooldown <= 0 && !game->fadeOut) {
+			real mult = pow(ENEMY_DAMAGE_MULTIPLIER, (real)game->planet.spec.planetDifficulty);
+			game->player.hp -= (ENEMY_DAMAGE * mult) + (sign(randr(game, rs_Combat) - 0.5) * ENEMY_DAMAGE_VARIANCE * ENEMY_DAMAGE * randr(game, rs_Combat));
+			pnlPlaySound(game, se_Hit);
+			game->player.hitcooldown = ENEMY_HIT_DELAY;
+
+			if (game->player.hp <= 0) {
+				game->highscore = pnlRecordHighscore(game);
+				game->deathCooldown = true;
 			}
 		}
 	}
+	PNL_PROFILE_END();
+}
+
+void pnlDrawEnemies(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlDrawEnemies");
+	PNLEnemies *enemies = &game->planet.enemies;
+	for (int i = 0; i < enemies->count; i++)
+		pnlSpriteBatchSprite(game->batch, game->assets.sprEnemy, lerp(enemies->lastX[i], enemies->x[i], game->interpolation), lerp(enemies->lastY[i], enemies->y[i], game->interpolation), enemies->colour[i]);
+	pnlSpriteBatchFlush(game->batch);
+	PNL_PROFILE_END();
 }
 
 /********************** Functions specific to regions **********************/
 void pnlInitHome(PNLRuntime game) {
+	int names[GENERATED_PLANET_COUNT];
+	pnlRandomSample(&game->random[rs_Planets], PLANET_NAMES_COUNT, GENERATED_PLANET_COUNT, names);
 	for (int i = 0; i < GENERATED_PLANET_COUNT; i++)
-		game->potentialPlanets[i] = pnlCreatePlanetSpec(game);
+		game->potentialPlanets[i] = pnlCreatePlanetSpec(game, names[i]);
 	for (int i = 0; i < STOCK_TRADE_COUNT; i++) {
 		game->market.previousCosts[i] = game->market.stockCosts[i];
-		real mult = weightedChance(0.5) ? -1 : 1; // 50/50 it goes up or down
-		game->market.stockCosts[i] = STOCK_BASE_PRICE * (1 + (mult * (STOCK_FLUCTUATION[i] * randr())));
+		real mult = weightedChance(game, rs_Market, 0.5) ? -1 : 1; // 50/50 it goes up or down
+		game->market.stockCosts[i] = STOCK_BASE_PRICE * (1 + (mult * (STOCK_FLUCTUATION[i] * randr(game, rs_Market))));
 	}
 	game->player.hp = PLAYER_MAX_HP;
 	game->player.pos.x = PLAYER_DEFAULT_STATE.pos.x;
 	game->player.pos.y = PLAYER_DEFAULT_STATE.pos.y;
+	game->player.lastPos = game->player.pos;
 	game->highscore = false;
 
-	// Make sure that there is at least MINIMUM_WEAPON_DAMAGE_PERCENT damage between all weapons generated for the shop
-	real totalWeaponDamagePercent = 0;
-	while (totalWeaponDamagePercent < MINIMUM_WEAPON_DAMAGE_PERCENT) {
-		totalWeaponDamagePercent = 0;
-		for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++) {
-			game->shop[i] = pnlGenerateWeapon(game, wt_Any);
-			totalWeaponDamagePercent += (game->shop[i].weaponDamage - WEAPON_MIN_DAMAGE) / WEAPON_MAX_DAMAGE;
-		}
-	}
+	pnlStockShop(&game->random[rs_Weapons], game->shop);
 
 	// Music
-	juSoundStopAll();
-	if (weightedChance(0.5))
-		juSoundPlay(game->assets.sndMusicGoofy, false, VOLUME_MUSIC_LEFT, VOLUME_MUSIC_RIGHT);
+	if (weightedChance(game, rs_Cosmetic, 0.5))
+		pnlPlayMusic(game, mt_Goofy, false);
 	else
-		juSoundPlay(game->assets.sndMusicSomber, false, VOLUME_MUSIC_LEFT, VOLUME_MUSIC_RIGHT);
+		pnlPlayMusic(game, mt_Somber, false);
 }
 
-WorldSelection pnlUpdateHome(PNLRuntime game) {
-	// Draw background
-	pnlDrawTiledBackground(game, game->assets.bgHome);
+// Returns the index of the home block the player is standing at or -1 if they aren't near one
+int pnlFindTerminal(PNLRuntime game) {
+	for (int i = 0; i < game->home.size; i++)
+		if (juPointDistance(game->player.pos.x, game->player.pos.y, game->home.blocks[i].x, game->home.blocks[i].y) <= IN_RANGE_TERMINAL_DISTANCE)
+			return i;
+	return -1;
+}
 
-	// Draw/update blocks
-	TerminalCode code = tc_Noop;
-	for (int i = 0; i < game->home.size && code == tc_Noop; i++) {
-		code = pnlUpdateBlock(game, i);
-	}
+WorldSelection pnlSimHome(PNLRuntime game, real dt, const PNLInput *input) {
+	// Terminals take over the screen, so the player can't shoot while using one
+	int terminal = !game->fadeIn && !game->fadeOut ? pnlFindTerminal(game) : -1;
+	game->inTerminal = terminal != -1;
+	pnlSimPlayer(game, dt, input, !game->inTerminal);
+	pnlSimBullets(game, dt);
 
-	pnlPlayerUpdate(game, code == tc_Noop);
-	pnlUpdateBullets(game);
+	// Headless runs have no sprites to lay buttons out with, bots call what the buttons do directly
+	if (game->inTerminal && !game->headless)
+		pnlSimTerminal(game, game->home.blocks[terminal].type, input);
 
-	// Overlay
-	pnlDrawTitleBar(game);
+	// Rinky has something to say whenever the player walks up to the shop
+	game->weaponLastFrame = game->weaponThisFrame;
+	game->weaponThisFrame = game->inTerminal && game->home.blocks[terminal].type == hb_Weapons;
+	if (!game->weaponLastFrame && game->weaponThisFrame)
+		pnlPlaySound(game, se_Shop1 + randi(game, rs_Cosmetic, MAX_SHOP_LINES));
 
 	// Handle fade
 	if (game->fadeOut) {
 		if (game->fadeClock >= FADE_IN_DURATION) {
-			code = tc_Goto;
 			game->fadeOut = false;
+			return ws_Offsite;
 		}
-		game->fadeClock += juDelta();
+		game->fadeClock += dt;
 	}
 
-	if (code == tc_Goto)
-		return ws_Offsite;
-	else
-		return ws_Home;
+	return ws_Home;
+}
+
+void pnlDrawHome(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlDrawHome");
+	// Draw background
+	pnlDrawTiledBackground(game, game->assets.bgHome);
+
+	// Draw/update blocks
+	TerminalCode code = tc_Noop;
+	for (int i = 0; i < game->home.size && code == tc_Noop; i++) {
+		code = pnlDrawBlock(game, i);
+	}
+
+	pnlDrawPlayer(game);
+	pnlDrawBullets(game);
+
+	// Overlay
+	pnlDrawTitleBar(game);
+	PNL_PROFILE_END();
 }
 
 void pnlQuitHome(PNLRuntime game) {
@@ -1406,69 +2069,67 @@ void pnlInitPlanet(PNLRuntime game) {
 	}
 	game->player.pos.x = 150;
 	game->player.pos.y = 150;
+	game->player.lastPos = game->player.pos;
 
 	// Scatter the minerals all around the place
-	for (int i = 0; i < MAX_MINERALS; i++) {
-		game->planet.minerals[i].active = true;
-		game->planet.minerals[i].pos.x = sign(randr() - 0.5) * (MIN_MINERAL_SPAWN_DISTANCE + ((MAX_MINERAL_SPAWN_DISTANCE - MIN_MINERAL_SPAWN_DISTANCE) * randr()));
-		game->planet.minerals[i].pos.y = sign(randr() - 0.5) * (MIN_MINERAL_SPAWN_DISTANCE + ((MAX_MINERAL_SPAWN_DISTANCE - MIN_MINERAL_SPAWN_DISTANCE) * randr()));
-		game->planet.minerals[i].stockIndex = (int)floor(randr() * STOCK_TRADE_COUNT);
-		game->planet.minerals[i].randomSeed = randr() * 10000;
+	PNLMinerals *minerals = &game->planet.minerals;
+	if (!pnlReserveMinerals(game, game->mineralCount))
+		pnlReserveMinerals(game, MAX_MINERALS);
+	minerals->count = minerals->capacity < game->mineralCount ? minerals->capacity : game->mineralCount;
+	for (int i = 0; i < minerals->count; i++) {
+		minerals->x[i] = sign(randr(game, rs_Minerals) - 0.5) * (MIN_MINERAL_SPAWN_DISTANCE + ((MAX_MINERAL_SPAWN_DISTANCE - MIN_MINERAL_SPAWN_DISTANCE) * randr(game, rs_Minerals)));
+		minerals->y[i] = sign(randr(game, rs_Minerals) - 0.5) * (MIN_MINERAL_SPAWN_DISTANCE + ((MAX_MINERAL_SPAWN_DISTANCE - MIN_MINERAL_SPAWN_DISTANCE) * randr(game, rs_Minerals)));
+		minerals->stockIndex[i] = randi(game, rs_Minerals, STOCK_TRADE_COUNT);
+		minerals->randomSeed[i] = randr(game, rs_Minerals) * 10000;
+		minerals->lastX[i] = minerals->x[i];
+		minerals->lastY[i] = minerals->y[i];
+		pnlChunkGridInsert(minerals->grid, i, minerals->x[i], minerals->y[i]);
 	}
 
 	// Reset enemy stuff
 	game->planet.enemySpawnDelayPrevious = ENEMY_SPAWN_DELAY;
 	game->planet.enemySpawnDelay = ENEMY_SPAWN_DELAY;
-	memset(game->planet.enemies, 0, sizeof(struct PNLEnemy) * MAX_ENEMIES);
+	if (!pnlReserveEnemies(game, ENEMY_CAPACITY[game->planet.spec.planetDifficulty - 1]))
+		pnlReserveEnemies(game, ENEMY_CAPACITY[0]);
 
 	// Music
-	juSoundStopAll();
-	juSoundPlay(game->assets.sndMusicMess, true, VOLUME_MUSIC_LEFT, VOLUME_MUSIC_RIGHT);
+	pnlPlayMusic(game, mt_Mess, true);
 }
 
-WorldSelection pnlUpdatePlanet(PNLRuntime game) {
-	// Draw background and ship
-	pnlDrawTiledBackground(game, game->assets.bgOnsite);
-	if (pnlDrawButtonExt(game, game->assets.sprButtonShip, 0, 0, juPointDistance(game->player.pos.x, game->player.pos.y, 75/2, 75/2) < IN_RANGE_TERMINAL_DISTANCE * 2) && !game->fadeOut) {
+// The ship doubles as the button to leave the planet
+bool pnlShipInRange(PNLRuntime game) {
+	return juPointDistance(game->player.pos.x, game->player.pos.y, SHIP_BUTTON_SIZE / 2, SHIP_BUTTON_SIZE / 2) < IN_RANGE_TERMINAL_DISTANCE * 2;
+}
+
+WorldSelection pnlSimPlanet(PNLRuntime game, real dt, const PNLInput *input) {
+	game->inTerminal = false;
+	JURectangle ship = {0, 0, SHIP_BUTTON_SIZE, SHIP_BUTTON_SIZE};
+	if (input->mouseLReleased && juPointInRectangle(&ship, input->mouseX, input->mouseY) && pnlShipInRange(game) && !game->fadeOut) {
 		game->fadeClock = 0;
 		game->fadeOut = true;
 		pnlLoadMineralsIntoShip(game);
 	}
 
 	// Update player bullets minerals and enemies
-	pnlUpdateMinerals(game);
-	pnlPlayerUpdate(game, true);
-	pnlUpdateBullets(game);
-	pnlUpdateEnemies(game);
+	pnlSimMinerals(game, dt);
+	pnlSimPlayer(game, dt, input, true);
+	pnlSimBullets(game, dt);
+	pnlSimEnemies(game, dt);
 	if (juPointDistance(game->player.pos.x, game->player.pos.y, 39, 39) < MINERAL_DEPOSIT_RANGE) {
 		pnlLoadMineralsIntoShip(game);
 	}
 
-	// Draw title and the element overlay
-	pnlDrawTitleBar(game);
-	pnlDrawMineralOverlay(game);
-
-	// Draw death overlay
-	if (game->deathCooldown) {
-		VK2DCamera cam = vk2dRendererGetCamera();
-		// Coordinates to start drawing the background - the +3 is to account for the background's frame
-		float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 3;
-		float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 3;
-		vk2dDrawTexture((game->highscore ? game->assets.texHighscoreScreen : game->assets.texDeathScreen), x - 3, y - 3);
-
-	}
-
-	// DEBUG
-	if (juKeyboardGetKey(SDL_SCANCODE_BACKSPACE)) {
-		game->fadeOut = true;
-		game->fadeClock = 0;
-	}
+	// DEBUG
+	if (input->keyDebugLeave) {
+		game->fadeOut = true;
+		game->fadeClock = 0;
+	}
 
 	// Handle fade in/out
 	if (game->fadeIn) {
 		if (game->fadeClock >= FADE_IN_DURATION)
 			game->fadeIn = false;
-		game->fadeClock += juDelta();
+		game->fadeClock += dt;
 	} else if (game->fadeOut) {
 		if (game->fadeClock >= FADE_IN_DURATION) {
 			// if the player died we need to reset the player
@@ -1484,12 +2145,39 @@ WorldSelection pnlUpdatePlanet(PNLRuntime game) {
 			game->fadeOut = false;
 			return ws_Home;
 		}
-		game->fadeClock += juDelta();
+		game->fadeClock += dt;
 	}
 
 	return ws_Offsite;
 }
 
+void pnlDrawPlanet(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlDrawPlanet");
+	// Draw background and ship, leaving is handled by pnlSimPlanet
+	pnlDrawTiledBackground(game, game->assets.bgOnsite);
+	pnlDrawButtonExt(game, game->assets.sprButtonShip, 0, 0, pnlShipInRange(game));
+
+	// Draw player bullets minerals and enemies
+	pnlDrawMinerals(game);
+	pnlDrawPlayer(game);
+	pnlDrawBullets(game);
+	pnlDrawEnemies(game);
+
+	// Draw title and the element overlay
+	pnlDrawTitleBar(game);
+	pnlDrawMineralOverlay(game);
+
+	// Draw death overlay
+	if (game->deathCooldown) {
+		VK2DCamera cam = vk2dRendererGetCamera();
+		// Coordinates to start drawing the background - the +3 is to account for the background's frame
+		float x = cam.x + (GAME_WIDTH / 2) - (game->assets.bgTerminal->img->width / 2) + 3;
+		float y = cam.y + (GAME_HEIGHT / 2) - (game->assets.bgTerminal->img->height / 2) + 3;
+		vk2dDrawTexture((game->highscore ? game->assets.texHighscoreScreen : game->assets.texDeathScreen), x - 3, y - 3);
+	}
+	PNL_PROFILE_END();
+}
+
 void pnlQuitPlanet(PNLRuntime game) {
 	for (int i = 0; i < STOCK_TRADE_COUNT; i++)
 		game->market.stockOwned[i] += game->planet.inventory.onShipInventory[i];
@@ -1497,70 +2185,82 @@ void pnlQuitPlanet(PNLRuntime game) {
 }
 
 /********************** Core game functions **********************/
+void pnlLoadAssets(PNLRuntime game) {
+	game->assets.bgHome = pnlAssetLoaderGetTexture(game->loader, "assets/home.png");
+	game->assets.fntOverlay = pnlAssetLoaderGetFont(game->loader, "assets/overlay.jufnt");
+	game->assets.texHelpTerminal = pnlAssetLoaderGetImage(game->loader, "assets/helpterm.png");
+	game->assets.texMemorialTerminal = pnlAssetLoaderGetImage(game->loader, "assets/memorialterm.png");
+	game->assets.texMissionTerminal = pnlAssetLoaderGetImage(game->loader, "assets/missionterm.png");
+	game->assets.texStockTerminal = pnlAssetLoaderGetImage(game->loader, "assets/stockterm.png");
+	game->assets.texWeaponTerminal = pnlAssetLoaderGetImage(game->loader, "assets/weaponterm.png");
+	game->assets.texCursor = pnlAssetLoaderGetImage(game->loader, "assets/cursor.png");
+	game->assets.texDown = pnlAssetLoaderGetImage(game->loader, "assets/down.png");
+	game->assets.texUp = pnlAssetLoaderGetImage(game->loader, "assets/up.png");
+	game->assets.bgTerminal = pnlAssetLoaderGetTexture(game->loader, "assets/terminalbg.png");
+	game->assets.sprButtonYes = pnlAssetLoaderGetSprite(game->loader, "assets/yesbutton.png");
+	game->assets.texPlanets[0] = pnlAssetLoaderGetImage(game->loader, "assets/planet1.png");
+	game->assets.texPlanets[1] = pnlAssetLoaderGetImage(game->loader, "assets/planet2.png");
+	game->assets.texPlanets[2] = pnlAssetLoaderGetImage(game->loader, "assets/planet3.png");
+	game->assets.texPlanets[3] = pnlAssetLoaderGetImage(game->loader, "assets/planet4.png");
+	game->assets.texPlanets[4] = pnlAssetLoaderGetImage(game->loader, "assets/planet5.png");
+	game->assets.texStocks[0] = pnlAssetLoaderGetImage(game->loader, "assets/stock1.png");
+	game->assets.texStocks[1] = pnlAssetLoaderGetImage(game->loader, "assets/stock2.png");
+	game->assets.texStocks[2] = pnlAssetLoaderGetImage(game->loader, "assets/stock3.png");
+	game->assets.texStocks[3] = pnlAssetLoaderGetImage(game->loader, "assets/stock4.png");
+	game->assets.texStocks[4] = pnlAssetLoaderGetImage(game->loader, "assets/stock5.png");
+	game->assets.sprButtonLaunch = pnlAssetLoaderGetSprite(game->loader, "assets/launchbutton.png");
+	game->assets.sprButtonBuy = pnlAssetLoaderGetSprite(game->loader, "assets/buybutton.png");
+	game->assets.sprButtonSell = pnlAssetLoaderGetSprite(game->loader, "assets/sellbutton.png");
+	game->assets.sprButtonBuy10 = pnlAssetLoaderGetSprite(game->loader, "assets/buy10button.png");
+	game->assets.sprButtonSell10 = pnlAssetLoaderGetSprite(game->loader, "assets/sell10button.png");
+	game->assets.sprButtonShip = pnlAssetLoaderGetSprite(game->loader, "assets/shipbutton.png");
+	game->assets.sprStars = pnlAssetLoaderGetSprite(game->loader, "assets/stars.png");
+	game->assets.sprButtonRetire = pnlAssetLoaderGetSprite(game->loader, "assets/retire.png");
+	game->assets.sprButtonFameToDosh = pnlAssetLoaderGetSprite(game->loader, "assets/fametodosh.png");
+	game->assets.sprButtonDoshToFame = pnlAssetLoaderGetSprite(game->loader, "assets/doshtofame.png");
+	game->assets.texAssaultRifle = pnlAssetLoaderGetImage(game->loader, "assets/assaultrifle.png");
+	game->assets.bgOnsite = pnlAssetLoaderGetTexture(game->loader, "assets/onsite.png");
+	game->assets.texPistol = pnlAssetLoaderGetImage(game->loader, "assets/pistol.png");
+	game->assets.texShotgun = pnlAssetLoaderGetImage(game->loader, "assets/shotgun.png");
+	game->assets.texSniper = pnlAssetLoaderGetImage(game->loader, "assets/sniper.png");
+	game->assets.texSword = pnlAssetLoaderGetImage(game->loader, "assets/sword.png");
+	game->assets.texBullet = pnlAssetLoaderGetImage(game->loader, "assets/bullet.png");
+	game->assets.texWhoosh = pnlAssetLoaderGetImage(game->loader, "assets/whoosh.png");
+	game->assets.texCompass = pnlAssetLoaderGetImage(game->loader, "assets/compass.png");
+	game->assets.texDeathScreen = pnlAssetLoaderGetTexture(game->loader, "assets/death.png");
+	game->assets.texHighscoreScreen = pnlAssetLoaderGetTexture(game->loader, "assets/deathhighscore.png");
+	game->assets.texTutorial1 = pnlAssetLoaderGetTexture(game->loader, "assets/tutorial1.png");
+	game->assets.texTutorial2 = pnlAssetLoaderGetTexture(game->loader, "assets/tutorial2.png");
+	game->assets.sprEnemy = pnlAssetLoaderGetSprite(game->loader, "assets/enemy.png");
+	game->assets.sprButtonPurchase = pnlAssetLoaderGetSprite(game->loader, "assets/purchase.png");
+	game->assets.sndNewGun = pnlAssetLoaderGetSound(game->loader, "assets/newgun.wav");
+	game->assets.sndShop[0] = pnlAssetLoaderGetSound(game->loader, "assets/whatisawenrad.wav");
+	game->assets.sndShop[1] = pnlAssetLoaderGetSound(game->loader, "assets/justdontgethit.wav");
+	game->assets.sndShop[2] = pnlAssetLoaderGetSound(game->loader, "assets/dontturnmypizzainsideout.wav");
+	game->assets.sndSword = pnlAssetLoaderGetSound(game->loader, "assets/sword.wav");
+	game->assets.sndPistol = pnlAssetLoaderGetSound(game->loader, "assets/pistol.wav");
+	game->assets.sndShotgun = pnlAssetLoaderGetSound(game->loader, "assets/shotgun.wav");
+	game->assets.sndAssaultRifle = pnlAssetLoaderGetSound(game->loader, "assets/assaultrifle.wav");
+	game->assets.sndSniper = pnlAssetLoaderGetSound(game->loader, "assets/sniper.wav");
+	game->assets.sndHit = pnlAssetLoaderGetSound(game->loader, "assets/hit.wav");
+	game->assets.sndHeavyDrum = pnlAssetLoaderGetSound(game->loader, "assets/heavy.wav");
+	game->assets.sprEnemy->rotation = 0;
+}
+
 void pnlInit(PNLRuntime game) {
 	// Load assets
-	game->assets.bgHome = juLoaderGetTexture(game->loader, "assets/home.png");
-	game->assets.fntOverlay = juLoaderGetFont(game->loader, "assets/overlay.jufnt");
-	game->assets.texHelpTerminal = juLoaderGetTexture(game->loader, "assets/helpterm.png");
-	game->assets.texMemorialTerminal = juLoaderGetTexture(game->loader, "assets/memorialterm.png");
-	game->assets.texMissionTerminal = juLoaderGetTexture(game->loader, "assets/missionterm.png");
-	game->assets.texStockTerminal = juLoaderGetTexture(game->loader, "assets/stockterm.png");
-	game->assets.texWeaponTerminal = juLoaderGetTexture(game->loader, "assets/weaponterm.png");
-	game->assets.texCursor = juLoaderGetTexture(game->loader, "assets/cursor.png");
-	game->assets.texDown = juLoaderGetTexture(game->loader, "assets/down.png");
-	game->assets.texUp = juLoaderGetTexture(game->loader, "assets/up.png");
-	game->assets.bgTerminal = juLoaderGetTexture(game->loader, "assets/terminalbg.png");
-	game->assets.sprButtonYes = juLoaderGetSprite(game->loader, "assets/yesbutton.png");
-	game->assets.texPlanets[0] = juLoaderGetTexture(game->loader, "assets/planet1.png");
-	game->assets.texPlanets[1] = juLoaderGetTexture(game->loader, "assets/planet2.png");
-	game->assets.texPlanets[2] = juLoaderGetTexture(game->loader, "assets/planet3.png");
-	game->assets.texPlanets[3] = juLoaderGetTexture(game->loader, "assets/planet4.png");
-	game->assets.texPlanets[4] = juLoaderGetTexture(game->loader, "assets/planet5.png");
-	game->assets.texStocks[0] = juLoaderGetTexture(game->loader, "assets/stock1.png");
-	game->assets.texStocks[1] = juLoaderGetTexture(game->loader, "assets/stock2.png");
-	game->assets.texStocks[2] = juLoaderGetTexture(game->loader, "assets/stock3.png");
-	game->assets.texStocks[3] = juLoaderGetTexture(game->loader, "assets/stock4.png");
-	game->assets.texStocks[4] = juLoaderGetTexture(game->loader, "assets/stock5.png");
-	game->assets.sprButtonLaunch = juLoaderGetSprite(game->loader, "assets/launchbutton.png");
-	game->assets.sprButtonBuy = juLoaderGetSprite(game->loader, "assets/buybutton.png");
-	game->assets.sprButtonSell = juLoaderGetSprite(game->loader, "assets/sellbutton.png");
-	game->assets.sprButtonBuy10 = juLoaderGetSprite(game->loader, "assets/buy10button.png");
-	game->assets.sprButtonSell10 = juLoaderGetSprite(game->loader, "assets/sell10button.png");
-	game->assets.sprButtonShip = juLoaderGetSprite(game->loader, "assets/shipbutton.png");
-	game->assets.sprStars = juLoaderGetSprite(game->loader, "assets/stars.png");
-	game->assets.sprButtonRetire = juLoaderGetSprite(game->loader, "assets/retire.png");
-	game->assets.sprButtonFameToDosh = juLoaderGetSprite(game->loader, "assets/fametodosh.png");
-	game->assets.sprButtonDoshToFame = juLoaderGetSprite(game->loader, "assets/doshtofame.png");
-	game->assets.texAssaultRifle = juLoaderGetTexture(game->loader, "assets/assaultrifle.png");
-	game->assets.bgOnsite = juLoaderGetTexture(game->loader, "assets/onsite.png");
-	game->assets.texPistol = juLoaderGetTexture(game->loader, "assets/pistol.png");
-	game->assets.texShotgun = juLoaderGetTexture(game->loader, "assets/shotgun.png");
-	game->assets.texSniper = juLoaderGetTexture(game->loader, "assets/sniper.png");
-	game->assets.texSword = juLoaderGetTexture(game->loader, "assets/sword.png");
-	game->assets.texBullet = juLoaderGetTexture(game->loader, "assets/bullet.png");
-	game->assets.texWhoosh = juLoaderGetTexture(game->loader, "assets/whoosh.png");
-	game->assets.texCompass = juLoaderGetTexture(game->loader, "assets/compass.png");
-	game->assets.texDeathScreen = juLoaderGetTexture(game->loader, "assets/death.png");
-	game->assets.texHighscoreScreen = juLoaderGetTexture(game->loader, "assets/deathhighscore.png");
-	game->assets.texTutorial1 = juLoaderGetTexture(game->loader, "assets/tutorial1.png");
-	game->assets.texTutorial2 = juLoaderGetTexture(game->loader, "assets/tutorial2.png");
-	game->assets.sprEnemy = juLoaderGetSprite(game->loader, "assets/enemy.png");
-	game->assets.sprButtonPurchase = juLoaderGetSprite(game->loader, "assets/purchase.png");
-	game->assets.sndMusicGoofy = juLoaderGetSound(game->loader, "assets/goofytrack.wav");
-	game->assets.sndMusicSomber = juLoaderGetSound(game->loader, "assets/sombertrack.wav");
-	game->assets.sndNewGun = juLoaderGetSound(game->loader, "assets/newgun.wav");
-	game->assets.sndShop[0] = juLoaderGetSound(game->loader, "assets/whatisawenrad.wav");
-	game->assets.sndShop[1] = juLoaderGetSound(game->loader, "assets/justdontgethit.wav");
-	game->assets.sndShop[2] = juLoaderGetSound(game->loader, "assets/dontturnmypizzainsideout.wav");
-	game->assets.sndSword = juLoaderGetSound(game->loader, "assets/sword.wav");
-	game->assets.sndPistol = juLoaderGetSound(game->loader, "assets/pistol.wav");
-	game->assets.sndShotgun = juLoaderGetSound(game->loader, "assets/shotgun.wav");
-	game->assets.sndAssaultRifle = juLoaderGetSound(game->loader, "assets/assaultrifle.wav");
-	game->assets.sndSniper = juLoaderGetSound(game->loader, "assets/sniper.wav");
-	game->assets.sndHit = juLoaderGetSound(game->loader, "assets/hit.wav");
-	game->assets.sndMusicMess = juLoaderGetSound(game->loader, "assets/mess.wav");
-	game->assets.sndHeavyDrum = juLoaderGetSound(game->loader, "assets/heavy.wav");
-	game->assets.sprEnemy->rotation = 0;
+	if (!game->headless) {
+		pnlLoadAssets(game);
+		game->batch = pnlSpriteBatchCreate();
+		game->text = pnlTextCacheCreate(TEXT_CACHE_SIZE);
+	}
+	pnlReserveEnemies(game, ENEMY_CAPACITY[0]);
+	pnlReserveMinerals(game, MAX_MINERALS);
+	if (game->mineralCount <= 0)
+		game->mineralCount = MAX_MINERALS;
+	game->bullets.pool = pnlPoolCreate(BULLET_CHUNK_SIZE);
+	if (game->kernels == NULL)
+		game->kernels = pnlKernelsGet(km_Auto);
 
 	// Build home grid
 	for (int i = 0; i < HOME_WORLD_GRID_HEIGHT; i++) {
@@ -1577,44 +2277,32 @@ void pnlInit(PNLRuntime game) {
 
 	// Load default player state and give a weapon
 	memcpy(&game->player, &PLAYER_DEFAULT_STATE, sizeof(struct PNLPlayer));
-	game->player.sprite = juLoaderGetSprite(game->loader, "assets/player.png");
+	if (!game->headless)
+		game->player.sprite = pnlAssetLoaderGetSprite(game->loader, "assets/player.png");
 	game->player.weapon = pnlGenerateWeapon(game, wt_Pistol);
 
-	// Debug - generate a bunch of random weapons
-	/*FILE *file = fopen("weapons/.csv", "w");
-	const char *wepnames[] = {
-			"Sword",
-			"Shotgun",
-			"AssaultRifle",
-			"Sniper",
-   			"Pistol",
-	};
-	for (int i = 0; i < 100; i++) {
-		PNLWeapon w = pnlGenerateWeapon(game, wt_Any);
-		fprintf(file, "%s %s,%s,%f damage,%f bps,%f spread,$%f,RGB:%f|%f|%f\n", WEAPON_NAME_FIRST[w.weaponNameFirstIndex], WEAPON_NAME_SECOND[w.weaponNameSecondIndex], wepnames[w.weaponType], w.weaponDamage, w.weaponBPS, w.weaponPellets, w.weaponCost, w.weaponColourMod[0], w.weaponColourMod[1], w.weaponColourMod[2]);
-	}
-	fclose(file);*/
-
 	pnlInitHome(game);
 }
 
 // Called before the rendering begins
 void pnlPreFrame(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlPreFrame");
 	VK2DCamera cam = vk2dRendererGetCamera();
 
 	// Start at the player
-	float destX = game->player.pos.x - (GAME_WIDTH / 2);
-	float destY = game->player.pos.y - (GAME_HEIGHT / 2);
+	physvec2 pos = pnlPlayerDrawPos(game);
+	float destX = pos.x - (GAME_WIDTH / 2);
+	float destY = pos.y - (GAME_HEIGHT / 2);
 
 	// Aim towards mouse
-	float dist = juPointDistance(game->player.pos.x, game->player.pos.y, game->mouseX, game->mouseY);
-	float angle = juPointAngle(game->player.pos.x, game->player.pos.y, game->mouseX, game->mouseY) - (VK2D_PI / 2);
-	destX += cos(angle) * dist * (game->mouseRHeld ? CAMERA_ZOOM_AIM_DISTANCE : CAMERA_ZOOM_DISTANCE);
-	destY -= sin(angle) * dist * (game->mouseRHeld ? CAMERA_ZOOM_AIM_DISTANCE : CAMERA_ZOOM_DISTANCE);
+	float dist = juPointDistance(pos.x, pos.y, game->input.mouseX, game->input.mouseY);
+	float angle = juPointAngle(pos.x, pos.y, game->input.mouseX, game->input.mouseY) - (VK2D_PI / 2);
+	destX += cos(angle) * dist * (game->input.mouseRHeld ? CAMERA_ZOOM_AIM_DISTANCE : CAMERA_ZOOM_DISTANCE);
+	destY -= sin(angle) * dist * (game->input.mouseRHeld ? CAMERA_ZOOM_AIM_DISTANCE : CAMERA_ZOOM_DISTANCE);
 
 	// Set camera
-	cam.x += (destX - cam.x) * PHYS_CAMERA_FRICTION * juDelta();
-	cam.y += (destY - cam.y) * PHYS_CAMERA_FRICTION * juDelta();
+	cam.x += (destX - cam.x) * PHYS_CAMERA_FRICTION * game->frameDelta;
+	cam.y += (destY - cam.y) * PHYS_CAMERA_FRICTION * game->frameDelta;
 	cam.w = GAME_WIDTH;
 	cam.h = GAME_HEIGHT;
 	cam.x = round(cam.x);
@@ -1628,32 +2316,175 @@ void pnlPreFrame(PNLRuntime game) {
 			percent = 1.0f - (game->fadeClock / FADE_IN_DURATION);
 		else
 			percent = (float)(game->fadeClock / FADE_IN_DURATION);
-		cam.zoom = MAX_ZOOM * percent;
+		cam.zoom = MAX_ZOOM * percent < MIN_FADE_ZOOM ? MIN_FADE_ZOOM : MAX_ZOOM * percent;
 		cam.rot = MAX_ROT * percent;
 	}
 
 	vk2dRendererSetCamera(cam);
+	PNL_PROFILE_END();
+}
+
+// Copies this frame's input into the input the next tick will see, holding on to any presses and
+// releases a tick hasn't seen yet so frames that run no ticks don't eat them
+void pnlAccumulateInput(PNLInput *tick, const PNLInput *frame) {
+	PNLInput unseen = *tick;
+	*tick = *frame;
+	tick->mouseLPressed |= unseen.mouseLPressed;
+	tick->mouseLReleased |= unseen.mouseLReleased;
+	tick->mouseRPressed |= unseen.mouseRPressed;
+	tick->mouseRReleased |= unseen.mouseRReleased;
+	tick->mouseMPressed |= unseen.mouseMPressed;
+	tick->mouseMReleased |= unseen.mouseMReleased;
+	tick->keyRespawn |= unseen.keyRespawn;
+}
+
+// Every button/key in an input, in the order they're packed for replays - only ever append to this
+int pnlInputFlags(PNLInput *input, bool **flags) {
+	bool *all[] = {
+			&input->mouseLPressed, &input->mouseLReleased, &input->mouseLHeld,
+			&input->mouseRPressed, &input->mouseRReleased, &input->mouseRHeld,
+			&input->mouseMPressed, &input->mouseMReleased, &input->mouseMHeld,
+			&input->keyUp, &input->keyDown, &input->keyLeft, &input->keyRight,
+			&input->keyRespawn, &input->keyDebugLeave,
+	};
+	int count = sizeof(all) / sizeof(bool*);
+	memcpy(flags, all, sizeof(all));
+	return count;
+}
+
+// Turns a frame's input into a replay frame
+PNLReplayFrame pnlPackInput(PNLRuntime game) {
+	PNLReplayFrame frame = {(float)game->frameDelta, game->input.mouseX, game->input.mouseY, 0};
+	bool *flags[32];
+	int count = pnlInputFlags(&game->input, flags);
+	for (int i = 0; i < count; i++)
+		frame.buttons |= *flags[i] ? (1u << i) : 0;
+	return frame;
+}
+
+// Sets the buttons/keys and frame time from a replay frame, the mouse is set separately since it
+// has to come after the camera moves
+void pnlUnpackInput(PNLRuntime game, const PNLReplayFrame *frame) {
+	bool *flags[32];
+	int count = pnlInputFlags(&game->input, flags);
+	for (int i = 0; i < count; i++)
+		*flags[i] = (frame->buttons & (1u << i)) != 0;
+	game->frameDelta = frame->delta;
+}
+
+// Presses and releases only count for the first tick that sees them
+void pnlConsumeInput(PNLInput *tick) {
+	tick->mouseLPressed = tick->mouseLReleased = false;
+	tick->mouseRPressed = tick->mouseRReleased = false;
+	tick->mouseMPressed = tick->mouseMReleased = false;
+	tick->keyRespawn = false;
 }
 
-// Called during rendering
-void pnlUpdate(PNLRuntime game) {
+// Remembers where everything is before a tick so frames can be drawn between ticks
+void pnlStorePositions(PNLRuntime game) {
+	game->player.lastPos = game->player.pos;
+	for (int c = 0; c < game->bullets.chunkCount; c++) {
+		PNLBulletChunk *chunk = game->bullets.chunks[c];
+		memcpy(chunk->lastX, chunk->x, sizeof(chunk->x));
+		memcpy(chunk->lastY, chunk->y, sizeof(chunk->y));
+	}
+	PNLEnemies *enemies = &game->planet.enemies;
+	memcpy(enemies->lastX, enemies->x, sizeof(real) * enemies->count);
+	memcpy(enemies->lastY, enemies->y, sizeof(real) * enemies->count);
+}
+
+// Advances the game by dt seconds, never touches the renderer or audio
+void pnlSimTick(PNLRuntime game, real dt, const PNLInput *input) {
+	PNL_PROFILE_BEGIN("pnlSimTick");
+	pnlStorePositions(game);
+	game->time += dt;
+	if (game->notificationTime > 0)
+		game->notificationTime -= dt;
+
 	if (game->onSite) {
-		if (pnlUpdatePlanet(game) == ws_Home) {
+		if (pnlSimPlanet(game, dt, input) == ws_Home) {
 			game->onSite = false;
 			pnlQuitPlanet(game);
 			pnlInitHome(game);
 		}
 	} else {
-		if (pnlUpdateHome(game) == ws_Offsite) {
+		if (pnlSimHome(game, dt, input) == ws_Offsite) {
 			game->onSite = true;
 			pnlQuitHome(game);
 			pnlInitPlanet(game);
 		}
 	}
-	if (!game->mouseRHeld)
-		vk2dDrawTexture(game->assets.texCursor, game->mouseX - 4, game->mouseY - 4);
+	PNL_PROFILE_END();
+}
+
+// Called during rendering, draws the state pnlSimTick left behind (terminals are still immediate mode)
+void pnlDraw(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlDraw");
+	game->uiInert = true; // Buttons were already pressed in the tick, terminals are only drawn here
+	if (game->onSite)
+		pnlDrawPlanet(game);
+	else
+		pnlDrawHome(game);
+	game->uiInert = false;
+	if (!game->input.mouseRHeld)
+		pnlDrawImage(game->assets.texCursor, game->input.mouseX - 4, game->input.mouseY - 4, 1, 1, 0, 0, 0);
+	else
+		pnlDrawImage(game->assets.texCursor, game->input.mouseX - 8, game->input.mouseY - 8, 2, 2, 0, 0, 0);
+	PNL_PROFILE_END();
+}
+
+PNLSound pnlGetSound(PNLRuntime game, SoundEffect sound) {
+	if (sound == se_Pistol)
+		return game->assets.sndPistol;
+	else if (sound == se_Shotgun)
+		return game->assets.sndShotgun;
+	else if (sound == se_AssaultRifle)
+		return game->assets.sndAssaultRifle;
+	else if (sound == se_Sniper)
+		return game->assets.sndSniper;
+	else if (sound == se_Sword)
+		return game->assets.sndSword;
+	else if (sound == se_Hit)
+		return game->assets.sndHit;
+	else if (sound == se_NewGun)
+		return game->assets.sndNewGun;
+	else if (sound == se_HeavyDrum)
+		return game->assets.sndHeavyDrum;
+	return game->assets.sndShop[sound - se_Shop1];
+}
+
+// Plays whatever the simulation asked for since the last call
+void pnlFlushAudio(PNLRuntime game) {
+	PNL_PROFILE_BEGIN("pnlFlushAudio");
+	if (game->musicRequest != mt_None) {
+		if (game->sounds != NULL)
+			pnlSoundPoolStopAll(game->sounds); // Only effects, the music crossfades into the new track on its own
+		if (game->music != NULL)
+			pnlMusicStreamPlay(game->music, MUSIC_TRACKS[game->musicRequest], game->musicLoop, MUSIC_CROSSFADE, VOLUME_MUSIC_LEFT, VOLUME_MUSIC_RIGHT);
+		game->musicRequest = mt_None;
+	}
+	for (int i = 0; i < game->soundQueueSize && game->sounds != NULL; i++) {
+		SoundEffect sound = game->soundQueue[i];
+		pnlSoundPoolPlay(game->sounds, pnlGetSound(game, sound), SOUND_PRIORITIES[sound], SOUND_LIMITS[sound], VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+	}
+	game->soundQueueSize = 0;
+	PNL_PROFILE_END();
+}
+
+// Puts what the simulation is juggling on the profiler's timeline next to the markers
+void pnlProfileCounters(PNLRuntime game) {
+	PNL_PROFILE_COUNTER("enemies", game->onSite ? game->planet.enemies.count : 0);
+	PNL_PROFILE_COUNTER("minerals", game->onSite ? game->planet.minerals.count : 0);
+	PNL_PROFILE_COUNTER("bullets", game->bullets.pool->liveCount);
+}
+
+// Dumps the profiler and says where it went
+void pnlDumpProfile(const char *filename, real seconds) {
+	int events = pnlProfilerDumpFile(filename, seconds);
+	if (events >= 0)
+		printf("Wrote %i profiler events from the last %.1fs to \"%s\"%s\n", events, seconds, filename, pnlProfilerRunning() ? "" : ", nothing was recorded without PNL_PROFILER");
 	else
-		vk2dDrawTextureExt(game->assets.texCursor, game->mouseX - 8, game->mouseY - 8, 2, 2, 0, 0, 0);
+		printf("Couldn't write \"%s\"\n", filename);
 }
 
 void pnlQuit(PNLRuntime game) {
@@ -1663,8 +2494,1990 @@ void pnlQuit(PNLRuntime game) {
 		pnlQuitHome(game);
 }
 
+/********************** Snapshots **********************/
+// The whole simulation state in one versioned binary blob, for picking a run back up after the game
+// is closed and for starting headless runs from a known state. Pointers never go in, assets are saved
+// as pnlAssetId of their path so ASSETS can be reordered without breaking old snapshots.
+
+#define SNAPSHOT_VERSION ((uint32_t)1) // Bump when a section changes shape, adding a section doesn't need it
+#define SNAPSHOT_RUN PNL_SNAPSHOT_TAG('R', 'U', 'N', ' ')
+#define SNAPSHOT_PLAYER PNL_SNAPSHOT_TAG('P', 'L', 'Y', 'R')
+#define SNAPSHOT_MARKET PNL_SNAPSHOT_TAG('M', 'R', 'K', 'T')
+#define SNAPSHOT_SHOP PNL_SNAPSHOT_TAG('S', 'H', 'O', 'P')
+#define SNAPSHOT_SPECS PNL_SNAPSHOT_TAG('S', 'P', 'E', 'C')
+#define SNAPSHOT_PLANET PNL_SNAPSHOT_TAG('P', 'L', 'N', 'T') // Only written while on a planet
+#define SNAPSHOT_BULLETS PNL_SNAPSHOT_TAG('B', 'U', 'L', 'L')
+#define SNAPSHOT_MAX_COUNT ((int)1000000) // Anything bigger in a snapshot is corrupt
+const char *SNAPSHOT_FILE = "suspend.pnlg"; // Where the run is left when the game closes, picked up on the next launch
+
+// 32 bit FNV-1a of an asset's path, 0 is saved for no asset
+uint32_t pnlAssetId(const char *path) {
+	uint32_t hash = 2166136261u;
+	for (const char *c = path; *c != 0; c++)
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	return hash != 0 ? hash : 1;
+}
+
+uint32_t pnlSpriteAssetId(PNLRuntime game, JUSprite sprite) {
+	for (int i = 0; i < ASSET_COUNT && sprite != NULL && game->loader != NULL; i++)
+		if (pnlAssetLoaderGetSprite(game->loader, ASSETS[i].path) == sprite)
+			return pnlAssetId(ASSETS[i].path);
+	return 0;
+}
+
+// NULL if it's not a sprite there is or there's no loader (headless)
+JUSprite pnlSpriteFromAssetId(PNLRuntime game, uint32_t id) {
+	for (int i = 0; i < ASSET_COUNT && id != 0 && game->loader != NULL; i++)
+		if (pnlAssetId(ASSETS[i].path) == id)
+			return pnlAssetLoaderGetSprite(game->loader, ASSETS[i].path);
+	return NULL;
+}
+
+void pnlSnapshotPutWeapon(PNLSnapshot snapshot, const PNLWeapon *weapon) {
+	real values[] = {weapon->weaponDamage, weapon->weaponPellets, weapon->weaponCost, weapon->weaponBPS, weapon->cooldown};
+	int indices[] = {weapon->weaponNameFirstIndex, weapon->weaponNameSecondIndex, weapon->weaponType};
+	pnlSnapshotPutDoubles(snapshot, values, 5);
+	pnlSnapshotPutInts(snapshot, indices, 3);
+	pnlSnapshotPutFloats(snapshot, weapon->weaponColourMod, 4);
+}
+
+void pnlSnapshotGetWeapon(PNLSnapshot snapshot, PNLWeapon *weapon) {
+	real values[5];
+	int indices[3];
+	pnlSnapshotGetDoubles(snapshot, values, 5);
+	pnlSnapshotGetInts(snapshot, indices, 3);
+	pnlSnapshotGetFloats(snapshot, weapon->weaponColourMod, 4);
+	weapon->weaponDamage = values[0];
+	weapon->weaponPellets = values[1];
+	weapon->weaponCost = values[2];
+	weapon->weaponBPS = values[3];
+	weapon->cooldown = values[4];
+	weapon->weaponNameFirstIndex = indices[0];
+	weapon->weaponNameSecondIndex = indices[1];
+	weapon->weaponType = indices[2];
+	if (weapon->weaponNameFirstIndex < 0 || weapon->weaponNameFirstIndex >= WEAPON_NAME_FIRST_COUNT ||
+		weapon->weaponNameSecondIndex < 0 || weapon->weaponNameSecondIndex >= WEAPON_NAME_SECOND_COUNT ||
+		weapon->weaponType < 0 || weapon->weaponType >= wt_Any)
+		snapshot->failed = true;
+}
+
+void pnlSnapshotPutSpec(PNLSnapshot snapshot, const PNLPlanetSpecs *spec) {
+	real values[] = {spec->fameBonus, spec->doshCost};
+	int indices[] = {spec->planetDifficulty, spec->planetTexIndex, spec->planetNameIndex};
+	pnlSnapshotPutDoubles(snapshot, values, 2);
+	pnlSnapshotPutInts(snapshot, indices, 3);
+}
+
+void pnlSnapshotGetSpec(PNLSnapshot snapshot, PNLPlanetSpecs *spec) {
+	real values[2];
+	int indices[3];
+	pnlSnapshotGetDoubles(snapshot, values, 2);
+	pnlSnapshotGetInts(snapshot, indices, 3);
+	spec->fameBonus = values[0];
+	spec->doshCost = values[1];
+	spec->planetDifficulty = indices[0];
+	spec->planetTexIndex = indices[1];
+	spec->planetNameIndex = indices[2];
+	if (spec->planetDifficulty < pd_Easy || spec->planetDifficulty >= pd_MAX || spec->planetTexIndex < 0 ||
+		spec->planetTexIndex >= PLANET_TEXTURE_COUNT || spec->planetNameIndex < 0 || spec->planetNameIndex >= PLANET_NAMES_COUNT)
+		snapshot->failed = true;
+}
+
+// Writes everything the simulation needs to carry on exactly where it is
+void pnlWriteSnapshot(PNLRuntime game, PNLSnapshot snapshot) {
+	pnlSnapshotClear(snapshot, SNAPSHOT_VERSION);
+
+	pnlSnapshotBeginSection(snapshot, SNAPSHOT_RUN);
+	pnlSnapshotPutU64(snapshot, game->seed);
+	for (int i = 0; i < rs_MAX; i++)
+		for (int j = 0; j < 4; j++)
+			pnlSnapshotPutU64(snapshot, game->random[i].s[j]);
+	real times[] = {game->time, game->fadeClock};
+	pnlSnapshotPutDoubles(snapshot, times, 2);
+	pnlSnapshotPutBool(snapshot, game->onSite);
+	pnlSnapshotPutBool(snapshot, game->fadeIn);
+	pnlSnapshotPutBool(snapshot, game->fadeOut);
+	pnlSnapshotPutBool(snapshot, game->deathCooldown);
+	pnlSnapshotPutBool(snapshot, game->highscore);
+	pnlSnapshotPutBool(snapshot, game->weaponLastFrame);
+	pnlSnapshotPutBool(snapshot, game->weaponThisFrame);
+	int settings[] = {game->tutorialPage, game->mineralCount};
+	pnlSnapshotPutInts(snapshot, settings, 2);
+	pnlSnapshotEndSection(snapshot);
+
+	pnlSnapshotBeginSection(snapshot, SNAPSHOT_PLAYER);
+	PNLPlayer *player = &game->player;
+	real state[] = {player->pos.x, player->pos.y, player->velocity.x, player->velocity.y, player->lastPos.x, player->lastPos.y,
+					player->dosh, player->fame, player->hp, player->hitcooldown};
+	pnlSnapshotPutDoubles(snapshot, state, 10);
+	pnlSnapshotPutInts(snapshot, &player->kills, 1);
+	pnlSnapshotPutU32(snapshot, pnlSpriteAssetId(game, player->sprite));
+	pnlSnapshotPutWeapon(snapshot, &player->weapon);
+	pnlSnapshotEndSection(snapshot);
+
+	pnlSnapshotBeginSection(snapshot, SNAPSHOT_MARKET);
+	pnlSnapshotPutDoubles(snapshot, game->market.stockCosts, STOCK_TRADE_COUNT);
+	pnlSnapshotPutDoubles(snapshot, game->market.previousCosts, STOCK_TRADE_COUNT);
+	pnlSnapshotPutInts(snapshot, game->market.stockOwned, STOCK_TRADE_COUNT);
+	pnlSnapshotEndSection(snapshot);
+
+	pnlSnapshotBeginSection(snapshot, SNAPSHOT_SHOP);
+	for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++)
+		pnlSnapshotPutWeapon(snapshot, &game->shop[i]);
+	pnlSnapshotEndSection(snapshot);
+
+	pnlSnapshotBeginSection(snapshot, SNAPSHOT_SPECS);
+	for (int i = 0; i < GENERATED_PLANET_COUNT; i++)
+		pnlSnapshotPutSpec(snapshot, &game->potentialPlanets[i]);
+	pnlSnapshotEndSection(snapshot);
+
+	// Counts up front so a reader can check the section is the right size before allocating anything
+	if (game->onSite) {
+		PNLPlanet *planet = &game->planet;
+		PNLMinerals *minerals = &planet->minerals;
+		PNLEnemies *enemies = &planet->enemies;
+		pnlSnapshotBeginSection(snapshot, SNAPSHOT_PLANET);
+		pnlSnapshotPutSpec(snapshot, &planet->spec);
+		real delays[] = {planet->enemySpawnDelay, planet->enemySpawnDelayPrevious};
+		pnlSnapshotPutDoubles(snapshot, delays, 2);
+		pnlSnapshotPutInts(snapshot, planet->inventory.onHandInventory, STOCK_TRADE_COUNT);
+		pnlSnapshotPutInts(snapshot, planet->inventory.onShipInventory, STOCK_TRADE_COUNT);
+		int counts[] = {minerals->count, minerals->grid->count, enemies->capacity, enemies->count};
+		pnlSnapshotPutInts(snapshot, counts, 4);
+		pnlSnapshotPutDoubles(snapshot, minerals->x, minerals->count);
+		pnlSnapshotPutDoubles(snapshot, minerals->y, minerals->count);
+		pnlSnapshotPutDoubles(snapshot, minerals->lastX, minerals->count);
+		pnlSnapshotPutDoubles(snapshot, minerals->lastY, minerals->count);
+		pnlSnapshotPutDoubles(snapshot, minerals->randomSeed, minerals->count);
+		pnlSnapshotPutInts(snapshot, minerals->stockIndex, minerals->count);
+
+		// Minerals still on the ground in the order the grid has them, so queries come back in the same order
+		for (int c = 0; c < minerals->grid->width * minerals->grid->height; c++)
+			pnlSnapshotPutInts(snapshot, minerals->grid->chunks[c].ids, minerals->grid->chunks[c].count);
+
+		pnlSnapshotPutDoubles(snapshot, enemies->x, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->y, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->lastX, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->lastY, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->distance, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->hp, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->dosh, enemies->count);
+		pnlSnapshotPutDoubles(snapshot, enemies->fame, enemies->count);
+		pnlSnapshotPutFloats(snapshot, (const float*)enemies->colour, enemies->count * 4);
+		pnlSnapshotEndSection(snapshot);
+	}
+
+	// Bullets in the order they're simulated in, slot ids don't matter
+	PNLBullets *bullets = &game->bullets;
+	pnlSnapshotBeginSection(snapshot, SNAPSHOT_BULLETS);
+	pnlSnapshotPutU32(snapshot, bullets->pool->liveCount);
+	for (int l = 0; l < bullets->pool->liveCount; l++) {
+		int id = bullets->pool->live[l];
+		PNLBulletChunk *chunk = bullets->chunks[id / BULLET_CHUNK_SIZE];
+		int i = id % BULLET_CHUNK_SIZE;
+		real values[] = {chunk->x[i], chunk->y[i], chunk->lastX[i], chunk->lastY[i], chunk->dirX[i], chunk->dirY[i], chunk->velocity[i],
+						 chunk->lifetime[i], chunk->damage[i], chunk->direction[i]};
+		pnlSnapshotPutDoubles(snapshot, values, 10);
+		pnlSnapshotPutBool(snapshot, chunk->canPierce[i]);
+		pnlSnapshotPutU32(snapshot, chunk->type[i]);
+	}
+	pnlSnapshotEndSection(snapshot);
+}
+
+// Bytes each bullet takes in SNAPSHOT_BULLETS
+#define SNAPSHOT_BULLET_SIZE ((size_t)((sizeof(double) * 10) + 1 + 4))
+
+// Puts a game back the way a snapshot left it, the game has to have been through pnlInit
+//
+// Everything is read and checked and all the storage it needs is reserved before any of it is applied,
+// so a snapshot that's too new, doesn't add up or doesn't fit in memory leaves the game alone and
+// returns false.
+bool pnlRestoreSnapshot(PNLRuntime game, PNLSnapshot snapshot) {
+	if (!snapshot->reading || snapshot->version > SNAPSHOT_VERSION)
+		return false;
+	bool ok = pnlSnapshotFindSection(snapshot, SNAPSHOT_RUN);
+	uint64_t seed = pnlSnapshotGetU64(snapshot);
+	PNLRandom random[rs_MAX];
+	for (int i = 0; i < rs_MAX; i++)
+		for (int j = 0; j < 4; j++)
+			random[i].s[j] = pnlSnapshotGetU64(snapshot);
+	real times[2];
+	pnlSnapshotGetDoubles(snapshot, times, 2);
+	bool flags[7];
+	for (int i = 0; i < 7; i++)
+		flags[i] = pnlSnapshotGetBool(snapshot);
+	int settings[2];
+	pnlSnapshotGetInts(snapshot, settings, 2);
+
+	PNLPlayer player = game->player;
+	ok = ok && pnlSnapshotFindSection(snapshot, SNAPSHOT_PLAYER);
+	real state[10];
+	pnlSnapshotGetDoubles(snapshot, state, 10);
+	pnlSnapshotGetInts(snapshot, &player.kills, 1);
+	uint32_t sprite = pnlSnapshotGetU32(snapshot);
+	pnlSnapshotGetWeapon(snapshot, &player.weapon);
+
+	PNLStockMarket market;
+	ok = ok && pnlSnapshotFindSection(snapshot, SNAPSHOT_MARKET);
+	pnlSnapshotGetDoubles(snapshot, market.stockCosts, STOCK_TRADE_COUNT);
+	pnlSnapshotGetDoubles(snapshot, market.previousCosts, STOCK_TRADE_COUNT);
+	pnlSnapshotGetInts(snapshot, market.stockOwned, STOCK_TRADE_COUNT);
+
+	PNLWeapon shop[MAX_WEAPONS_AT_RINKYS];
+	ok = ok && pnlSnapshotFindSection(snapshot, SNAPSHOT_SHOP);
+	for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++)
+		pnlSnapshotGetWeapon(snapshot, &shop[i]);
+
+	PNLPlanetSpecs specs[GENERATED_PLANET_COUNT];
+	ok = ok && pnlSnapshotFindSection(snapshot, SNAPSHOT_SPECS);
+	for (int i = 0; i < GENERATED_PLANET_COUNT; i++)
+		pnlSnapshotGetSpec(snapshot, &specs[i]);
+
+	// The planet's arrays are read straight into place, so only the parts in front of them are read now
+	bool onSite = flags[0];
+	PNLPlanet planet = {0};
+	int counts[4] = {0};
+	size_t planetArrays = 0;
+	if (onSite) {
+		ok = ok && pnlSnapshotFindSection(snapshot, SNAPSHOT_PLANET);
+		pnlSnapshotGetSpec(snapshot, &planet.spec);
+		real delays[2];
+		pnlSnapshotGetDoubles(snapshot, delays, 2);
+		planet.enemySpawnDelay = delays[0];
+		planet.enemySpawnDelayPrevious = delays[1];
+		pnlSnapshotGetInts(snapshot, planet.inventory.onHandInventory, STOCK_TRADE_COUNT);
+		pnlSnapshotGetInts(snapshot, planet.inventory.onShipInventory, STOCK_TRADE_COUNT);
+		pnlSnapshotGetInts(snapshot, counts, 4);
+		ok = ok && counts[0] >= 0 && counts[0] <= SNAPSHOT_MAX_COUNT && counts[1] >= 0 && counts[1] <= counts[0] &&
+			 counts[2] > 0 && counts[2] <= SNAPSHOT_MAX_COUNT && counts[3] >= 0 && counts[3] <= counts[2];
+		planetArrays = ((size_t)counts[0] * ((sizeof(double) * 5) + 4)) + ((size_t)counts[1] * 4) + ((size_t)counts[3] * ((sizeof(double) * 8) + (sizeof(float) * 4)));
+		ok = ok && !snapshot->failed && snapshot->section - snapshot->offset == planetArrays;
+	}
+	ok = ok && !snapshot->failed;
+	size_t planetOffset = snapshot->offset;
+
+	// Bullets are checked the same way
+	ok = ok && pnlSnapshotFindSection(snapshot, SNAPSHOT_BULLETS);
+	int bulletCount = (int)pnlSnapshotGetU32(snapshot);
+	ok = ok && !snapshot->failed && bulletCount >= 0 && bulletCount <= SNAPSHOT_MAX_COUNT &&
+		 snapshot->section - snapshot->offset == (size_t)bulletCount * SNAPSHOT_BULLET_SIZE;
+	size_t bulletOffset = snapshot->offset;
+	if (!ok)
+		return false;
+
+	// Nothing left that can go wrong besides running out of memory, so all of it is reserved before the
+	// game is touched. Planet storage that's too small is replaced, the new storage is made with the
+	// game's swapped out and only swapped in once everything has been reserved.
+	PNLMinerals oldMinerals = game->planet.minerals;
+	PNLEnemies oldEnemies = game->planet.enemies;
+	PNLSpatialHash oldEnemyGrid = game->enemyGrid;
+	PNLMinerals minerals = oldMinerals;
+	PNLEnemies enemies = oldEnemies;
+	PNLSpatialHash enemyGrid = oldEnemyGrid;
+	if (onSite) {
+		int mineralCapacity = counts[0] > 0 ? counts[0] : 1;
+		memset(&game->planet.minerals, 0, sizeof(PNLMinerals));
+		memset(&game->planet.enemies, 0, sizeof(PNLEnemies));
+		game->enemyGrid = NULL;
+		if (oldMinerals.grid == NULL || oldMinerals.capacity < mineralCapacity) {
+			ok = pnlReserveMinerals(game, mineralCapacity);
+			minerals = game->planet.minerals;
+		}
+		if (ok && (oldEnemyGrid == NULL || oldEnemies.capacity != counts[2])) {
+			ok = pnlReserveEnemies(game, counts[2]);
+			enemies = game->planet.enemies;
+			enemyGrid = game->enemyGrid;
+		}
+	}
+
+	// Spare bullet slots and chunks don't change anything so they're kept either way
+	PNLBullets *bullets = &game->bullets;
+	ok = ok && pnlPoolReserve(bullets->pool, bulletCount);
+	while (ok && bullets->chunkCount < pnlPoolChunkCount(bullets->pool))
+		ok = pnlGrowBullets(game);
+
+	// Whichever storage isn't going to be used is freed and the game gets back what it had
+	if (onSite) {
+		game->planet.minerals = ok ? oldMinerals : minerals;
+		if (minerals.grid != oldMinerals.grid)
+			pnlFreeMinerals(game);
+		game->planet.enemies = ok ? oldEnemies : enemies;
+		if (enemies.x != oldEnemies.x)
+			pnlFreeEnemies(game);
+		if (enemyGrid != oldEnemyGrid)
+			pnlSpatialHashFree(ok ? oldEnemyGrid : enemyGrid);
+		game->planet.minerals = ok ? minerals : oldMinerals;
+		game->planet.enemies = ok ? enemies : oldEnemies;
+		game->enemyGrid = ok ? enemyGrid : oldEnemyGrid;
+	}
+	if (!ok)
+		return false;
+
+	// From here on the snapshot is applied and nothing can fail
+	if (onSite) {
+		snapshot->section = snapshot->size;
+		snapshot->offset = planetOffset;
+		pnlChunkGridClear(minerals.grid);
+		minerals.count = counts[0];
+		enemies.count = counts[3];
+		pnlSnapshotGetDoubles(snapshot, minerals.x, minerals.count);
+		pnlSnapshotGetDoubles(snapshot, minerals.y, minerals.count);
+		pnlSnapshotGetDoubles(snapshot, minerals.lastX, minerals.count);
+		pnlSnapshotGetDoubles(snapshot, minerals.lastY, minerals.count);
+		pnlSnapshotGetDoubles(snapshot, minerals.randomSeed, minerals.count);
+		pnlSnapshotGetInts(snapshot, minerals.stockIndex, minerals.count);
+		for (int i = 0; i < minerals.count; i++)
+			minerals.stockIndex[i] = minerals.stockIndex[i] >= 0 && minerals.stockIndex[i] < STOCK_TRADE_COUNT ? minerals.stockIndex[i] : 0;
+		for (int i = 0; i < counts[1]; i++) {
+			int id = (int)pnlSnapshotGetU32(snapshot);
+			if (id >= 0 && id < minerals.count)
+				pnlChunkGridInsert(minerals.grid, id, minerals.x[id], minerals.y[id]);
+		}
+		pnlSnapshotGetDoubles(snapshot, enemies.x, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.y, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.lastX, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.lastY, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.distance, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.hp, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.dosh, enemies.count);
+		pnlSnapshotGetDoubles(snapshot, enemies.fame, enemies.count);
+		pnlSnapshotGetFloats(snapshot, (float*)enemies.colour, enemies.count * 4);
+		planet.minerals = minerals;
+		planet.enemies = enemies;
+		game->planet = planet;
+	}
+
+	pnlPoolClear(bullets->pool);
+	snapshot->section = snapshot->size;
+	snapshot->offset = bulletOffset;
+	for (int b = 0; b < bulletCount; b++) {
+		real values[10];
+		pnlSnapshotGetDoubles(snapshot, values, 10);
+		bool pierce = pnlSnapshotGetBool(snapshot);
+		uint32_t type = pnlSnapshotGetU32(snapshot);
+		int id = pnlPoolAcquire(bullets->pool); // Can't fail, the slots were reserved above
+		PNLBulletChunk *chunk = bullets->chunks[id / BULLET_CHUNK_SIZE];
+		int i = id % BULLET_CHUNK_SIZE;
+		chunk->x[i] = values[0];
+		chunk->y[i] = values[1];
+		chunk->lastX[i] = values[2];
+		chunk->lastY[i] = values[3];
+		chunk->dirX[i] = values[4];
+		chunk->dirY[i] = values[5];
+		chunk->velocity[i] = values[6];
+		chunk->lifetime[i] = values[7];
+		chunk->damage[i] = values[8];
+		chunk->direction[i] = values[9];
+		chunk->canPierce[i] = pierce;
+		chunk->type[i] = type == bt_Whoosh ? bt_Whoosh : bt_Bullet;
+	}
+
+	game->seed = seed;
+	memcpy(game->random, random, sizeof(random));
+	game->time = times[0];
+	game->fadeClock = times[1];
+	game->onSite = onSite;
+	game->fadeIn = flags[1];
+	game->fadeOut = flags[2];
+	game->deathCooldown = flags[3];
+	game->highscore = flags[4];
+	game->weaponLastFrame = flags[5];
+	game->weaponThisFrame = flags[6];
+	game->tutorialPage = settings[0];
+	game->mineralCount = settings[1];
+	player.pos.x = state[0];
+	player.pos.y = state[1];
+	player.velocity.x = state[2];
+	player.velocity.y = state[3];
+	player.lastPos.x = state[4];
+	player.lastPos.y = state[5];
+	player.dosh = state[6];
+	player.fame = state[7];
+	player.hp = state[8];
+	player.hitcooldown = state[9];
+	JUSprite spr = pnlSpriteFromAssetId(game, sprite);
+	player.sprite = spr != NULL ? spr : game->player.sprite;
+	game->player = player;
+	game->market = market;
+	memcpy(game->shop, shop, sizeof(shop));
+	memcpy(game->potentialPlanets, specs, sizeof(specs));
+	game->notificationTime = 0;
+	pnlPlayMusic(game, onSite ? mt_Mess : mt_Goofy, onSite);
+	return true;
+}
+
+/********************** Headless **********************/
+
+// Returns the argument following name or NULL if name isn't there
+const char *pnlFindArg(int argc, char **argv, const char *name) {
+	for (int i = 1; i < argc - 1; i++)
+		if (strcmp(argv[i], name) == 0)
+			return argv[i + 1];
+	return NULL;
+}
+
+// Whether a flag that doesn't take a value is there
+bool pnlHasArg(int argc, char **argv, const char *name) {
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], name) == 0)
+			return true;
+	return false;
+}
+
+// Looks for "--kernels <auto|scalar|sse2|avx>" anywhere in the arguments
+PNLKernelMode pnlKernelModeFromArgs(int argc, char **argv) {
+	const char *mode = pnlFindArg(argc, argv, "--kernels");
+	return mode != NULL ? pnlKernelModeFromString(mode) : km_Auto;
+}
+
+// Index of the enemy closest to the player or -1 if there are none
+int pnlNearestEnemy(PNLRuntime game) {
+	int nearest = -1;
+	real nearestDistance = 0;
+	PNLEnemies *enemies = &game->planet.enemies;
+	for (int i = 0; i < enemies->count; i++) {
+		real distance = juPointDistance(game->player.pos.x, game->player.pos.y, enemies->x[i], enemies->y[i]);
+		if (nearest == -1 || distance < nearestDistance) {
+			nearest = i;
+			nearestDistance = distance;
+		}
+	}
+	return nearest;
+}
+
+// Frees a runtime set up with headless on
+void pnlFreeHeadless(PNLRuntime game) {
+	pnlSpatialHashFree(game->enemyGrid);
+	pnlFreeEnemies(game);
+	pnlFreeMinerals(game);
+	pnlFreeBullets(game);
+	free(game);
+}
+
+// Stand-in for a player in headless runs - strafes around in a square and shoots the nearest enemy
+void pnlBotInput(PNLRuntime game, int tick, PNLInput *input) {
+	memset(input, 0, sizeof(PNLInput));
+
+	int nearest = pnlNearestEnemy(game);
+	PNLEnemies *enemies = &game->planet.enemies;
+
+	if (nearest != -1) {
+		input->mouseX = enemies->x[nearest];
+		input->mouseY = enemies->y[nearest];
+		input->mouseLHeld = true;
+		input->mouseLPressed = tick % 2 == 0;
+	} else {
+		input->mouseX = game->player.pos.x + 100;
+		input->mouseY = game->player.pos.y;
+	}
+
+	int side = (tick / (int)SIM_TICK_RATE) % 4;
+	input->keyUp = side == 0;
+	input->keyRight = side == 1;
+	input->keyDown = side == 2;
+	input->keyLeft = side == 3;
+	input->keyRespawn = game->deathCooldown;
+}
+
+// One tick of a headless run with the bot playing
+void pnlHeadlessTick(PNLRuntime game, int tick) {
+	// The bot heads straight back out whenever it ends up home
+	PNLInput input;
+	if (!game->onSite && !game->fadeOut)
+		pnlLaunchPlanet(game, 0);
+	pnlBotInput(game, tick, &input);
+	pnlSimTick(game, 1.0 / SIM_TICK_RATE, &input);
+
+	// Nobody to hear it
+	game->soundQueueSize = 0;
+	game->musicRequest = mt_None;
+}
+
+// Runs the simulation without a window, renderer, or audio device - usage: --headless [ticks] [seed] [--kernels mode] [--minerals count]
+// [--snapshot-in file] [--snapshot-out file] [--first-tick n] [--profile file] [--profile-seconds n], a snapshot in replaces the
+// fresh game (seed included) before the first tick and --first-tick picks up the bot's tick count where the run that wrote it stopped
+int pnlHeadlessMain(int argc, char **argv) {
+	int ticks = argc > 2 && argv[2][0] != '-' ? atoi(argv[2]) : 100000;
+	uint64_t seed = argc > 3 && argv[3][0] != '-' ? strtoull(argv[3], NULL, 10) : (uint64_t)time(NULL);
+
+	PNLRuntime game = calloc(1, sizeof(struct PNLRuntime));
+	pnlSeedRandom(game, seed);
+	game->headless = true;
+	game->kernels = pnlKernelsGet(pnlKernelModeFromArgs(argc, argv));
+	const char *minerals = pnlFindArg(argc, argv, "--minerals");
+	game->mineralCount = minerals != NULL ? atoi(minerals) : MAX_MINERALS;
+	pnlInit(game);
+	const char *snapshotIn = pnlFindArg(argc, argv, "--snapshot-in");
+	const char *snapshotOut = pnlFindArg(argc, argv, "--snapshot-out");
+	if (snapshotIn != NULL) {
+		PNLSnapshot snapshot = pnlSnapshotLoad(snapshotIn);
+		bool restored = snapshot != NULL && pnlRestoreSnapshot(game, snapshot);
+		pnlSnapshotFree(snapshot);
+		if (!restored) {
+			printf("Couldn't restore \"%s\"\n", snapshotIn);
+			pnlFreeHeadless(game);
+			return 1;
+		}
+	}
+
+	const char *firstTick = pnlFindArg(argc, argv, "--first-tick");
+	int first = firstTick != NULL ? atoi(firstTick) : 0;
+	const char *profile = pnlFindArg(argc, argv, "--profile");
+	const char *profileSeconds = pnlFindArg(argc, argv, "--profile-seconds");
+#ifdef PNL_PROFILER
+	if (profile != NULL) {
+		pnlProfilerStart("Peace & Liberty (headless)");
+		pnlProfilerNameThread("main");
+	}
+#endif
+
+	real start = (real)SDL_GetPerformanceCounter();
+	for (int i = 0; i < ticks; i++) {
+		pnlHeadlessTick(game, first + i);
+		pnlProfileCounters(game);
+	}
+	real elapsed = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+	if (profile != NULL)
+		pnlDumpProfile(profile, profileSeconds != NULL ? atof(profileSeconds) : PROFILE_SECONDS);
+	pnlProfilerQuit();
+	if (snapshotOut != NULL) {
+		PNLSnapshot snapshot = pnlSnapshotCreate(SNAPSHOT_VERSION);
+		if (snapshot != NULL)
+			pnlWriteSnapshot(game, snapshot);
+		if (snapshot == NULL || !pnlSnapshotStore(snapshot, snapshotOut))
+			printf("Couldn't write \"%s\"\n", snapshotOut);
+		pnlSnapshotFree(snapshot);
+	}
+
+	printf("%i ticks in %.3fs (%.0f ticks/s), seed %llu, %s kernels\n", ticks, elapsed, ticks / elapsed, (unsigned long long)seed, game->kernels->name);
+	printf("Kills: %i | Fame: %.0f | Dosh: $%.2f | HP: %.0f\n", game->player.kills, game->player.fame, game->player.dosh, game->player.hp);
+	printf("Bullet pool: %i live, %i high water, %i capacity in %i chunks\n", game->bullets.pool->liveCount, game->bullets.pool->highWater, game->bullets.pool->capacity, game->bullets.pool->growths);
+	pnlFreeHeadless(game);
+	return 0;
+}
+
+/********************** Balance simulator **********************/
+// Plays whole careers with bots - buying planets, fighting, selling minerals - on every core to see how
+// the constants play out over thousands of runs. Every career gets its own runtime and seed so they
+// share nothing and the results don't depend on the thread count.
+
+#define BALANCE_MAX_EXPEDITIONS ((int)20) // Careers that last this many expeditions are called retirements
+const real BALANCE_EXPEDITION_TIME = 45; // Seconds bots spend on a planet before heading back to the ship
+const real BALANCE_EXPEDITION_TIMEOUT = 120; // Bots still not back by now are pulled out
+const real BALANCE_CLICKS_PER_SECOND = 6; // How fast bots click for weapons that need a click per shot
+const real BALANCE_CAUTIOUS_HP = 0.4; // Cautious bots head back when they drop below this much hp
+const real BALANCE_ARRIVE_DISTANCE = 8; // Close enough when walking somewhere
+
+typedef enum {
+	bp_Cautious = 0, // Easiest planet it can afford, buys weapons, heads home when hurt
+	bp_Greedy = 1, // Most fame per dosh, buys weapons
+	bp_Reckless = 2, // Hardest planet it can afford, never buys weapons or heads home early
+	bp_MAX = 3,
+} BotPolicy;
+
+const char *BOT_POLICY_NAMES[] = {
+		"cautious",
+		"greedy",
+		"reckless",
+};
+
+typedef enum {
+	ce_Died = 0,
+	ce_Broke = 1, // Couldn't afford a planet even after trading in fame
+	ce_Retired = 2, // Made it through BALANCE_MAX_EXPEDITIONS
+	ce_MAX = 3,
+} CareerEnd;
+
+const char *CAREER_END_NAMES[] = {
+		"died",
+		"broke",
+		"retired",
+};
+
+// How one career went
+typedef struct PNLCareer {
+	BotPolicy policy;
+	CareerEnd end;
+	int expeditions; // Expeditions survived
+	int kills;
+	real survival; // Seconds spent on planets, including the one it died on
+	PlanetDifficulty deathDifficulty; // Only set if it died
+	int deathPlanet; // Index into PLANET_NAMES, only set if it died
+	real fame[BALANCE_MAX_EXPEDITIONS]; // Fame after each expedition survived
+	real worth[BALANCE_MAX_EXPEDITIONS]; // Dosh plus stocks at market price after each expedition survived
+} PNLCareer;
+
+// Value of everything the player has
+real pnlNetWorth(PNLRuntime game) {
+	real worth = game->player.dosh;
+	for (int i = 0; i < STOCK_TRADE_COUNT; i++)
+		worth += game->market.stockOwned[i] * game->market.stockCosts[i];
+	return worth;
+}
+
+// Sells everything, maybe buys a weapon, and picks a planet - returns the planet or -1 if it can't afford any
+int pnlBalanceHome(PNLRuntime game, BotPolicy policy) {
+	for (int i = 0; i < STOCK_TRADE_COUNT; i++)
+		pnlSellStocks(game, i, game->market.stockOwned[i]);
+
+	// Trade fame in until a planet is affordable
+	real cheapest = game->potentialPlanets[0].doshCost;
+	for (int i = 1; i < GENERATED_PLANET_COUNT; i++)
+		cheapest = game->potentialPlanets[i].doshCost < cheapest ? game->potentialPlanets[i].doshCost : cheapest;
+	while (game->player.dosh < cheapest && pnlConvertFameToDosh(game));
+	if (game->player.dosh < cheapest)
+		return -1;
+
+	// Price is the shop's idea of how good a weapon is, buy the best one that still leaves enough for a planet
+	if (policy != bp_Reckless) {
+		int best = -1;
+		for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++)
+			if (game->player.dosh - game->shop[i].weaponCost >= cheapest && game->shop[i].weaponCost > game->player.weapon.weaponCost &&
+				(best == -1 || game->shop[i].weaponCost > game->shop[best].weaponCost))
+				best = i;
+		if (best != -1)
+			pnlBuyShopWeapon(game, best);
+	}
+
+	int choice = -1;
+	for (int i = 0; i < GENERATED_PLANET_COUNT; i++) {
+		PNLPlanetSpecs *spec = &game->potentialPlanets[i];
+		if (spec->doshCost > game->player.dosh)
+			continue;
+		if (choice == -1) {
+			choice = i;
+			continue;
+		}
+		PNLPlanetSpecs *current = &game->potentialPlanets[choice];
+		if (policy == bp_Cautious && (spec->planetDifficulty < current->planetDifficulty || (spec->planetDifficulty == current->planetDifficulty && spec->doshCost < current->doshCost)))
+			choice = i;
+		else if (policy == bp_Greedy && spec->fameBonus / spec->doshCost > current->fameBonus / current->doshCost)
+			choice = i;
+		else if (policy == bp_Reckless && (spec->planetDifficulty > current->planetDifficulty || (spec->planetDifficulty == current->planetDifficulty && spec->fameBonus > current->fameBonus)))
+			choice = i;
+	}
+	return choice;
+}
+
+// Walks towards a point
+void pnlBalanceWalk(PNLRuntime game, real x, real y, PNLInput *input) {
+	real dx = x - game->player.pos.x;
+	real dy = y - game->player.pos.y;
+	input->keyLeft = dx < -BALANCE_ARRIVE_DISTANCE;
+	input->keyRight = dx > BALANCE_ARRIVE_DISTANCE;
+	input->keyUp = dy < -BALANCE_ARRIVE_DISTANCE;
+	input->keyDown = dy > BALANCE_ARRIVE_DISTANCE;
+}
+
+// Fights whatever is closest while collecting minerals, then heads back to the ship
+void pnlBalanceBotInput(PNLRuntime game, BotPolicy policy, int tick, real elapsed, PNLInput *input) {
+	memset(input, 0, sizeof(PNLInput));
+	input->keyRespawn = game->deathCooldown;
+	input->keyDebugLeave = elapsed > BALANCE_EXPEDITION_TIMEOUT && !game->fadeOut; // Holding it restarts the fade
+
+	int nearest = pnlNearestEnemy(game);
+	if (nearest != -1) {
+		input->mouseX = game->planet.enemies.x[nearest];
+		input->mouseY = game->planet.enemies.y[nearest];
+		input->mouseLHeld = true;
+		input->mouseLPressed = tick % (int)(SIM_TICK_RATE / BALANCE_CLICKS_PER_SECOND) == 0;
+	}
+
+	bool hurt = policy == bp_Cautious && game->player.hp < PLAYER_MAX_HP * BALANCE_CAUTIOUS_HP;
+	if (elapsed >= BALANCE_EXPEDITION_TIME || hurt) {
+		pnlBalanceWalk(game, SHIP_BUTTON_SIZE / 2, SHIP_BUTTON_SIZE / 2, input);
+		if (pnlShipInRange(game)) {
+			// Stop shooting for a tick to click the ship
+			input->mouseX = SHIP_BUTTON_SIZE / 2;
+			input->mouseY = SHIP_BUTTON_SIZE / 2;
+			input->mouseLReleased = true;
+		}
+		return;
+	}
+
+	// Head for the closest mineral that hasn't been picked up, or strafe if there are none around
+	PNLMinerals *minerals = &game->planet.minerals;
+	const int *nearby;
+	int nearbyCount = pnlChunkGridQuery(minerals->grid, game->player.pos.x, game->player.pos.y, GAME_WIDTH, &nearby);
+	int target = -1;
+	real targetDistance = 0;
+	for (int n = 0; n < nearbyCount; n++) {
+		real distance = juPointDistance(game->player.pos.x, game->player.pos.y, minerals->x[nearby[n]], minerals->y[nearby[n]]);
+		if (target == -1 || distance < targetDistance) {
+			target = nearby[n];
+			targetDistance = distance;
+		}
+	}
+	if (target != -1) {
+		pnlBalanceWalk(game, minerals->x[target], minerals->y[target], input);
+	} else {
+		int side = (tick / (int)SIM_TICK_RATE) % 4;
+		input->keyUp = side == 0;
+		input->keyRight = side == 1;
+		input->keyDown = side == 2;
+		input->keyLeft = side == 3;
+	}
+}
+
+// Plays one career from a fresh save until the bot dies, goes broke, or retires
+void pnlRunCareer(PNLCareer *career, uint64_t seed, BotPolicy policy, int mineralCount) {
+	memset(career, 0, sizeof(PNLCareer));
+	career->policy = policy;
+	career->end = ce_Retired;
+
+	PNLRuntime game = calloc(1, sizeof(struct PNLRuntime));
+	if (game == NULL)
+		return;
+	pnlSeedRandom(game, seed);
+	game->headless = true;
+	game->mineralCount = mineralCount;
+	pnlInit(game);
+	PNLInput input;
+	real dt = 1.0 / SIM_TICK_RATE;
+
+	for (int expedition = 0; expedition < BALANCE_MAX_EXPEDITIONS && career->end == ce_Retired; expedition++) {
+		int planet = pnlBalanceHome(game, policy);
+		if (planet == -1 || !pnlLaunchPlanet(game, planet)) {
+			career->end = ce_Broke;
+			break;
+		}
+
+		// Fade out of home, then play the planet until back home
+		memset(&input, 0, sizeof(PNLInput));
+		while (!game->onSite)
+			pnlSimTick(game, dt, &input);
+		int tick = 0;
+		bool died = false;
+		while (game->onSite) {
+			pnlBalanceBotInput(game, policy, tick, tick * dt, &input);
+			pnlSimTick(game, dt, &input);
+			game->soundQueueSize = 0;
+			game->musicRequest = mt_None;
+
+			// The player is reset on the way home after dying, so grab everything before that
+			if (game->deathCooldown && !died) {
+				died = true;
+				career->kills = game->player.kills;
+				career->deathDifficulty = game->planet.spec.planetDifficulty;
+				career->deathPlanet = game->planet.spec.planetNameIndex;
+			}
+			tick++;
+		}
+		career->survival += tick * dt;
+
+		if (died) {
+			career->end = ce_Died;
+		} else {
+			career->kills = game->player.kills;
+			career->fame[expedition] = game->player.fame;
+			career->worth[expedition] = pnlNetWorth(game);
+			career->expeditions++;
+		}
+	}
+
+	pnlFreeHeadless(game);
+}
+
+typedef struct PNLBalanceJob {
+	PNLCareer *careers;
+	int count;
+	uint64_t seed;
+	int policy; // -1 to cycle through every policy
+	int mineralCount;
+	SDL_atomic_t next; // Next career nobody has started yet
+} PNLBalanceJob;
+
+int pnlBalanceWorker(void *data) {
+	PNLBalanceJob *job = data;
+	int i;
+	while ((i = SDL_AtomicAdd(&job->next, 1)) < job->count)
+		pnlRunCareer(&job->careers[i], job->seed + i, job->policy == -1 ? i % bp_MAX : job->policy, job->mineralCount);
+	return 0;
+}
+
+int pnlCompareReals(const void *a, const void *b) {
+	real x = *(const real*)a;
+	real y = *(const real*)b;
+	return (x > y) - (x < y);
+}
+
+void pnlBalanceReport(PNLCareer *careers, int count, FILE *out) {
+	real *survival = malloc(sizeof(real) * count);
+	for (int policy = 0; policy < bp_MAX; policy++) {
+		int total = 0;
+		int ends[ce_MAX] = {0};
+		int deathsAt[pd_MAX] = {0};
+		int deathsOn[PLANET_NAMES_COUNT];
+		int reached[BALANCE_MAX_EXPEDITIONS] = {0};
+		real fame[BALANCE_MAX_EXPEDITIONS] = {0};
+		real worth[BALANCE_MAX_EXPEDITIONS] = {0};
+		real kills = 0, expeditions = 0;
+		memset(deathsOn, 0, sizeof(deathsOn));
+
+		for (int i = 0; i < count; i++) {
+			PNLCareer *c = &careers[i];
+			if (c->policy != policy)
+				continue;
+			survival[total++] = c->survival;
+			ends[c->end]++;
+			kills += c->kills;
+			expeditions += c->expeditions;
+			if (c->end == ce_Died) {
+				deathsAt[c->deathDifficulty]++;
+				deathsOn[c->deathPlanet]++;
+			}
+			for (int e = 0; e < c->expeditions; e++) {
+				reached[e]++;
+				fame[e] += c->fame[e];
+				worth[e] += c->worth[e];
+			}
+		}
+		if (total == 0)
+			continue;
+
+		qsort(survival, total, sizeof(real), pnlCompareReals);
+		real meanSurvival = 0;
+		for (int i = 0; i < total; i++)
+			meanSurvival += survival[i];
+		meanSurvival /= total;
+
+		fprintf(out, "\n=== %s: %i careers ===\n", BOT_POLICY_NAMES[policy], total);
+		for (int e = 0; e < ce_MAX; e++)
+			fprintf(out, "%s %.1f%%%s", CAREER_END_NAMES[e], ((real)ends[e] / total) * 100, e == ce_MAX - 1 ? "\n" : " | ");
+		fprintf(out, "Survival: %.0fs mean, %.0fs / %.0fs / %.0fs (10th / 50th / 90th percentile)\n", meanSurvival,
+				survival[(int)(total * 0.1)], survival[total / 2], survival[(int)(total * 0.9)]);
+		fprintf(out, "%.2f expeditions, %.0f kills on average\n", expeditions / total, kills / total);
+		if (ends[ce_Died] > 0) {
+			fprintf(out, "Deaths by difficulty:");
+			for (int d = pd_Easy; d < pd_MAX; d++)
+				fprintf(out, " %s %.1f%%", DIFFICULTY_NAMES[d - 1], ((real)deathsAt[d] / ends[ce_Died]) * 100);
+			int deadliest = 0;
+			for (int p = 1; p < PLANET_NAMES_COUNT; p++)
+				deadliest = deathsOn[p] > deathsOn[deadliest] ? p : deadliest;
+			fprintf(out, "\nDeadliest planet: %s (%i deaths)\n", PLANET_NAMES[deadliest], deathsOn[deadliest]);
+		}
+		fprintf(out, "Expedition | Careers | Mean fame | Mean net worth\n");
+		for (int e = 0; e < BALANCE_MAX_EXPEDITIONS && reached[e] > 0; e++)
+			fprintf(out, "%10i | %7i | %9.0f | $%.2f\n", e + 1, reached[e], fame[e] / reached[e], worth[e] / reached[e]);
+	}
+	free(survival);
+}
+
+// Plays lots of careers across every core and reports how they went - usage: --balance [careers] [seed] [--threads n] [--policy name] [--minerals count]
+int pnlBalanceMain(int argc, char **argv) {
+	PNLBalanceJob job = {0};
+	job.count = argc > 2 && argv[2][0] != '-' ? atoi(argv[2]) : 1000;
+	job.seed = argc > 3 && argv[3][0] != '-' ? strtoull(argv[3], NULL, 10) : (uint64_t)time(NULL);
+	const char *threadArg = pnlFindArg(argc, argv, "--threads");
+	const char *policyArg = pnlFindArg(argc, argv, "--policy");
+	const char *mineralArg = pnlFindArg(argc, argv, "--minerals");
+	int threadCount = threadArg != NULL ? atoi(threadArg) : SDL_GetCPUCount();
+	threadCount = threadCount < 1 ? 1 : threadCount;
+	job.mineralCount = mineralArg != NULL ? atoi(mineralArg) : MAX_MINERALS;
+	job.policy = -1;
+	for (int i = 0; i < bp_MAX && policyArg != NULL; i++)
+		if (strcmp(policyArg, BOT_POLICY_NAMES[i]) == 0)
+			job.policy = i;
+	job.careers = malloc(sizeof(PNLCareer) * (job.count > 0 ? job.count : 1));
+	SDL_Thread **threads = malloc(sizeof(SDL_Thread*) * threadCount);
+	if (job.careers == NULL || threads == NULL || job.count <= 0) {
+		free(job.careers);
+		free(threads);
+		printf("Nothing to simulate\n");
+		return 1;
+	}
+	SDL_AtomicSet(&job.next, 0);
+
+	real start = (real)SDL_GetPerformanceCounter();
+	for (int i = 0; i < threadCount; i++)
+		threads[i] = SDL_CreateThread(pnlBalanceWorker, "balance", &job);
+	for (int i = 0; i < threadCount; i++) {
+		if (threads[i] != NULL)
+			SDL_WaitThread(threads[i], NULL);
+		else
+			pnlBalanceWorker(&job); // Couldn't start a thread, pick up the slack here
+	}
+	real elapsed = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+
+	real gameTime = 0;
+	for (int i = 0; i < job.count; i++)
+		gameTime += job.careers[i].survival;
+	printf("%i careers in %.2fs on %i threads (%.0f careers/s, %.0fx real time), seed %llu\n", job.count, elapsed, threadCount,
+		   job.count / elapsed, gameTime / elapsed, (unsigned long long)job.seed);
+	pnlBalanceReport(job.careers, job.count, stdout);
+	free(job.careers);
+	free(threads);
+	return 0;
+}
+
+/********************** Weapon catalog **********************/
+// Rolls weapons in bulk on every core for checking the price model. Work is split into fixed blocks that
+// each get their own generator stream, so the output only depends on the seed and not the thread count.
+
+#define WEAPON_BLOCK_SIZE ((int)16384) // Weapons per block of work
+#define WEAPON_STAT_BINS ((int)10) // Histogram bins per stat
+#define WEAPON_BINARY_RECORD ((int)19) // Bytes per weapon in the binary format
+#define WEAPON_CSV_ROW ((int)160) // Longest a csv row can be
+
+const char *WEAPON_TYPE_NAMES[] = {
+		"Sword",
+		"Shotgun",
+		"AssaultRifle",
+		"Sniper",
+		"Pistol",
+};
+
+typedef enum {
+	wm_Damage = 0,
+	wm_BPS = 1,
+	wm_Pellets = 2,
+	wm_Cost = 3,
+	wm_MAX = 4,
+} WeaponMetric;
+
+const char *WEAPON_METRIC_NAMES[] = {
+		"damage",
+		"bps",
+		"pellets",
+		"cost",
+};
+
+typedef enum {
+	wf_None = 0, // Only stats
+	wf_CSV = 1,
+	wf_Binary = 2,
+} WeaponFormat;
+
+// Distribution of every stat for each weapon type
+typedef struct PNLWeaponStats {
+	long long count[wt_Any];
+	real sum[wt_Any][wm_MAX];
+	real sumSq[wt_Any][wm_MAX];
+	real sumWithCost[wt_Any][wm_MAX]; // Sum of stat * cost, for how well cost follows each stat
+	real min[wt_Any][wm_MAX];
+	real max[wt_Any][wm_MAX];
+	long long bins[wt_Any][wm_MAX][WEAPON_STAT_BINS];
+} PNLWeaponStats;
+
+// A block of weapons already formatted for output
+typedef struct PNLWeaponBlock {
+	char *data;
+	size_t size;
+	bool ready; // Written by a worker and waiting for the writer
+} PNLWeaponBlock;
+
+typedef struct PNLWeaponJob {
+	long long count;
+	uint64_t seed;
+	WeaponType type;
+	WeaponFormat format;
+	int blockCount;
+	PNLWeaponBlock *slots; // Blocks in flight, block n uses slot n % slotCount
+	int slotCount;
+	PNLWeaponStats *stats; // One per worker so nobody shares anything until the end
+
+	// Workers can only start a block once the writer has finished with the block slotCount before it
+	SDL_mutex *lock;
+	SDL_cond *changed;
+	int nextBlock;
+	int written;
+} PNLWeaponJob;
+
+// Range of the histogram for a stat
+void pnlWeaponMetricRange(WeaponType type, WeaponMetric metric, real *low, real *high) {
+	if (metric == wm_Damage) {
+		*low = WEAPON_MIN_DAMAGE * pnlWeaponDamageMultiplier(type);
+		*high = WEAPON_MAX_DAMAGE * pnlWeaponDamageMultiplier(type);
+	} else if (metric == wm_BPS) {
+		*low = WEAPON_MIN_BPS;
+		*high = WEAPON_MAX_BPS;
+	} else if (metric == wm_Pellets) {
+		*low = WEAPON_MIN_SPREAD;
+		*high = WEAPON_MAX_SPREAD;
+	} else {
+		*low = WEAPON_BASE_COST;
+		*high = WEAPON_BASE_COST * (1 + WEAPON_COST_BPS_MULTIPLIER + WEAPON_COST_DAMAGE_MULTIPLIER + WEAPON_COST_SPREAD_MULTIPLIER);
+	}
+}
+
+void pnlWeaponStatsAdd(PNLWeaponStats *stats, const PNLWeapon *wep) {
+	WeaponType type = wep->weaponType;
+	real values[wm_MAX] = {wep->weaponDamage, wep->weaponBPS, wep->weaponPellets, wep->weaponCost};
+	bool first = stats->count[type]++ == 0;
+	for (int m = 0; m < wm_MAX; m++) {
+		real low, high;
+		pnlWeaponMetricRange(type, m, &low, &high);
+		int bin = (int)(((values[m] - low) / (high - low)) * WEAPON_STAT_BINS);
+		stats->bins[type][m][bin < 0 ? 0 : (bin >= WEAPON_STAT_BINS ? WEAPON_STAT_BINS - 1 : bin)]++;
+		stats->sum[type][m] += values[m];
+		stats->sumSq[type][m] += values[m] * values[m];
+		stats->sumWithCost[type][m] += values[m] * wep->weaponCost;
+		stats->min[type][m] = first || values[m] < stats->min[type][m] ? values[m] : stats->min[type][m];
+		stats->max[type][m] = first || values[m] > stats->max[type][m] ? values[m] : stats->max[type][m];
+	}
+}
+
+void pnlWeaponStatsMerge(PNLWeaponStats *into, const PNLWeaponStats *from) {
+	for (int t = 0; t < wt_Any; t++) {
+		if (from->count[t] == 0)
+			continue;
+		for (int m = 0; m < wm_MAX; m++) {
+			into->min[t][m] = into->count[t] == 0 || from->min[t][m] < into->min[t][m] ? from->min[t][m] : into->min[t][m];
+			into->max[t][m] = into->count[t] == 0 || from->max[t][m] > into->max[t][m] ? from->max[t][m] : into->max[t][m];
+			into->sum[t][m] += from->sum[t][m];
+			into->sumSq[t][m] += from->sumSq[t][m];
+			into->sumWithCost[t][m] += from->sumWithCost[t][m];
+			for (int b = 0; b < WEAPON_STAT_BINS; b++)
+				into->bins[t][m][b] += from->bins[t][m][b];
+		}
+		into->count[t] += from->count[t];
+	}
+}
+
+// Little endian float, the binary format doesn't depend on the machine that wrote it
+uint8_t *pnlPutFloat(uint8_t *out, float f) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(float));
+	for (int i = 0; i < 4; i++)
+		*out++ = (uint8_t)(bits >> (i * 8));
+	return out;
+}
+
+// Appends a weapon to a block in the job's format
+size_t pnlFormatWeapon(WeaponFormat format, const PNLWeapon *wep, char *out) {
+	if (format == wf_CSV) {
+		return (size_t)snprintf(out, WEAPON_CSV_ROW, "%s %s,%s,%f,%f,%.0f,%f,%f,%f,%f\n", WEAPON_NAME_FIRST[wep->weaponNameFirstIndex],
+				WEAPON_NAME_SECOND[wep->weaponNameSecondIndex], WEAPON_TYPE_NAMES[wep->weaponType], wep->weaponDamage, wep->weaponBPS,
+				wep->weaponPellets, wep->weaponCost, wep->weaponColourMod[0], wep->weaponColourMod[1], wep->weaponColourMod[2]);
+	} else if (format == wf_Binary) {
+		uint8_t *bytes = (uint8_t*)out;
+		*bytes++ = (uint8_t)wep->weaponType;
+		*bytes++ = (uint8_t)wep->weaponNameFirstIndex;
+		*bytes++ = (uint8_t)wep->weaponNameSecondIndex;
+		*bytes++ = (uint8_t)wep->weaponPellets;
+		bytes = pnlPutFloat(bytes, (float)wep->weaponDamage);
+		bytes = pnlPutFloat(bytes, (float)wep->weaponBPS);
+		bytes = pnlPutFloat(bytes, (float)wep->weaponCost);
+		for (int i = 0; i < 3; i++)
+			*bytes++ = (uint8_t)round(wep->weaponColourMod[i] * 255);
+		return WEAPON_BINARY_RECORD;
+	}
+	return 0;
+}
+
+typedef struct PNLWeaponWorker {
+	PNLWeaponJob *job;
+	PNLWeaponStats *stats;
+} PNLWeaponWorker;
+
+// Claims the next block once its slot is free and fills it, returns false once there are none left
+bool pnlWeaponWorkBlock(PNLWeaponWorker *worker) {
+	PNLWeaponJob *job = worker->job;
+	SDL_LockMutex(job->lock);
+	while (job->nextBlock < job->blockCount && job->nextBlock - job->written >= job->slotCount)
+		SDL_CondWait(job->changed, job->lock);
+	int block = job->nextBlock < job->blockCount ? job->nextBlock++ : -1;
+	SDL_UnlockMutex(job->lock);
+	if (block == -1)
+		return false;
+
+	PNLWeaponBlock *slot = &job->slots[block % job->slotCount];
+	long long first = (long long)block * WEAPON_BLOCK_SIZE;
+	int count = job->count - first < WEAPON_BLOCK_SIZE ? (int)(job->count - first) : WEAPON_BLOCK_SIZE;
+	PNLRandom rng;
+	pnlRandomSeed(&rng, job->seed, (uint64_t)block);
+	slot->size = 0;
+	for (int i = 0; i < count; i++) {
+		PNLWeapon wep = pnlRollWeapon(&rng, job->type);
+		pnlWeaponStatsAdd(worker->stats, &wep);
+		if (slot->data != NULL)
+			slot->size += pnlFormatWeapon(job->format, &wep, slot->data + slot->size);
+	}
+
+	SDL_LockMutex(job->lock);
+	slot->ready = true;
+	SDL_CondBroadcast(job->changed);
+	SDL_UnlockMutex(job->lock);
+	return true;
+}
+
+int pnlWeaponWorker(void *data) {
+	while (pnlWeaponWorkBlock(data));
+	return 0;
+}
+
+void pnlWeaponReport(const PNLWeaponStats *stats) {
+	for (int t = 0; t < wt_Any; t++) {
+		long long n = stats->count[t];
+		if (n == 0)
+			continue;
+		printf("\n=== %s: %lli weapons ===\n", WEAPON_TYPE_NAMES[t], n);
+		printf("Stat    |       Mean |        Min |        Max | Std dev | Cost correlation | Histogram (%% per bin)\n");
+		real costMean = stats->sum[t][wm_Cost] / n;
+		real costDev = sqrt(fmax(stats->sumSq[t][wm_Cost] / n - (costMean * costMean), 0));
+		for (int m = 0; m < wm_MAX; m++) {
+			real mean = stats->sum[t][m] / n;
+			real dev = sqrt(fmax(stats->sumSq[t][m] / n - (mean * mean), 0));
+			real covariance = (stats->sumWithCost[t][m] / n) - (mean * costMean);
+			printf("%-7s | %10.2f | %10.2f | %10.2f | %7.2f | %16.3f |", WEAPON_METRIC_NAMES[m], mean, stats->min[t][m], stats->max[t][m], dev,
+				   dev > 0 && costDev > 0 ? covariance / (dev * costDev) : 0);
+			for (int b = 0; b < WEAPON_STAT_BINS; b++)
+				printf(" %4.1f", ((real)stats->bins[t][m][b] / n) * 100);
+			printf("\n");
+		}
+	}
+}
+
+// Rolls lots of weapons and reports their stats, optionally writing them out - usage:
+// --weapons [count] [seed] [--threads n] [--type name] [--format csv|binary] [--out file]
+// Binary files are "PNLW", a u32 version, a u64 count then 19 bytes per weapon: u8 type, first name, second name
+// and pellets, f32 damage, bps and cost, then u8 red, green and blue. Everything is little endian.
+int pnlWeaponsMain(int argc, char **argv) {
+	PNLWeaponJob job = {0};
+	job.count = argc > 2 && argv[2][0] != '-' ? strtoll(argv[2], NULL, 10) : 1000000;
+	job.seed = argc > 3 && argv[3][0] != '-' ? strtoull(argv[3], NULL, 10) : (uint64_t)time(NULL);
+	const char *threadArg = pnlFindArg(argc, argv, "--threads");
+	const char *typeArg = pnlFindArg(argc, argv, "--type");
+	const char *formatArg = pnlFindArg(argc, argv, "--format");
+	const char *outArg = pnlFindArg(argc, argv, "--out");
+	int threadCount = threadArg != NULL ? atoi(threadArg) : SDL_GetCPUCount();
+	threadCount = threadCount < 1 ? 1 : threadCount;
+	job.type = wt_Any;
+	for (int i = 0; i < wt_Any && typeArg != NULL; i++)
+		if (strcmp(typeArg, WEAPON_TYPE_NAMES[i]) == 0)
+			job.type = i;
+	job.format = outArg == NULL ? wf_None : (formatArg != NULL && strcmp(formatArg, "binary") == 0 ? wf_Binary : wf_CSV);
+	if (job.count <= 0) {
+		printf("Nothing to generate\n");
+		return 1;
+	}
+
+	FILE *out = NULL;
+	if (job.format != wf_None) {
+		out = fopen(outArg, job.format == wf_Binary ? "wb" : "w");
+		if (out == NULL) {
+			printf("Couldn't open \"%s\"\n", outArg);
+			return 1;
+		}
+		if (job.format == wf_CSV) {
+			fprintf(out, "name,type,damage,bps,pellets,cost,red,green,blue\n");
+		} else {
+			uint8_t header[16] = {'P', 'N', 'L', 'W', 1, 0, 0, 0};
+			for (int i = 0; i < 8; i++)
+				header[8 + i] = (uint8_t)((uint64_t)job.count >> (i * 8));
+			fwrite(header, 1, sizeof(header), out);
+		}
+	}
+
+	// Two blocks in flight per thread keeps everyone busy while the writer catches up
+	job.blockCount = (int)((job.count + WEAPON_BLOCK_SIZE - 1) / WEAPON_BLOCK_SIZE);
+	job.slotCount = threadCount * 2;
+	job.slots = calloc(job.slotCount, sizeof(PNLWeaponBlock));
+	job.stats = calloc(threadCount, sizeof(PNLWeaponStats));
+	PNLWeaponWorker *workers = malloc(sizeof(PNLWeaponWorker) * threadCount);
+	SDL_Thread **threads = malloc(sizeof(SDL_Thread*) * threadCount);
+	job.lock = SDL_CreateMutex();
+	job.changed = SDL_CreateCond();
+	bool failed = job.slots == NULL || job.stats == NULL || workers == NULL || threads == NULL || job.lock == NULL || job.changed == NULL;
+	size_t blockBytes = (size_t)WEAPON_BLOCK_SIZE * (job.format == wf_Binary ? WEAPON_BINARY_RECORD : WEAPON_CSV_ROW);
+	for (int i = 0; i < job.slotCount && !failed && job.format != wf_None; i++)
+		failed = (job.slots[i].data = malloc(blockBytes)) == NULL;
+
+	if (!failed) {
+		real start = (real)SDL_GetPerformanceCounter();
+		for (int i = 0; i < threadCount; i++) {
+			workers[i].job = &job;
+			workers[i].stats = &job.stats[i];
+			threads[i] = SDL_CreateThread(pnlWeaponWorker, "weapons", &workers[i]);
+		}
+
+		// Write blocks out in order as they finish
+		long long bytes = 0;
+		bool anyThreads = false;
+		for (int i = 0; i < threadCount; i++)
+			anyThreads = anyThreads || threads[i] != NULL;
+		for (int block = 0; block < job.blockCount; block++) {
+			PNLWeaponBlock *slot = &job.slots[block % job.slotCount];
+			if (!anyThreads)
+				pnlWeaponWorkBlock(&workers[0]); // Couldn't start any threads, do the work here
+			SDL_LockMutex(job.lock);
+			while (!slot->ready)
+				SDL_CondWait(job.changed, job.lock);
+			SDL_UnlockMutex(job.lock);
+			if (out != NULL)
+				bytes += fwrite(slot->data, 1, slot->size, out);
+			SDL_LockMutex(job.lock);
+			slot->ready = false;
+			job.written++;
+			SDL_CondBroadcast(job.changed);
+			SDL_UnlockMutex(job.lock);
+		}
+		for (int i = 0; i < threadCount; i++)
+			if (threads[i] != NULL)
+				SDL_WaitThread(threads[i], NULL);
+		real elapsed = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+
+		PNLWeaponStats total = {0};
+		for (int i = 0; i < threadCount; i++)
+			pnlWeaponStatsMerge(&total, &job.stats[i]);
+		printf("%lli weapons in %.3fs on %i threads (%.1fM weapons/s), seed %llu", job.count, elapsed, threadCount, (job.count / elapsed) / 1000000,
+			   (unsigned long long)job.seed);
+		if (out != NULL)
+			printf(", %.1fMB written to %s", bytes / 1000000.0, outArg);
+		printf("\n");
+		pnlWeaponReport(&total);
+	} else {
+		printf("Out of memory\n");
+	}
+
+	if (out != NULL)
+		fclose(out);
+	for (int i = 0; i < job.slotCount && job.slots != NULL; i++)
+		free(job.slots[i].data);
+	free(job.slots);
+	free(job.stats);
+	free(workers);
+	free(threads);
+	if (job.lock != NULL)
+		SDL_DestroyMutex(job.lock);
+	if (job.changed != NULL)
+		SDL_DestroyCond(job.changed);
+	return failed ? 1 : 0;
+}
+
+// Times the bullet/enemy broadphase against checking every pair - usage: --bench-collision
+int pnlBenchCollisionMain(int argc, char **argv) {
+	const int BULLET_COUNTS[] = {50, 500, 2500, 10000};
+	const int ENEMY_COUNTS[] = {30, 300, 1250, 5000};
+	const int BENCH_CASES = sizeof(BULLET_COUNTS) / sizeof(int);
+	const int BENCH_REPEATS = 5;
+	PNLRandom rng;
+	pnlRandomSeed(&rng, 1, 0);
+
+	printf("Bullets | Enemies | Brute force ms | Grid ms | Brute ns/bullet | Grid ns/bullet | Hits\n");
+	for (int c = 0; c < BENCH_CASES; c++) {
+		int bullets = BULLET_COUNTS[c];
+		int enemies = ENEMY_COUNTS[c];
+		real *bx = malloc(sizeof(real) * bullets);
+		real *by = malloc(sizeof(real) * bullets);
+		real *ex = malloc(sizeof(real) * enemies);
+		real *ey = malloc(sizeof(real) * enemies);
+
+		// Everything crowds the same area around the player as it would in game
+		for (int i = 0; i < bullets; i++) {
+			bx[i] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_ENEMY_SPAWN_DISTANCE;
+			by[i] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_ENEMY_SPAWN_DISTANCE;
+		}
+		for (int i = 0; i < enemies; i++) {
+			ex[i] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_ENEMY_SPAWN_DISTANCE;
+			ey[i] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_ENEMY_SPAWN_DISTANCE;
+		}
+
+		int bruteHits = 0;
+		real start = (real)SDL_GetPerformanceCounter();
+		for (int r = 0; r < BENCH_REPEATS; r++)
+			for (int i = 0; i < bullets; i++)
+				for (int j = 0; j < enemies; j++)
+					if (juPointDistance(ex[j], ey[j], bx[i], by[i]) <= ENEMY_HIT_DISTANCE)
+						bruteHits++;
+		real brute = (((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency()) / BENCH_REPEATS;
+
+		int gridHits = 0;
+		PNLSpatialHash grid = pnlSpatialHashCreate(ENEMY_HIT_DISTANCE, enemies);
+		start = (real)SDL_GetPerformanceCounter();
+		for (int r = 0; r < BENCH_REPEATS; r++) {
+			pnlSpatialHashClear(grid);
+			for (int j = 0; j < enemies; j++)
+				pnlSpatialHashInsert(grid, j, ex[j], ey[j]);
+			pnlSpatialHashBuild(grid);
+			for (int i = 0; i < bullets; i++) {
+				const int *hits;
+				gridHits += pnlSpatialHashQuery(grid, bx[i], by[i], ENEMY_HIT_DISTANCE, &hits);
+			}
+		}
+		real gridTime = (((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency()) / BENCH_REPEATS;
+
+		printf("%7i | %7i | %14.3f | %7.3f | %15.1f | %14.1f | %i%s\n", bullets, enemies, brute * 1000, gridTime * 1000,
+			   (brute / bullets) * 1000000000, (gridTime / bullets) * 1000000000, gridHits / BENCH_REPEATS,
+			   gridHits == bruteHits ? "" : " (MISMATCH)");
+
+		pnlSpatialHashFree(grid);
+		free(bx);
+		free(by);
+		free(ex);
+		free(ey);
+	}
+	return 0;
+}
+
+// Times every kernel implementation the CPU can run against each other and checks they all
+// agree with the scalar ones - usage: --bench-kernels
+int pnlBenchKernelsMain(int argc, char **argv) {
+	const int ENTITY_COUNTS[] = {50, 1000, 10000, 100000};
+	const int BENCH_CASES = sizeof(ENTITY_COUNTS) / sizeof(int);
+	const int BENCH_TICKS = 100;
+	const PNLKernelMode MODES[] = {km_Scalar, km_SSE2, km_AVX};
+	const int MODE_COUNT = sizeof(MODES) / sizeof(PNLKernelMode);
+	const real dt = 1.0 / SIM_TICK_RATE;
+	PNLRandom rng;
+	pnlRandomSeed(&rng, 1, 0);
+
+	printf("Entities | Kernels | Bullets ms | Enemies ms | Bullets ns/entity | Enemies ns/entity | Matches scalar\n");
+	for (int c = 0; c < BENCH_CASES; c++) {
+		int count = ENTITY_COUNTS[c];
+		real *start = malloc(sizeof(real) * count * 5);
+		real *scalar = malloc(sizeof(real) * count * 6);
+		real *columns = malloc(sizeof(real) * count * 6);
+		for (int i = 0; i < count; i++) {
+			real direction = pnlRandomReal(&rng) * VK2D_PI * 2;
+			start[i] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_ENEMY_SPAWN_DISTANCE;
+			start[count + i] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_ENEMY_SPAWN_DISTANCE;
+			start[(count * 2) + i] = cos(direction);
+			start[(count * 3) + i] = -sin(direction);
+			start[(count * 4) + i] = WEAPON_BULLET_SPEED * pnlRandomReal(&rng);
+		}
+
+		for (int m = 0; m < MODE_COUNT; m++) {
+			const PNLKernels *kernels = pnlKernelsGet(MODES[m]);
+			if (kernels->mode != MODES[m])
+				continue; // CPU can't run it
+
+			// x, y, velocity, lifetime for bullets then x, y for enemies
+			real *x = columns, *y = columns + count, *velocity = columns + (count * 2), *lifetime = columns + (count * 3);
+			real *ex = columns + (count * 4), *ey = columns + (count * 5);
+			real *distance = malloc(sizeof(real) * count);
+			memcpy(x, start, sizeof(real) * count * 2);
+			memcpy(velocity, start + (count * 4), sizeof(real) * count);
+			memset(lifetime, 0, sizeof(real) * count);
+			memcpy(ex, start, sizeof(real) * count * 2);
+
+			real begin = (real)SDL_GetPerformanceCounter();
+			for (int t = 0; t < BENCH_TICKS; t++)
+				kernels->integrateBullets(x, y, start + (count * 2), start + (count * 3), velocity, lifetime, count, dt, WEAPON_BULLET_DECELERATION);
+			real bulletTime = (((real)SDL_GetPerformanceCounter() - begin) / (real)SDL_GetPerformanceFrequency()) / BENCH_TICKS;
+
+			begin = (real)SDL_GetPerformanceCounter();
+			for (int t = 0; t < BENCH_TICKS; t++)
+				kernels->homeEnemies(ex, ey, distance, count, 150, 150, ENEMY_SPEED, (real)GAME_WIDTH * 1.5, 4, dt);
+			real enemyTime = (((real)SDL_GetPerformanceCounter() - begin) / (real)SDL_GetPerformanceFrequency()) / BENCH_TICKS;
+
+			if (kernels->mode == km_Scalar)
+				memcpy(scalar, columns, sizeof(real) * count * 6);
+			printf("%8i | %7s | %10.4f | %10.4f | %17.2f | %17.2f | %s\n", count, kernels->name, bulletTime * 1000, enemyTime * 1000,
+				   (bulletTime / count) * 1000000000, (enemyTime / count) * 1000000000,
+				   memcmp(scalar, columns, sizeof(real) * count * 6) == 0 ? "yes" : "NO");
+			free(distance);
+		}
+
+		free(start);
+		free(scalar);
+		free(columns);
+	}
+	return 0;
+}
+
+// Times finding the minerals near the player with the chunk grid against checking all of them - usage: --bench-minerals
+int pnlBenchMineralsMain(int argc, char **argv) {
+	const int MINERAL_COUNTS[] = {200, 10000, 100000, 1000000};
+	const int BENCH_CASES = sizeof(MINERAL_COUNTS) / sizeof(int);
+	const int BENCH_QUERIES = 1000;
+	PNLRandom rng;
+	pnlRandomSeed(&rng, 1, 0);
+
+	printf("Minerals | Build ms | Linear us/query | Grid us/query | Found\n");
+	for (int c = 0; c < BENCH_CASES; c++) {
+		int count = MINERAL_COUNTS[c];
+		real *x = malloc(sizeof(real) * count);
+		real *y = malloc(sizeof(real) * count);
+		for (int i = 0; i < count; i++) {
+			x[i] = sign(pnlRandomReal(&rng) - 0.5) * (MIN_MINERAL_SPAWN_DISTANCE + ((MAX_MINERAL_SPAWN_DISTANCE - MIN_MINERAL_SPAWN_DISTANCE) * pnlRandomReal(&rng)));
+			y[i] = sign(pnlRandomReal(&rng) - 0.5) * (MIN_MINERAL_SPAWN_DISTANCE + ((MAX_MINERAL_SPAWN_DISTANCE - MIN_MINERAL_SPAWN_DISTANCE) * pnlRandomReal(&rng)));
+		}
+		real *px = malloc(sizeof(real) * BENCH_QUERIES);
+		real *py = malloc(sizeof(real) * BENCH_QUERIES);
+		for (int q = 0; q < BENCH_QUERIES; q++) {
+			px[q] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_MINERAL_SPAWN_DISTANCE;
+			py[q] = (pnlRandomReal(&rng) - 0.5) * 2 * MAX_MINERAL_SPAWN_DISTANCE;
+		}
+
+		real start = (real)SDL_GetPerformanceCounter();
+		PNLChunkGrid grid = pnlChunkGridCreate(-MAX_MINERAL_SPAWN_DISTANCE, -MAX_MINERAL_SPAWN_DISTANCE, MAX_MINERAL_SPAWN_DISTANCE, MAX_MINERAL_SPAWN_DISTANCE, MINERAL_CHUNK_SIZE);
+		for (int i = 0; i < count; i++)
+			pnlChunkGridInsert(grid, i, x[i], y[i]);
+		real build = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+
+		int linearFound = 0;
+		start = (real)SDL_GetPerformanceCounter();
+		for (int q = 0; q < BENCH_QUERIES; q++)
+			for (int i = 0; i < count; i++)
+				if (juPointDistance(x[i], y[i], px[q], py[q]) < GAME_WIDTH)
+					linearFound++;
+		real linear = (((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency()) / BENCH_QUERIES;
+
+		int gridFound = 0;
+		start = (real)SDL_GetPerformanceCounter();
+		for (int q = 0; q < BENCH_QUERIES; q++) {
+			const int *nearby;
+			int nearbyCount = pnlChunkGridQuery(grid, px[q], py[q], GAME_WIDTH, &nearby);
+			for (int n = 0; n < nearbyCount; n++)
+				if (juPointDistance(x[nearby[n]], y[nearby[n]], px[q], py[q]) < GAME_WIDTH)
+					gridFound++;
+		}
+		real gridTime = (((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency()) / BENCH_QUERIES;
+
+		printf("%8i | %8.3f | %15.2f | %13.2f | %i%s\n", count, build * 1000, linear * 1000000, gridTime * 1000000,
+			   gridFound / BENCH_QUERIES, gridFound == linearFound ? "" : " (MISMATCH)");
+
+		pnlChunkGridFree(grid);
+		free(x);
+		free(y);
+		free(px);
+		free(py);
+	}
+	return 0;
+}
+
+// Sorts a set of timings in seconds and prints their mean, 99th percentile and worst in microseconds
+void pnlPrintLatencies(real *times, int count) {
+	real total = 0;
+	for (int i = 0; i < count; i++)
+		total += times[i];
+	qsort(times, count, sizeof(real), pnlCompareReals);
+	printf("%9.2f | %9.2f | %9.2f", (total / count) * 1000000, times[(int)(count * 0.99)] * 1000000, times[count - 1] * 1000000);
+}
+
+// Times what entering the home world rolls - the shop and planet names against re-rolling until they fit the way
+// they used to be - then all of pnlInitHome - usage: --bench-home [visits]
+int pnlBenchHomeMain(int argc, char **argv) {
+	const real SHOP_MINIMUMS[] = {0.75, 3.5, 5, 6.5};
+	const int SHOP_CASES = sizeof(SHOP_MINIMUMS) / sizeof(real);
+	const int NAME_POOLS[] = {PLANET_NAMES_COUNT, 8, GENERATED_PLANET_COUNT + 1};
+	const int NAME_CASES = sizeof(NAME_POOLS) / sizeof(int);
+	const int REROLL_LIMIT = 100000; // Re-rolling never gives up on its own
+	int visits = argc > 2 && argv[2][0] != '-' ? atoi(argv[2]) : 100000;
+	if (visits <= 0) {
+		printf("Usage: --bench-home [visits], visits has to be at least 1\n");
+		return 1;
+	}
+	real *times = malloc(sizeof(real) * visits);
+	if (times == NULL) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	real shopMinimum = MINIMUM_WEAPON_DAMAGE_PERCENT;
+	PNLWeapon shop[MAX_WEAPONS_AT_RINKYS];
+	PNLRandom rng;
+	pnlRandomSeed(&rng, 1, 0);
+
+	printf("Shop minimum | Method  |   Mean us |    p99 us |    Max us | Mean damage | Worst rolls\n");
+	for (int c = 0; c < SHOP_CASES; c++) {
+		MINIMUM_WEAPON_DAMAGE_PERCENT = SHOP_MINIMUMS[c];
+		for (int method = 0; method < 2; method++) {
+			real damage = 0;
+			int worstRolls = 1;
+			for (int v = 0; v < visits; v++) {
+				real start = (real)SDL_GetPerformanceCounter();
+				real total = 0;
+				if (method == 0) {
+					int rolls = 0;
+					while (total < MINIMUM_WEAPON_DAMAGE_PERCENT && rolls++ < REROLL_LIMIT) {
+						total = 0;
+						for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++) {
+							shop[i] = pnlRollWeapon(&rng, wt_Any);
+							total += (shop[i].weaponDamage - WEAPON_MIN_DAMAGE) / WEAPON_MAX_DAMAGE;
+						}
+					}
+					worstRolls = rolls > worstRolls ? rolls : worstRolls;
+				} else {
+					pnlStockShop(&rng, shop);
+					for (int i = 0; i < MAX_WEAPONS_AT_RINKYS; i++)
+						total += (shop[i].weaponDamage - WEAPON_MIN_DAMAGE) / WEAPON_MAX_DAMAGE;
+				}
+				times[v] = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+				damage += total;
+			}
+			printf("%12.2f | %-7s | ", SHOP_MINIMUMS[c], method == 0 ? "reroll" : "sampled");
+			pnlPrintLatencies(times, visits);
+			if (method == 0)
+				printf(" | %11.3f | %i\n", damage / visits, worstRolls);
+			else
+				printf(" | %11.3f | -\n", damage / visits);
+		}
+	}
+	MINIMUM_WEAPON_DAMAGE_PERCENT = shopMinimum;
+
+	printf("\nName pool | Method  |   Mean us |    p99 us |    Max us\n");
+	for (int c = 0; c < NAME_CASES; c++) {
+		int pool = NAME_POOLS[c];
+		int names[GENERATED_PLANET_COUNT];
+		for (int method = 0; method < 2; method++) {
+			for (int v = 0; v < visits; v++) {
+				real start = (real)SDL_GetPerformanceCounter();
+				if (method == 0) {
+					for (int i = 0; i < GENERATED_PLANET_COUNT; i++) {
+						bool nameTaken = true;
+						while (nameTaken) {
+							names[i] = pnlRandomInt(&rng, pool);
+							nameTaken = false;
+							for (int j = 0; j < i; j++)
+								if (names[i] == names[j])
+									nameTaken = true;
+						}
+					}
+				} else {
+					pnlRandomSample(&rng, pool, GENERATED_PLANET_COUNT, names);
+				}
+				times[v] = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+			}
+			printf("%9i | %-7s | ", pool, method == 0 ? "reroll" : "sampled");
+			pnlPrintLatencies(times, visits);
+			printf("\n");
+		}
+	}
+
+	// The real thing, fame high enough that planets get every difficulty
+	PNLRuntime game = calloc(1, sizeof(struct PNLRuntime));
+	pnlSeedRandom(game, 1);
+	game->headless = true;
+	game->kernels = pnlKernelsGet(km_Auto);
+	game->mineralCount = MAX_MINERALS;
+	pnlInit(game);
+	game->player.fame = FAME_4_STAR_CUTOFF;
+	for (int v = 0; v < visits; v++) {
+		real start = (real)SDL_GetPerformanceCounter();
+		pnlInitHome(game);
+		times[v] = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+		game->musicRequest = mt_None;
+	}
+	printf("\n%-20s |   Mean us |    p99 us |    Max us\n%-20s | ", "", "pnlInitHome");
+	pnlPrintLatencies(times, visits);
+	printf("\n");
+
+	pnlFreeHeadless(game);
+	free(times);
+	return 0;
+}
+
+// Times decoding every asset with different numbers of threads and taking them from the archive, leaving
+// out the parts only the main thread can do - usage: --bench-load
+int pnlBenchLoadMain(int argc, char **argv) {
+	const int THREAD_COUNTS[] = {0, 1, 2, 4, 8};
+	const int BENCH_CASES = sizeof(THREAD_COUNTS) / sizeof(int);
+	const int BENCH_REPEATS = 5;
+
+	printf("Threads | Wall ms | Decode ms | Speedup | Failed\n");
+	real serial = 0;
+	for (int c = 0; c < BENCH_CASES; c++) {
+		real wall = 0, decode = 0;
+		int failed = 0;
+		for (int r = 0; r < BENCH_REPEATS; r++) {
+			real start = (real)SDL_GetPerformanceCounter();
+			PNLAssetLoader loader = pnlAssetLoaderCreate(ASSETS, ASSET_COUNT, THREAD_COUNTS[c], NULL);
+			while (SDL_AtomicGet(&loader->decoded) < loader->count)
+				SDL_Delay(0);
+			wall += ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+			failed = 0;
+			for (int i = 0; i < loader->count; i++) {
+				decode += loader->assets[i].decodeTime;
+				failed += SDL_AtomicGet(&loader->assets[i].state) == as_Failed;
+			}
+			pnlAssetLoaderFree(loader);
+		}
+		wall /= BENCH_REPEATS;
+		decode /= BENCH_REPEATS;
+		if (c == 0)
+			serial = wall;
+		printf("%7i | %7.2f | %9.2f | %6.2fx | %i\n", THREAD_COUNTS[c], wall * 1000, decode * 1000, serial / wall, failed);
+	}
+
+	// Everything the renderer would read has to be paged in, so the archive run touches every page of every image
+	PNLAssetArchive archive = pnlAssetArchiveOpen(ASSET_ARCHIVE);
+	if (archive == NULL) {
+		printf("No archive at \"%s\", make one with --pack-assets\n", ASSET_ARCHIVE);
+		return 0;
+	}
+	pnlAssetArchiveClose(archive);
+	real wall = 0;
+	unsigned long checksum = 0;
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		real start = (real)SDL_GetPerformanceCounter();
+		archive = pnlAssetArchiveOpen(ASSET_ARCHIVE);
+		PNLAssetLoader loader = pnlAssetLoaderCreate(ASSETS, ASSET_COUNT, 0, archive);
+		for (int i = 0; i < loader->count; i++) {
+			PNLAsset *asset = &loader->assets[i];
+			if (asset->pixels != NULL)
+				for (long b = 0; b < (long)asset->width * asset->height * 4; b += 4096)
+					checksum += asset->pixels[b];
+		}
+		wall += ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+		pnlAssetLoaderFree(loader);
+		pnlAssetArchiveClose(archive);
+	}
+	printf("%7s | %7.2f | (fonts are still read from their files, checksum %lu)\n", "archive", (wall / BENCH_REPEATS) * 1000, checksum % 1000);
+	return 0;
+}
+
+// Streams the music faster than real time, crossfading between tracks - usage: --bench-music [seconds]
+int pnlBenchMusicMain(int argc, char **argv) {
+	const real SWITCH_EVERY = 10; // Seconds between crossfades
+	real seconds = argc > 2 && argv[2][0] != '-' ? strtod(argv[2], NULL) : 120;
+	long frames = (long)(seconds * PNL_MUSIC_RATE);
+
+	// Tracks that aren't there would just be silence
+	MusicTrack tracks[mt_MAX];
+	int trackCount = 0;
+	long whole = 0;
+	for (int i = mt_None + 1; i < mt_MAX; i++) {
+		FILE *file = fopen(MUSIC_TRACKS[i], "rb");
+		if (file != NULL) {
+			fseek(file, 0, SEEK_END);
+			whole += ftell(file);
+			tracks[trackCount++] = i;
+			fclose(file);
+		}
+	}
+	if (trackCount == 0) {
+		printf("None of the music is there to stream\n");
+		return 1;
+	}
+	printf("%i of %i tracks found, %.1fKiB resident if they were loaded whole\n", trackCount, mt_MAX - 1, whole / 1024.0);
+
+	PNLAssetArchive archive = pnlAssetArchiveOpen(ASSET_ARCHIVE);
+	int16_t *out = malloc(sizeof(int16_t) * 2 * PNL_MUSIC_DEVICE_FRAMES);
+	printf(" Source | Wall ms | Realtime | Peak resident KiB\n");
+	for (int source = 0; source < (archive != NULL ? 2 : 1); source++) {
+		PNLMusicStream stream = pnlMusicStreamCreate(source == 1 ? archive : NULL, false);
+		size_t peak = 0;
+		int track = 0;
+		long nextSwitch = 0;
+		real start = (real)SDL_GetPerformanceCounter();
+		for (long f = 0; f < frames; f += PNL_MUSIC_DEVICE_FRAMES) {
+			if (f >= nextSwitch) {
+				pnlMusicStreamPlay(stream, MUSIC_TRACKS[tracks[track++ % trackCount]], true, f > 0 ? MUSIC_CROSSFADE : 0, VOLUME_MUSIC_LEFT, VOLUME_MUSIC_RIGHT);
+				nextSwitch += (long)(SWITCH_EVERY * PNL_MUSIC_RATE);
+			}
+			pnlMusicStreamRead(stream, out, PNL_MUSIC_DEVICE_FRAMES);
+			size_t memory = pnlMusicStreamMemory(stream);
+			peak = memory > peak ? memory : peak;
+		}
+		real wall = ((real)SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+		printf("%7s | %7.2f | %7.0fx | %.1f\n", source == 1 ? "archive" : "files", wall * 1000, seconds / wall, peak / 1024.0);
+		pnlMusicStreamFree(stream);
+	}
+	free(out);
+	pnlAssetArchiveClose(archive);
+	return 0;
+}
+
+// Mixes a drawn out firefight faster than real time, once with every sound getting its own voice and
+// then through the real pool on each kernel - usage: --bench-mixer [seconds]
+int pnlBenchMixerMain(int argc, char **argv) {
+	const char *PATHS[se_MAX] = {"assets/pistol.wav", "assets/shotgun.wav", "assets/assaultrifle.wav", "assets/sniper.wav", "assets/sword.wav", "assets/hit.wav",
+								 "assets/newgun.wav", "assets/heavy.wav", "assets/whatisawenrad.wav", "assets/justdontgethit.wav", "assets/dontturnmypizzainsideout.wav"};
+	const int UNBOUNDED_VOICES = 1024;
+	const int FRAMES_PER_TICK = PNL_SOUND_RATE / 60;
+	real seconds = argc > 2 && argv[2][0] != '-' ? strtod(argv[2], NULL) : 60;
+	int ticks = (int)(seconds * 60);
+
+	PNLSound sounds[se_MAX];
+	for (int i = 0; i < se_MAX; i++) {
+		sounds[i] = pnlSoundLoad(PATHS[i]);
+		if (sounds[i] == NULL) {
+			printf("Couldn't load \"%s\"\n", PATHS[i]);
+			for (int j = 0; j < i; j++)
+				pnlSoundFree(sounds[j]);
+			return 1;
+		}
+	}
+
+	// Same fight every run: an assault rifle, a shotgun and a sniper going at once with enemies getting hit constantly
+	const PNLKernelMode MODES[] = {km_Scalar, km_Scalar, km_SSE2, km_AVX};
+	int16_t *out = malloc(sizeof(int16_t) * 2 * FRAMES_PER_TICK);
+	printf("  Voices | Kernels | Avg voices | Peak | Stolen | Dropped | Realtime | Mix %% of a core | Worst callback us\n");
+	for (int m = 0; m < 4; m++) {
+		const PNLKernels *kernels = pnlKernelsGet(MODES[m]);
+		if (kernels->mode != MODES[m])
+			continue;
+		bool bounded = m > 0;
+		PNLSoundPool pool = pnlSoundPoolCreate(bounded ? SOUND_VOICES : UNBOUNDED_VOICES, kernels, false);
+		PNLRandom rng;
+		pnlRandomSeed(&rng, 1, 0);
+		double voices = 0;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int tick = 0; tick < ticks; tick++) {
+			SoundEffect plays[16];
+			int count = 0;
+			if (tick % 6 == 0)
+				plays[count++] = se_AssaultRifle;
+			if (tick % 40 == 0)
+				plays[count++] = se_Shotgun;
+			if (tick % 90 == 0)
+				plays[count++] = se_Sniper;
+			for (int hits = pnlRandomInt(&rng, 5); hits > 0; hits--)
+				plays[count++] = se_Hit;
+			if (tick % 600 == 0)
+				plays[count++] = se_HeavyDrum;
+			for (int i = 0; i < count; i++)
+				pnlSoundPoolPlay(pool, sounds[plays[i]], bounded ? SOUND_PRIORITIES[plays[i]] : 0, bounded ? SOUND_LIMITS[plays[i]] : 0, VOLUME_EFFECT_LEFT, VOLUME_EFFECT_RIGHT);
+			pnlSoundPoolMix(pool, out, FRAMES_PER_TICK);
+			voices += SDL_AtomicGet(&pool->active);
+		}
+		real wall = (real)(SDL_GetPerformanceCounter() - start) / (real)SDL_GetPerformanceFrequency();
+		PNLSoundPoolStats stats;
+		pnlSoundPoolGetStats(pool, &stats);
+		printf("%8i | %7s | %10.1f | %4i | %6i | %7i | %7.0fx | %15.3f | %17.2f\n", pool->voiceCount, kernels->name, voices / ticks, stats.peak, stats.stolen,
+			   stats.dropped, stats.audioTime / wall, (stats.mixTime / stats.audioTime) * 100, stats.mixTimeMax * 1000000);
+		pnlSoundPoolFree(pool);
+	}
+	free(out);
+	for (int i = 0; i < se_MAX; i++)
+		pnlSoundFree(sounds[i]);
+	return 0;
+}
+
+// Copies a file as it is right now, false if it couldn't (a file that isn't there copies as nothing)
+bool pnlCopyFile(const char *from, const char *to) {
+	remove(to);
+	FILE *in = fopen(from, "rb");
+	if (in == NULL)
+		return true;
+	FILE *out = fopen(to, "wb");
+	char buffer[4096];
+	size_t size;
+	bool ok = out != NULL;
+	while (ok && (size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		ok = fwrite(buffer, 1, size, out) == size;
+	fclose(in);
+	if (out != NULL)
+		fclose(out);
+	return ok;
+}
+
+// Times sets against the save store with and without waiting for the disk, then pulls the files out from
+// under it mid-run with half a record on the end and makes sure everything comes back - usage: --bench-save [sets]
+int pnlBenchSaveMain(int argc, char **argv) {
+	const char *FILE_NAME = "bench.pnls";
+	const char *CRASH_NAME = "bench-crash.pnls";
+	const char *FILES[] = {"bench.pnls", "bench.pnls.journal", "bench.pnls.tmp", "bench-crash.pnls", "bench-crash.pnls.journal"};
+	const int FILE_COUNT = 5;
+	const char *KEYS[] = {"hs", "dosh", "kills", "planet", "diff"};
+	int sets = argc > 2 && argv[2][0] != '-' ? atoi(argv[2]) : 2000;
+	for (int i = 0; i < FILE_COUNT; i++)
+		remove(FILES[i]);
+
+	// Asynchronous is how the game uses it, synchronous is what a death would cost if it waited for the disk
+	printf("        Mode |  Sets | Avg set us | Worst set us | Wall ms | Compactions | Failures\n");
+	for (int sync = 0; sync < 2; sync++) {
+		PNLSaveStore store = pnlSaveStoreOpen(FILE_NAME);
+		if (store == NULL) {
+			printf("Couldn't open \"%s\"\n", FILE_NAME);
+			return 1;
+		}
+		Uint64 start = SDL_GetPerformanceCounter();
+		double worst = 0;
+		for (int i = 0; i < sets; i++) {
+			Uint64 setStart = SDL_GetPerformanceCounter();
+			if (i % 5 >= 3)
+				pnlSaveStoreSetString(store, KEYS[i % 5], PLANET_NAMES[i % PLANET_NAMES_COUNT]);
+			else
+				pnlSaveStoreSetDouble(store, KEYS[i % 5], i * 1.5);
+			if (sync)
+				pnlSaveStoreFlush(store);
+			double time = (double)(SDL_GetPerformanceCounter() - setStart) / SDL_GetPerformanceFrequency();
+			worst = time > worst ? time : worst;
+		}
+		double setTime = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		pnlSaveStoreFlush(store);
+		double wall = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		PNLSaveStoreStats stats;
+		pnlSaveStoreGetStats(store, &stats);
+		printf("%12s | %5i | %10.2f | %12.2f | %7.1f | %11i | %i\n", sync ? "synchronous" : "asynchronous", sets, (setTime / sets) * 1000000, worst * 1000000,
+			   wall * 1000, stats.compactions, stats.failures);
+		pnlSaveStoreClose(store);
+	}
+
+	// Whatever is on disk after a flush is what a crash right then would leave behind, cut the last record in half too
+	PNLSaveStore store = pnlSaveStoreOpen(FILE_NAME);
+	for (int i = 0; i < 5; i++) {
+		if (i >= 3)
+			pnlSaveStoreSetString(store, KEYS[i], "crash");
+		else
+			pnlSaveStoreSetDouble(store, KEYS[i], 1000 + i);
+	}
+	pnlSaveStoreFlush(store);
+	bool ok = pnlCopyFile(FILE_NAME, CRASH_NAME) && pnlCopyFile("bench.pnls.journal", "bench-crash.pnls.journal");
+	FILE *journal = fopen("bench-crash.pnls.journal", "ab");
+	if (journal != NULL) {
+		const unsigned char torn[] = {20, 0, 0, 0, 1, 2, 3, 4, 0, 2, 'h'};
+		fwrite(torn, 1, sizeof(torn), journal);
+		fclose(journal);
+	}
+	pnlSaveStoreClose(store);
+
+	PNLSaveStore recovered = pnlSaveStoreOpen(CRASH_NAME);
+	for (int i = 0; i < 5 && ok && recovered != NULL; i++) {
+		if (i >= 3)
+			ok = strcmp(pnlSaveStoreGetString(recovered, KEYS[i]), "crash") == 0;
+		else
+			ok = pnlSaveStoreGetDouble(recovered, KEYS[i]) == 1000 + i;
+	}
+
+	// And it keeps working after, anything appended lands after the torn record was dropped
+	if (ok && recovered != NULL) {
+		pnlSaveStoreSetDouble(recovered, "after", 42);
+		pnlSaveStoreFlush(recovered);
+		pnlCopyFile(CRASH_NAME, FILE_NAME);
+		pnlCopyFile("bench-crash.pnls.journal", "bench.pnls.journal");
+		PNLSaveStore again = pnlSaveStoreOpen(FILE_NAME);
+		ok = again != NULL && pnlSaveStoreGetDouble(again, "after") == 42 && pnlSaveStoreGetDouble(again, "hs") == 1000;
+		pnlSaveStoreClose(again);
+	}
+	ok = ok && recovered != NULL;
+	pnlSaveStoreClose(recovered);
+	printf("Crash recovery: %s\n", ok ? "everything flushed came back" : "LOST DATA");
+	for (int i = 0; i < FILE_COUNT; i++)
+		remove(FILES[i]);
+	return ok ? 0 : 1;
+}
+
+// Times snapshotting a planet mid-fight and restoring it over another game, then plays both on to make
+// sure the restored one can't be told apart from the original - usage: --bench-snapshot [ticks] [seed]
+int pnlBenchSnapshotMain(int argc, char **argv) {
+	const int REPEATS = 200;
+	const int CONTINUE_TICKS = 5000; // Both games play this long after the restore and have to end up the same
+	int ticks = argc > 2 && argv[2][0] != '-' ? atoi(argv[2]) : 20000;
+	uint64_t seed = argc > 3 && argv[3][0] != '-' ? strtoull(argv[3], NULL, 10) : 1;
+
+	// The copy starts from another seed so anything the restore misses shows up
+	PNLRuntime games[2];
+	for (int i = 0; i < 2; i++) {
+		games[i] = calloc(1, sizeof(struct PNLRuntime));
+		pnlSeedRandom(games[i], seed + i);
+		games[i]->headless = true;
+		games[i]->kernels = pnlKernelsGet(km_Auto);
+		games[i]->mineralCount = MAX_MINERALS;
+		pnlInit(games[i]);
+	}
+	PNLRuntime game = games[0];
+	PNLRuntime copy = games[1];
+	int tick = 0;
+	while (tick < ticks || !game->onSite)
+		pnlHeadlessTick(game, tick++);
+
+	PNLSnapshot snapshot = pnlSnapshotCreate(SNAPSHOT_VERSION);
+	PNLSnapshot check = pnlSnapshotCreate(SNAPSHOT_VERSION);
+	if (snapshot == NULL || check == NULL) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	size_t size;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int r = 0; r < REPEATS; r++) {
+		pnlWriteSnapshot(game, snapshot);
+		pnlSnapshotBytes(snapshot, &size);
+	}
+	real writeTime = ((real)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency()) / REPEATS;
+	const void *bytes = pnlSnapshotBytes(snapshot, &size);
+
+	bool restored = true;
+	start = SDL_GetPerformanceCounter();
+	for (int r = 0; r < REPEATS; r++) {
+		PNLSnapshot reading = pnlSnapshotOpen(bytes, size);
+		restored = reading != NULL && pnlRestoreSnapshot(copy, reading) && restored;
+		pnlSnapshotFree(reading);
+	}
+	real restoreTime = ((real)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency()) / REPEATS;
+
+	// Written back out it has to be the same bytes, and the same again after both games play on
+	size_t checkSize;
+	pnlWriteSnapshot(copy, check);
+	const void *checkBytes = pnlSnapshotBytes(check, &checkSize);
+	bool roundTrip = restored && checkSize == size && memcmp(bytes, checkBytes, size) == 0;
+	for (int i = 0; i < CONTINUE_TICKS; i++) {
+		pnlHeadlessTick(game, tick + i);
+		pnlHeadlessTick(copy, tick + i);
+	}
+	pnlWriteSnapshot(game, snapshot);
+	pnlWriteSnapshot(copy, check);
+	bytes = pnlSnapshotBytes(snapshot, &size);
+	checkBytes = pnlSnapshotBytes(check, &checkSize);
+	bool playsOn = roundTrip && checkSize == size && memcmp(bytes, checkBytes, size) == 0;
+
+	printf("Planet after %i ticks: %i/%i enemies, %i minerals (%i on the ground), %i bullets\n", tick, game->planet.enemies.count,
+		   game->planet.enemies.capacity, game->planet.minerals.count, game->planet.minerals.grid->count, game->bullets.pool->liveCount);
+	printf("Snapshot: %.1fKiB, %.3fms to write, %.3fms to check and restore\n", size / 1024.0, writeTime * 1000, restoreTime * 1000);
+	printf("Round trip: %s\n", roundTrip ? "same bytes back out" : "DIFFERENT");
+	printf("%i more ticks: %s\n", CONTINUE_TICKS, playsOn ? "both games still identical" : "DIVERGED");
+	pnlSnapshotFree(snapshot);
+	pnlSnapshotFree(check);
+	pnlFreeHeadless(game);
+	pnlFreeHeadless(copy);
+	return playsOn ? 0 : 1;
+}
+
+// Bakes every asset in ASSETS into one archive - usage: --pack-assets [archive]
+int pnlPackAssetsMain(int argc, char **argv) {
+	const char *filename = argc > 2 && argv[2][0] != '-' ? argv[2] : ASSET_ARCHIVE;
+	int count = ASSET_COUNT + mt_MAX - 1;
+	const char **paths = malloc(sizeof(const char*) * count);
+	PNLPackHint *hints = calloc(count, sizeof(PNLPackHint));
+	for (int i = 0; i < ASSET_COUNT; i++) {
+		paths[i] = ASSETS[i].path;
+		hints[i] = ASSETS[i].w != 0 ? ph_Atlas : ph_None; // Sprites are always drawn by region
+		for (int j = 0; j < ATLAS_TEXTURE_COUNT && hints[i] == ph_None; j++)
+			hints[i] = strcmp(ASSETS[i].path, ATLAS_TEXTURES[j]) == 0 ? ph_Atlas : ph_None;
+	}
+	for (int i = mt_None + 1; i < mt_MAX; i++) {
+		paths[ASSET_COUNT + i - 1] = MUSIC_TRACKS[i];
+		hints[ASSET_COUNT + i - 1] = ph_Stream;
+	}
+	bool ok = pnlAssetArchivePack(filename, paths, hints, count);
+	free(paths);
+	free(hints);
+	if (!ok) {
+		printf("Couldn't write \"%s\"\n", filename);
+		return 1;
+	}
+
+	PNLAssetArchive archive = pnlAssetArchiveOpen(filename);
+	if (archive == NULL) {
+		printf("Wrote \"%s\" but it doesn't open\n", filename);
+		return 1;
+	}
+	printf("Packed %i assets into %u entries in \"%s\", %.1fKiB\n", count, archive->header->count, filename, archive->size / 1024.0);
+	pnlAssetArchiveClose(archive);
+	return 0;
+}
+
 /********************** main lmao **********************/
-int main() {
+int main(int argc, char **argv) {
+	if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+		return pnlHeadlessMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--balance") == 0)
+		return pnlBalanceMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--weapons") == 0)
+		return pnlWeaponsMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-collision") == 0)
+		return pnlBenchCollisionMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-kernels") == 0)
+		return pnlBenchKernelsMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-minerals") == 0)
+		return pnlBenchMineralsMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-home") == 0)
+		return pnlBenchHomeMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-load") == 0)
+		return pnlBenchLoadMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-music") == 0)
+		return pnlBenchMusicMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-mixer") == 0)
+		return pnlBenchMixerMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-save") == 0)
+		return pnlBenchSaveMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--bench-snapshot") == 0)
+		return pnlBenchSnapshotMain(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--pack-assets") == 0)
+		return pnlPackAssetsMain(argc, argv);
+
 	// Init TODO: Make resizeable
 	SDL_Window *window = SDL_CreateWindow(GAME_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, GAME_WIDTH * WINDOW_SCALE, GAME_HEIGHT * WINDOW_SCALE, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
 	VK2DRendererConfig config = {
@@ -1676,7 +4489,6 @@ int main() {
 	juInit(window);
 	bool running = true;
 	SDL_Event e;
-	srand(time(NULL));
 	SDL_ShowCursor(0);
 
 	SDL_Surface *icon = SDL_LoadBMP("assets/icon.bmp");
@@ -1692,59 +4504,177 @@ int main() {
 	lh = h;
 	vk2dRendererSetTextureCamera(true);
 
-	// Show loading screen before loading assets
+	// The profiler is always recording when it's built in so F9 can dump whatever just happened
+#ifdef PNL_PROFILER
+	pnlProfilerStart(GAME_TITLE);
+	pnlProfilerNameThread("main");
+#endif
+	const char *profileFile = pnlFindArg(argc, argv, "--profile");
+	const char *profileSecondsArg = pnlFindArg(argc, argv, "--profile-seconds");
+	real profileSeconds = profileSecondsArg != NULL ? atof(profileSecondsArg) : PROFILE_SECONDS;
+
+	// Assets are decoded on every core while the loading screen shows how far along they are
+	const char *loadThreads = pnlFindArg(argc, argv, "--load-threads");
+	PNLAssetArchive archive = pnlAssetArchiveOpen(ASSET_ARCHIVE);
+	PNLAssetLoader loader = pnlAssetLoaderCreate(ASSETS, ASSET_COUNT, loadThreads != NULL ? atoi(loadThreads) : SDL_GetCPUCount(), archive);
 	VK2DTexture texLoading = vk2dTextureLoad("assets/loading.png");
-	vk2dRendererStartFrame(VK2D_BLACK);
-	vk2dDrawTextureExt(texLoading, 0, 0, WINDOW_SCALE, WINDOW_SCALE, 0, 0, 0);
-	vk2dRendererEndFrame();
+	while (!pnlAssetLoaderUpdate(loader, LOADING_FRAME_BUDGET)) {
+		while (SDL_PollEvent(&e))
+			if (e.type == SDL_QUIT)
+				running = false; // Loading still finishes so everything can be freed the normal way
+		vk2dRendererStartFrame(VK2D_BLACK);
+		vk2dDrawTextureExt(texLoading, 0, 0, WINDOW_SCALE, WINDOW_SCALE, 0, 0, 0);
+		vk2dRendererSetColourMod(VK2D_WHITE);
+		vk2dDrawRectangle(20 * WINDOW_SCALE, (GAME_HEIGHT - 20) * WINDOW_SCALE, (GAME_WIDTH - 40) * WINDOW_SCALE * pnlAssetLoaderProgress(loader), 4 * WINDOW_SCALE);
+		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		vk2dRendererEndFrame();
+	}
 	vk2dRendererWait();
 	vk2dTextureFree(texLoading);
+	const char *loadReport = pnlFindArg(argc, argv, "--load-report");
+	FILE *reportFile = loadReport != NULL ? fopen(loadReport, "w") : NULL;
+	if (reportFile != NULL) {
+		pnlAssetLoaderReport(loader, reportFile);
+		fclose(reportFile);
+	}
+	printf("Loaded %i assets in %.1fms%s\n", loader->count, loader->loadTime * 1000, archive != NULL ? " from the archive" : "");
 
 	// Game
 	PNLRuntime game = calloc(1, sizeof(struct PNLRuntime));
-	game->save = juSaveLoad(SAVE_FILE);
-	game->loader = juLoaderCreate(ASSETS, ASSET_COUNT);
+	game->backbuffer = backbuffer;
+	game->save = pnlSaveStoreOpen(SAVE_FILE);
+	if (game->save != NULL)
+		pnlImportLegacySave(game);
+	game->loader = loader;
+	game->archive = archive;
+	game->music = pnlMusicStreamCreate(archive, true);
+	if (game->music == NULL)
+		printf("Couldn't open an audio device for music, %s\n", SDL_GetError());
 	game->ww = w;
 	game->wh = h;
+	game->kernels = pnlKernelsGet(pnlKernelModeFromArgs(argc, argv));
+	game->sounds = pnlSoundPoolCreate(SOUND_VOICES, game->kernels, true);
+	if (game->sounds == NULL)
+		printf("Couldn't open an audio device for sound effects, %s\n", SDL_GetError());
+	const char *seed = pnlFindArg(argc, argv, "--seed");
+	pnlSeedRandom(game, seed != NULL ? strtoull(seed, NULL, 10) : (uint64_t)time(NULL));
+
+	// Input recording/playback, a replay brings its own seed
+	const char *recordFile = pnlFindArg(argc, argv, "--record");
+	const char *replayFile = pnlFindArg(argc, argv, "--replay");
+	PNLReplay replay = NULL;
+	if (replayFile != NULL) {
+		replay = pnlReplayOpen(replayFile);
+		if (replay != NULL)
+			pnlSeedRandom(game, replay->seed);
+		else
+			printf("Couldn't open replay \"%s\"\n", replayFile);
+	} else if (recordFile != NULL) {
+		replay = pnlReplayRecord(recordFile, game->seed);
+		if (replay == NULL)
+			printf("Couldn't record to \"%s\"\n", recordFile);
+	}
+	bool playing = replay != NULL && !replay->recording;
+	PNLReplayFrame replayFrame;
 	pnlInit(game);
 
-	real time = (real)SDL_GetPerformanceCounter();
+	// Pick up where the last run was left unless it's a replay, which has to start from scratch
+	bool suspendable = replay == NULL;
+	if (suspendable && !pnlHasArg(argc, argv, "--new-game")) {
+		PNLSnapshot suspended = pnlSnapshotLoad(SNAPSHOT_FILE);
+		if (suspended != NULL && pnlRestoreSnapshot(game, suspended))
+			printf("Resumed the run in \"%s\"\n", SNAPSHOT_FILE);
+		else if (suspended != NULL)
+			printf("Couldn't resume \"%s\", starting a new run\n", SNAPSHOT_FILE);
+		pnlSnapshotFree(suspended);
+	}
+
+	SDL_DisplayMode mode;
+	bool knownRefresh = SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0;
+	PNLFramePacer pacer = pnlFramePacerCreate(knownRefresh ? mode.refresh_rate : MAX_FRAMERATE);
+	real accumulator = 0; // Time the simulation is behind the renderer
+	PNLInput tickInput = {0};
 
 	while (running) {
+		PNL_PROFILE_BEGIN("Frame");
 		juUpdate();
 		while (SDL_PollEvent(&e))
 			if (e.type == SDL_QUIT)
 				running = false;
+		if (playing && !pnlReplayRead(replay, &replayFrame))
+			running = false;
 
 		if (running) {
 			// Update window interface stuff for the game
 			lw = w;
 			lh = h;
 			int mx, my;
-			lastState = state;
 			SDL_GetWindowSize(window, &w, &h);
+			PNLInput *input = &game->input;
+			lastState = state;
 			state = SDL_GetMouseState(&mx, &my);
-			game->mouseLHeld = state & SDL_BUTTON(SDL_BUTTON_LEFT);
-			game->mouseLPressed = (state & SDL_BUTTON(SDL_BUTTON_LEFT)) && !(lastState & SDL_BUTTON(SDL_BUTTON_LEFT));
-			game->mouseLReleased = !(state & SDL_BUTTON(SDL_BUTTON_LEFT)) && (lastState & SDL_BUTTON(SDL_BUTTON_LEFT));
-			game->mouseRHeld = state & SDL_BUTTON(SDL_BUTTON_RIGHT);
-			game->mouseRPressed = (state & SDL_BUTTON(SDL_BUTTON_RIGHT)) && !(lastState & SDL_BUTTON(SDL_BUTTON_RIGHT));
-			game->mouseRReleased = !(state & SDL_BUTTON(SDL_BUTTON_RIGHT)) && (lastState & SDL_BUTTON(SDL_BUTTON_RIGHT));
-			game->mouseMHeld = state & SDL_BUTTON(SDL_BUTTON_MIDDLE);
-			game->mouseMPressed = (state & SDL_BUTTON(SDL_BUTTON_MIDDLE)) && !(lastState & SDL_BUTTON(SDL_BUTTON_MIDDLE));
-			game->mouseMReleased = !(state & SDL_BUTTON(SDL_BUTTON_MIDDLE)) && (lastState & SDL_BUTTON(SDL_BUTTON_MIDDLE));
+			input->mouseLHeld = state & SDL_BUTTON(SDL_BUTTON_LEFT);
+			input->mouseLPressed = (state & SDL_BUTTON(SDL_BUTTON_LEFT)) && !(lastState & SDL_BUTTON(SDL_BUTTON_LEFT));
+			input->mouseLReleased = !(state & SDL_BUTTON(SDL_BUTTON_LEFT)) && (lastState & SDL_BUTTON(SDL_BUTTON_LEFT));
+			input->mouseRHeld = state & SDL_BUTTON(SDL_BUTTON_RIGHT);
+			input->mouseRPressed = (state & SDL_BUTTON(SDL_BUTTON_RIGHT)) && !(lastState & SDL_BUTTON(SDL_BUTTON_RIGHT));
+			input->mouseRReleased = !(state & SDL_BUTTON(SDL_BUTTON_RIGHT)) && (lastState & SDL_BUTTON(SDL_BUTTON_RIGHT));
+			input->mouseMHeld = state & SDL_BUTTON(SDL_BUTTON_MIDDLE);
+			input->mouseMPressed = (state & SDL_BUTTON(SDL_BUTTON_MIDDLE)) && !(lastState & SDL_BUTTON(SDL_BUTTON_MIDDLE));
+			input->mouseMReleased = !(state & SDL_BUTTON(SDL_BUTTON_MIDDLE)) && (lastState & SDL_BUTTON(SDL_BUTTON_MIDDLE));
+			input->keyUp = juKeyboardGetKey(SDL_SCANCODE_W);
+			input->keyDown = juKeyboardGetKey(SDL_SCANCODE_S);
+			input->keyLeft = juKeyboardGetKey(SDL_SCANCODE_A);
+			input->keyRight = juKeyboardGetKey(SDL_SCANCODE_D);
+			input->keyRespawn = juKeyboardGetKeyPressed(SDL_SCANCODE_SPACE);
+			input->keyDebugLeave = juKeyboardGetKey(SDL_SCANCODE_BACKSPACE);
+			if (juKeyboardGetKeyPressed(SDL_SCANCODE_F9)) {
+				char filename[64];
+				time_t now = time(NULL);
+				strftime(filename, sizeof(filename), "profile-%Y%m%d-%H%M%S.json", localtime(&now));
+				pnlDumpProfile(filename, profileSeconds);
+			}
+			game->frameDelta = (float)juDelta(); // Float so recording it loses nothing
+			if (playing)
+				pnlUnpackInput(game, &replayFrame);
 
 			// Update game
 			pnlPreFrame(game);
 			VK2DCamera cam = vk2dRendererGetCamera();
-			game->mouseX = (mx / (w / GAME_WIDTH)) + cam.x;
-			game->mouseY = (my / (h / GAME_HEIGHT)) + cam.y;
+			input->mouseX = (mx / (w / GAME_WIDTH)) + cam.x;
+			input->mouseY = (my / (h / GAME_HEIGHT)) + cam.y;
+			input->viewX = cam.x;
+			input->viewY = cam.y;
+			if (playing) {
+				input->mouseX = replayFrame.mouseX;
+				input->mouseY = replayFrame.mouseY;
+			} else if (replay != NULL) {
+				PNLReplayFrame frame = pnlPackInput(game);
+				pnlReplayWrite(replay, &frame);
+			}
+
+			// Run as many fixed ticks as the last frame took, whatever is left over is drawn interpolated
+			pnlAccumulateInput(&tickInput, input);
+			accumulator += game->frameDelta > MAX_FRAME_TIME ? MAX_FRAME_TIME : game->frameDelta;
+			while (accumulator >= 1.0 / SIM_TICK_RATE) {
+				pnlSimTick(game, 1.0 / SIM_TICK_RATE, &tickInput);
+				pnlConsumeInput(&tickInput);
+				accumulator -= 1.0 / SIM_TICK_RATE;
+			}
+			game->interpolation = accumulator * SIM_TICK_RATE;
+			PNL_PROFILE_BEGIN("vk2dRendererStartFrame");
 			vk2dRendererStartFrame(VK2D_BLACK);
+			PNL_PROFILE_END();
 			vk2dRendererSetViewport(0, 0, GAME_WIDTH, GAME_HEIGHT);
 			vk2dRendererSetTarget(backbuffer);
 			vk2dRendererClear();
-			game->time += juDelta();
-			pnlUpdate(game);
+#ifdef PNL_PROFILER
+			long sprites = game->batch->stats.instances;
+#endif
+			pnlDraw(game);
+			PNL_PROFILE_COUNTER("batched sprites", game->batch->stats.instances - sprites); // Terminals and UI are still drawn immediately
+			pnlSpriteBatchEndFrame(game->batch);
+			pnlTextCacheEndFrame(game->text);
 			vk2dRendererSetTarget(VK2D_TARGET_SCREEN);
 			vk2dRendererSetViewport(0, 0, w, h);
 			cam = vk2dRendererGetCamera();
@@ -1759,26 +4689,91 @@ int main() {
 			float finalYScale = (GAME_HEIGHT - spaceY) / GAME_HEIGHT;
 
 			vk2dDrawTextureExt(backbuffer, cam.x + (spaceX / 2), cam.y + (spaceY / 2), finalXScale, finalYScale, 0, 0, 0);
+			PNL_PROFILE_BEGIN("vk2dRendererEndFrame");
 			vk2dRendererEndFrame();
-
-			volatile int i;
-			while (((real)SDL_GetPerformanceCounter() - time) / (real)SDL_GetPerformanceFrequency() < 1.0f / TARGET_FRAMERATE) {
-				i = 0;// lol no
-			}
-			time = (real)SDL_GetPerformanceCounter();
+			PNL_PROFILE_END();
+			pnlFlushAudio(game);
+			pnlProfileCounters(game);
+			PNL_PROFILE_COUNTER("sound voices", game->sounds != NULL ? SDL_AtomicGet(&game->sounds->active) : 0);
+			PNL_PROFILE_BEGIN("pnlFramePacerWait");
+			pnlFramePacerWait(pacer);
+			PNL_PROFILE_END();
 		}
+		PNL_PROFILE_END();
+	}
+
+	PNLFrameStats stats;
+	pnlFramePacerGetStats(pacer, &stats);
+	printf("%i frames, frame time %.2fms avg (%.2fms - %.2fms), std dev %.3fms, scheduler jitter %.3fms\n", stats.frames, stats.mean * 1000, stats.min * 1000, stats.max * 1000, sqrt(stats.variance) * 1000, stats.jitter * 1000);
+	pnlFramePacerFree(pacer);
+	printf("Bullet pool: %i high water, %i capacity in %i chunks\n", game->bullets.pool->highWater, game->bullets.pool->capacity, game->bullets.pool->growths);
+	PNLSpriteBatchStats batchStats = game->batch->stats;
+	real frames = batchStats.frames > 0 ? batchStats.frames : 1;
+	printf("Sprite batch per frame: %.1f draws with %.1f texture switches and %.1f colour changes (unsorted: %.1f texture switches, immediate mode: %.1f colour changes)\n",
+		   batchStats.draws / frames, batchStats.textureSwitches / frames, batchStats.stateChanges / frames, batchStats.immediateTextureSwitches / frames, batchStats.immediateStateChanges / frames);
+	PNLTextCacheStats textStats = game->text->total;
+	printf("Text cache: %.1f strings per frame, %.1f%% hit rate, %.2fus formatting and %.2fus laying out per frame\n", textStats.draws / frames,
+		   textStats.draws > 0 ? ((real)textStats.hits / textStats.draws) * 100 : 0, (textStats.formatTime / frames) * 1000000, (textStats.layoutTime / frames) * 1000000);
+	printf("Terminals: %i frames shown, %i redrawn\n", game->terminalFrames, game->terminalRedraws);
+	if (replay != NULL)
+		printf("Replay: %i frames %s, %li bytes (%.1f bytes per frame), seed %llu\n", replay->frames, replay->recording ? "recorded" : "played",
+			   replay->bytes, replay->frames > 0 ? (real)replay->bytes / replay->frames : 0, (unsigned long long)replay->seed);
+	pnlReplayClose(replay);
+	if (game->music != NULL)
+		printf("Music: %.1fKiB resident while streaming, %i underruns\n", pnlMusicStreamMemory(game->music) / 1024.0, SDL_AtomicGet(&game->music->underruns));
+	if (game->sounds != NULL) {
+		PNLSoundPoolStats soundStats;
+		pnlSoundPoolGetStats(game->sounds, &soundStats);
+		printf("Sounds: %i started, %i stolen, %i dropped, peak %i of %i voices, mixing took %.3f%% of a core (%.1fus worst callback)\n", soundStats.started,
+			   soundStats.stolen, soundStats.dropped, soundStats.peak, SOUND_VOICES, soundStats.audioTime > 0 ? (soundStats.mixTime / soundStats.audioTime) * 100 : 0,
+			   soundStats.mixTimeMax * 1000000);
+	}
+	if (game->save != NULL) {
+		PNLSaveStoreStats saveStats;
+		pnlSaveStoreGetStats(game->save, &saveStats);
+		printf("Save: %i changes journaled, %i compactions, %i failed writes, %.2fus worst set on the main thread, %.2fms worst write on the writer\n",
+			   saveStats.records, saveStats.compactions, saveStats.failures, saveStats.setTimeMax * 1000000, saveStats.writeTimeMax * 1000);
 	}
 
+	// Suspend the run before pnlQuit takes the player off the planet, a finished run has nothing to resume
+	if (suspendable && game->player.hp > 0) {
+		PNLSnapshot suspend = pnlSnapshotCreate(SNAPSHOT_VERSION);
+		if (suspend != NULL) {
+			pnlWriteSnapshot(game, suspend);
+			size_t suspendSize;
+			pnlSnapshotBytes(suspend, &suspendSize);
+			if (pnlSnapshotStore(suspend, SNAPSHOT_FILE))
+				printf("Suspended the run to \"%s\" (%.1fKiB)\n", SNAPSHOT_FILE, suspendSize / 1024.0);
+			else
+				printf("Couldn't suspend the run to \"%s\"\n", SNAPSHOT_FILE);
+		}
+		pnlSnapshotFree(suspend);
+	} else if (suspendable) {
+		remove(SNAPSHOT_FILE);
+	}
+	if (profileFile != NULL)
+		pnlDumpProfile(profileFile, profileSeconds);
 
 	// Free assets
 	vk2dRendererWait();
 	pnlQuit(game);
-	juSoundStopAll();
-	juLoaderFree(game->loader);
-	juSaveStore(game->save, SAVE_FILE);
-	// juSaveFree(game->save); // uh oh memory leak?
+	pnlSoundPoolFree(game->sounds); // Before the loader frees the sounds it's playing
+	pnlMusicStreamFree(game->music); // Before the archive, it could be reading from it
+	pnlAssetLoaderFree(game->loader);
+	pnlAssetArchiveClose(game->archive);
+	pnlSaveStoreClose(game->save);
+	pnlSpatialHashFree(game->enemyGrid);
+	pnlFreeEnemies(game);
+	pnlFreeMinerals(game);
+	pnlFreeBullets(game);
+	pnlSpriteBatchFree(game->batch);
+	pnlTextCacheFree(game->text);
+	for (int i = 0; i < hb_MAX; i++)
+		if (game->terminalCache[i].texture != NULL)
+			vk2dTextureFree(game->terminalCache[i].texture);
 	free(game);
 	vk2dTextureFree(backbuffer);
+	pnlProfilerQuit(); // Every thread that could be recording is gone
 
 	// Free
 	juQuit();
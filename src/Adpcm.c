@@ -0,0 +1,106 @@
+#include "Adpcm.h"
+
+static const int ADPCM_INDEX_TABLE[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+static const int ADPCM_STEP_TABLE[89] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+		130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+		1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+		7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static int _pnlAdpcmClamp(int x, int low, int high) {
+	return x < low ? low : (x > high ? high : x);
+}
+
+// Applies a nibble to a channel's predictor and step index, the encoder does the same so both stay in step
+static int _pnlAdpcmStep(int nibble, int *predictor, int *index) {
+	int step = ADPCM_STEP_TABLE[*index];
+	int difference = step >> 3;
+	if (nibble & 4)
+		difference += step;
+	if (nibble & 2)
+		difference += step >> 1;
+	if (nibble & 1)
+		difference += step >> 2;
+	*predictor = _pnlAdpcmClamp(*predictor + (nibble & 8 ? -difference : difference), -32768, 32767);
+	*index = _pnlAdpcmClamp(*index + ADPCM_INDEX_TABLE[nibble], 0, 88);
+	return *predictor;
+}
+
+static int _pnlAdpcmEncodeSample(int sample, int *predictor, int *index) {
+	int step = ADPCM_STEP_TABLE[*index];
+	int difference = sample - *predictor;
+	int nibble = 0;
+	if (difference < 0) {
+		nibble = 8;
+		difference = -difference;
+	}
+	if (difference >= step) {
+		nibble |= 4;
+		difference -= step;
+	}
+	if (difference >= step >> 1) {
+		nibble |= 2;
+		difference -= step >> 1;
+	}
+	if (difference >= step >> 2)
+		nibble |= 1;
+	_pnlAdpcmStep(nibble, predictor, index);
+	return nibble;
+}
+
+int pnlAdpcmBlockFrames(int blockAlign, int channels) {
+	return (((blockAlign - (4 * channels)) * 2) / channels) + 1;
+}
+
+void pnlAdpcmEncodeBlock(const int16_t *samples, int count, int channels, int blockAlign, int *indices, unsigned char *out) {
+	int frames = pnlAdpcmBlockFrames(blockAlign, channels);
+	int predictors[2];
+	for (int c = 0; c < channels; c++) {
+		predictors[c] = samples[c];
+		out[(c * 4)] = (unsigned char)(predictors[c] & 0xFF);
+		out[(c * 4) + 1] = (unsigned char)((predictors[c] >> 8) & 0xFF);
+		out[(c * 4) + 2] = (unsigned char)indices[c];
+		out[(c * 4) + 3] = 0;
+	}
+
+	// After the header it's 4 bytes (8 frames) of one channel then 4 of the next, low nibble first
+	unsigned char *data = out + (channels * 4);
+	for (int frame = 1; frame < frames; frame += 8) {
+		for (int c = 0; c < channels; c++) {
+			for (int i = 0; i < 8; i += 2) {
+				int first = frame + i < count ? frame + i : count - 1;
+				int second = frame + i + 1 < count ? frame + i + 1 : count - 1;
+				int low = _pnlAdpcmEncodeSample(samples[(first * channels) + c], &predictors[c], &indices[c]);
+				int high = _pnlAdpcmEncodeSample(samples[(second * channels) + c], &predictors[c], &indices[c]);
+				*data++ = (unsigned char)(low | (high << 4));
+			}
+		}
+	}
+}
+
+int pnlAdpcmDecodeBlock(const unsigned char *block, int size, int channels, int16_t *out) {
+	if (channels < 1 || channels > 2 || size < channels * 4)
+		return 0;
+	int predictors[2];
+	int indices[2];
+	for (int c = 0; c < channels; c++) {
+		predictors[c] = (int16_t)(block[c * 4] | (block[(c * 4) + 1] << 8));
+		indices[c] = _pnlAdpcmClamp(block[(c * 4) + 2], 0, 88);
+		out[c] = (int16_t)predictors[c];
+	}
+
+	const unsigned char *data = block + (channels * 4);
+	int groups = (size - (channels * 4)) / (channels * 4);
+	for (int g = 0; g < groups; g++) {
+		int frame = 1 + (g * 8);
+		for (int c = 0; c < channels; c++) {
+			for (int i = 0; i < 8; i += 2) {
+				int byte = *data++;
+				out[((frame + i) * channels) + c] = (int16_t)_pnlAdpcmStep(byte & 0xF, &predictors[c], &indices[c]);
+				out[((frame + i + 1) * channels) + c] = (int16_t)_pnlAdpcmStep(byte >> 4, &predictors[c], &indices[c]);
+			}
+		}
+	}
+	return 1 + (groups * 8);
+}
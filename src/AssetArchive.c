@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <VK2D/stb_image.h>
+#include "AssetArchive.h"
+#include "Atlas.h"
+#include "Adpcm.h"
+#include "FileUtil.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// A payload waiting to be written by the packer
+typedef struct PNLPackedAsset {
+	PNLArchiveEntry entry;
+	unsigned char *payload; ///< Whole file for ak_Raw/ak_Samples, stb_image pixels for ak_Pixels
+	const unsigned char *start;
+} PNLPackedAsset;
+
+static uint64_t _pnlAlign(uint64_t offset) {
+	return (offset + PNL_ARCHIVE_ALIGNMENT - 1) / PNL_ARCHIVE_ALIGNMENT * PNL_ARCHIVE_ALIGNMENT;
+}
+
+static uint32_t _pnlRead32(const unsigned char *bytes) {
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint16_t _pnlRead16(const unsigned char *bytes) {
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+// Finds the samples in a PCM WAV and fills out the entry's format, false if it isn't one
+static bool _pnlParseWav(const unsigned char *bytes, size_t size, PNLArchiveEntry *entry, const unsigned char **samples) {
+	if (size < 12 || memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WAVE", 4) != 0)
+		return false;
+	bool format = false;
+	size_t position = 12;
+	while (position + 8 <= size) {
+		const unsigned char *chunk = bytes + position;
+		size_t chunkSize = _pnlRead32(chunk + 4);
+		if (chunkSize > size - position - 8)
+			return false;
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+			if (_pnlRead16(chunk + 8) != 1) // Only plain PCM
+				return false;
+			entry->width = _pnlRead16(chunk + 10);
+			entry->height = _pnlRead32(chunk + 12);
+			entry->bits = _pnlRead16(chunk + 22);
+			format = true;
+		} else if (memcmp(chunk, "data", 4) == 0 && format) {
+			*samples = chunk + 8;
+			entry->size = chunkSize;
+			return true;
+		}
+		position += 8 + chunkSize + (chunkSize % 2); // Chunks are padded to an even size
+	}
+	return false;
+}
+
+static void _pnlWrite32(unsigned char *bytes, uint32_t x) {
+	bytes[0] = (unsigned char)x;
+	bytes[1] = (unsigned char)(x >> 8);
+	bytes[2] = (unsigned char)(x >> 16);
+	bytes[3] = (unsigned char)(x >> 24);
+}
+
+static void _pnlWrite16(unsigned char *bytes, uint16_t x) {
+	bytes[0] = (unsigned char)x;
+	bytes[1] = (unsigned char)(x >> 8);
+}
+
+// Compresses parsed 8 or 16 bit PCM into a whole IMA ADPCM WAV file, NULL if it's a format that can't be
+static unsigned char *_pnlEncodeAdpcmWav(const PNLArchiveEntry *entry, const unsigned char *samples, size_t *size) {
+	int channels = entry->width;
+	int bytesPerSample = entry->bits / 8;
+	if (channels < 1 || channels > 2 || (entry->bits != 8 && entry->bits != 16))
+		return NULL;
+	int blockAlign = PNL_ADPCM_CHANNEL_BYTES * channels;
+	int blockFrames = pnlAdpcmBlockFrames(blockAlign, channels);
+	size_t frames = entry->size / (bytesPerSample * channels);
+	size_t blocks = (frames + blockFrames - 1) / blockFrames;
+	size_t dataSize = blocks * blockAlign;
+	const int headerSize = 12 + 28 + 12 + 8; // RIFF, fmt, fact, data
+	unsigned char *bytes = malloc(headerSize + dataSize);
+	int16_t *block = malloc(sizeof(int16_t) * blockFrames * channels);
+	if (bytes == NULL || block == NULL || frames == 0) {
+		free(bytes);
+		free(block);
+		return NULL;
+	}
+
+	memcpy(bytes, "RIFF", 4);
+	_pnlWrite32(bytes + 4, (uint32_t)(headerSize - 8 + dataSize));
+	memcpy(bytes + 8, "WAVE", 4);
+	memcpy(bytes + 12, "fmt ", 4);
+	_pnlWrite32(bytes + 16, 20);
+	_pnlWrite16(bytes + 20, PNL_ADPCM_FORMAT);
+	_pnlWrite16(bytes + 22, channels);
+	_pnlWrite32(bytes + 24, entry->height);
+	_pnlWrite32(bytes + 28, (uint32_t)(((uint64_t)entry->height * blockAlign) / blockFrames));
+	_pnlWrite16(bytes + 32, blockAlign);
+	_pnlWrite16(bytes + 34, 4);
+	_pnlWrite16(bytes + 36, 2);
+	_pnlWrite16(bytes + 38, blockFrames);
+	memcpy(bytes + 40, "fact", 4);
+	_pnlWrite32(bytes + 44, 4);
+	_pnlWrite32(bytes + 48, (uint32_t)frames);
+	memcpy(bytes + 52, "data", 4);
+	_pnlWrite32(bytes + 56, (uint32_t)dataSize);
+
+	int indices[2] = {0, 0};
+	for (size_t b = 0; b < blocks; b++) {
+		size_t first = b * blockFrames;
+		int count = frames - first < (size_t)blockFrames ? (int)(frames - first) : blockFrames;
+		for (int i = 0; i < count * channels; i++) {
+			const unsigned char *sample = samples + ((first * channels) + i) * bytesPerSample;
+			block[i] = bytesPerSample == 2 ? (int16_t)_pnlRead16(sample) : (int16_t)((sample[0] - 128) << 8);
+		}
+		pnlAdpcmEncodeBlock(block, count, channels, blockAlign, indices, bytes + headerSize + (b * blockAlign));
+	}
+	free(block);
+	*size = headerSize + dataSize;
+	return bytes;
+}
+
+static int _pnlComparePacked(const void *a, const void *b) {
+	return strcmp(((const PNLPackedAsset*)a)->entry.path, ((const PNLPackedAsset*)b)->entry.path);
+}
+
+// Moves the images flagged for the atlas onto pages, replacing their entries with the pages and the region table
+static PNLAtlas _pnlPackAtlas(PNLPackedAsset **packed, int *packedCount, const bool *flagged) {
+	const char **paths = malloc(sizeof(const char*) * (*packedCount > 0 ? *packedCount : 1));
+	unsigned char **pixels = malloc(sizeof(unsigned char*) * (*packedCount > 0 ? *packedCount : 1));
+	int *widths = malloc(sizeof(int) * (*packedCount > 0 ? *packedCount : 1));
+	int *heights = malloc(sizeof(int) * (*packedCount > 0 ? *packedCount : 1));
+	PNLAtlas atlas = NULL;
+	int count = 0;
+	if (paths != NULL && pixels != NULL && widths != NULL && heights != NULL) {
+		for (int i = 0; i < *packedCount; i++) {
+			if (flagged[i]) {
+				paths[count] = (*packed)[i].entry.path;
+				pixels[count] = (*packed)[i].payload;
+				widths[count] = (*packed)[i].entry.width;
+				heights[count] = (*packed)[i].entry.height;
+				count++;
+			}
+		}
+		atlas = count > 0 ? pnlAtlasBuild(paths, pixels, widths, heights, count) : NULL;
+	}
+	free(paths);
+	free(pixels);
+	free(widths);
+	free(heights);
+	PNLPackedAsset *grown = atlas != NULL ? realloc(*packed, sizeof(PNLPackedAsset) * (*packedCount + atlas->pageCount + 1)) : NULL;
+	if (grown == NULL) {
+		pnlAtlasFree(atlas);
+		return NULL;
+	}
+	*packed = grown;
+
+	// Images that made it onto a page aren't needed on their own
+	int kept = 0;
+	for (int i = 0; i < *packedCount; i++) {
+		if (flagged[i] && pnlAtlasFindRegion(atlas->regions, atlas->regionCount, grown[i].entry.path) != NULL)
+			stbi_image_free(grown[i].payload);
+		else
+			grown[kept++] = grown[i];
+	}
+
+	// The atlas owns these payloads, so they're left without one to free
+	for (int i = 0; i < atlas->pageCount; i++) {
+		PNLPackedAsset *page = &grown[kept++];
+		memset(page, 0, sizeof(PNLPackedAsset));
+		snprintf(page->entry.path, PNL_ARCHIVE_PATH_LENGTH, PNL_ATLAS_PAGE_PATH, i);
+		page->entry.kind = ak_Pixels;
+		page->entry.width = PNL_ATLAS_PAGE_SIZE;
+		page->entry.height = PNL_ATLAS_PAGE_SIZE;
+		page->entry.size = (uint64_t)PNL_ATLAS_PAGE_SIZE * PNL_ATLAS_PAGE_SIZE * 4;
+		page->start = atlas->pages[i];
+	}
+	PNLPackedAsset *regions = &grown[kept++];
+	memset(regions, 0, sizeof(PNLPackedAsset));
+	strcpy(regions->entry.path, PNL_ATLAS_REGIONS_PATH);
+	regions->entry.kind = ak_Raw;
+	regions->entry.size = sizeof(PNLAtlasRegion) * atlas->regionCount;
+	regions->start = (const unsigned char*)atlas->regions;
+	*packedCount = kept;
+	return atlas;
+}
+
+bool pnlAssetArchivePack(const char *filename, const char **paths, const PNLPackHint *hints, int count) {
+	PNLPackedAsset *packed = calloc(count > 0 ? count : 1, sizeof(PNLPackedAsset));
+	bool *flagged = calloc(count > 0 ? count : 1, sizeof(bool));
+	if (packed == NULL || flagged == NULL) {
+		free(packed);
+		free(flagged);
+		return false;
+	}
+
+	// Decode everything first so the index can be written before the payloads
+	int packedCount = 0;
+	for (int i = 0; i < count; i++) {
+		PNLPackedAsset *asset = &packed[packedCount];
+		size_t size;
+		if (strlen(paths[i]) >= PNL_ARCHIVE_PATH_LENGTH) {
+			printf("Skipping \"%s\", path is too long\n", paths[i]);
+			continue;
+		}
+		unsigned char *bytes = pnlReadFile(paths[i], &size);
+		if (bytes == NULL) {
+			printf("Skipping \"%s\", couldn't read it\n", paths[i]);
+			continue;
+		}
+		strcpy(asset->entry.path, paths[i]);
+
+		bool ok = true;
+		if (pnlEndsWith(paths[i], ".png")) {
+			int w, h, channels;
+			asset->payload = stbi_load_from_memory(bytes, (int)size, &w, &h, &channels, 4);
+			free(bytes);
+			ok = asset->payload != NULL;
+			asset->start = asset->payload;
+			asset->entry.kind = ak_Pixels;
+			asset->entry.width = w;
+			asset->entry.height = h;
+			asset->entry.size = (uint64_t)w * h * 4;
+		} else if (pnlEndsWith(paths[i], ".wav")) {
+			asset->payload = bytes;
+			asset->entry.kind = ak_Samples;
+			ok = _pnlParseWav(bytes, size, &asset->entry, &asset->start);
+
+			// Streamed music is decoded a block at a time anyway, so it may as well be a quarter the size
+			if (ok && hints != NULL && hints[i] == ph_Stream) {
+				size_t compressed;
+				asset->payload = _pnlEncodeAdpcmWav(&asset->entry, asset->start, &compressed);
+				free(bytes);
+				ok = asset->payload != NULL;
+				asset->start = asset->payload;
+				asset->entry.kind = ak_Raw;
+				asset->entry.width = 0;
+				asset->entry.height = 0;
+				asset->entry.bits = 0;
+				asset->entry.size = compressed;
+			}
+		} else {
+			asset->payload = bytes;
+			asset->start = bytes;
+			asset->entry.kind = ak_Raw;
+			asset->entry.size = size;
+		}
+
+		if (ok) {
+			flagged[packedCount++] = hints != NULL && hints[i] == ph_Atlas && asset->entry.kind == ak_Pixels;
+		} else {
+			printf("Skipping \"%s\", couldn't decode it\n", paths[i]);
+			if (asset->entry.kind == ak_Pixels)
+				stbi_image_free(asset->payload);
+			else
+				free(asset->payload);
+			memset(asset, 0, sizeof(PNLPackedAsset));
+		}
+	}
+
+	PNLAtlas atlas = _pnlPackAtlas(&packed, &packedCount, flagged);
+	free(flagged);
+	if (atlas != NULL)
+		printf("Atlas: %i images on %i page(s) of %ix%i, %.1f%% covered\n", atlas->regionCount, atlas->pageCount, PNL_ATLAS_PAGE_SIZE, PNL_ATLAS_PAGE_SIZE, atlas->fill * 100);
+
+	// Sorted by path so lookups can binary search
+	qsort(packed, packedCount, sizeof(PNLPackedAsset), _pnlComparePacked);
+	uint64_t offset = _pnlAlign(sizeof(PNLArchiveHeader) + (sizeof(PNLArchiveEntry) * packedCount));
+	for (int i = 0; i < packedCount; i++) {
+		packed[i].entry.offset = offset;
+		offset = _pnlAlign(offset + packed[i].entry.size);
+	}
+	PNLArchiveHeader header = {{'P', 'N', 'L', 'A'}, PNL_ARCHIVE_VERSION, (uint32_t)packedCount, 0, offset};
+
+	FILE *file = fopen(filename, "wb");
+	bool ok = file != NULL;
+	if (ok) {
+		static const unsigned char PADDING[PNL_ARCHIVE_ALIGNMENT] = {0};
+		ok = fwrite(&header, sizeof(PNLArchiveHeader), 1, file) == 1;
+		for (int i = 0; i < packedCount && ok; i++)
+			ok = fwrite(&packed[i].entry, sizeof(PNLArchiveEntry), 1, file) == 1;
+		for (int i = 0; i < packedCount && ok; i++) {
+			long position = ftell(file);
+			ok = fwrite(PADDING, 1, packed[i].entry.offset - position, file) == packed[i].entry.offset - position &&
+				 fwrite(packed[i].start, 1, packed[i].entry.size, file) == packed[i].entry.size;
+		}
+		long position = ftell(file);
+		ok = ok && fwrite(PADDING, 1, offset - position, file) == offset - position;
+		ok = fclose(file) == 0 && ok;
+	}
+
+	for (int i = 0; i < packedCount; i++) {
+		if (packed[i].entry.kind == ak_Pixels)
+			stbi_image_free(packed[i].payload);
+		else
+			free(packed[i].payload);
+	}
+	free(packed);
+	pnlAtlasFree(atlas);
+	return ok;
+}
+
+// Checks that everything the header and index claim is actually inside the archive
+// Every atlas region has to be on a page the archive has and fit inside it, the loader takes them as-is
+static bool _pnlAtlasRegionsValid(PNLAssetArchive archive) {
+	const PNLArchiveEntry *entry = pnlAssetArchiveFind(archive, PNL_ATLAS_REGIONS_PATH);
+	if (entry == NULL)
+		return true;
+	if (entry->kind != ak_Raw || entry->size % sizeof(PNLAtlasRegion) != 0)
+		return false;
+	const PNLAtlasRegion *regions = pnlAssetArchiveData(archive, entry);
+	uint64_t count = entry->size / sizeof(PNLAtlasRegion);
+	for (uint64_t i = 0; i < count; i++) {
+		const PNLAtlasRegion *region = &regions[i];
+		if (memchr(region->path, 0, PNL_ARCHIVE_PATH_LENGTH) == NULL || region->page >= archive->header->count)
+			return false; // There can't be more pages than entries
+		char path[PNL_ARCHIVE_PATH_LENGTH];
+		snprintf(path, PNL_ARCHIVE_PATH_LENGTH, PNL_ATLAS_PAGE_PATH, (int)region->page);
+		const PNLArchiveEntry *page = pnlAssetArchiveFind(archive, path);
+		if (page == NULL || page->kind != ak_Pixels ||
+			(uint64_t)region->x + region->w > page->width || (uint64_t)region->y + region->h > page->height)
+			return false;
+	}
+	return true;
+}
+
+static bool _pnlAssetArchiveValid(PNLAssetArchive archive) {
+	if (archive->size < sizeof(PNLArchiveHeader))
+		return false;
+	const PNLArchiveHeader *header = archive->header;
+	if (memcmp(header->magic, "PNLA", 4) != 0 || header->version != PNL_ARCHIVE_VERSION || header->size != archive->size)
+		return false;
+	if (header->count > (archive->size - sizeof(PNLArchiveHeader)) / sizeof(PNLArchiveEntry))
+		return false;
+	for (uint32_t i = 0; i < header->count; i++) {
+		const PNLArchiveEntry *entry = &archive->entries[i];
+		if (entry->offset > archive->size || entry->size > archive->size - entry->offset ||
+			memchr(entry->path, 0, PNL_ARCHIVE_PATH_LENGTH) == NULL || entry->kind >= ak_MAX)
+			return false;
+
+		// Pixels are uploaded straight from the archive, anything short would be read past
+		if (entry->kind == ak_Pixels && (uint64_t)entry->width * entry->height * 4 != entry->size)
+			return false;
+	}
+	return _pnlAtlasRegionsValid(archive);
+}
+
+PNLAssetArchive pnlAssetArchiveOpen(const char *filename) {
+	PNLAssetArchive archive = calloc(1, sizeof(struct PNLAssetArchive));
+	if (archive == NULL)
+		return NULL;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			archive->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (archive->data != NULL) {
+				archive->size = (size_t)size.QuadPart;
+				archive->handle = mapping;
+				archive->mapped = true;
+			} else {
+				CloseHandle(mapping);
+			}
+		}
+	}
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+#else
+	int file = open(filename, O_RDONLY);
+	struct stat info;
+	if (file != -1 && fstat(file, &info) == 0 && info.st_size > 0) {
+		void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			archive->data = data;
+			archive->size = info.st_size;
+			archive->mapped = true;
+		}
+	}
+	if (file != -1)
+		close(file);
+#endif
+
+	// Better slow than nothing
+	if (!archive->mapped)
+		archive->data = pnlReadFile(filename, &archive->size);
+
+	archive->header = (const PNLArchiveHeader*)archive->data;
+	archive->entries = (const PNLArchiveEntry*)(archive->data + sizeof(PNLArchiveHeader));
+	if (archive->data == NULL || !_pnlAssetArchiveValid(archive)) {
+		pnlAssetArchiveClose(archive);
+		return NULL;
+	}
+	return archive;
+}
+
+const PNLArchiveEntry *pnlAssetArchiveFind(PNLAssetArchive archive, const char *path) {
+	int low = 0;
+	int high = (int)archive->header->count - 1;
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		int order = strcmp(path, archive->entries[mid].path);
+		if (order == 0)
+			return &archive->entries[mid];
+		else if (order < 0)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+	return NULL;
+}
+
+const void *pnlAssetArchiveData(PNLAssetArchive archive, const PNLArchiveEntry *entry) {
+	return archive->data + entry->offset;
+}
+
+void pnlAssetArchiveClose(PNLAssetArchive archive) {
+	if (archive != NULL) {
+		if (archive->mapped) {
+#ifdef _WIN32
+			UnmapViewOfFile(archive->data);
+			CloseHandle(archive->handle);
+#else
+			munmap((void*)archive->data, archive->size);
+#endif
+		} else {
+			free((void*)archive->data);
+		}
+		free(archive);
+	}
+}
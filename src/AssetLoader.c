@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#include <VK2D/stb_image.h>
+#include "AssetLoader.h"
+#include "FileUtil.h"
+#include "Profiler.h"
+
+// Workers past this many don't record, there's one per core and they'd take the rings the audio threads need
+#define PROFILED_WORKERS ((int)4)
+
+static double _pnlSeconds(Uint64 start) {
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+// Worker half of loading an asset - everything that doesn't need the renderer or audio device
+static void _pnlAssetDecode(PNLAssetLoader loader, PNLAsset *asset) {
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	// Nothing to do for images on the atlas besides remembering where they are
+	if (loader->regions != NULL && (asset->type == at_Texture || asset->type == at_Sprite)) {
+		asset->region = pnlAtlasFindRegion(loader->regions, loader->regionCount, asset->spec->path);
+		if (asset->region != NULL) {
+			asset->decodeTime = _pnlSeconds(start);
+			SDL_AtomicSet(&asset->state, as_Decoded);
+			return;
+		}
+	}
+
+	// Already decoded, the pages aren't even touched until the upload reads them
+	if (loader->archive != NULL && (asset->type == at_Texture || asset->type == at_Sprite)) {
+		const PNLArchiveEntry *entry = pnlAssetArchiveFind(loader->archive, asset->spec->path);
+		if (entry != NULL && entry->kind == ak_Pixels) {
+			asset->pixels = (unsigned char*)pnlAssetArchiveData(loader->archive, entry);
+			asset->width = entry->width;
+			asset->height = entry->height;
+			asset->mapped = true;
+			asset->decodeTime = _pnlSeconds(start);
+			SDL_AtomicSet(&asset->state, as_Decoded);
+			return;
+		}
+	}
+
+	// Sounds never need the main thread, they're converted to what the mixer wants right here
+	if (asset->type == at_Sound) {
+		const PNLArchiveEntry *entry = loader->archive != NULL ? pnlAssetArchiveFind(loader->archive, asset->spec->path) : NULL;
+		if (entry != NULL && entry->kind == ak_Samples)
+			asset->snd = pnlSoundCreate(pnlAssetArchiveData(loader->archive, entry), entry->size, entry->bits == 8 ? AUDIO_U8 : AUDIO_S16SYS, entry->width, entry->height);
+		else
+			asset->snd = pnlSoundLoad(asset->spec->path);
+		asset->decodeTime = _pnlSeconds(start);
+		SDL_AtomicSet(&asset->state, asset->snd != NULL ? as_Decoded : as_Failed);
+		return;
+	}
+
+	size_t size;
+	unsigned char *bytes = pnlReadFile(asset->spec->path, &size);
+	bool ok = bytes != NULL;
+
+	// JamUtil only loads fonts from a path so those get finished on the main thread, reading them
+	// here still means that read comes out of the OS's file cache instead of off the disk
+	if (ok && (asset->type == at_Texture || asset->type == at_Sprite)) {
+		int channels;
+		asset->pixels = stbi_load_from_memory(bytes, (int)size, &asset->width, &asset->height, &channels, 4);
+		ok = asset->pixels != NULL;
+	}
+	free(bytes);
+
+	asset->decodeTime = _pnlSeconds(start);
+	SDL_AtomicSet(&asset->state, ok ? as_Decoded : as_Failed);
+}
+
+// Main thread half of loading an asset
+static void _pnlAssetFinish(PNLAssetLoader loader, PNLAsset *asset) {
+	Uint64 start = SDL_GetPerformanceCounter();
+	const JULoadedAsset *spec = asset->spec;
+	bool ok;
+	if (asset->region != NULL) {
+		VK2DTexture page = asset->region->page < (uint32_t)loader->pageCount ? loader->pages[asset->region->page] : NULL;
+		if (asset->type == at_Sprite && page != NULL)
+			asset->spr = juSpriteFrom(page, asset->region->x + spec->x, asset->region->y + spec->y, spec->w, spec->h, spec->delay, spec->frames);
+		if (asset->spr != NULL) {
+			asset->spr->originX = spec->originX;
+			asset->spr->originY = spec->originY;
+		}
+		ok = asset->type == at_Sprite ? asset->spr != NULL : page != NULL;
+	} else if (asset->type == at_Texture || asset->type == at_Sprite) {
+		asset->image = vk2dImageFromPixels(vk2dRendererGetDevice(), asset->pixels, asset->width, asset->height);
+		asset->tex = asset->image != NULL ? vk2dTextureLoadFromImage(asset->image) : NULL;
+		if (asset->type == at_Sprite && asset->tex != NULL) {
+			asset->spr = juSpriteFrom(asset->tex, spec->x, spec->y, spec->w, spec->h, spec->delay, spec->frames);
+			if (asset->spr != NULL) {
+				asset->spr->originX = spec->originX;
+				asset->spr->originY = spec->originY;
+			}
+		}
+		if (!asset->mapped)
+			stbi_image_free(asset->pixels);
+		asset->pixels = NULL;
+		ok = asset->type == at_Sprite ? asset->spr != NULL : asset->tex != NULL;
+	} else if (asset->type == at_Font) {
+		asset->fnt = juFontLoad(spec->path);
+		ok = asset->fnt != NULL;
+	} else {
+		ok = asset->snd != NULL;
+	}
+
+	asset->uploadTime = _pnlSeconds(start);
+	SDL_AtomicSet(&asset->state, ok ? as_Ready : as_Failed);
+}
+
+static int _pnlAssetWorker(void *data) {
+	PNLAssetLoader loader = data;
+	if (SDL_AtomicAdd(&loader->workers, 1) < PROFILED_WORKERS)
+		PNL_PROFILE_THREAD("assets");
+	else
+		PNL_PROFILE_IGNORE_THREAD();
+	int i;
+	while ((i = SDL_AtomicAdd(&loader->next, 1)) < loader->count) {
+		PNL_PROFILE_BEGIN(loader->assets[i].spec->path);
+		_pnlAssetDecode(loader, &loader->assets[i]);
+		PNL_PROFILE_END();
+		SDL_AtomicAdd(&loader->decoded, 1);
+	}
+	return 0;
+}
+
+PNLAssetLoader pnlAssetLoaderCreate(JULoadedAsset *assets, int count, int threadCount, PNLAssetArchive archive) {
+	PNLAssetLoader loader = calloc(1, sizeof(struct PNLAssetLoader));
+	if (loader == NULL)
+		return NULL;
+	loader->assets = calloc(count > 0 ? count : 1, sizeof(PNLAsset));
+	loader->threads = calloc(threadCount > 0 ? threadCount : 1, sizeof(SDL_Thread*));
+	if (loader->assets == NULL || loader->threads == NULL) {
+		free(loader->assets);
+		free(loader->threads);
+		free(loader);
+		return NULL;
+	}
+	loader->count = count;
+	loader->archive = archive;
+	loader->start = SDL_GetPerformanceCounter();
+
+	// Pages are only made once the main thread gets to them, but the workers need the regions now
+	const PNLArchiveEntry *regions = archive != NULL ? pnlAssetArchiveFind(archive, PNL_ATLAS_REGIONS_PATH) : NULL;
+	if (regions != NULL && regions->kind == ak_Raw) {
+		loader->regions = pnlAssetArchiveData(archive, regions);
+		loader->regionCount = (int)(regions->size / sizeof(PNLAtlasRegion));
+		for (int i = 0; i < loader->regionCount; i++)
+			loader->pageCount = loader->regions[i].page >= (uint32_t)loader->pageCount ? (int)loader->regions[i].page + 1 : loader->pageCount;
+		loader->pages = calloc(loader->pageCount > 0 ? loader->pageCount : 1, sizeof(VK2DTexture));
+		loader->pageImages = calloc(loader->pageCount > 0 ? loader->pageCount : 1, sizeof(VK2DImage));
+		if (loader->pages == NULL || loader->pageImages == NULL) {
+			free(loader->pages);
+			free(loader->pageImages);
+			loader->pages = NULL;
+			loader->pageImages = NULL;
+			loader->regions = NULL;
+			loader->regionCount = 0;
+			loader->pageCount = 0;
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		PNLAsset *asset = &loader->assets[i];
+		asset->spec = &assets[i];
+		if (pnlEndsWith(assets[i].path, ".jufnt"))
+			asset->type = at_Font;
+		else if (pnlEndsWith(assets[i].path, ".wav"))
+			asset->type = at_Sound;
+		else if (assets[i].w != 0)
+			asset->type = at_Sprite;
+		else
+			asset->type = at_Texture;
+	}
+
+	// Threads that can't be made just leave more work for the rest, with none at all it's done right here
+	for (int i = 0; i < threadCount; i++) {
+		loader->threads[loader->threadCount] = SDL_CreateThread(_pnlAssetWorker, "assets", loader);
+		if (loader->threads[loader->threadCount] != NULL)
+			loader->threadCount++;
+	}
+	if (loader->threadCount == 0)
+		_pnlAssetWorker(loader);
+	return loader;
+}
+
+bool pnlAssetLoaderUpdate(PNLAssetLoader loader, double budget) {
+	if (loader->ready == loader->count)
+		return true;
+
+	// Every atlased asset needs these, a page that's missing just fails the assets on it
+	if (!loader->pagesReady) {
+		for (int i = 0; i < loader->pageCount; i++) {
+			char path[PNL_ARCHIVE_PATH_LENGTH];
+			snprintf(path, PNL_ARCHIVE_PATH_LENGTH, PNL_ATLAS_PAGE_PATH, i);
+			const PNLArchiveEntry *entry = pnlAssetArchiveFind(loader->archive, path);
+			if (entry != NULL && entry->kind == ak_Pixels) {
+				loader->pageImages[i] = vk2dImageFromPixels(vk2dRendererGetDevice(), (void*)pnlAssetArchiveData(loader->archive, entry), entry->width, entry->height);
+				loader->pages[i] = loader->pageImages[i] != NULL ? vk2dTextureLoadFromImage(loader->pageImages[i]) : NULL;
+			}
+		}
+		loader->pagesReady = true;
+	}
+
+	// Finished in list order so the time spent here doesn't depend on which worker got there first
+	Uint64 start = SDL_GetPerformanceCounter();
+	while (loader->ready < loader->count && _pnlSeconds(start) < budget) {
+		PNLAsset *asset = &loader->assets[loader->ready];
+		int state = SDL_AtomicGet(&asset->state);
+		if (state == as_Queued)
+			break;
+		if (state == as_Decoded) {
+			PNL_PROFILE_BEGIN(asset->spec->path);
+			_pnlAssetFinish(loader, asset);
+			PNL_PROFILE_END();
+		}
+		loader->ready++;
+	}
+
+	if (loader->ready == loader->count) {
+		for (int i = 0; i < loader->threadCount; i++)
+			SDL_WaitThread(loader->threads[i], NULL);
+		loader->threadCount = 0;
+		loader->loadTime = _pnlSeconds(loader->start);
+		return true;
+	}
+	return false;
+}
+
+double pnlAssetLoaderProgress(PNLAssetLoader loader) {
+	if (loader->count == 0)
+		return 1;
+	return ((double)SDL_AtomicGet(&loader->decoded) + loader->ready) / (loader->count * 2);
+}
+
+static int _pnlCompareAssetTimes(const void *a, const void *b) {
+	const PNLAsset *x = *(const PNLAsset**)a;
+	const PNLAsset *y = *(const PNLAsset**)b;
+	double tx = x->decodeTime + x->uploadTime;
+	double ty = y->decodeTime + y->uploadTime;
+	return (tx < ty) - (tx > ty);
+}
+
+void pnlAssetLoaderReport(PNLAssetLoader loader, FILE *out) {
+	const char *TYPE_NAMES[] = {"texture", "sprite", "font", "sound"};
+	PNLAsset **sorted = malloc(sizeof(PNLAsset*) * (loader->count > 0 ? loader->count : 1));
+	if (sorted == NULL)
+		return;
+	double decodeTotal = 0, uploadTotal = 0;
+	for (int i = 0; i < loader->count; i++) {
+		sorted[i] = &loader->assets[i];
+		decodeTotal += loader->assets[i].decodeTime;
+		uploadTotal += loader->assets[i].uploadTime;
+	}
+	qsort(sorted, loader->count, sizeof(PNLAsset*), _pnlCompareAssetTimes);
+
+	fprintf(out, "%-36s | %-7s | Decode ms | Finish ms\n", "Asset", "Type");
+	for (int i = 0; i < loader->count; i++) {
+		PNLAsset *asset = sorted[i];
+		fprintf(out, "%-36s | %-7s | %9.3f | %9.3f%s\n", asset->spec->path, TYPE_NAMES[asset->type], asset->decodeTime * 1000,
+				asset->uploadTime * 1000, SDL_AtomicGet(&asset->state) == as_Failed ? " (FAILED)" : "");
+	}
+	fprintf(out, "%i assets in %.1fms - %.1fms decoding across threads, %.1fms finishing on the main thread\n", loader->count,
+			loader->loadTime * 1000, decodeTotal * 1000, uploadTotal * 1000);
+	free(sorted);
+}
+
+static PNLAsset *_pnlAssetFind(PNLAssetLoader loader, const char *path, PNLAssetType type) {
+	for (int i = 0; i < loader->count; i++) {
+		PNLAsset *asset = &loader->assets[i];
+		if (asset->type == type && SDL_AtomicGet(&asset->state) == as_Ready && strcmp(asset->spec->path, path) == 0)
+			return asset;
+	}
+	return NULL;
+}
+
+VK2DTexture pnlAssetLoaderGetTexture(PNLAssetLoader loader, const char *path) {
+	PNLAsset *asset = _pnlAssetFind(loader, path, at_Texture);
+	return asset != NULL ? asset->tex : NULL;
+}
+
+PNLImage pnlAssetLoaderGetImage(PNLAssetLoader loader, const char *path) {
+	PNLAsset *asset = _pnlAssetFind(loader, path, at_Texture);
+	PNLImage image = {0};
+	if (asset != NULL && asset->region != NULL) {
+		image.tex = asset->region->page < (uint32_t)loader->pageCount ? loader->pages[asset->region->page] : NULL;
+		image.x = asset->region->x;
+		image.y = asset->region->y;
+		image.w = asset->region->w;
+		image.h = asset->region->h;
+	} else if (asset != NULL && asset->tex != NULL) {
+		image.tex = asset->tex;
+		image.w = asset->tex->img->width;
+		image.h = asset->tex->img->height;
+	}
+	return image;
+}
+
+JUSprite pnlAssetLoaderGetSprite(PNLAssetLoader loader, const char *path) {
+	PNLAsset *asset = _pnlAssetFind(loader, path, at_Sprite);
+	return asset != NULL ? asset->spr : NULL;
+}
+
+JUFont pnlAssetLoaderGetFont(PNLAssetLoader loader, const char *path) {
+	PNLAsset *asset = _pnlAssetFind(loader, path, at_Font);
+	return asset != NULL ? asset->fnt : NULL;
+}
+
+PNLSound pnlAssetLoaderGetSound(PNLAssetLoader loader, const char *path) {
+	PNLAsset *asset = _pnlAssetFind(loader, path, at_Sound);
+	return asset != NULL ? asset->snd : NULL;
+}
+
+void pnlAssetLoaderFree(PNLAssetLoader loader) {
+	if (loader != NULL) {
+		for (int i = 0; i < loader->threadCount; i++)
+			SDL_WaitThread(loader->threads[i], NULL);
+		for (int i = 0; i < loader->count; i++) {
+			PNLAsset *asset = &loader->assets[i];
+			if (!asset->mapped)
+				stbi_image_free(asset->pixels);
+			if (asset->spr != NULL)
+				juSpriteFree(asset->spr); // Sprites made from a texture leave it alone
+			if (asset->tex != NULL)
+				vk2dTextureFree(asset->tex);
+			if (asset->image != NULL)
+				vk2dImageFree(asset->image);
+			if (asset->fnt != NULL)
+				juFontFree(asset->fnt);
+			if (asset->snd != NULL)
+				pnlSoundFree(asset->snd);
+		}
+		for (int i = 0; i < loader->pageCount; i++) {
+			if (loader->pages[i] != NULL)
+				vk2dTextureFree(loader->pages[i]);
+			if (loader->pageImages[i] != NULL)
+				vk2dImageFree(loader->pageImages[i]);
+		}
+		free(loader->pages);
+		free(loader->pageImages);
+		free(loader->assets);
+		free(loader->threads);
+		free(loader);
+	}
+}
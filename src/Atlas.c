@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Atlas.h"
+
+// A row of images on a page, as tall as the first (tallest) image put on it
+typedef struct PNLAtlasShelf {
+	int page;
+	int y, height;
+	int x; ///< Where the next image goes
+} PNLAtlasShelf;
+
+// Images are packed in this order, kept alongside so the comparison can see the sizes
+typedef struct PNLAtlasOrder {
+	int index;
+	int width, height;
+} PNLAtlasOrder;
+
+static int _pnlCompareAtlasOrder(const void *a, const void *b) {
+	const PNLAtlasOrder *x = a;
+	const PNLAtlasOrder *y = b;
+	if (x->height != y->height)
+		return y->height - x->height;
+	if (x->width != y->width)
+		return y->width - x->width;
+	return x->index - y->index; // qsort isn't stable and the output should be the same every time
+}
+
+static int _pnlCompareRegions(const void *a, const void *b) {
+	return strcmp(((const PNLAtlasRegion*)a)->path, ((const PNLAtlasRegion*)b)->path);
+}
+
+static int _pnlClamp(int x, int low, int high) {
+	return x < low ? low : (x > high ? high : x);
+}
+
+// Copies an image onto a page with its edge pixels stretched out over the padding
+static void _pnlAtlasBlit(unsigned char *page, const unsigned char *pixels, int width, int height, int x, int y) {
+	for (int py = -PNL_ATLAS_PADDING; py < height + PNL_ATLAS_PADDING; py++) {
+		const unsigned char *row = pixels + ((size_t)_pnlClamp(py, 0, height - 1) * width * 4);
+		unsigned char *out = page + ((((size_t)(y + py) * PNL_ATLAS_PAGE_SIZE) + x - PNL_ATLAS_PADDING) * 4);
+		for (int px = -PNL_ATLAS_PADDING; px < width + PNL_ATLAS_PADDING; px++, out += 4)
+			memcpy(out, row + (_pnlClamp(px, 0, width - 1) * 4), 4);
+	}
+}
+
+PNLAtlas pnlAtlasBuild(const char **paths, unsigned char **pixels, const int *widths, const int *heights, int count) {
+	PNLAtlas atlas = calloc(1, sizeof(struct PNLAtlas));
+	PNLAtlasOrder *order = malloc(sizeof(PNLAtlasOrder) * (count > 0 ? count : 1));
+	PNLAtlasShelf *shelves = malloc(sizeof(PNLAtlasShelf) * (count > 0 ? count : 1)); // Never more shelves than images
+	int *pageBottoms = malloc(sizeof(int) * (count > 0 ? count : 1));
+	if (atlas != NULL) {
+		atlas->regions = calloc(count > 0 ? count : 1, sizeof(PNLAtlasRegion));
+		atlas->pages = calloc(count > 0 ? count : 1, sizeof(unsigned char*)); // Or pages
+	}
+	if (atlas == NULL || order == NULL || shelves == NULL || pageBottoms == NULL || atlas->regions == NULL || atlas->pages == NULL) {
+		pnlAtlasFree(atlas);
+		free(order);
+		free(shelves);
+		free(pageBottoms);
+		return NULL;
+	}
+
+	for (int i = 0; i < count; i++) {
+		order[i].index = i;
+		order[i].width = widths[i] + (PNL_ATLAS_PADDING * 2);
+		order[i].height = heights[i] + (PNL_ATLAS_PADDING * 2);
+	}
+	qsort(order, count, sizeof(PNLAtlasOrder), _pnlCompareAtlasOrder);
+
+	// First fit decreasing height - each image goes on the first shelf with room, then a new shelf, then a new page
+	int shelfCount = 0;
+	long used = 0;
+	bool ok = true;
+	for (int o = 0; o < count && ok; o++) {
+		int i = order[o].index;
+		int w = order[o].width;
+		int h = order[o].height;
+		if (w > PNL_ATLAS_PAGE_SIZE || h > PNL_ATLAS_PAGE_SIZE || strlen(paths[i]) >= PNL_ARCHIVE_PATH_LENGTH || widths[i] <= 0 || heights[i] <= 0)
+			continue;
+
+		PNLAtlasShelf *shelf = NULL;
+		for (int s = 0; s < shelfCount && shelf == NULL; s++)
+			if (shelves[s].height >= h && shelves[s].x + w <= PNL_ATLAS_PAGE_SIZE)
+				shelf = &shelves[s];
+		if (shelf == NULL) {
+			int page = atlas->pageCount - 1;
+			if (page == -1 || pageBottoms[page] + h > PNL_ATLAS_PAGE_SIZE) {
+				page = atlas->pageCount;
+				atlas->pages[page] = calloc((size_t)PNL_ATLAS_PAGE_SIZE * PNL_ATLAS_PAGE_SIZE, 4);
+				if (atlas->pages[page] == NULL) {
+					ok = false;
+					continue;
+				}
+				pageBottoms[page] = 0;
+				atlas->pageCount++;
+			}
+			shelf = &shelves[shelfCount++];
+			shelf->page = page;
+			shelf->y = pageBottoms[page];
+			shelf->height = h;
+			shelf->x = 0;
+			pageBottoms[page] += h;
+		}
+
+		PNLAtlasRegion *region = &atlas->regions[atlas->regionCount++];
+		strcpy(region->path, paths[i]);
+		region->page = shelf->page;
+		region->x = shelf->x + PNL_ATLAS_PADDING;
+		region->y = shelf->y + PNL_ATLAS_PADDING;
+		region->w = widths[i];
+		region->h = heights[i];
+		_pnlAtlasBlit(atlas->pages[shelf->page], pixels[i], widths[i], heights[i], region->x, region->y);
+		shelf->x += w;
+		used += (long)widths[i] * heights[i];
+	}
+
+	free(order);
+	free(shelves);
+	free(pageBottoms);
+	if (!ok) {
+		pnlAtlasFree(atlas);
+		return NULL;
+	}
+	qsort(atlas->regions, atlas->regionCount, sizeof(PNLAtlasRegion), _pnlCompareRegions);
+	atlas->fill = atlas->pageCount > 0 ? (double)used / ((double)PNL_ATLAS_PAGE_SIZE * PNL_ATLAS_PAGE_SIZE * atlas->pageCount) : 0;
+	return atlas;
+}
+
+const PNLAtlasRegion *pnlAtlasFindRegion(const PNLAtlasRegion *regions, int count, const char *path) {
+	int low = 0;
+	int high = count - 1;
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		int order = strcmp(path, regions[mid].path);
+		if (order == 0)
+			return &regions[mid];
+		else if (order < 0)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+	return NULL;
+}
+
+void pnlAtlasFree(PNLAtlas atlas) {
+	if (atlas != NULL) {
+		for (int i = 0; i < atlas->pageCount; i++)
+			free(atlas->pages[i]);
+		free(atlas->pages);
+		free(atlas->regions);
+		free(atlas);
+	}
+}
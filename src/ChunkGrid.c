@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <math.h>
+#include "ChunkGrid.h"
+
+// Chunk lists start at this many ids and double when full
+#define CHUNK_INITIAL_CAPACITY ((int)8)
+
+static int _pnlChunkGridColumn(PNLChunkGrid grid, double x) {
+	int cx = (int)floor((x - grid->left) / grid->chunkSize);
+	return cx < 0 ? 0 : (cx >= grid->width ? grid->width - 1 : cx);
+}
+
+static int _pnlChunkGridRow(PNLChunkGrid grid, double y) {
+	int cy = (int)floor((y - grid->top) / grid->chunkSize);
+	return cy < 0 ? 0 : (cy >= grid->height ? grid->height - 1 : cy);
+}
+
+static PNLChunk *_pnlChunkGridChunk(PNLChunkGrid grid, double x, double y) {
+	return &grid->chunks[(_pnlChunkGridRow(grid, y) * grid->width) + _pnlChunkGridColumn(grid, x)];
+}
+
+PNLChunkGrid pnlChunkGridCreate(double left, double top, double right, double bottom, double chunkSize) {
+	PNLChunkGrid grid = calloc(1, sizeof(struct PNLChunkGrid));
+	if (grid == NULL)
+		return NULL;
+	grid->left = left;
+	grid->top = top;
+	grid->chunkSize = chunkSize;
+	grid->width = (int)ceil((right - left) / chunkSize);
+	grid->height = (int)ceil((bottom - top) / chunkSize);
+	grid->width = grid->width < 1 ? 1 : grid->width;
+	grid->height = grid->height < 1 ? 1 : grid->height;
+	grid->chunks = calloc(grid->width * grid->height, sizeof(PNLChunk));
+	if (grid->chunks == NULL) {
+		free(grid);
+		return NULL;
+	}
+	return grid;
+}
+
+void pnlChunkGridClear(PNLChunkGrid grid) {
+	for (int i = 0; i < grid->width * grid->height; i++)
+		grid->chunks[i].count = 0;
+	grid->count = 0;
+}
+
+static bool _pnlChunkAdd(PNLChunk *chunk, int id) {
+	if (chunk->count == chunk->capacity) {
+		int capacity = chunk->capacity == 0 ? CHUNK_INITIAL_CAPACITY : chunk->capacity * 2;
+		int *ids = realloc(chunk->ids, sizeof(int) * capacity);
+		if (ids == NULL)
+			return false;
+		chunk->ids = ids;
+		chunk->capacity = capacity;
+	}
+	chunk->ids[chunk->count++] = id;
+	return true;
+}
+
+static bool _pnlChunkRemove(PNLChunk *chunk, int id) {
+	for (int i = 0; i < chunk->count; i++) {
+		if (chunk->ids[i] == id) {
+			chunk->ids[i] = chunk->ids[--chunk->count];
+			return true;
+		}
+	}
+	return false;
+}
+
+bool pnlChunkGridInsert(PNLChunkGrid grid, int id, double x, double y) {
+	if (!_pnlChunkAdd(_pnlChunkGridChunk(grid, x, y), id))
+		return false;
+	grid->count++;
+	return true;
+}
+
+bool pnlChunkGridRemove(PNLChunkGrid grid, int id, double x, double y) {
+	if (!_pnlChunkRemove(_pnlChunkGridChunk(grid, x, y), id))
+		return false;
+	grid->count--;
+	return true;
+}
+
+bool pnlChunkGridMove(PNLChunkGrid grid, int id, double oldX, double oldY, double newX, double newY) {
+	PNLChunk *from = _pnlChunkGridChunk(grid, oldX, oldY);
+	PNLChunk *to = _pnlChunkGridChunk(grid, newX, newY);
+	if (from == to)
+		return true;
+	if (!_pnlChunkAdd(to, id))
+		return false;
+	return _pnlChunkRemove(from, id);
+}
+
+int pnlChunkGridQuery(PNLChunkGrid grid, double x, double y, double radius, const int **results) {
+	int cx0 = _pnlChunkGridColumn(grid, x - radius);
+	int cx1 = _pnlChunkGridColumn(grid, x + radius);
+	int cy0 = _pnlChunkGridRow(grid, y - radius);
+	int cy1 = _pnlChunkGridRow(grid, y + radius);
+
+	// Size the output first so the copy loop doesn't have to check
+	int found = 0;
+	for (int cy = cy0; cy <= cy1; cy++)
+		for (int cx = cx0; cx <= cx1; cx++)
+			found += grid->chunks[(cy * grid->width) + cx].count;
+	if (found > grid->resultCapacity) {
+		int *newResults = realloc(grid->results, sizeof(int) * found);
+		if (newResults == NULL)
+			return -1;
+		grid->results = newResults;
+		grid->resultCapacity = found;
+	}
+
+	found = 0;
+	for (int cy = cy0; cy <= cy1; cy++) {
+		for (int cx = cx0; cx <= cx1; cx++) {
+			PNLChunk *chunk = &grid->chunks[(cy * grid->width) + cx];
+			for (int i = 0; i < chunk->count; i++)
+				grid->results[found++] = chunk->ids[i];
+		}
+	}
+	*results = grid->results;
+	return found;
+}
+
+void pnlChunkGridFree(PNLChunkGrid grid) {
+	if (grid != NULL) {
+		for (int i = 0; i < grid->width * grid->height; i++)
+			free(grid->chunks[i].ids);
+		free(grid->chunks);
+		free(grid->results);
+		free(grid);
+	}
+}
@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "FileUtil.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+unsigned char *pnlReadFile(const char *path, size_t *size) {
+	*size = 0;
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char *bytes = length >= 0 ? malloc(length > 0 ? length : 1) : NULL;
+	if (bytes != NULL && fread(bytes, 1, length, file) != (size_t)length) {
+		free(bytes);
+		bytes = NULL;
+	}
+	fclose(file);
+	if (bytes != NULL)
+		*size = (size_t)length;
+	return bytes;
+}
+
+bool pnlSyncFile(FILE *file) {
+	if (fflush(file) != 0)
+		return false;
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool pnlWriteFileSynced(const char *path, const unsigned char *data, size_t size) {
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	bool ok = fwrite(data, 1, size, file) == size && pnlSyncFile(file);
+	return fclose(file) == 0 && ok;
+}
+
+bool pnlReplaceFile(const char *from, const char *to) {
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (rename(from, to) != 0)
+		return false;
+
+	// The rename itself is only safe once the directory it's in is synced
+	char directory[1024];
+	const char *slash = strrchr(to, '/');
+	size_t length = slash != NULL ? (size_t)(slash - to) : 0;
+	if (length >= sizeof(directory))
+		return true;
+	memcpy(directory, slash != NULL ? to : ".", slash != NULL ? length : 1);
+	directory[slash != NULL ? length : 1] = 0;
+	int fd = open(directory, O_RDONLY);
+	if (fd != -1) {
+		fsync(fd);
+		close(fd);
+	}
+	return true;
+#endif
+}
+
+bool pnlEndsWith(const char *string, const char *end) {
+	size_t length = strlen(string);
+	size_t endLength = strlen(end);
+	return length >= endLength && strcmp(string + length - endLength, end) == 0;
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <math.h>
+#include "FramePacer.h"
+
+// Spinning is only done for the last little bit of the frame, this is the least it will spin for
+static const double PACER_MIN_SPIN = 0.0002;
+
+// How quickly the jitter estimate follows new measurements - it rises fast and decays slowly so
+// one bad wake-up is enough to stop us from oversleeping for a while
+static const double PACER_JITTER_RISE = 0.5;
+static const double PACER_JITTER_DECAY = 0.02;
+
+// Starting guess for scheduler wake-up jitter before anything has been measured
+static const double PACER_INITIAL_JITTER = 0.001;
+
+PNLFramePacer pnlFramePacerCreate(double framerate) {
+	PNLFramePacer pacer = calloc(1, sizeof(struct PNLFramePacer));
+	if (pacer != NULL) {
+		pacer->frequency = (double)SDL_GetPerformanceFrequency();
+		pacer->period = (Uint64)(pacer->frequency / framerate);
+		pacer->lastFrame = SDL_GetPerformanceCounter();
+		pacer->deadline = pacer->lastFrame + pacer->period;
+		pacer->jitter = PACER_INITIAL_JITTER;
+		pacer->spinThreshold = PACER_MIN_SPIN;
+		pnlFramePacerResetStats(pacer);
+	}
+	return pacer;
+}
+
+static void _pnlFramePacerSleep(PNLFramePacer pacer) {
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (now >= pacer->deadline)
+		return;
+	double remaining = (double)(pacer->deadline - now) / pacer->frequency;
+	double sleepFor = remaining - pacer->jitter - pacer->spinThreshold;
+	Uint32 ms = sleepFor > 0 ? (Uint32)(sleepFor * 1000) : 0;
+	if (ms == 0)
+		return;
+
+	// Sleep and see how far past the requested time we actually woke up
+	SDL_Delay(ms);
+	double overshoot = (((double)(SDL_GetPerformanceCounter() - now) / pacer->frequency) - (ms / 1000.0));
+	if (overshoot < 0)
+		overshoot = 0;
+	if (overshoot > pacer->jitter)
+		pacer->jitter += (overshoot - pacer->jitter) * PACER_JITTER_RISE;
+	else
+		pacer->jitter += (overshoot - pacer->jitter) * PACER_JITTER_DECAY;
+}
+
+double pnlFramePacerWait(PNLFramePacer pacer) {
+	_pnlFramePacerSleep(pacer);
+	Uint64 now = SDL_GetPerformanceCounter();
+	while (now < pacer->deadline)
+		now = SDL_GetPerformanceCounter();
+
+	// Schedule the next frame from the old deadline so small overshoots don't accumulate, unless
+	// we are more than a frame behind in which case there is no point trying to catch up
+	pacer->deadline += pacer->period;
+	if (pacer->deadline < now)
+		pacer->deadline = now + pacer->period;
+
+	double frameTime = (double)(now - pacer->lastFrame) / pacer->frequency;
+	pacer->lastFrame = now;
+
+	pacer->frames++;
+	double delta = frameTime - pacer->mean;
+	pacer->mean += delta / pacer->frames;
+	pacer->m2 += delta * (frameTime - pacer->mean);
+	if (frameTime < pacer->min)
+		pacer->min = frameTime;
+	if (frameTime > pacer->max)
+		pacer->max = frameTime;
+
+	return frameTime;
+}
+
+void pnlFramePacerGetStats(PNLFramePacer pacer, PNLFrameStats *stats) {
+	stats->frames = pacer->frames;
+	stats->mean = pacer->mean;
+	stats->variance = pacer->frames > 1 ? pacer->m2 / (pacer->frames - 1) : 0;
+	stats->min = pacer->frames > 0 ? pacer->min : 0;
+	stats->max = pacer->max;
+	stats->jitter = pacer->jitter;
+}
+
+void pnlFramePacerResetStats(PNLFramePacer pacer) {
+	pacer->frames = 0;
+	pacer->mean = 0;
+	pacer->m2 = 0;
+	pacer->min = HUGE_VAL;
+	pacer->max = 0;
+}
+
+void pnlFramePacerFree(PNLFramePacer pacer) {
+	free(pacer);
+}
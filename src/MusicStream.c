@@ -0,0 +1,418 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "MusicStream.h"
+#include "Adpcm.h"
+#include "Profiler.h"
+
+// Frames of PCM decoded at a time, ADPCM goes a block at a time instead
+#define PCM_CHUNK_FRAMES ((int)2048)
+
+// Biggest ADPCM block a track can use, anything bigger is refused
+#define MAX_BLOCK_BYTES ((int)8192)
+
+// WAV format tag for plain PCM
+#define PCM_FORMAT ((int)1)
+
+#define HALF_PI ((float)1.57079632679)
+
+struct PNLMusicVoice {
+	// Where the track is, either an open file or a payload in the archive
+	FILE *file;
+	const unsigned char *memory;
+	uint64_t size;
+	uint64_t dataStart, dataSize;
+	uint64_t position;   // Bytes into the data
+	int64_t frames;      // In the track, -1 until it's known
+	int64_t framesDone;
+
+	// Format
+	int format, channels, rate, bits;
+	int blockAlign;      // ADPCM only
+	int chunkFrames;     // Most frames one read decodes into
+	int chunkBytes;      // Most bytes one read takes
+
+	// Decoding
+	unsigned char *block; // Bytes read from a file, the archive is read in place
+	int16_t *samples;
+	SDL_AudioStream *convert; // To float stereo at PNL_MUSIC_RATE
+	bool flushed;
+	int bytes;           // Held by the buffers below
+
+	// Playing
+	bool loop;
+	float gain, target, step; // Gain goes 0 to 1 and is shaped into the volume
+	float left, right;
+};
+
+static uint32_t _pnlRead32(const unsigned char *bytes) {
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint16_t _pnlRead16(const unsigned char *bytes) {
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+// Gets bytes of the track from wherever it is, NULL if there aren't that many
+static const unsigned char *_pnlMusicVoiceBytes(PNLMusicVoice voice, uint64_t offset, size_t size, unsigned char *buffer) {
+	if (offset > voice->size || size > voice->size - offset)
+		return NULL;
+	if (voice->memory != NULL)
+		return voice->memory + offset;
+	if (fseek(voice->file, (long)offset, SEEK_SET) != 0 || fread(buffer, 1, size, voice->file) != size)
+		return NULL;
+	return buffer;
+}
+
+// Walks a WAV file's chunks for the format and where the data is without reading the data
+static bool _pnlMusicVoiceParseWav(PNLMusicVoice voice) {
+	unsigned char buffer[20];
+	const unsigned char *bytes = _pnlMusicVoiceBytes(voice, 0, 12, buffer);
+	if (bytes == NULL || memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WAVE", 4) != 0)
+		return false;
+	bool format = false;
+	uint64_t position = 12;
+	while ((bytes = _pnlMusicVoiceBytes(voice, position, 8, buffer)) != NULL) {
+		char id[4];
+		memcpy(id, bytes, 4);
+		uint32_t chunkSize = _pnlRead32(bytes + 4);
+		if (memcmp(id, "fmt ", 4) == 0 && chunkSize >= 16 && (bytes = _pnlMusicVoiceBytes(voice, position + 8, 16, buffer)) != NULL) {
+			voice->format = _pnlRead16(bytes);
+			voice->channels = _pnlRead16(bytes + 2);
+			voice->rate = (int)_pnlRead32(bytes + 4);
+			voice->blockAlign = _pnlRead16(bytes + 12);
+			voice->bits = _pnlRead16(bytes + 14);
+			format = true;
+		} else if (memcmp(id, "fact", 4) == 0 && chunkSize >= 4 && (bytes = _pnlMusicVoiceBytes(voice, position + 8, 4, buffer)) != NULL) {
+			voice->frames = _pnlRead32(bytes);
+		} else if (memcmp(id, "data", 4) == 0 && format) {
+			voice->dataStart = position + 8;
+			voice->dataSize = chunkSize < voice->size - voice->dataStart ? chunkSize : voice->size - voice->dataStart; // Cut off files still play
+			return true;
+		}
+		position += 8 + (uint64_t)chunkSize + (chunkSize % 2); // Chunks are padded to an even size
+	}
+	return false;
+}
+
+// Checks the format is one that can be played and gets the buffers for it
+static bool _pnlMusicVoiceSetup(PNLMusicVoice voice) {
+	if (voice->channels < 1 || voice->channels > 2 || voice->rate <= 0)
+		return false;
+	if (voice->format == PCM_FORMAT && (voice->bits == 8 || voice->bits == 16)) {
+		int frameBytes = (voice->bits / 8) * voice->channels;
+		voice->chunkFrames = PCM_CHUNK_FRAMES;
+		voice->chunkBytes = PCM_CHUNK_FRAMES * frameBytes;
+		voice->frames = voice->dataSize / frameBytes;
+	} else if (voice->format == PNL_ADPCM_FORMAT && voice->bits == 4 && voice->blockAlign > voice->channels * 4 && voice->blockAlign <= MAX_BLOCK_BYTES) {
+		voice->chunkFrames = pnlAdpcmBlockFrames(voice->blockAlign, voice->channels);
+		voice->chunkBytes = voice->blockAlign;
+		int64_t blocks = (voice->dataSize + voice->blockAlign - 1) / voice->blockAlign;
+		if (voice->frames < 0 || voice->frames > blocks * voice->chunkFrames) // The last block is padded, fact says by how much
+			voice->frames = blocks * voice->chunkFrames;
+	} else {
+		return false;
+	}
+
+	voice->block = voice->file != NULL ? malloc(voice->chunkBytes) : NULL;
+	voice->samples = malloc(sizeof(int16_t) * voice->chunkFrames * voice->channels);
+	voice->convert = SDL_NewAudioStream(AUDIO_S16SYS, voice->channels, voice->rate, AUDIO_F32SYS, 2, PNL_MUSIC_RATE);
+	voice->bytes = (voice->block != NULL ? voice->chunkBytes : 0) + (sizeof(int16_t) * voice->chunkFrames * voice->channels) +
+					 (sizeof(float) * 2 * voice->chunkFrames); // The converter holds about a chunk as floats
+	return (voice->file == NULL || voice->block != NULL) && voice->samples != NULL && voice->convert != NULL;
+}
+
+static void _pnlMusicVoiceClose(PNLMusicStream stream, PNLMusicVoice voice) {
+	if (voice != NULL) {
+		SDL_AtomicAdd(&stream->memory, -voice->bytes);
+		if (voice->file != NULL)
+			fclose(voice->file);
+		if (voice->convert != NULL)
+			SDL_FreeAudioStream(voice->convert);
+		free(voice->block);
+		free(voice->samples);
+		free(voice);
+	}
+}
+
+// Opens a track from the archive or disk, NULL if it can't be played
+static PNLMusicVoice _pnlMusicVoiceOpen(PNLMusicStream stream, const PNLMusicRequest *request) {
+	PNLMusicVoice voice = calloc(1, sizeof(struct PNLMusicVoice));
+	if (voice == NULL)
+		return NULL;
+	voice->frames = -1;
+
+	bool ok = false;
+	const PNLArchiveEntry *entry = stream->archive != NULL ? pnlAssetArchiveFind(stream->archive, request->path) : NULL;
+	if (entry != NULL) {
+		voice->memory = pnlAssetArchiveData(stream->archive, entry);
+		voice->size = entry->size;
+		if (entry->kind == ak_Samples) {
+			voice->format = PCM_FORMAT;
+			voice->channels = entry->width;
+			voice->rate = entry->height;
+			voice->bits = entry->bits;
+			voice->dataSize = entry->size;
+			ok = true;
+		} else if (entry->kind == ak_Raw) {
+			ok = _pnlMusicVoiceParseWav(voice);
+		}
+	} else {
+		voice->file = fopen(request->path, "rb");
+		if (voice->file != NULL && fseek(voice->file, 0, SEEK_END) == 0) {
+			long size = ftell(voice->file);
+			voice->size = size > 0 ? size : 0;
+			ok = _pnlMusicVoiceParseWav(voice);
+		}
+	}
+
+	ok = ok && _pnlMusicVoiceSetup(voice);
+	SDL_AtomicAdd(&stream->memory, voice->bytes);
+	if (!ok) {
+		_pnlMusicVoiceClose(stream, voice);
+		return NULL;
+	}
+	voice->loop = request->loop;
+	voice->left = request->left;
+	voice->right = request->right;
+	return voice;
+}
+
+// Decodes the next chunk into the converter, false once the track is over
+static bool _pnlMusicVoiceFeed(PNLMusicVoice voice) {
+	if (voice->framesDone >= voice->frames) {
+		if (!voice->loop || voice->framesDone == 0)
+			return false;
+		voice->position = 0;
+		voice->framesDone = 0;
+	}
+
+	size_t size = voice->dataSize - voice->position < (uint64_t)voice->chunkBytes ? voice->dataSize - voice->position : voice->chunkBytes;
+	const unsigned char *bytes = size > 0 ? _pnlMusicVoiceBytes(voice, voice->dataStart + voice->position, size, voice->block) : NULL;
+	int frames = 0;
+	if (bytes != NULL && voice->format == PNL_ADPCM_FORMAT) {
+		frames = pnlAdpcmDecodeBlock(bytes, (int)size, voice->channels, voice->samples);
+	} else if (bytes != NULL && voice->bits == 16) {
+		frames = (int)(size / (2 * voice->channels));
+		for (int i = 0; i < frames * voice->channels; i++)
+			voice->samples[i] = (int16_t)_pnlRead16(bytes + (i * 2));
+	} else if (bytes != NULL) {
+		frames = (int)(size / voice->channels);
+		for (int i = 0; i < frames * voice->channels; i++)
+			voice->samples[i] = (int16_t)((bytes[i] - 128) << 8);
+	}
+	voice->position += size;
+
+	// A track that ends early (or can't be read) ends where it stopped, looping from there if it loops
+	if (frames > voice->frames - voice->framesDone)
+		frames = (int)(voice->frames - voice->framesDone);
+	if (frames == 0) {
+		voice->frames = voice->framesDone;
+		return voice->loop && voice->framesDone > 0;
+	}
+	voice->framesDone += frames;
+	return SDL_AudioStreamPut(voice->convert, voice->samples, frames * voice->channels * sizeof(int16_t)) == 0;
+}
+
+// Adds a chunk of a voice to the mix, false once it has nothing left and can be closed
+static bool _pnlMusicVoiceMix(PNLMusicVoice voice, float *mix, float *scratch, int frames) {
+	int got = 0;
+	while (got < frames) {
+		int bytes = SDL_AudioStreamGet(voice->convert, scratch + (got * 2), (frames - got) * 2 * sizeof(float));
+		if (bytes < 0)
+			break;
+		got += bytes / (2 * sizeof(float));
+		if (got < frames && !_pnlMusicVoiceFeed(voice)) {
+			if (voice->flushed)
+				break;
+			SDL_AudioStreamFlush(voice->convert); // Gets the last bit out of the resampler
+			voice->flushed = true;
+		}
+	}
+
+	// Equal power so a crossfade doesn't dip in the middle
+	float volume = sinf(voice->gain * HALF_PI);
+	for (int i = 0; i < got; i++) {
+		if (voice->gain != voice->target) {
+			voice->gain = voice->gain < voice->target ? fminf(voice->gain + voice->step, voice->target) : fmaxf(voice->gain - voice->step, voice->target);
+			volume = sinf(voice->gain * HALF_PI);
+		}
+		mix[(i * 2)] += scratch[(i * 2)] * volume * voice->left;
+		mix[(i * 2) + 1] += scratch[(i * 2) + 1] * volume * voice->right;
+	}
+	return got == frames && (voice->gain > 0 || voice->target > 0);
+}
+
+// Starts whatever the game asked for last, what's playing becomes what's fading
+static void _pnlMusicTakeRequest(PNLMusicStream stream) {
+	SDL_LockMutex(stream->lock);
+	bool requested = stream->requested;
+	PNLMusicRequest request = stream->request;
+	stream->requested = false;
+	SDL_UnlockMutex(stream->lock);
+	if (!requested)
+		return;
+
+	// Only two tracks at a time, anything still fading out is cut off
+	float step = request.fade > 0 ? 1.0f / (request.fade * PNL_MUSIC_RATE) : 1;
+	_pnlMusicVoiceClose(stream, stream->fading);
+	stream->fading = stream->playing;
+	stream->playing = NULL;
+	if (stream->fading != NULL) {
+		stream->fading->target = 0;
+		stream->fading->step = step;
+	}
+	if (request.path[0] != 0 && (stream->playing = _pnlMusicVoiceOpen(stream, &request)) != NULL) {
+		stream->playing->gain = request.fade > 0 ? 0 : 1;
+		stream->playing->target = 1;
+		stream->playing->step = step;
+	}
+}
+
+// Mixes a chunk into the ring, false if there wasn't room for one
+static bool _pnlMusicPump(PNLMusicStream stream) {
+	_pnlMusicTakeRequest(stream);
+	unsigned int written = (unsigned int)SDL_AtomicGet(&stream->written);
+	unsigned int queued = written - (unsigned int)SDL_AtomicGet(&stream->read);
+	if (queued + PNL_MUSIC_CHUNK_FRAMES > PNL_MUSIC_RING_FRAMES)
+		return false;
+
+	PNL_PROFILE_BEGIN("_pnlMusicPump");
+	memset(stream->mix, 0, sizeof(float) * PNL_MUSIC_CHUNK_FRAMES * 2);
+	if (stream->playing != NULL && !_pnlMusicVoiceMix(stream->playing, stream->mix, stream->scratch, PNL_MUSIC_CHUNK_FRAMES)) {
+		_pnlMusicVoiceClose(stream, stream->playing);
+		stream->playing = NULL;
+	}
+	if (stream->fading != NULL && !_pnlMusicVoiceMix(stream->fading, stream->mix, stream->scratch, PNL_MUSIC_CHUNK_FRAMES)) {
+		_pnlMusicVoiceClose(stream, stream->fading);
+		stream->fading = NULL;
+	}
+
+	for (int i = 0; i < PNL_MUSIC_CHUNK_FRAMES * 2; i++) {
+		float sample = stream->mix[i] * 32767;
+		stream->ring[((written * 2) + i) & ((PNL_MUSIC_RING_FRAMES * 2) - 1)] = (int16_t)(sample > 32767 ? 32767 : (sample < -32768 ? -32768 : sample));
+	}
+	SDL_AtomicSet(&stream->written, (int)(written + PNL_MUSIC_CHUNK_FRAMES)); // Full barrier, the samples are there before the reader can see them
+	PNL_PROFILE_END();
+	return true;
+}
+
+static int _pnlMusicThread(void *data) {
+	PNLMusicStream stream = data;
+	PNL_PROFILE_THREAD("music");
+	while (!SDL_AtomicGet(&stream->quit))
+		if (!_pnlMusicPump(stream))
+			SDL_SemWaitTimeout(stream->space, 10); // Timeout so requests still get picked up if the device stalls
+	return 0;
+}
+
+static void _pnlMusicCallback(void *data, Uint8 *out, int length) {
+	PNL_PROFILE_THREAD("music device");
+	PNL_PROFILE_BEGIN("pnlMusicStreamRead");
+	pnlMusicStreamRead(data, (int16_t*)out, length / (int)(sizeof(int16_t) * 2));
+	PNL_PROFILE_END();
+}
+
+PNLMusicStream pnlMusicStreamCreate(PNLAssetArchive archive, bool device) {
+	PNLMusicStream stream = calloc(1, sizeof(struct PNLMusicStream));
+	if (stream == NULL)
+		return NULL;
+	stream->archive = archive;
+	stream->ring = calloc(PNL_MUSIC_RING_FRAMES * 2, sizeof(int16_t));
+	stream->mix = malloc(sizeof(float) * PNL_MUSIC_CHUNK_FRAMES * 2);
+	stream->scratch = malloc(sizeof(float) * PNL_MUSIC_CHUNK_FRAMES * 2);
+	stream->space = SDL_CreateSemaphore(0);
+	stream->lock = SDL_CreateMutex();
+	if (stream->ring == NULL || stream->mix == NULL || stream->scratch == NULL || stream->space == NULL || stream->lock == NULL) {
+		pnlMusicStreamFree(stream);
+		return NULL;
+	}
+
+	// The decoder is started first so the device has something to play right away
+	if (device) {
+		SDL_AudioSpec want = {0};
+		want.freq = PNL_MUSIC_RATE;
+		want.format = AUDIO_S16SYS;
+		want.channels = 2;
+		want.samples = PNL_MUSIC_DEVICE_FRAMES;
+		want.callback = _pnlMusicCallback;
+		want.userdata = stream;
+		stream->thread = SDL_CreateThread(_pnlMusicThread, "music", stream);
+		if (stream->thread != NULL && SDL_InitSubSystem(SDL_INIT_AUDIO) == 0) {
+			stream->device = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0); // SDL converts if the device wants something else
+			if (stream->device == 0)
+				SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		}
+		if (stream->device == 0) {
+			pnlMusicStreamFree(stream);
+			return NULL;
+		}
+		SDL_PauseAudioDevice(stream->device, 0);
+	}
+	return stream;
+}
+
+void pnlMusicStreamPlay(PNLMusicStream stream, const char *path, bool loop, float fade, float left, float right) {
+	SDL_LockMutex(stream->lock);
+	snprintf(stream->request.path, PNL_ARCHIVE_PATH_LENGTH, "%s", path);
+	stream->request.loop = loop;
+	stream->request.fade = fade;
+	stream->request.left = left;
+	stream->request.right = right;
+	stream->requested = true;
+	SDL_UnlockMutex(stream->lock);
+}
+
+void pnlMusicStreamStop(PNLMusicStream stream, float fade) {
+	SDL_LockMutex(stream->lock);
+	stream->request.path[0] = 0;
+	stream->request.fade = fade;
+	stream->requested = true;
+	SDL_UnlockMutex(stream->lock);
+}
+
+int pnlMusicStreamRead(PNLMusicStream stream, int16_t *out, int frames) {
+	if (stream->thread == NULL)
+		while ((unsigned int)SDL_AtomicGet(&stream->written) - (unsigned int)SDL_AtomicGet(&stream->read) < (unsigned int)frames && _pnlMusicPump(stream));
+
+	unsigned int read = (unsigned int)SDL_AtomicGet(&stream->read);
+	unsigned int available = (unsigned int)SDL_AtomicGet(&stream->written) - read;
+	int count = available < (unsigned int)frames ? (int)available : frames;
+	for (int i = 0; i < count * 2; i++)
+		out[i] = stream->ring[((read * 2) + i) & ((PNL_MUSIC_RING_FRAMES * 2) - 1)];
+	memset(out + (count * 2), 0, sizeof(int16_t) * 2 * (frames - count));
+	if (count < frames)
+		SDL_AtomicAdd(&stream->underruns, 1);
+	SDL_AtomicSet(&stream->read, (int)(read + count));
+	SDL_SemPost(stream->space);
+	return count;
+}
+
+size_t pnlMusicStreamMemory(PNLMusicStream stream) {
+	return (sizeof(int16_t) * PNL_MUSIC_RING_FRAMES * 2) + (sizeof(float) * PNL_MUSIC_CHUNK_FRAMES * 4) + SDL_AtomicGet(&stream->memory);
+}
+
+void pnlMusicStreamFree(PNLMusicStream stream) {
+	if (stream != NULL) {
+		if (stream->device != 0) {
+			SDL_CloseAudioDevice(stream->device); // Waits for the callback to finish
+			SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		}
+		if (stream->thread != NULL) {
+			SDL_AtomicSet(&stream->quit, 1);
+			SDL_SemPost(stream->space);
+			SDL_WaitThread(stream->thread, NULL);
+		}
+		_pnlMusicVoiceClose(stream, stream->playing);
+		_pnlMusicVoiceClose(stream, stream->fading);
+		if (stream->space != NULL)
+			SDL_DestroySemaphore(stream->space);
+		if (stream->lock != NULL)
+			SDL_DestroyMutex(stream->lock);
+		free(stream->ring);
+		free(stream->mix);
+		free(stream->scratch);
+		free(stream);
+	}
+}
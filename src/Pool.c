@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include "Pool.h"
+
+PNLPool pnlPoolCreate(int chunkSize) {
+	PNLPool pool = calloc(1, sizeof(struct PNLPool));
+	if (pool != NULL) {
+		pool->chunkSize = chunkSize;
+		pool->freeHead = -1;
+	}
+	return pool;
+}
+
+static bool _pnlPoolGrow(PNLPool pool) {
+	int capacity = pool->capacity + pool->chunkSize;
+	int *next = realloc(pool->next, sizeof(int) * capacity);
+	if (next == NULL)
+		return false;
+	pool->next = next;
+	int *live = realloc(pool->live, sizeof(int) * capacity);
+	if (live == NULL)
+		return false;
+	pool->live = live;
+	int *liveIndex = realloc(pool->liveIndex, sizeof(int) * capacity);
+	if (liveIndex == NULL)
+		return false;
+	pool->liveIndex = liveIndex;
+
+	// Link the new slots in ascending order so the lowest ids get used first
+	for (int i = capacity - 1; i >= pool->capacity; i--) {
+		pool->next[i] = pool->freeHead;
+		pool->liveIndex[i] = -1;
+		pool->freeHead = i;
+	}
+	pool->capacity = capacity;
+	pool->growths++;
+	return true;
+}
+
+int pnlPoolAcquire(PNLPool pool) {
+	if (pool->freeHead == -1 && !_pnlPoolGrow(pool))
+		return -1;
+	int id = pool->freeHead;
+	pool->freeHead = pool->next[id];
+	pool->liveIndex[id] = pool->liveCount;
+	pool->live[pool->liveCount++] = id;
+	if (pool->liveCount > pool->highWater)
+		pool->highWater = pool->liveCount;
+	return id;
+}
+
+bool pnlPoolReserve(PNLPool pool, int count) {
+	while (pool->capacity < count)
+		if (!_pnlPoolGrow(pool))
+			return false;
+	return true;
+}
+
+void pnlPoolRelease(PNLPool pool, int id) {
+	int index = pool->liveIndex[id];
+	if (index == -1)
+		return;
+	int last = pool->live[--pool->liveCount];
+	pool->live[index] = last;
+	pool->liveIndex[last] = index;
+	pool->liveIndex[id] = -1;
+	pool->next[id] = pool->freeHead;
+	pool->freeHead = id;
+}
+
+void pnlPoolClear(PNLPool pool) {
+	while (pool->liveCount > 0)
+		pnlPoolRelease(pool, pool->live[pool->liveCount - 1]);
+}
+
+int pnlPoolChunkCount(PNLPool pool) {
+	return pool->capacity / pool->chunkSize;
+}
+
+void pnlPoolFree(PNLPool pool) {
+	if (pool != NULL) {
+		free(pool->next);
+		free(pool->live);
+		free(pool->liveIndex);
+		free(pool);
+	}
+}
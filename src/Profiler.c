@@ -0,0 +1,268 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Profiler.h"
+
+// Every thread's ring, threads claim them in the order they start recording
+static struct {
+	SDL_atomic_t running;
+	SDL_mutex *lock;              // Only dumps take it
+	PNLProfilerThread *threads;   // PNL_PROFILER_THREADS of them
+	SDL_atomic_t threadCount;     // Rings claimed, goes past PNL_PROFILER_THREADS once they're all taken
+	Uint64 start;
+	const char *name;
+} _pnlProfiler;
+
+static _Thread_local PNLProfilerThread *_pnlProfilerSelf;
+static _Thread_local bool _pnlProfilerIgnored; // Every ring was taken by the time this thread wanted one
+static _Thread_local const char *_pnlProfilerSelfName; // Kept in case the thread is named before recording starts
+
+// One thread's events copied out of its ring for a dump
+typedef struct PNLProfilerCopy {
+	SDL_threadID id;
+	int index;
+	const char *name;
+	PNLProfileEvent *events; // Just the ones in the dump's window, oldest first
+	int count;
+} PNLProfilerCopy;
+
+// The calling thread's ring, claiming one the first time, NULL if it can't record
+static PNLProfilerThread *_pnlProfilerThread() {
+	if (!SDL_AtomicGet(&_pnlProfiler.running) || _pnlProfilerIgnored)
+		return NULL;
+	if (_pnlProfilerSelf != NULL)
+		return _pnlProfilerSelf;
+
+	int index = SDL_AtomicAdd(&_pnlProfiler.threadCount, 1);
+	if (index >= PNL_PROFILER_THREADS) {
+		_pnlProfilerIgnored = true;
+		return NULL;
+	}
+	PNLProfilerThread *thread = &_pnlProfiler.threads[index];
+	thread->id = SDL_ThreadID();
+	thread->index = index;
+	SDL_AtomicSetPtr(&thread->name, (void*)_pnlProfilerSelfName);
+	SDL_AtomicSet(&thread->claimed, 1); // Full barrier, a dump that sees the ring claimed sees the id too
+	_pnlProfilerSelf = thread;
+	return thread;
+}
+
+static void _pnlProfilerRecord(PNLProfilerThread *thread, const PNLProfileEvent *event) {
+	thread->events[thread->count & (thread->capacity - 1)] = *event;
+	thread->count++;
+	SDL_AtomicSet(&thread->written, (int)thread->count); // Full barrier, the event is there before a dump can see it
+}
+
+// Copies whatever of a thread's ring is inside the window, dropping whatever the thread could have
+// written over while it was copied, the slot it's writing right now included
+static bool _pnlProfilerCopy(PNLProfilerThread *thread, PNLProfilerCopy *copy, Uint64 cutoff) {
+	unsigned int end = (unsigned int)SDL_AtomicGet(&thread->written);
+	unsigned int first = end > thread->capacity ? end - thread->capacity : 0;
+	copy->events = malloc(sizeof(PNLProfileEvent) * (end > first ? end - first : 1));
+	if (copy->events == NULL)
+		return false;
+	for (unsigned int i = first; i != end; i++)
+		copy->events[i - first] = thread->events[i & (thread->capacity - 1)];
+	unsigned int after = (unsigned int)SDL_AtomicGet(&thread->written);
+	unsigned int begin = after + 1 > thread->capacity ? after + 1 - thread->capacity : 0;
+	begin = begin < first ? first : (begin > end ? end : begin);
+
+	copy->count = 0;
+	for (unsigned int i = begin; i != end; i++) {
+		const PNLProfileEvent *event = &copy->events[i - first];
+		Uint64 finish = event->type == pe_Span ? event->start + event->duration : event->start;
+		if (finish >= cutoff)
+			copy->events[copy->count++] = *event;
+	}
+	copy->id = thread->id;
+	copy->index = thread->index;
+	copy->name = SDL_AtomicGetPtr(&thread->name);
+	return true;
+}
+
+// Writes a JSON string, names are usually literals but asset paths on Windows have backslashes
+static void _pnlProfilerWriteString(FILE *file, const char *string) {
+	fputc('"', file);
+	for (const char *c = string; *c != 0; c++) {
+		if (*c == '"' || *c == '\\')
+			fprintf(file, "\\%c", *c);
+		else if ((unsigned char)*c < 0x20)
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+		else
+			fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+/********************** Recording **********************/
+
+void pnlProfilerStart(const char *name) {
+	if (SDL_AtomicGet(&_pnlProfiler.running))
+		return;
+	_pnlProfiler.lock = SDL_CreateMutex();
+	_pnlProfiler.threads = calloc(PNL_PROFILER_THREADS, sizeof(PNLProfilerThread));
+	bool ok = _pnlProfiler.lock != NULL && _pnlProfiler.threads != NULL;
+	for (int i = 0; i < PNL_PROFILER_THREADS && ok; i++) {
+		_pnlProfiler.threads[i].capacity = i == 0 ? PNL_PROFILER_MAIN_EVENTS : PNL_PROFILER_EVENTS;
+		_pnlProfiler.threads[i].events = malloc(sizeof(PNLProfileEvent) * _pnlProfiler.threads[i].capacity);
+		ok = _pnlProfiler.threads[i].events != NULL;
+	}
+	if (!ok) {
+		for (int i = 0; i < PNL_PROFILER_THREADS && _pnlProfiler.threads != NULL; i++)
+			free(_pnlProfiler.threads[i].events);
+		free(_pnlProfiler.threads);
+		if (_pnlProfiler.lock != NULL)
+			SDL_DestroyMutex(_pnlProfiler.lock);
+		memset(&_pnlProfiler, 0, sizeof(_pnlProfiler));
+		return;
+	}
+	_pnlProfiler.name = name;
+	_pnlProfiler.start = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&_pnlProfiler.running, 1);
+	_pnlProfilerIgnored = false;
+	_pnlProfilerThread(); // Takes the first ring, the big one
+}
+
+bool pnlProfilerRunning() {
+	return SDL_AtomicGet(&_pnlProfiler.running) != 0;
+}
+
+void pnlProfilerNameThread(const char *name) {
+	_pnlProfilerSelfName = name;
+	PNLProfilerThread *thread = _pnlProfilerThread();
+	if (thread != NULL && SDL_AtomicGetPtr(&thread->name) != name) // Audio callbacks name themselves every time they're called
+		SDL_AtomicSetPtr(&thread->name, (void*)name);
+}
+
+void pnlProfilerIgnoreThread() {
+	_pnlProfilerIgnored = _pnlProfilerSelf == NULL;
+}
+
+void pnlProfilerBegin(const char *name) {
+	PNLProfilerThread *thread = _pnlProfilerThread();
+	if (thread == NULL)
+		return;
+	if (thread->depth < PNL_PROFILER_DEPTH) {
+		thread->stackNames[thread->depth] = name;
+		thread->stackStarts[thread->depth] = SDL_GetPerformanceCounter();
+	}
+	thread->depth++;
+}
+
+void pnlProfilerEnd() {
+	PNLProfilerThread *thread = _pnlProfilerThread();
+	if (thread == NULL || thread->depth == 0)
+		return; // Began before recording started
+	thread->depth--;
+	if (thread->depth < PNL_PROFILER_DEPTH) {
+		PNLProfileEvent event = {0};
+		event.name = thread->stackNames[thread->depth];
+		event.start = thread->stackStarts[thread->depth];
+		event.duration = SDL_GetPerformanceCounter() - event.start;
+		event.type = pe_Span;
+		_pnlProfilerRecord(thread, &event);
+	}
+}
+
+void pnlProfilerCounter(const char *name, double value) {
+	PNLProfilerThread *thread = _pnlProfilerThread();
+	if (thread == NULL)
+		return;
+	PNLProfileEvent event = {0};
+	event.name = name;
+	event.start = SDL_GetPerformanceCounter();
+	event.value = value;
+	event.type = pe_Counter;
+	_pnlProfilerRecord(thread, &event);
+}
+
+/********************** Dumping **********************/
+
+int pnlProfilerDump(FILE *file, double seconds) {
+	if (file == NULL)
+		return -1;
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 window = (Uint64)(seconds * frequency);
+	Uint64 cutoff = now > window ? now - window : 0;
+
+	// Only copying happens under the lock, the file is written after it's let go
+	PNLProfilerCopy copies[PNL_PROFILER_THREADS];
+	int copyCount = 0;
+	const char *name = NULL;
+	Uint64 start = 0;
+	bool ok = true;
+	if (pnlProfilerRunning()) {
+		SDL_LockMutex(_pnlProfiler.lock);
+		name = _pnlProfiler.name;
+		start = _pnlProfiler.start;
+		int claimed = SDL_AtomicGet(&_pnlProfiler.threadCount);
+		for (int i = 0; i < claimed && i < PNL_PROFILER_THREADS && ok; i++) {
+			PNLProfilerThread *thread = &_pnlProfiler.threads[i];
+			if (!SDL_AtomicGet(&thread->claimed))
+				continue; // Still being claimed, it hasn't recorded anything yet
+			ok = _pnlProfilerCopy(thread, &copies[copyCount], cutoff);
+			copyCount += ok;
+		}
+		SDL_UnlockMutex(_pnlProfiler.lock);
+	}
+
+	int written = 0;
+	if (ok) {
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":");
+		if (name != NULL)
+			_pnlProfilerWriteString(file, name);
+		else
+			fprintf(file, "\"not recording\"");
+		fprintf(file, "}}");
+		for (int i = 0; i < copyCount; i++) {
+			PNLProfilerCopy *copy = &copies[i];
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", copy->index);
+			if (copy->name != NULL) {
+				_pnlProfilerWriteString(file, copy->name);
+			} else {
+				fprintf(file, "\"thread %lu\"", (unsigned long)copy->id);
+			}
+			fprintf(file, "}}");
+
+			for (int j = 0; j < copy->count; j++) {
+				const PNLProfileEvent *event = &copy->events[j];
+				fprintf(file, ",\n{\"name\":");
+				_pnlProfilerWriteString(file, event->name);
+				double timestamp = ((double)(event->start - start) / frequency) * 1000000;
+				if (event->type == pe_Span)
+					fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i}", timestamp, ((double)event->duration / frequency) * 1000000, copy->index);
+				else
+					fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%i,\"args\":{\"value\":%.10g}}", timestamp, copy->index, event->value);
+				written++;
+			}
+		}
+		fprintf(file, "\n]}\n");
+	}
+	for (int i = 0; i < copyCount; i++)
+		free(copies[i].events);
+	return ok && !ferror(file) ? written : -1;
+}
+
+int pnlProfilerDumpFile(const char *filename, double seconds) {
+	FILE *file = fopen(filename, "w");
+	if (file == NULL)
+		return -1;
+	int written = pnlProfilerDump(file, seconds);
+	if (fclose(file) != 0)
+		return -1;
+	return written;
+}
+
+void pnlProfilerQuit() {
+	if (!pnlProfilerRunning())
+		return;
+	SDL_AtomicSet(&_pnlProfiler.running, 0);
+	for (int i = 0; i < PNL_PROFILER_THREADS; i++)
+		free(_pnlProfiler.threads[i].events);
+	free(_pnlProfiler.threads);
+	SDL_DestroyMutex(_pnlProfiler.lock);
+	memset(&_pnlProfiler, 0, sizeof(_pnlProfiler));
+	_pnlProfilerSelf = NULL;
+	_pnlProfilerIgnored = false;
+}
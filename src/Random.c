@@ -0,0 +1,147 @@
+#include <math.h>
+#include "Random.h"
+
+static inline uint64_t _pnlRotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64, turns any seed (including 0) into well mixed state for xoshiro
+static uint64_t _pnlSplitMix(uint64_t *x) {
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+void pnlRandomSeed(PNLRandom *rng, uint64_t seed, uint64_t stream) {
+	// Mixing the stream in before expanding means neighbouring streams start nowhere near each other
+	uint64_t x = seed;
+	uint64_t mixed = _pnlSplitMix(&x) ^ (stream * 0xd1b54a32d192ed03ull);
+	x = mixed;
+	for (int i = 0; i < 4; i++)
+		rng->s[i] = _pnlSplitMix(&x);
+}
+
+uint64_t pnlRandomNext(PNLRandom *rng) {
+	uint64_t *s = rng->s;
+	uint64_t result = _pnlRotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = _pnlRotl(s[3], 45);
+	return result;
+}
+
+double pnlRandomReal(PNLRandom *rng) {
+	// Top 53 bits fill a double's mantissa exactly
+	return (double)(pnlRandomNext(rng) >> 11) * 0x1.0p-53;
+}
+
+int pnlRandomInt(PNLRandom *rng, int n) {
+	// Multiply-shift instead of modulo, the bias is at most n / 2^32
+	return (int)(((pnlRandomNext(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+void pnlRandomSample(PNLRandom *rng, int n, int count, int *out) {
+	// Floyd - each step either takes a new value or, if it's already taken, the top of the current range
+	for (int i = 0; i < count; i++) {
+		int j = n - count + i;
+		int t = pnlRandomInt(rng, j + 1);
+		bool taken = false;
+		for (int k = 0; k < i && !taken; k++)
+			taken = out[k] == t;
+		out[i] = taken ? j : t;
+	}
+
+	// Floyd picks a uniform subset but not a uniform order
+	for (int i = count - 1; i > 0; i--) {
+		int j = pnlRandomInt(rng, i + 1);
+		int temp = out[i];
+		out[i] = out[j];
+		out[j] = temp;
+	}
+}
+
+static double _pnlPositivePow(double x, int power) {
+	if (x <= 0)
+		return 0;
+	double result = 1;
+	for (int i = 0; i < power; i++)
+		result *= x;
+	return result;
+}
+
+// Sum of (x - corner)^power over every corner of the box the scales describe, signed by parity
+static double _pnlCornerSum(const double *scales, int count, double x, int power) {
+	double sum = 0;
+	for (unsigned int subset = 0; subset < (1u << count); subset++) {
+		double corner = 0;
+		int bits = 0;
+		for (int i = 0; i < count; i++) {
+			if (subset & (1u << i)) {
+				corner += scales[i];
+				bits++;
+			}
+		}
+		sum += (bits % 2 == 0 ? 1 : -1) * _pnlPositivePow(x - corner, power);
+	}
+	return sum;
+}
+
+double pnlUniformSumCdf(const double *scales, int count, double x) {
+	if (count == 0)
+		return x >= 0 ? 1 : 0;
+	double denominator = 1;
+	for (int i = 0; i < count; i++)
+		denominator *= scales[i] * (i + 1);
+	double cdf = _pnlCornerSum(scales, count, x, count) / denominator;
+	return cdf < 0 ? 0 : (cdf > 1 ? 1 : cdf);
+}
+
+// Integral of pnlUniformSumCdf(scales, count, x - scale * u) for u from 0 to y, closed form
+static double _pnlUniformSumCdfIntegral(const double *scales, int count, double x, double scale, double y) {
+	double denominator = scale * (count + 1);
+	for (int i = 0; i < count; i++)
+		denominator *= scales[i] * (i + 1);
+	return (_pnlCornerSum(scales, count, x, count + 1) - _pnlCornerSum(scales, count, x - (scale * y), count + 1)) / denominator;
+}
+
+void pnlRandomConstrainedUniforms(PNLRandom *rng, const double *scales, int count, double minimum, double *out) {
+	if (count == 0)
+		return;
+	if (1 - pnlUniformSumCdf(scales, count, minimum) <= 0) {
+		for (int i = 0; i < count; i++)
+			out[i] = pnlRandomReal(rng);
+		return;
+	}
+
+	// Each value is weighted by how likely the ones after it are to still meet what's left of the minimum,
+	// the weight integrates to a closed form so it can be inverted with Newton's method (kept inside a
+	// bisection bracket so it can't wander off where the weight flattens out)
+	double remaining = minimum;
+	for (int i = 0; i < count; i++) {
+		const double *rest = scales + i + 1;
+		int restCount = count - i - 1;
+		double total = 1 - _pnlUniformSumCdfIntegral(rest, restCount, remaining, scales[i], 1);
+		double target = pnlRandomReal(rng) * total;
+		double low = 0, high = 1, x = 0.5;
+		for (int step = 0; step < 64 && high - low > 1e-12; step++) {
+			double error = x - _pnlUniformSumCdfIntegral(rest, restCount, remaining, scales[i], x) - target;
+			double weight = 1 - pnlUniformSumCdf(rest, restCount, remaining - (scales[i] * x));
+			if (error < 0)
+				low = x;
+			else
+				high = x;
+			if (fabs(error) < 1e-14)
+				break;
+			x = weight > 0 ? x - (error / weight) : -1;
+			if (x <= low || x >= high)
+				x = (low + high) / 2;
+		}
+		out[i] = x < 1 ? x : low;
+		remaining -= scales[i] * out[i];
+	}
+}
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Replay.h"
+
+#define REPLAY_MAGIC "PNLR"
+#define REPLAY_VERSION ((uint32_t)1)
+
+// Which fields a record holds
+#define REPLAY_BUTTONS ((uint8_t)1)
+#define REPLAY_MOUSE_X ((uint8_t)2)
+#define REPLAY_MOUSE_Y ((uint8_t)4)
+#define REPLAY_DELTA   ((uint8_t)8)
+
+static void _pnlReplayPut(PNLReplay replay, uint32_t value, int size) {
+	uint8_t bytes[4];
+	for (int i = 0; i < size; i++)
+		bytes[i] = (uint8_t)(value >> (i * 8));
+	fwrite(bytes, 1, size, replay->file);
+	replay->bytes += size;
+}
+
+static bool _pnlReplayGet(PNLReplay replay, uint32_t *value, int size) {
+	uint8_t bytes[4];
+	if (fread(bytes, 1, size, replay->file) != (size_t)size)
+		return false;
+	*value = 0;
+	for (int i = 0; i < size; i++)
+		*value |= (uint32_t)bytes[i] << (i * 8);
+	replay->bytes += size;
+	return true;
+}
+
+// Floats are stored as their bits so playback gets back exactly what was recorded
+static uint32_t _pnlFloatBits(float f) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(float));
+	return bits;
+}
+
+static float _pnlBitsFloat(uint32_t bits) {
+	float f;
+	memcpy(&f, &bits, sizeof(float));
+	return f;
+}
+
+static PNLReplay _pnlReplayCreate(const char *filename, bool recording) {
+	PNLReplay replay = calloc(1, sizeof(struct PNLReplay));
+	if (replay == NULL)
+		return NULL;
+	replay->file = fopen(filename, recording ? "wb" : "rb");
+	if (replay->file == NULL) {
+		free(replay);
+		return NULL;
+	}
+	replay->recording = recording;
+	return replay;
+}
+
+PNLReplay pnlReplayRecord(const char *filename, uint64_t seed) {
+	PNLReplay replay = _pnlReplayCreate(filename, true);
+	if (replay == NULL)
+		return NULL;
+	replay->seed = seed;
+	fwrite(REPLAY_MAGIC, 1, 4, replay->file);
+	replay->bytes += 4;
+	_pnlReplayPut(replay, REPLAY_VERSION, 4);
+	_pnlReplayPut(replay, (uint32_t)seed, 4);
+	_pnlReplayPut(replay, (uint32_t)(seed >> 32), 4);
+	return replay;
+}
+
+PNLReplay pnlReplayOpen(const char *filename) {
+	PNLReplay replay = _pnlReplayCreate(filename, false);
+	if (replay == NULL)
+		return NULL;
+	char magic[4];
+	uint32_t version, seedLow, seedHigh;
+	if (fread(magic, 1, 4, replay->file) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0 ||
+		!_pnlReplayGet(replay, &version, 4) || version != REPLAY_VERSION ||
+		!_pnlReplayGet(replay, &seedLow, 4) || !_pnlReplayGet(replay, &seedHigh, 4)) {
+		pnlReplayClose(replay);
+		return NULL;
+	}
+	replay->bytes += 4;
+	replay->seed = ((uint64_t)seedHigh << 32) | seedLow;
+	return replay;
+}
+
+void pnlReplayWrite(PNLReplay replay, const PNLReplayFrame *frame) {
+	// Fields are compared by bits, not value, so -0 and NaNs survive the trip too
+	uint8_t mask = 0;
+	if (replay->frames == 0 || frame->buttons != replay->last.buttons)
+		mask |= REPLAY_BUTTONS;
+	if (replay->frames == 0 || _pnlFloatBits(frame->mouseX) != _pnlFloatBits(replay->last.mouseX))
+		mask |= REPLAY_MOUSE_X;
+	if (replay->frames == 0 || _pnlFloatBits(frame->mouseY) != _pnlFloatBits(replay->last.mouseY))
+		mask |= REPLAY_MOUSE_Y;
+	if (replay->frames == 0 || _pnlFloatBits(frame->delta) != _pnlFloatBits(replay->last.delta))
+		mask |= REPLAY_DELTA;
+
+	_pnlReplayPut(replay, mask, 1);
+	if (mask & REPLAY_BUTTONS)
+		_pnlReplayPut(replay, frame->buttons, 4);
+	if (mask & REPLAY_MOUSE_X)
+		_pnlReplayPut(replay, _pnlFloatBits(frame->mouseX), 4);
+	if (mask & REPLAY_MOUSE_Y)
+		_pnlReplayPut(replay, _pnlFloatBits(frame->mouseY), 4);
+	if (mask & REPLAY_DELTA)
+		_pnlReplayPut(replay, _pnlFloatBits(frame->delta), 4);
+	replay->last = *frame;
+	replay->frames++;
+}
+
+bool pnlReplayRead(PNLReplay replay, PNLReplayFrame *frame) {
+	// A record cut off partway through (the game was killed while recording) counts as the end
+	uint32_t mask, buttons, mouseX, mouseY, delta;
+	if (!_pnlReplayGet(replay, &mask, 1) ||
+		((mask & REPLAY_BUTTONS) && !_pnlReplayGet(replay, &buttons, 4)) ||
+		((mask & REPLAY_MOUSE_X) && !_pnlReplayGet(replay, &mouseX, 4)) ||
+		((mask & REPLAY_MOUSE_Y) && !_pnlReplayGet(replay, &mouseY, 4)) ||
+		((mask & REPLAY_DELTA) && !_pnlReplayGet(replay, &delta, 4)))
+		return false;
+	*frame = replay->last;
+	if (mask & REPLAY_BUTTONS)
+		frame->buttons = buttons;
+	if (mask & REPLAY_MOUSE_X)
+		frame->mouseX = _pnlBitsFloat(mouseX);
+	if (mask & REPLAY_MOUSE_Y)
+		frame->mouseY = _pnlBitsFloat(mouseY);
+	if (mask & REPLAY_DELTA)
+		frame->delta = _pnlBitsFloat(delta);
+	replay->last = *frame;
+	replay->frames++;
+	return true;
+}
+
+void pnlReplayClose(PNLReplay replay) {
+	if (replay != NULL) {
+		fclose(replay->file);
+		free(replay);
+	}
+}
@@ -0,0 +1,435 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "SaveStore.h"
+#include "FileUtil.h"
+#include "Profiler.h"
+
+#define SAVE_MAGIC "PNLS"
+#define SAVE_VERSION ((uint32_t)1)
+#define SAVE_HEADER_SIZE ((size_t)8)
+#define SAVE_RECORD_HEADER_SIZE ((size_t)8) // Body size then checksum
+
+// What a record's value is
+#define SAVE_NUMBER ((uint8_t)0)
+#define SAVE_STRING ((uint8_t)1)
+
+static double _pnlSeconds(Uint64 start) {
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+// FNV-1a, used for both looking keys up and catching records a crash cut short
+static uint32_t _pnlSaveHash(const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+	return hash;
+}
+
+static uint32_t _pnlRead32(const unsigned char *bytes) {
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void _pnlWrite32(unsigned char *bytes, uint32_t x) {
+	for (int i = 0; i < 4; i++)
+		bytes[i] = (unsigned char)(x >> (i * 8));
+}
+
+/********************** Buffers **********************/
+
+static unsigned char *_pnlSaveBufferReserve(PNLSaveBuffer *buffer, size_t size) {
+	if (buffer->size + size > buffer->capacity) {
+		size_t capacity = buffer->capacity > 0 ? buffer->capacity * 2 : 256;
+		while (capacity < buffer->size + size)
+			capacity *= 2;
+		unsigned char *data = realloc(buffer->data, capacity);
+		if (data == NULL)
+			return NULL;
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+	unsigned char *out = buffer->data + buffer->size;
+	buffer->size += size;
+	return out;
+}
+
+static void _pnlSaveBufferSwap(PNLSaveBuffer *a, PNLSaveBuffer *b) {
+	PNLSaveBuffer temp = *a;
+	*a = *b;
+	*b = temp;
+}
+
+// Appends a value's record, false if there wasn't memory for it
+static bool _pnlSaveEncode(PNLSaveBuffer *buffer, const PNLSaveValue *value) {
+	size_t keyLength = strlen(value->key);
+	size_t valueLength = value->isString ? strlen(value->string) : sizeof(uint64_t);
+	size_t bodySize = 2 + keyLength + valueLength;
+	unsigned char *record = _pnlSaveBufferReserve(buffer, SAVE_RECORD_HEADER_SIZE + bodySize);
+	if (record == NULL)
+		return false;
+	unsigned char *body = record + SAVE_RECORD_HEADER_SIZE;
+	body[0] = value->isString ? SAVE_STRING : SAVE_NUMBER;
+	body[1] = (unsigned char)keyLength;
+	memcpy(body + 2, value->key, keyLength);
+	if (value->isString) {
+		memcpy(body + 2 + keyLength, value->string, valueLength);
+	} else {
+		uint64_t bits;
+		memcpy(&bits, &value->number, sizeof(double)); // Bits so it comes back exactly
+		_pnlWrite32(body + 2 + keyLength, (uint32_t)bits);
+		_pnlWrite32(body + 6 + keyLength, (uint32_t)(bits >> 32));
+	}
+	_pnlWrite32(record, (uint32_t)bodySize);
+	_pnlWrite32(record + 4, _pnlSaveHash(body, bodySize));
+	return true;
+}
+
+static bool _pnlSaveEncodeHeader(PNLSaveBuffer *buffer) {
+	unsigned char *header = _pnlSaveBufferReserve(buffer, SAVE_HEADER_SIZE);
+	if (header == NULL)
+		return false;
+	memcpy(header, SAVE_MAGIC, 4);
+	_pnlWrite32(header + 4, SAVE_VERSION);
+	return true;
+}
+
+/********************** Values **********************/
+
+static PNLSaveValue *_pnlSaveFind(PNLSaveStore store, const char *key) {
+	uint32_t hash = _pnlSaveHash(key, strlen(key));
+	for (int i = 0; i < store->count; i++)
+		if (store->values[i].hash == hash && strcmp(store->values[i].key, key) == 0)
+			return &store->values[i];
+	return NULL;
+}
+
+// Sets a value in memory, NULL if the key is too long or there's no memory for it
+static PNLSaveValue *_pnlSaveApply(PNLSaveStore store, const char *key, bool isString, double number, const char *string, size_t length) {
+	size_t keyLength = strlen(key);
+	if (keyLength == 0 || keyLength >= PNL_SAVE_KEY_LENGTH)
+		return NULL;
+	char *copy = NULL;
+	if (isString) {
+		copy = malloc(length + 1);
+		if (copy == NULL)
+			return NULL;
+		memcpy(copy, string, length);
+		copy[length] = 0;
+	}
+
+	PNLSaveValue *value = _pnlSaveFind(store, key);
+	if (value == NULL) {
+		if (store->count == store->capacity) {
+			int capacity = store->capacity > 0 ? store->capacity * 2 : 16;
+			PNLSaveValue *values = realloc(store->values, sizeof(PNLSaveValue) * capacity);
+			if (values == NULL) {
+				free(copy);
+				return NULL;
+			}
+			store->values = values;
+			store->capacity = capacity;
+		}
+		value = &store->values[store->count++];
+		memset(value, 0, sizeof(PNLSaveValue));
+		memcpy(value->key, key, keyLength + 1);
+		value->hash = _pnlSaveHash(key, keyLength);
+	}
+	free(value->string);
+	value->isString = isString;
+	value->number = number;
+	value->string = copy;
+	return value;
+}
+
+// Applies every record in a file, stopping at the first one that was cut short or doesn't check out
+static void _pnlSaveReplay(PNLSaveStore store, const unsigned char *bytes, size_t size) {
+	if (size < SAVE_HEADER_SIZE || memcmp(bytes, SAVE_MAGIC, 4) != 0 || _pnlRead32(bytes + 4) != SAVE_VERSION)
+		return;
+	size_t offset = SAVE_HEADER_SIZE;
+	while (offset + SAVE_RECORD_HEADER_SIZE <= size) {
+		size_t bodySize = _pnlRead32(bytes + offset);
+		const unsigned char *body = bytes + offset + SAVE_RECORD_HEADER_SIZE;
+		if (bodySize < 2 || bodySize > size - offset - SAVE_RECORD_HEADER_SIZE || _pnlSaveHash(body, bodySize) != _pnlRead32(bytes + offset + 4))
+			return;
+		size_t keyLength = body[1];
+		if (keyLength == 0 || keyLength >= PNL_SAVE_KEY_LENGTH || 2 + keyLength > bodySize)
+			return;
+		char key[PNL_SAVE_KEY_LENGTH];
+		memcpy(key, body + 2, keyLength);
+		key[keyLength] = 0;
+		const unsigned char *data = body + 2 + keyLength;
+		size_t dataSize = bodySize - 2 - keyLength;
+		if (body[0] == SAVE_STRING) {
+			_pnlSaveApply(store, key, true, 0, (const char*)data, dataSize);
+		} else if (body[0] == SAVE_NUMBER && dataSize == sizeof(uint64_t)) {
+			uint64_t bits = (uint64_t)_pnlRead32(data) | ((uint64_t)_pnlRead32(data + 4) << 32);
+			double number;
+			memcpy(&number, &bits, sizeof(double));
+			_pnlSaveApply(store, key, false, number, NULL, 0);
+		} else {
+			return;
+		}
+		offset += SAVE_RECORD_HEADER_SIZE + bodySize;
+	}
+}
+
+/********************** Disk **********************/
+
+// Starts the journal over, it's empty besides the header
+static bool _pnlSaveResetJournal(PNLSaveStore store, const char *path) {
+	if (store->file != NULL)
+		fclose(store->file);
+	store->file = fopen(path, "wb");
+	if (store->file == NULL)
+		return false;
+	unsigned char header[SAVE_HEADER_SIZE];
+	memcpy(header, SAVE_MAGIC, 4);
+	_pnlWrite32(header + 4, SAVE_VERSION);
+	return fwrite(header, 1, SAVE_HEADER_SIZE, store->file) == SAVE_HEADER_SIZE && pnlSyncFile(store->file);
+}
+
+// Opens the journal to append to, keeping whatever is already in it
+static bool _pnlSaveOpenJournal(PNLSaveStore store, const char *path) {
+	store->file = fopen(path, "ab");
+	if (store->file == NULL)
+		return false;
+	fseek(store->file, 0, SEEK_END);
+	if (ftell(store->file) > 0)
+		return true;
+	unsigned char header[SAVE_HEADER_SIZE];
+	memcpy(header, SAVE_MAGIC, 4);
+	_pnlWrite32(header + 4, SAVE_VERSION);
+	return fwrite(header, 1, SAVE_HEADER_SIZE, store->file) == SAVE_HEADER_SIZE && pnlSyncFile(store->file);
+}
+
+// Takes whatever is queued and writes it, called with the lock held but only holds it to swap buffers
+static void _pnlSaveWriteLocked(PNLSaveStore store) {
+	uint64_t batch = store->submitted;
+	PNLSaveBuffer *journal = &store->writing[0];
+	PNLSaveBuffer *snapshot = &store->writing[1];
+	_pnlSaveBufferSwap(&store->journal, journal);
+	_pnlSaveBufferSwap(&store->snapshot, snapshot);
+	SDL_UnlockMutex(store->lock);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	size_t pathLength = strlen(store->filename) + 9;
+	char *tempPath = malloc(pathLength);
+	char *journalPath = malloc(pathLength);
+	bool ok = tempPath != NULL && journalPath != NULL;
+	bool compacted = false;
+	if (ok) {
+		snprintf(tempPath, pathLength, "%s.tmp", store->filename);
+		snprintf(journalPath, pathLength, "%s.journal", store->filename);
+	}
+
+	// The journal only starts over once the snapshot that replaces it is safely in place, if anything
+	// fails the old snapshot and journal are still there and the next compaction tries again
+	if (ok && snapshot->size > 0) {
+		ok = pnlWriteFileSynced(tempPath, snapshot->data, snapshot->size) && pnlReplaceFile(tempPath, store->filename) &&
+			 _pnlSaveResetJournal(store, journalPath);
+		compacted = ok;
+	}
+	if (ok && journal->size > 0) {
+		// A journal that failed could end in half a record, which would hide anything appended after it
+		// when it's replayed, so it's left alone until the compaction the failure queued starts it over
+		if (store->file == NULL)
+			ok = !store->journalTorn && _pnlSaveOpenJournal(store, journalPath);
+		ok = ok && fwrite(journal->data, 1, journal->size, store->file) == journal->size && pnlSyncFile(store->file);
+	}
+	if (compacted)
+		store->journalTorn = false;
+	if (!ok && store->file != NULL) {
+		fclose(store->file); // It could have half a record on the end now
+		store->file = NULL;
+		store->journalTorn = true;
+	}
+	free(tempPath);
+	free(journalPath);
+	double time = _pnlSeconds(start);
+
+	SDL_LockMutex(store->lock);
+	journal->size = 0;
+	snapshot->size = 0;
+	store->completed = batch;
+	store->compactions += compacted;
+	store->failures += !ok;
+	store->dirty = store->dirty || !ok;
+	store->writeTime += time;
+	store->writeTimeMax = time > store->writeTimeMax ? time : store->writeTimeMax;
+	SDL_CondBroadcast(store->done);
+}
+
+static int _pnlSaveWriter(void *data) {
+	PNLSaveStore store = data;
+	PNL_PROFILE_THREAD("save");
+	SDL_LockMutex(store->lock);
+	while (true) {
+		while (!store->quit && store->completed == store->submitted)
+			SDL_CondWait(store->work, store->lock);
+		if (store->completed == store->submitted)
+			break; // Quitting and there's nothing left
+		PNL_PROFILE_BEGIN("_pnlSaveWriteLocked");
+		_pnlSaveWriteLocked(store);
+		PNL_PROFILE_END();
+	}
+	SDL_UnlockMutex(store->lock);
+	return 0;
+}
+
+// Hands a changed value to the writer, or the whole store if it's time to compact
+static void _pnlSaveQueue(PNLSaveStore store, const PNLSaveValue *value) {
+	SDL_LockMutex(store->lock);
+	bool compact = value == NULL || store->dirty || store->journalBytes >= PNL_SAVE_COMPACT_BYTES;
+	if (compact) {
+		// Everything waiting to be appended is in the snapshot anyway
+		store->journal.size = 0;
+		store->snapshot.size = 0;
+		bool ok = _pnlSaveEncodeHeader(&store->snapshot);
+		for (int i = 0; i < store->count && ok; i++)
+			ok = _pnlSaveEncode(&store->snapshot, &store->values[i]);
+		if (!ok)
+			store->snapshot.size = 0;
+		store->dirty = !ok;
+		store->journalBytes = 0;
+	} else {
+		size_t size = store->journal.size;
+		if (!_pnlSaveEncode(&store->journal, value))
+			store->dirty = true;
+		store->journalBytes += store->journal.size - size;
+		store->records++;
+	}
+	store->submitted++;
+	if (store->thread != NULL)
+		SDL_CondSignal(store->work);
+	else
+		_pnlSaveWriteLocked(store);
+	SDL_UnlockMutex(store->lock);
+}
+
+/********************** Store **********************/
+
+PNLSaveStore pnlSaveStoreOpen(const char *filename) {
+	PNLSaveStore store = calloc(1, sizeof(struct PNLSaveStore));
+	if (store == NULL)
+		return NULL;
+	store->filename = malloc(strlen(filename) + 1);
+	store->lock = SDL_CreateMutex();
+	store->work = SDL_CreateCond();
+	store->done = SDL_CreateCond();
+	if (store->filename == NULL || store->lock == NULL || store->work == NULL || store->done == NULL) {
+		pnlSaveStoreClose(store);
+		return NULL;
+	}
+	strcpy(store->filename, filename);
+
+	// The snapshot and then every change since it
+	size_t size;
+	unsigned char *bytes = pnlReadFile(filename, &size);
+	if (size > 0)
+		_pnlSaveReplay(store, bytes, size);
+	free(bytes);
+	char *journalPath = malloc(strlen(filename) + 9);
+	bytes = NULL;
+	if (journalPath != NULL) {
+		sprintf(journalPath, "%s.journal", filename);
+		bytes = pnlReadFile(journalPath, &size);
+	}
+	free(journalPath);
+	if (bytes != NULL && size > 0) {
+		_pnlSaveReplay(store, bytes, size);
+
+		// Compacting right away folds the journal into the snapshot and gets rid of anything half written
+		// on the end of it, which would hide whatever got appended after it
+		store->dirty = true;
+	}
+	free(bytes);
+
+	store->thread = SDL_CreateThread(_pnlSaveWriter, "save", store);
+	if (store->dirty)
+		_pnlSaveQueue(store, NULL);
+	return store;
+}
+
+bool pnlSaveStoreKeyExists(PNLSaveStore store, const char *key) {
+	return _pnlSaveFind(store, key) != NULL;
+}
+
+double pnlSaveStoreGetDouble(PNLSaveStore store, const char *key) {
+	PNLSaveValue *value = _pnlSaveFind(store, key);
+	return value != NULL && !value->isString ? value->number : 0;
+}
+
+const char *pnlSaveStoreGetString(PNLSaveStore store, const char *key) {
+	PNLSaveValue *value = _pnlSaveFind(store, key);
+	return value != NULL && value->isString ? value->string : "";
+}
+
+static void _pnlSaveStoreSet(PNLSaveStore store, const char *key, bool isString, double number, const char *string) {
+	Uint64 start = SDL_GetPerformanceCounter();
+	PNLSaveValue *value = _pnlSaveApply(store, key, isString, number, string, isString ? strlen(string) : 0);
+	if (value != NULL)
+		_pnlSaveQueue(store, value);
+	double time = _pnlSeconds(start);
+	store->setTime += time;
+	store->setTimeMax = time > store->setTimeMax ? time : store->setTimeMax;
+}
+
+void pnlSaveStoreSetDouble(PNLSaveStore store, const char *key, double value) {
+	_pnlSaveStoreSet(store, key, false, value, NULL);
+}
+
+void pnlSaveStoreSetString(PNLSaveStore store, const char *key, const char *value) {
+	_pnlSaveStoreSet(store, key, true, 0, value);
+}
+
+void pnlSaveStoreFlush(PNLSaveStore store) {
+	SDL_LockMutex(store->lock);
+	uint64_t target = store->submitted;
+	while (store->completed < target)
+		SDL_CondWait(store->done, store->lock);
+	SDL_UnlockMutex(store->lock);
+}
+
+void pnlSaveStoreGetStats(PNLSaveStore store, PNLSaveStoreStats *stats) {
+	SDL_LockMutex(store->lock);
+	stats->records = store->records;
+	stats->compactions = store->compactions;
+	stats->failures = store->failures;
+	stats->setTime = store->setTime;
+	stats->setTimeMax = store->setTimeMax;
+	stats->writeTime = store->writeTime;
+	stats->writeTimeMax = store->writeTimeMax;
+	SDL_UnlockMutex(store->lock);
+}
+
+void pnlSaveStoreClose(PNLSaveStore store) {
+	if (store != NULL) {
+		if (store->lock != NULL && (store->journalBytes > 0 || store->dirty))
+			_pnlSaveQueue(store, NULL);
+		if (store->thread != NULL) {
+			SDL_LockMutex(store->lock);
+			store->quit = true;
+			SDL_CondSignal(store->work);
+			SDL_UnlockMutex(store->lock);
+			SDL_WaitThread(store->thread, NULL);
+		}
+		if (store->file != NULL)
+			fclose(store->file);
+		for (int i = 0; i < store->count; i++)
+			free(store->values[i].string);
+		free(store->values);
+		free(store->journal.data);
+		free(store->snapshot.data);
+		free(store->writing[0].data);
+		free(store->writing[1].data);
+		if (store->lock != NULL)
+			SDL_DestroyMutex(store->lock);
+		if (store->work != NULL)
+			SDL_DestroyCond(store->work);
+		if (store->done != NULL)
+			SDL_DestroyCond(store->done);
+		free(store->filename);
+		free(store);
+	}
+}
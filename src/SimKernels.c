@@ -0,0 +1,227 @@
+#include <math.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "SimKernels.h"
+
+// SSE2 is part of x86-64 so it can be used unconditionally there, AVX needs to be checked for at runtime
+#if defined(__SSE2__) || defined(_M_X64)
+#define PNL_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PNL_KERNELS_AVX
+#include <immintrin.h>
+#define PNL_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+/********************** Scalar **********************/
+// Every other implementation does the exact same operations in the same order, the tails of their
+// loops are handed off to these
+
+static void _pnlIntegrateBulletsScalar(double *x, double *y, const double *dirX, const double *dirY, double *velocity, double *lifetime, int count, double dt, double deceleration) {
+	double slowdown = deceleration * dt;
+	for (int i = 0; i < count; i++) {
+		double step = velocity[i] * dt;
+		x[i] += dirX[i] * step;
+		y[i] += dirY[i] * step;
+		velocity[i] -= slowdown;
+		lifetime[i] += dt;
+	}
+}
+
+static void _pnlHomeEnemiesScalar(double *x, double *y, double *distance, int count, double targetX, double targetY, double speed, double farDistance, double farMultiplier, double dt) {
+	double nearStep = speed * dt;
+	double farStep = speed * farMultiplier * dt;
+	for (int i = 0; i < count; i++) {
+		double dx = targetX - x[i];
+		double dy = targetY - y[i];
+		double d = sqrt((dx * dx) + (dy * dy));
+		double scale = d > 0 ? (d > farDistance ? farStep : nearStep) / d : 0;
+		distance[i] = d;
+		x[i] += dx * scale;
+		y[i] += dy * scale;
+	}
+}
+
+static void _pnlMixSamplesScalar(float *out, const float *in, int frames, int channels, float left, float right) {
+	if (channels == 1) {
+		for (int i = 0; i < frames; i++) {
+			out[(i * 2)] += in[i] * left;
+			out[(i * 2) + 1] += in[i] * right;
+		}
+	} else {
+		for (int i = 0; i < frames; i++) {
+			out[(i * 2)] += in[(i * 2)] * left;
+			out[(i * 2) + 1] += in[(i * 2) + 1] * right;
+		}
+	}
+}
+
+static const PNLKernels KERNELS_SCALAR = {
+		"scalar",
+		km_Scalar,
+		_pnlIntegrateBulletsScalar,
+		_pnlHomeEnemiesScalar,
+		_pnlMixSamplesScalar,
+};
+
+/********************** SSE2 **********************/
+#ifdef PNL_KERNELS_SSE2
+static void _pnlIntegrateBulletsSSE2(double *x, double *y, const double *dirX, const double *dirY, double *velocity, double *lifetime, int count, double dt, double deceleration) {
+	__m128d vdt = _mm_set1_pd(dt);
+	__m128d slowdown = _mm_set1_pd(deceleration * dt);
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d v = _mm_loadu_pd(velocity + i);
+		__m128d step = _mm_mul_pd(v, vdt);
+		_mm_storeu_pd(x + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(_mm_loadu_pd(dirX + i), step)));
+		_mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_loadu_pd(dirY + i), step)));
+		_mm_storeu_pd(velocity + i, _mm_sub_pd(v, slowdown));
+		_mm_storeu_pd(lifetime + i, _mm_add_pd(_mm_loadu_pd(lifetime + i), vdt));
+	}
+	_pnlIntegrateBulletsScalar(x + i, y + i, dirX + i, dirY + i, velocity + i, lifetime + i, count - i, dt, deceleration);
+}
+
+static void _pnlHomeEnemiesSSE2(double *x, double *y, double *distance, int count, double targetX, double targetY, double speed, double farDistance, double farMultiplier, double dt) {
+	__m128d tx = _mm_set1_pd(targetX);
+	__m128d ty = _mm_set1_pd(targetY);
+	__m128d far = _mm_set1_pd(farDistance);
+	__m128d nearStep = _mm_set1_pd(speed * dt);
+	__m128d farStep = _mm_set1_pd(speed * farMultiplier * dt);
+	__m128d zero = _mm_setzero_pd();
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d px = _mm_loadu_pd(x + i);
+		__m128d py = _mm_loadu_pd(y + i);
+		__m128d dx = _mm_sub_pd(tx, px);
+		__m128d dy = _mm_sub_pd(ty, py);
+		__m128d d = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+		__m128d isFar = _mm_cmpgt_pd(d, far);
+		__m128d step = _mm_or_pd(_mm_and_pd(isFar, farStep), _mm_andnot_pd(isFar, nearStep));
+		__m128d scale = _mm_and_pd(_mm_cmpgt_pd(d, zero), _mm_div_pd(step, d)); // 0 distance divides by 0, mask it
+		_mm_storeu_pd(distance + i, d);
+		_mm_storeu_pd(x + i, _mm_add_pd(px, _mm_mul_pd(dx, scale)));
+		_mm_storeu_pd(y + i, _mm_add_pd(py, _mm_mul_pd(dy, scale)));
+	}
+	_pnlHomeEnemiesScalar(x + i, y + i, distance + i, count - i, targetX, targetY, speed, farDistance, farMultiplier, dt);
+}
+
+static void _pnlMixSamplesSSE2(float *out, const float *in, int frames, int channels, float left, float right) {
+	__m128 gains = _mm_setr_ps(left, right, left, right);
+	int i = 0;
+	if (channels == 1) {
+		for (; i + 4 <= frames; i += 4) {
+			__m128 s = _mm_loadu_ps(in + i);
+			_mm_storeu_ps(out + (i * 2), _mm_add_ps(_mm_loadu_ps(out + (i * 2)), _mm_mul_ps(_mm_unpacklo_ps(s, s), gains)));
+			_mm_storeu_ps(out + (i * 2) + 4, _mm_add_ps(_mm_loadu_ps(out + (i * 2) + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), gains)));
+		}
+		_pnlMixSamplesScalar(out + (i * 2), in + i, frames - i, channels, left, right);
+	} else {
+		for (; i + 2 <= frames; i += 2)
+			_mm_storeu_ps(out + (i * 2), _mm_add_ps(_mm_loadu_ps(out + (i * 2)), _mm_mul_ps(_mm_loadu_ps(in + (i * 2)), gains)));
+		_pnlMixSamplesScalar(out + (i * 2), in + (i * 2), frames - i, channels, left, right);
+	}
+}
+
+static const PNLKernels KERNELS_SSE2 = {
+		"sse2",
+		km_SSE2,
+		_pnlIntegrateBulletsSSE2,
+		_pnlHomeEnemiesSSE2,
+		_pnlMixSamplesSSE2,
+};
+#endif // PNL_KERNELS_SSE2
+
+/********************** AVX **********************/
+#ifdef PNL_KERNELS_AVX
+PNL_TARGET_AVX static void _pnlIntegrateBulletsAVX(double *x, double *y, const double *dirX, const double *dirY, double *velocity, double *lifetime, int count, double dt, double deceleration) {
+	__m256d vdt = _mm256_set1_pd(dt);
+	__m256d slowdown = _mm256_set1_pd(deceleration * dt);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_loadu_pd(velocity + i);
+		__m256d step = _mm256_mul_pd(v, vdt);
+		_mm256_storeu_pd(x + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_mul_pd(_mm256_loadu_pd(dirX + i), step)));
+		_mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(_mm256_loadu_pd(dirY + i), step)));
+		_mm256_storeu_pd(velocity + i, _mm256_sub_pd(v, slowdown));
+		_mm256_storeu_pd(lifetime + i, _mm256_add_pd(_mm256_loadu_pd(lifetime + i), vdt));
+	}
+	_pnlIntegrateBulletsScalar(x + i, y + i, dirX + i, dirY + i, velocity + i, lifetime + i, count - i, dt, deceleration);
+}
+
+PNL_TARGET_AVX static void _pnlHomeEnemiesAVX(double *x, double *y, double *distance, int count, double targetX, double targetY, double speed, double farDistance, double farMultiplier, double dt) {
+	__m256d tx = _mm256_set1_pd(targetX);
+	__m256d ty = _mm256_set1_pd(targetY);
+	__m256d far = _mm256_set1_pd(farDistance);
+	__m256d nearStep = _mm256_set1_pd(speed * dt);
+	__m256d farStep = _mm256_set1_pd(speed * farMultiplier * dt);
+	__m256d zero = _mm256_setzero_pd();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d px = _mm256_loadu_pd(x + i);
+		__m256d py = _mm256_loadu_pd(y + i);
+		__m256d dx = _mm256_sub_pd(tx, px);
+		__m256d dy = _mm256_sub_pd(ty, py);
+		__m256d d = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+		__m256d step = _mm256_blendv_pd(nearStep, farStep, _mm256_cmp_pd(d, far, _CMP_GT_OQ));
+		__m256d scale = _mm256_and_pd(_mm256_cmp_pd(d, zero, _CMP_GT_OQ), _mm256_div_pd(step, d)); // 0 distance divides by 0, mask it
+		_mm256_storeu_pd(distance + i, d);
+		_mm256_storeu_pd(x + i, _mm256_add_pd(px, _mm256_mul_pd(dx, scale)));
+		_mm256_storeu_pd(y + i, _mm256_add_pd(py, _mm256_mul_pd(dy, scale)));
+	}
+	_pnlHomeEnemiesScalar(x + i, y + i, distance + i, count - i, targetX, targetY, speed, farDistance, farMultiplier, dt);
+}
+
+PNL_TARGET_AVX static void _pnlMixSamplesAVX(float *out, const float *in, int frames, int channels, float left, float right) {
+	__m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+	int i = 0;
+	if (channels == 1) {
+		for (; i + 8 <= frames; i += 8) {
+			// Unpacking works within each 128 bit half, so the halves are swapped back into order after
+			__m256 s = _mm256_loadu_ps(in + i);
+			__m256 low = _mm256_unpacklo_ps(s, s);
+			__m256 high = _mm256_unpackhi_ps(s, s);
+			__m256 first = _mm256_permute2f128_ps(low, high, 0x20);
+			__m256 second = _mm256_permute2f128_ps(low, high, 0x31);
+			_mm256_storeu_ps(out + (i * 2), _mm256_add_ps(_mm256_loadu_ps(out + (i * 2)), _mm256_mul_ps(first, gains)));
+			_mm256_storeu_ps(out + (i * 2) + 8, _mm256_add_ps(_mm256_loadu_ps(out + (i * 2) + 8), _mm256_mul_ps(second, gains)));
+		}
+		_pnlMixSamplesScalar(out + (i * 2), in + i, frames - i, channels, left, right);
+	} else {
+		for (; i + 4 <= frames; i += 4)
+			_mm256_storeu_ps(out + (i * 2), _mm256_add_ps(_mm256_loadu_ps(out + (i * 2)), _mm256_mul_ps(_mm256_loadu_ps(in + (i * 2)), gains)));
+		_pnlMixSamplesScalar(out + (i * 2), in + (i * 2), frames - i, channels, left, right);
+	}
+}
+
+static const PNLKernels KERNELS_AVX = {
+		"avx",
+		km_AVX,
+		_pnlIntegrateBulletsAVX,
+		_pnlHomeEnemiesAVX,
+		_pnlMixSamplesAVX,
+};
+#endif // PNL_KERNELS_AVX
+
+/********************** Selection **********************/
+const PNLKernels *pnlKernelsGet(PNLKernelMode mode) {
+#ifdef PNL_KERNELS_AVX
+	if ((mode == km_Auto || mode == km_AVX) && SDL_HasAVX())
+		return &KERNELS_AVX;
+#endif
+#ifdef PNL_KERNELS_SSE2
+	if (mode != km_Scalar && SDL_HasSSE2())
+		return &KERNELS_SSE2;
+#endif
+	return &KERNELS_SCALAR;
+}
+
+PNLKernelMode pnlKernelModeFromString(const char *string) {
+	if (strcmp(string, "scalar") == 0)
+		return km_Scalar;
+	else if (strcmp(string, "sse2") == 0)
+		return km_SSE2;
+	else if (strcmp(string, "avx") == 0)
+		return km_AVX;
+	return km_Auto;
+}
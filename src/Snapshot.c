@@ -0,0 +1,291 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "Snapshot.h"
+#include "FileUtil.h"
+
+#define SNAPSHOT_MAGIC "PNLG"
+#define SNAPSHOT_SECTION_HEADER_SIZE ((size_t)8) // Tag then size
+
+static uint32_t _pnlSnapshotChecksum(const unsigned char *bytes, size_t size) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+	return hash;
+}
+
+static uint32_t _pnlRead32(const unsigned char *bytes) {
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void _pnlWrite32(unsigned char *bytes, uint32_t x) {
+	for (int i = 0; i < 4; i++)
+		bytes[i] = (unsigned char)(x >> (i * 8));
+}
+
+// Makes room for size more bytes and returns where they go, NULL if there's no memory
+static unsigned char *_pnlSnapshotReserve(PNLSnapshot snapshot, size_t size) {
+	if (snapshot->failed || snapshot->reading)
+		return NULL;
+	if (snapshot->size + size > snapshot->capacity) {
+		size_t capacity = snapshot->capacity > 0 ? snapshot->capacity * 2 : 4096;
+		while (capacity < snapshot->size + size)
+			capacity *= 2;
+		unsigned char *data = realloc(snapshot->data, capacity);
+		if (data == NULL) {
+			snapshot->failed = true;
+			return NULL;
+		}
+		snapshot->data = data;
+		snapshot->capacity = capacity;
+	}
+	unsigned char *out = snapshot->data + snapshot->size;
+	snapshot->size += size;
+	return out;
+}
+
+// Where the next size bytes are read from, NULL if the section doesn't have that many left
+static const unsigned char *_pnlSnapshotTake(PNLSnapshot snapshot, size_t size) {
+	if (snapshot->failed || !snapshot->reading || size > snapshot->section - snapshot->offset) {
+		snapshot->failed = true;
+		return NULL;
+	}
+	const unsigned char *in = snapshot->data + snapshot->offset;
+	snapshot->offset += size;
+	return in;
+}
+
+/********************** Snapshots **********************/
+
+PNLSnapshot pnlSnapshotCreate(uint32_t version) {
+	PNLSnapshot snapshot = calloc(1, sizeof(struct PNLSnapshot));
+	if (snapshot == NULL)
+		return NULL;
+	pnlSnapshotClear(snapshot, version);
+	if (snapshot->failed) {
+		pnlSnapshotFree(snapshot);
+		return NULL;
+	}
+	return snapshot;
+}
+
+void pnlSnapshotClear(PNLSnapshot snapshot, uint32_t version) {
+	snapshot->size = 0;
+	snapshot->version = version;
+	snapshot->reading = false;
+	snapshot->failed = false;
+	snapshot->section = 0;
+	snapshot->offset = 0;
+	_pnlSnapshotReserve(snapshot, PNL_SNAPSHOT_HEADER_SIZE); // Filled in by pnlSnapshotBytes
+}
+
+PNLSnapshot pnlSnapshotOpen(const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	if (size < PNL_SNAPSHOT_HEADER_SIZE || memcmp(bytes, SNAPSHOT_MAGIC, 4) != 0 ||
+		_pnlRead32(bytes + 8) != size - PNL_SNAPSHOT_HEADER_SIZE ||
+		_pnlRead32(bytes + 12) != _pnlSnapshotChecksum(bytes + PNL_SNAPSHOT_HEADER_SIZE, size - PNL_SNAPSHOT_HEADER_SIZE))
+		return NULL;
+	PNLSnapshot snapshot = calloc(1, sizeof(struct PNLSnapshot));
+	if (snapshot == NULL)
+		return NULL;
+	snapshot->data = malloc(size);
+	if (snapshot->data == NULL) {
+		free(snapshot);
+		return NULL;
+	}
+	memcpy(snapshot->data, data, size);
+	snapshot->size = size;
+	snapshot->capacity = size;
+	snapshot->version = _pnlRead32(bytes + 4);
+	snapshot->reading = true;
+	return snapshot;
+}
+
+PNLSnapshot pnlSnapshotLoad(const char *filename) {
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char *bytes = length > 0 ? malloc(length) : NULL;
+	bool ok = bytes != NULL && fread(bytes, 1, length, file) == (size_t)length;
+	fclose(file);
+	PNLSnapshot snapshot = ok ? pnlSnapshotOpen(bytes, length) : NULL;
+	free(bytes);
+	return snapshot;
+}
+
+const void *pnlSnapshotBytes(PNLSnapshot snapshot, size_t *size) {
+	if (!snapshot->reading) {
+		memcpy(snapshot->data, SNAPSHOT_MAGIC, 4);
+		_pnlWrite32(snapshot->data + 4, snapshot->version);
+		_pnlWrite32(snapshot->data + 8, (uint32_t)(snapshot->size - PNL_SNAPSHOT_HEADER_SIZE));
+		_pnlWrite32(snapshot->data + 12, _pnlSnapshotChecksum(snapshot->data + PNL_SNAPSHOT_HEADER_SIZE, snapshot->size - PNL_SNAPSHOT_HEADER_SIZE));
+	}
+	*size = snapshot->size;
+	return snapshot->data;
+}
+
+bool pnlSnapshotStore(PNLSnapshot snapshot, const char *filename) {
+	if (snapshot->failed)
+		return false;
+	size_t size;
+	const void *bytes = pnlSnapshotBytes(snapshot, &size);
+	char *temp = malloc(strlen(filename) + 5);
+	if (temp == NULL)
+		return false;
+	sprintf(temp, "%s.tmp", filename);
+
+	// Synced before it's renamed, otherwise a power loss could leave a torn file where the last good one was
+	bool ok = pnlWriteFileSynced(temp, bytes, size) && pnlReplaceFile(temp, filename);
+	if (!ok)
+		remove(temp);
+	free(temp);
+	return ok;
+}
+
+/********************** Sections **********************/
+
+void pnlSnapshotBeginSection(PNLSnapshot snapshot, uint32_t tag) {
+	size_t start = snapshot->size;
+	unsigned char *header = _pnlSnapshotReserve(snapshot, SNAPSHOT_SECTION_HEADER_SIZE);
+	if (header != NULL) {
+		_pnlWrite32(header, tag);
+		snapshot->section = start;
+	}
+}
+
+void pnlSnapshotEndSection(PNLSnapshot snapshot) {
+	if (!snapshot->failed && !snapshot->reading)
+		_pnlWrite32(snapshot->data + snapshot->section + 4, (uint32_t)(snapshot->size - snapshot->section - SNAPSHOT_SECTION_HEADER_SIZE));
+}
+
+bool pnlSnapshotFindSection(PNLSnapshot snapshot, uint32_t tag) {
+	if (!snapshot->reading)
+		return false;
+	size_t offset = PNL_SNAPSHOT_HEADER_SIZE;
+	while (offset + SNAPSHOT_SECTION_HEADER_SIZE <= snapshot->size) {
+		size_t size = _pnlRead32(snapshot->data + offset + 4);
+		if (size > snapshot->size - offset - SNAPSHOT_SECTION_HEADER_SIZE)
+			return false;
+		if (_pnlRead32(snapshot->data + offset) == tag) {
+			snapshot->offset = offset + SNAPSHOT_SECTION_HEADER_SIZE;
+			snapshot->section = snapshot->offset + size;
+			return true;
+		}
+		offset += SNAPSHOT_SECTION_HEADER_SIZE + size;
+	}
+	return false;
+}
+
+/********************** Values **********************/
+
+void pnlSnapshotPutBool(PNLSnapshot snapshot, bool value) {
+	unsigned char *out = _pnlSnapshotReserve(snapshot, 1);
+	if (out != NULL)
+		*out = value ? 1 : 0;
+}
+
+void pnlSnapshotPutU32(PNLSnapshot snapshot, uint32_t value) {
+	unsigned char *out = _pnlSnapshotReserve(snapshot, 4);
+	if (out != NULL)
+		_pnlWrite32(out, value);
+}
+
+void pnlSnapshotPutU64(PNLSnapshot snapshot, uint64_t value) {
+	unsigned char *out = _pnlSnapshotReserve(snapshot, 8);
+	if (out != NULL) {
+		_pnlWrite32(out, (uint32_t)value);
+		_pnlWrite32(out + 4, (uint32_t)(value >> 32));
+	}
+}
+
+void pnlSnapshotPutDouble(PNLSnapshot snapshot, double value) {
+	pnlSnapshotPutDoubles(snapshot, &value, 1);
+}
+
+// Arrays of 4 or 8 byte values, straight copies unless the machine is big endian
+static void _pnlSnapshotPutArray(PNLSnapshot snapshot, const void *values, int count, size_t size) {
+	unsigned char *out = count > 0 ? _pnlSnapshotReserve(snapshot, (size_t)count * size) : NULL;
+	if (out == NULL)
+		return;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+	memcpy(out, values, (size_t)count * size);
+#else
+	const unsigned char *in = values;
+	for (int i = 0; i < count; i++)
+		for (size_t b = 0; b < size; b++)
+			out[(i * size) + b] = in[(i * size) + (size - 1 - b)];
+#endif
+}
+
+static void _pnlSnapshotGetArray(PNLSnapshot snapshot, void *values, int count, size_t size) {
+	const unsigned char *in = count > 0 ? _pnlSnapshotTake(snapshot, (size_t)count * size) : NULL;
+	if (in == NULL) {
+		if (count > 0)
+			memset(values, 0, (size_t)count * size);
+		return;
+	}
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+	memcpy(values, in, (size_t)count * size);
+#else
+	unsigned char *out = values;
+	for (int i = 0; i < count; i++)
+		for (size_t b = 0; b < size; b++)
+			out[(i * size) + b] = in[(i * size) + (size - 1 - b)];
+#endif
+}
+
+void pnlSnapshotPutInts(PNLSnapshot snapshot, const int *values, int count) {
+	_pnlSnapshotPutArray(snapshot, values, count, sizeof(int));
+}
+
+void pnlSnapshotPutFloats(PNLSnapshot snapshot, const float *values, int count) {
+	_pnlSnapshotPutArray(snapshot, values, count, sizeof(float));
+}
+
+void pnlSnapshotPutDoubles(PNLSnapshot snapshot, const double *values, int count) {
+	_pnlSnapshotPutArray(snapshot, values, count, sizeof(double));
+}
+
+bool pnlSnapshotGetBool(PNLSnapshot snapshot) {
+	const unsigned char *in = _pnlSnapshotTake(snapshot, 1);
+	return in != NULL && *in != 0;
+}
+
+uint32_t pnlSnapshotGetU32(PNLSnapshot snapshot) {
+	const unsigned char *in = _pnlSnapshotTake(snapshot, 4);
+	return in != NULL ? _pnlRead32(in) : 0;
+}
+
+uint64_t pnlSnapshotGetU64(PNLSnapshot snapshot) {
+	const unsigned char *in = _pnlSnapshotTake(snapshot, 8);
+	return in != NULL ? (uint64_t)_pnlRead32(in) | ((uint64_t)_pnlRead32(in + 4) << 32) : 0;
+}
+
+double pnlSnapshotGetDouble(PNLSnapshot snapshot) {
+	double value;
+	pnlSnapshotGetDoubles(snapshot, &value, 1);
+	return value;
+}
+
+void pnlSnapshotGetInts(PNLSnapshot snapshot, int *values, int count) {
+	_pnlSnapshotGetArray(snapshot, values, count, sizeof(int));
+}
+
+void pnlSnapshotGetFloats(PNLSnapshot snapshot, float *values, int count) {
+	_pnlSnapshotGetArray(snapshot, values, count, sizeof(float));
+}
+
+void pnlSnapshotGetDoubles(PNLSnapshot snapshot, double *values, int count) {
+	_pnlSnapshotGetArray(snapshot, values, count, sizeof(double));
+}
+
+void pnlSnapshotFree(PNLSnapshot snapshot) {
+	if (snapshot != NULL) {
+		free(snapshot->data);
+		free(snapshot);
+	}
+}
@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <string.h>
+#include "SoundPool.h"
+#include "Profiler.h"
+
+PNLSound pnlSoundCreate(const void *samples, size_t size, SDL_AudioFormat format, int channels, int rate) {
+	if (channels < 1 || channels > 2 || rate <= 0)
+		return NULL;
+	PNLSound sound = calloc(1, sizeof(struct PNLSound));
+	SDL_AudioStream *convert = sound != NULL ? SDL_NewAudioStream(format, channels, rate, AUDIO_F32SYS, channels, PNL_SOUND_RATE) : NULL;
+	bool ok = convert != NULL && SDL_AudioStreamPut(convert, samples, (int)size) == 0 && SDL_AudioStreamFlush(convert) == 0;
+	int bytes = ok ? SDL_AudioStreamAvailable(convert) : 0;
+	if (ok) {
+		sound->samples = malloc(bytes > 0 ? bytes : 1);
+		ok = sound->samples != NULL && SDL_AudioStreamGet(convert, sound->samples, bytes) == bytes;
+		sound->frames = bytes / (int)(sizeof(float) * channels);
+		sound->channels = channels;
+	}
+	if (convert != NULL)
+		SDL_FreeAudioStream(convert);
+	if (!ok) {
+		pnlSoundFree(sound);
+		return NULL;
+	}
+	return sound;
+}
+
+PNLSound pnlSoundLoad(const char *filename) {
+	SDL_AudioSpec spec;
+	Uint8 *samples;
+	Uint32 size;
+	if (SDL_LoadWAV(filename, &spec, &samples, &size) == NULL)
+		return NULL;
+	PNLSound sound = pnlSoundCreate(samples, size, spec.format, spec.channels, spec.freq);
+	SDL_FreeWAV(samples);
+	return sound;
+}
+
+void pnlSoundFree(PNLSound sound) {
+	if (sound != NULL) {
+		free(sound->samples);
+		free(sound);
+	}
+}
+
+// Picks a voice for a play, or drops it if everything playing is more important
+static void _pnlSoundPoolStart(PNLSoundPool pool, const PNLSoundPlay *play) {
+	PNLSoundVoice *idle = NULL;
+	PNLSoundVoice *oldestSame = NULL;
+	PNLSoundVoice *weakest = NULL;
+	int same = 0;
+	for (int i = 0; i < pool->voiceCount; i++) {
+		PNLSoundVoice *voice = &pool->voices[i];
+		if (voice->sound == NULL) {
+			idle = idle == NULL ? voice : idle;
+			continue;
+		}
+		if (voice->sound == play->sound) {
+			same++;
+			if (oldestSame == NULL || voice->started < oldestSame->started)
+				oldestSame = voice;
+		}
+		if (weakest == NULL || voice->priority < weakest->priority || (voice->priority == weakest->priority && voice->started < weakest->started))
+			weakest = voice;
+	}
+
+	PNLSoundVoice *voice;
+	if (play->limit > 0 && same >= play->limit) {
+		voice = oldestSame;
+		SDL_AtomicAdd(&pool->stolen, 1);
+	} else if (idle != NULL) {
+		voice = idle;
+	} else if (weakest != NULL && weakest->priority <= play->priority) {
+		voice = weakest;
+		SDL_AtomicAdd(&pool->stolen, 1);
+	} else {
+		SDL_AtomicAdd(&pool->dropped, 1);
+		return;
+	}
+	voice->sound = play->sound;
+	voice->position = 0;
+	voice->priority = play->priority;
+	voice->left = play->left;
+	voice->right = play->right;
+	voice->started = pool->plays++;
+	SDL_AtomicAdd(&pool->started, 1);
+}
+
+void pnlSoundPoolMix(PNLSoundPool pool, int16_t *out, int frames) {
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	// Start everything the game queued since the last mix
+	unsigned int taken = (unsigned int)SDL_AtomicGet(&pool->taken);
+	unsigned int queued = (unsigned int)SDL_AtomicGet(&pool->queued);
+	for (; taken != queued; taken++) {
+		const PNLSoundPlay *play = &pool->queue[taken & (PNL_SOUND_QUEUE_SIZE - 1)];
+		if (play->sound == NULL)
+			for (int i = 0; i < pool->voiceCount; i++)
+				pool->voices[i].sound = NULL;
+		else
+			_pnlSoundPoolStart(pool, play);
+	}
+	SDL_AtomicSet(&pool->taken, (int)taken);
+
+	int active = 0;
+	for (int i = 0; i < pool->voiceCount; i++)
+		active += pool->voices[i].sound != NULL;
+
+	// In device sized pieces since that's all the mix buffer holds
+	for (int done = 0; done < frames; done += PNL_SOUND_DEVICE_FRAMES) {
+		int count = frames - done < PNL_SOUND_DEVICE_FRAMES ? frames - done : PNL_SOUND_DEVICE_FRAMES;
+		memset(pool->mix, 0, sizeof(float) * 2 * count);
+		for (int i = 0; i < pool->voiceCount; i++) {
+			PNLSoundVoice *voice = &pool->voices[i];
+			if (voice->sound == NULL)
+				continue;
+			PNLSound sound = voice->sound;
+			int length = sound->frames - voice->position < count ? sound->frames - voice->position : count;
+			pool->kernels->mixSamples(pool->mix, sound->samples + (voice->position * sound->channels), length, sound->channels, voice->left, voice->right);
+			voice->position += length;
+			if (voice->position >= sound->frames)
+				voice->sound = NULL;
+		}
+		int16_t *samples = out + (done * 2);
+		for (int i = 0; i < count * 2; i++) {
+			float sample = pool->mix[i] * 32767;
+			samples[i] = (int16_t)(sample > 32767 ? 32767 : (sample < -32768 ? -32768 : sample));
+		}
+	}
+
+	Uint64 ticks = SDL_GetPerformanceCounter() - start;
+	SDL_AtomicSet(&pool->active, active);
+	if (active > SDL_AtomicGet(&pool->peak))
+		SDL_AtomicSet(&pool->peak, active);
+	pool->mixTicks += ticks;
+	pool->mixTicksMax = ticks > pool->mixTicksMax ? ticks : pool->mixTicksMax;
+	pool->mixedFrames += frames;
+}
+
+static void _pnlSoundPoolCallback(void *data, Uint8 *out, int length) {
+	PNL_PROFILE_THREAD("sound device");
+	PNL_PROFILE_BEGIN("pnlSoundPoolMix");
+	pnlSoundPoolMix(data, (int16_t*)out, length / (int)(sizeof(int16_t) * 2));
+	PNL_PROFILE_END();
+}
+
+// Only the game calls this, so only the mixer can be racing it and all it does is make room
+static bool _pnlSoundPoolQueue(PNLSoundPool pool, const PNLSoundPlay *play) {
+	unsigned int queued = (unsigned int)SDL_AtomicGet(&pool->queued);
+	if (queued - (unsigned int)SDL_AtomicGet(&pool->taken) >= PNL_SOUND_QUEUE_SIZE) {
+		SDL_AtomicAdd(&pool->dropped, 1);
+		return false;
+	}
+	pool->queue[queued & (PNL_SOUND_QUEUE_SIZE - 1)] = *play;
+	SDL_AtomicSet(&pool->queued, (int)(queued + 1)); // Full barrier, the play is there before the mixer can see it
+	return true;
+}
+
+PNLSoundPool pnlSoundPoolCreate(int voices, const PNLKernels *kernels, bool device) {
+	PNLSoundPool pool = calloc(1, sizeof(struct PNLSoundPool));
+	if (pool == NULL)
+		return NULL;
+	pool->kernels = kernels;
+	pool->voiceCount = voices;
+	pool->voices = calloc(voices > 0 ? voices : 1, sizeof(PNLSoundVoice));
+	pool->mix = malloc(sizeof(float) * 2 * PNL_SOUND_DEVICE_FRAMES);
+	if (pool->voices == NULL || pool->mix == NULL) {
+		pnlSoundPoolFree(pool);
+		return NULL;
+	}
+
+	if (device) {
+		SDL_AudioSpec want = {0};
+		want.freq = PNL_SOUND_RATE;
+		want.format = AUDIO_S16SYS;
+		want.channels = 2;
+		want.samples = PNL_SOUND_DEVICE_FRAMES;
+		want.callback = _pnlSoundPoolCallback;
+		want.userdata = pool;
+		if (SDL_InitSubSystem(SDL_INIT_AUDIO) == 0) {
+			pool->device = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0);
+			if (pool->device == 0)
+				SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		}
+		if (pool->device == 0) {
+			pnlSoundPoolFree(pool);
+			return NULL;
+		}
+		SDL_PauseAudioDevice(pool->device, 0);
+	}
+	return pool;
+}
+
+bool pnlSoundPoolPlay(PNLSoundPool pool, PNLSound sound, int priority, int limit, float left, float right) {
+	if (sound == NULL)
+		return false;
+	PNLSoundPlay play = {sound, priority, limit, left, right};
+	return _pnlSoundPoolQueue(pool, &play);
+}
+
+void pnlSoundPoolStopAll(PNLSoundPool pool) {
+	PNLSoundPlay stop = {0};
+	_pnlSoundPoolQueue(pool, &stop);
+}
+
+void pnlSoundPoolGetStats(PNLSoundPool pool, PNLSoundPoolStats *stats) {
+	stats->voices = SDL_AtomicGet(&pool->active);
+	stats->peak = SDL_AtomicGet(&pool->peak);
+	stats->started = SDL_AtomicGet(&pool->started);
+	stats->stolen = SDL_AtomicGet(&pool->stolen);
+	stats->dropped = SDL_AtomicGet(&pool->dropped);
+	stats->mixTime = (double)pool->mixTicks / SDL_GetPerformanceFrequency();
+	stats->mixTimeMax = (double)pool->mixTicksMax / SDL_GetPerformanceFrequency();
+	stats->audioTime = (double)pool->mixedFrames / PNL_SOUND_RATE;
+}
+
+void pnlSoundPoolFree(PNLSoundPool pool) {
+	if (pool != NULL) {
+		if (pool->device != 0) {
+			SDL_CloseAudioDevice(pool->device); // Waits for the callback to finish
+			SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		}
+		free(pool->voices);
+		free(pool->mix);
+		free(pool);
+	}
+}
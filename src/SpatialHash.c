@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <math.h>
+#include "SpatialHash.h"
+
+// Queries that touch more cells than this check every point instead
+#define MAX_QUERY_BUCKETS ((int)64)
+
+static int _pnlSpatialHashBucket(PNLSpatialHash hash, long cx, long cy) {
+	unsigned long h = ((unsigned long)cx * 73856093ul) ^ ((unsigned long)cy * 19349663ul);
+	return (int)(h & (unsigned long)(hash->bucketCount - 1));
+}
+
+static int _pnlCompareInts(const void *a, const void *b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+PNLSpatialHash pnlSpatialHashCreate(double cellSize, int capacity) {
+	PNLSpatialHash hash = calloc(1, sizeof(struct PNLSpatialHash));
+	if (hash == NULL)
+		return NULL;
+
+	// Twice as many buckets as points keeps collisions between unrelated cells rare
+	int buckets = 1;
+	while (buckets < capacity * 2)
+		buckets *= 2;
+
+	hash->cellSize = cellSize;
+	hash->capacity = capacity;
+	hash->bucketCount = buckets;
+	hash->bucketStart = malloc(sizeof(int) * (buckets + 1));
+	hash->bucketOf = malloc(sizeof(int) * capacity);
+	hash->ids = malloc(sizeof(int) * capacity);
+	hash->xs = malloc(sizeof(double) * capacity);
+	hash->ys = malloc(sizeof(double) * capacity);
+	hash->sorted = malloc(sizeof(int) * capacity);
+	hash->results = malloc(sizeof(int) * capacity);
+	if (hash->bucketStart == NULL || hash->bucketOf == NULL || hash->ids == NULL || hash->xs == NULL ||
+		hash->ys == NULL || hash->sorted == NULL || hash->results == NULL) {
+		pnlSpatialHashFree(hash);
+		return NULL;
+	}
+	pnlSpatialHashClear(hash);
+	pnlSpatialHashBuild(hash);
+	return hash;
+}
+
+void pnlSpatialHashClear(PNLSpatialHash hash) {
+	hash->count = 0;
+}
+
+bool pnlSpatialHashInsert(PNLSpatialHash hash, int id, double x, double y) {
+	if (hash->count >= hash->capacity)
+		return false;
+	int i = hash->count++;
+	hash->ids[i] = id;
+	hash->xs[i] = x;
+	hash->ys[i] = y;
+	hash->bucketOf[i] = _pnlSpatialHashBucket(hash, (long)floor(x / hash->cellSize), (long)floor(y / hash->cellSize));
+	return true;
+}
+
+void pnlSpatialHashBuild(PNLSpatialHash hash) {
+	// Count, prefix sum, scatter - stable, so each bucket keeps insertion order
+	for (int i = 0; i <= hash->bucketCount; i++)
+		hash->bucketStart[i] = 0;
+	for (int i = 0; i < hash->count; i++)
+		hash->bucketStart[hash->bucketOf[i] + 1]++;
+	for (int i = 0; i < hash->bucketCount; i++)
+		hash->bucketStart[i + 1] += hash->bucketStart[i];
+	for (int i = 0; i < hash->count; i++)
+		hash->sorted[hash->bucketStart[hash->bucketOf[i]]++] = i;
+
+	// Scattering moved every start to the next bucket's start, shift them back
+	for (int i = hash->bucketCount; i > 0; i--)
+		hash->bucketStart[i] = hash->bucketStart[i - 1];
+	hash->bucketStart[0] = 0;
+}
+
+int pnlSpatialHashQuery(PNLSpatialHash hash, double x, double y, double radius, const int **results) {
+	long cx0 = (long)floor((x - radius) / hash->cellSize);
+	long cx1 = (long)floor((x + radius) / hash->cellSize);
+	long cy0 = (long)floor((y - radius) / hash->cellSize);
+	long cy1 = (long)floor((y + radius) / hash->cellSize);
+	int visited[MAX_QUERY_BUCKETS];
+	int visitedCount = 0;
+	int found = 0;
+	double r2 = radius * radius;
+
+	if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > MAX_QUERY_BUCKETS) {
+		// Covering that many cells is slower than just looking at everything
+		for (int p = 0; p < hash->count; p++) {
+			double dx = hash->xs[p] - x;
+			double dy = hash->ys[p] - y;
+			if ((dx * dx) + (dy * dy) <= r2)
+				hash->results[found++] = hash->ids[p];
+		}
+	} else {
+		for (long cy = cy0; cy <= cy1; cy++) {
+			for (long cx = cx0; cx <= cx1; cx++) {
+				// Different cells can share a bucket, don't report the same points twice
+				int bucket = _pnlSpatialHashBucket(hash, cx, cy);
+				bool seen = false;
+				for (int i = 0; i < visitedCount && !seen; i++)
+					seen = visited[i] == bucket;
+				if (seen)
+					continue;
+				visited[visitedCount++] = bucket;
+
+				for (int i = hash->bucketStart[bucket]; i < hash->bucketStart[bucket + 1]; i++) {
+					int p = hash->sorted[i];
+					double dx = hash->xs[p] - x;
+					double dy = hash->ys[p] - y;
+					if ((dx * dx) + (dy * dy) <= r2)
+						hash->results[found++] = hash->ids[p];
+				}
+			}
+		}
+	}
+
+	if (found > 1)
+		qsort(hash->results, found, sizeof(int), _pnlCompareInts);
+	*results = hash->results;
+	return found;
+}
+
+void pnlSpatialHashFree(PNLSpatialHash hash) {
+	if (hash != NULL) {
+		free(hash->bucketStart);
+		free(hash->bucketOf);
+		free(hash->ids);
+		free(hash->xs);
+		free(hash->ys);
+		free(hash->sorted);
+		free(hash->results);
+		free(hash);
+	}
+}
@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "SpriteBatch.h"
+
+// Batches start with room for this many instances and double when full
+#define BATCH_INITIAL_CAPACITY ((int)256)
+
+// Distinct textures a flush has room for before doubling, there's only ever a handful
+#define BATCH_INITIAL_KEYS ((int)16)
+
+PNLSpriteBatch pnlSpriteBatchCreate() {
+	return calloc(1, sizeof(struct PNLSpriteBatch));
+}
+
+static PNLSpriteInstance *_pnlSpriteBatchAdd(PNLSpriteBatch batch, const vec4 colour) {
+	if (batch->count == batch->capacity) {
+		int capacity = batch->capacity == 0 ? BATCH_INITIAL_CAPACITY : batch->capacity * 2;
+		PNLSpriteInstance *instances = realloc(batch->instances, sizeof(PNLSpriteInstance) * capacity);
+		if (instances == NULL)
+			return NULL;
+		batch->instances = instances;
+		batch->capacity = capacity;
+	}
+	PNLSpriteInstance *instance = &batch->instances[batch->count];
+	memset(instance, 0, sizeof(PNLSpriteInstance));
+	memcpy(instance->colour, colour, sizeof(vec4));
+	instance->order = batch->count++;
+	return instance;
+}
+
+void pnlSpriteBatchTexture(PNLSpriteBatch batch, VK2DTexture tex, float x, float y, float xscale, float yscale, float rot, float originX, float originY, float xInTex, float yInTex, float texWidth, float texHeight, const vec4 colour) {
+	PNLSpriteInstance *instance = _pnlSpriteBatchAdd(batch, colour);
+	if (instance == NULL) { // Out of memory, draw it now rather than not at all
+		vk2dRendererSetColourMod((float*)colour);
+		vk2dRendererDrawTexture(tex, x, y, xscale, yscale, rot, originX, originY, xInTex, yInTex, texWidth, texHeight);
+		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		return;
+	}
+	instance->tex = tex;
+	instance->x = x;
+	instance->y = y;
+	instance->xscale = xscale;
+	instance->yscale = yscale;
+	instance->rot = rot;
+	instance->originX = originX;
+	instance->originY = originY;
+	instance->xInTex = xInTex;
+	instance->yInTex = yInTex;
+	instance->texWidth = texWidth;
+	instance->texHeight = texHeight;
+}
+
+void pnlSpriteBatchSprite(PNLSpriteBatch batch, JUSprite spr, float x, float y, const vec4 colour) {
+	PNLSpriteInstance *instance = _pnlSpriteBatchAdd(batch, colour);
+	if (instance == NULL) {
+		vk2dRendererSetColourMod((float*)colour);
+		juSpriteDraw(spr, x, y);
+		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		return;
+	}
+	instance->spr = spr;
+	instance->x = x;
+	instance->y = y;
+}
+
+static const void *_pnlSpriteInstanceKey(const PNLSpriteInstance *instance) {
+	return instance->tex != NULL ? (const void*)instance->tex : (const void*)instance->spr;
+}
+
+// Numbers every texture by when it was first queued this flush, so groups are drawn in the order
+// they first showed up rather than wherever their textures happen to live in memory
+static bool _pnlSpriteBatchGroup(PNLSpriteBatch batch) {
+	int keyCount = 0;
+	for (int i = 0; i < batch->count; i++) {
+		const void *key = _pnlSpriteInstanceKey(&batch->instances[i]);
+		int group = 0;
+		while (group < keyCount && batch->keys[group] != key)
+			group++;
+		if (group == keyCount) {
+			if (keyCount == batch->keyCapacity) {
+				int capacity = batch->keyCapacity == 0 ? BATCH_INITIAL_KEYS : batch->keyCapacity * 2;
+				const void **keys = realloc(batch->keys, sizeof(const void*) * capacity);
+				if (keys == NULL)
+					return false;
+				batch->keys = keys;
+				batch->keyCapacity = capacity;
+			}
+			batch->keys[keyCount++] = key;
+		}
+		batch->instances[i].group = group;
+	}
+	return true;
+}
+
+static int _pnlCompareInstances(const void *a, const void *b) {
+	const PNLSpriteInstance *x = a;
+	const PNLSpriteInstance *y = b;
+	if (x->group != y->group)
+		return (x->group > y->group) - (x->group < y->group);
+	return (x->order > y->order) - (x->order < y->order);
+}
+
+void pnlSpriteBatchFlush(PNLSpriteBatch batch) {
+	if (batch->count == 0)
+		return;
+
+	// Texture switches drawing everything in the order it was queued would have made
+	const void *lastKey = NULL;
+	for (int i = 0; i < batch->count; i++) {
+		if (_pnlSpriteInstanceKey(&batch->instances[i]) != lastKey) {
+			lastKey = _pnlSpriteInstanceKey(&batch->instances[i]);
+			batch->stats.immediateTextureSwitches++;
+		}
+	}
+
+	// Out of memory just draws them in the order they were queued
+	if (_pnlSpriteBatchGroup(batch))
+		qsort(batch->instances, batch->count, sizeof(PNLSpriteInstance), _pnlCompareInstances);
+
+	vec4 current;
+	memcpy(current, VK2D_DEFAULT_COLOUR_MOD, sizeof(vec4));
+	lastKey = NULL;
+	for (int i = 0; i < batch->count; i++) {
+		PNLSpriteInstance *instance = &batch->instances[i];
+		if (memcmp(current, instance->colour, sizeof(vec4)) != 0) {
+			memcpy(current, instance->colour, sizeof(vec4));
+			vk2dRendererSetColourMod(current);
+			batch->stats.stateChanges++;
+		}
+		if (memcmp(instance->colour, VK2D_DEFAULT_COLOUR_MOD, sizeof(vec4)) != 0)
+			batch->stats.immediateStateChanges += 2;
+		if (_pnlSpriteInstanceKey(instance) != lastKey) {
+			lastKey = _pnlSpriteInstanceKey(instance);
+			batch->stats.textureSwitches++;
+		}
+
+		// Vulkan2D has no instanced draw, so every instance is still its own submission
+		if (instance->tex != NULL)
+			vk2dRendererDrawTexture(instance->tex, instance->x, instance->y, instance->xscale, instance->yscale, instance->rot, instance->originX, instance->originY, instance->xInTex, instance->yInTex, instance->texWidth, instance->texHeight);
+		else
+			juSpriteDraw(instance->spr, instance->x, instance->y);
+		batch->stats.draws++;
+	}
+	if (memcmp(current, VK2D_DEFAULT_COLOUR_MOD, sizeof(vec4)) != 0) {
+		vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
+		batch->stats.stateChanges++;
+	}
+
+	batch->stats.instances += batch->count;
+	batch->count = 0;
+}
+
+void pnlSpriteBatchEndFrame(PNLSpriteBatch batch) {
+	batch->stats.frames++;
+}
+
+void pnlSpriteBatchFree(PNLSpriteBatch batch) {
+	if (batch != NULL) {
+		free(batch->instances);
+		free(batch->keys);
+		free(batch);
+	}
+}
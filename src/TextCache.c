@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "TextCache.h"
+
+PNLTextCache pnlTextCacheCreate(int capacity) {
+	PNLTextCache cache = calloc(1, sizeof(struct PNLTextCache));
+	if (cache == NULL)
+		return NULL;
+	cache->runs = calloc(capacity, sizeof(PNLTextRun));
+	if (cache->runs == NULL) {
+		free(cache);
+		return NULL;
+	}
+	cache->capacity = capacity;
+	return cache;
+}
+
+static double _pnlSeconds(Uint64 start) {
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+// FNV-1a over the string then the font pointer
+static unsigned long _pnlTextHash(JUFont font, const char *text) {
+	unsigned long hash = 2166136261ul;
+	for (const char *c = text; *c != 0; c++)
+		hash = (hash ^ (unsigned char)*c) * 16777619ul;
+	return (hash ^ (unsigned long)(size_t)font) * 16777619ul;
+}
+
+// Same rules as juFontDraw - characters outside the font are skipped and \n starts a new line
+static bool _pnlTextLayout(PNLTextRun *run, JUFont font, const char *text, int length) {
+	PNLTextQuad *quads = realloc(run->quads, sizeof(PNLTextQuad) * (length > 0 ? length : 1));
+	char *copy = malloc(length + 1);
+	if (quads == NULL || copy == NULL) {
+		run->quads = quads;
+		free(copy);
+		return false;
+	}
+	run->quads = quads;
+	free(run->text);
+	run->text = copy;
+	memcpy(run->text, text, length + 1);
+	run->font = font;
+	run->quadCount = 0;
+
+	float x = 0;
+	float y = 0;
+	for (int i = 0; i < length; i++) {
+		uint32_t c = (unsigned char)text[i];
+		if (c == '\n') {
+			x = 0;
+			y += font->newLineHeight;
+		} else if (c >= font->unicodeStart && c < font->unicodeEnd) {
+			JUCharacter *character = &font->characters[c - font->unicodeStart];
+			if (character->drawn) {
+				PNLTextQuad *quad = &run->quads[run->quadCount++];
+				quad->x = x;
+				quad->y = y + character->ykern;
+				quad->u = character->x;
+				quad->v = character->y;
+				quad->w = character->w;
+				quad->h = character->h;
+			}
+			x += character->w;
+		}
+	}
+	return true;
+}
+
+static PNLTextRun *_pnlTextCacheFind(PNLTextCache cache, JUFont font, const char *text, unsigned long hash) {
+	for (int i = 0; i < cache->capacity; i++) {
+		PNLTextRun *run = &cache->runs[i];
+		if (run->hash == hash && run->font == font && run->text != NULL && strcmp(run->text, text) == 0)
+			return run;
+	}
+	return NULL;
+}
+
+static PNLTextRun *_pnlTextCacheOldest(PNLTextCache cache) {
+	PNLTextRun *oldest = &cache->runs[0];
+	for (int i = 1; i < cache->capacity && oldest->text != NULL; i++)
+		if (cache->runs[i].text == NULL || cache->runs[i].lastUsed < oldest->lastUsed)
+			oldest = &cache->runs[i];
+	return oldest;
+}
+
+void pnlTextDraw(PNLTextCache cache, JUFont font, float x, float y, const char *fmt, ...) {
+	char text[TEXT_MAX_LENGTH];
+	Uint64 start = SDL_GetPerformanceCounter();
+	va_list list;
+	va_start(list, fmt);
+	int length = vsnprintf(text, TEXT_MAX_LENGTH, fmt, list);
+	va_end(list);
+	if (length < 0)
+		return;
+	length = length >= TEXT_MAX_LENGTH ? TEXT_MAX_LENGTH - 1 : length;
+	unsigned long hash = _pnlTextHash(font, text);
+	PNLTextRun *run = _pnlTextCacheFind(cache, font, text, hash);
+	cache->frameStats.formatTime += _pnlSeconds(start);
+	cache->frameStats.draws++;
+
+	if (run != NULL) {
+		cache->frameStats.hits++;
+	} else {
+		start = SDL_GetPerformanceCounter();
+		run = _pnlTextCacheOldest(cache);
+		run->hash = 0;
+		if (!_pnlTextLayout(run, font, text, length)) {
+			juFontDraw(font, x, y, "%s", text);
+			return;
+		}
+		run->hash = hash;
+		cache->frameStats.layoutTime += _pnlSeconds(start);
+	}
+
+	run->lastUsed = cache->frame;
+	for (int i = 0; i < run->quadCount; i++) {
+		PNLTextQuad *quad = &run->quads[i];
+		vk2dRendererDrawTexture(font->bitmap, x + quad->x, y + quad->y, 1, 1, 0, 0, 0, quad->u, quad->v, quad->w, quad->h);
+	}
+}
+
+void pnlTextCacheEndFrame(PNLTextCache cache) {
+	cache->lastFrame = cache->frameStats;
+	cache->total.draws += cache->frameStats.draws;
+	cache->total.hits += cache->frameStats.hits;
+	cache->total.formatTime += cache->frameStats.formatTime;
+	cache->total.layoutTime += cache->frameStats.layoutTime;
+	memset(&cache->frameStats, 0, sizeof(PNLTextCacheStats));
+	cache->frame++;
+}
+
+void pnlTextCacheFree(PNLTextCache cache) {
+	if (cache != NULL) {
+		for (int i = 0; i < cache->capacity; i++) {
+			free(cache->runs[i].text);
+			free(cache->runs[i].quads);
+		}
+		free(cache->runs);
+		free(cache);
+	}
+}